@@ -45,30 +45,424 @@
  *****************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
 #include <string.h>
+#include <time.h>
 #include "qat_utils.h"
 #include "cmn_mem_drv_inf.h"
 #include "qae_mem.h"
 
 #define unlikely(x) __builtin_expect (!!(x), 0)
 
+/*
+ * Every buffer handed out by this allocator is preceded by a header of
+ * QAT_BYTE_ALIGNMENT bytes so that the returned pointer keeps the alignment
+ * requested from USDM. The header records the size class of the buffer,
+ * which allows freed buffers to be parked in a thread local cache and
+ * reused without taking mem_mutex.
+ *
+ * Size classes are powers of two from 64 bytes up to 32KB. Requests bigger
+ * than the largest class bypass the cache and go straight to USDM.
+ */
+#define QAE_CACHE_HDR_SIZE       QAT_BYTE_ALIGNMENT
+#define QAE_CACHE_MIN_SHIFT      6
+#define QAE_CACHE_NUM_CLASSES    10
+#define QAE_CACHE_MAX_CLASS_SIZE \
+    (1UL << (QAE_CACHE_MIN_SHIFT + QAE_CACHE_NUM_CLASSES - 1))
+#define QAE_CACHE_NO_CLASS       -1
+#define QAE_CACHE_SIG_ALLOC      0xA1A2A3A4
+#define QAE_CACHE_SIG_FREE       0xF1F2F3F4
+
+/*
+ * Statistics are kept for each size class plus one extra entry for the
+ * allocations that are too big for any class.
+ */
+#define QAE_STATS_NUM_CLASSES    (QAE_CACHE_NUM_CLASSES + 1)
+#define QAE_STATS_BIG_CLASS      QAE_CACHE_NUM_CLASSES
+
+/* number of distinct call sites that can be tracked */
+#define QAE_MAX_CALL_SITES       256
+#define QAE_NO_CALL_SITE         -1
+
+typedef struct _qae_cache_hdr {
+    struct _qae_cache_hdr *next;
+    int sig;
+    int class_index;
+    int site_index;
+    size_t size;
+} qae_cache_hdr;
+
+typedef struct {
+    unsigned long live_allocs;
+    unsigned long live_bytes;
+    unsigned long peak_live_bytes;
+} qae_class_stats;
+
+typedef struct {
+    const char *file;
+    int line;
+    unsigned long live_allocs;
+    unsigned long live_bytes;
+} qae_call_site;
+
+/*
+ * The lock of a cache is only contended when another thread flushes every
+ * cache, e.g. before a fork, so taking it on the fast path stays cheap.
+ */
+typedef struct _qae_thread_cache {
+    pthread_mutex_t lock;
+    qae_cache_hdr *free_list[QAE_CACHE_NUM_CLASSES];
+    size_t cached_bytes;
+    struct _qae_thread_cache *prev;
+    struct _qae_thread_cache *next;
+} qae_thread_cache;
+
 static pthread_mutex_t mem_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int crypto_inited = 0;
 
+static pthread_key_t qae_cache_key;
+static pthread_once_t qae_cache_key_once = PTHREAD_ONCE_INIT;
+static int qae_cache_key_created = 0;
+/* Read and written with __atomic builtins as any thread may change it */
+static size_t qae_cache_max_bytes = QAE_CACHE_DEFAULT_MAX_BYTES;
+
+/* Every thread cache, so that all of them can be flushed before a fork */
+static pthread_mutex_t qae_cache_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static qae_thread_cache *qae_cache_list = NULL;
+
+/*
+ * The statistics are updated with atomic operations so that the thread local
+ * cache fast path does not need to take any lock.
+ */
+static qae_class_stats class_stats[QAE_STATS_NUM_CLASSES];
+static unsigned long live_bytes_total = 0;
+static unsigned long peak_live_bytes_total = 0;
+static unsigned long long total_allocs = 0;
+static unsigned long long total_frees = 0;
+static unsigned long long failed_allocs = 0;
+
+/*
+ * Call sites are only looked up once enabled as the lookup hashes into a
+ * table shared by all the threads. Read with __atomic builtins.
+ */
+static int call_site_stats_enabled = 0;
+static pthread_mutex_t call_site_mutex = PTHREAD_MUTEX_INITIALIZER;
+static qae_call_site call_sites[QAE_MAX_CALL_SITES];
+
+static void qae_cache_destructor(void *thread_key);
+
+static void qae_cache_make_key(void)
+{
+    int rc;
+
+    if ((rc = pthread_key_create(&qae_cache_key, qae_cache_destructor)) != 0) {
+        MEM_WARN("pthread_key_create: %s\n", strerror(rc));
+        return;
+    }
+    qae_cache_key_created = 1;
+}
 
 static void crypto_init(void)
 {
     MEM_WARN("Memory Driver Warnings Enabled.\n");
     MEM_DEBUG("Memory Driver Debug Enabled.\n");
 
+    pthread_once(&qae_cache_key_once, qae_cache_make_key);
     crypto_inited = 1;
 }
 
+/* map a requested size onto the smallest size class that can hold it */
+static inline int qae_cache_class_index(size_t memsize)
+{
+    int i;
+    size_t class_size = 1UL << QAE_CACHE_MIN_SHIFT;
+
+    if (memsize > QAE_CACHE_MAX_CLASS_SIZE)
+        return QAE_CACHE_NO_CLASS;
+
+    for (i = 0; class_size < memsize; i++)
+        class_size <<= 1;
+    return i;
+}
+
+static inline size_t qae_cache_class_size(int class_index)
+{
+    return 1UL << (QAE_CACHE_MIN_SHIFT + class_index);
+}
+
+static inline void qae_stats_update_peak(unsigned long *peak,
+                                         unsigned long value)
+{
+    unsigned long old = *peak;
+
+    while (value > old) {
+        if (__sync_bool_compare_and_swap(peak, old, value))
+            break;
+        old = *peak;
+    }
+}
+
+/******************************************************************************
+* function:
+*         qae_call_site_index(const char *file, int line)
+*
+* @param file [IN] - the C source filename of the call site
+* @param line [IN] - the line number within the C source file
+*
+* description:
+*   Look up the entry of a call site in the call site table, adding it on the
+*   first allocation from that site. Lookups do not take a lock as entries are
+*   never removed once they have been published.
+*
+* @retval index of the entry, QAE_NO_CALL_SITE if the table is full
+******************************************************************************/
+static int qae_call_site_index(const char *file, int line)
+{
+    int i, n, rc;
+    int index = QAE_NO_CALL_SITE;
+    unsigned int start;
+
+    if (unlikely(file == NULL))
+        return QAE_NO_CALL_SITE;
+
+    start = (unsigned int)(((uintptr_t)file >> 4) ^ (unsigned int)line) %
+            QAE_MAX_CALL_SITES;
+
+    for (n = 0; n < QAE_MAX_CALL_SITES; n++) {
+        i = (start + n) % QAE_MAX_CALL_SITES;
+        if (call_sites[i].file == NULL)
+            break;
+        if (call_sites[i].file == file && call_sites[i].line == line)
+            return i;
+    }
+    if (n == QAE_MAX_CALL_SITES)
+        return QAE_NO_CALL_SITE;
+
+    if ((rc = pthread_mutex_lock(&call_site_mutex)) != 0) {
+        MEM_WARN("pthread_mutex_lock: %s\n", strerror(rc));
+        return QAE_NO_CALL_SITE;
+    }
+    for (; n < QAE_MAX_CALL_SITES; n++) {
+        i = (start + n) % QAE_MAX_CALL_SITES;
+        if (call_sites[i].file == NULL) {
+            call_sites[i].line = line;
+            __sync_synchronize();
+            call_sites[i].file = file;
+            index = i;
+            break;
+        }
+        if (call_sites[i].file == file && call_sites[i].line == line) {
+            index = i;
+            break;
+        }
+    }
+    if ((rc = pthread_mutex_unlock(&call_site_mutex)) != 0) {
+        MEM_WARN("pthread_mutex_unlock: %s\n", strerror(rc));
+    }
+    return index;
+}
+
+static void qae_stats_on_alloc(qae_cache_hdr *hdr, const char *file, int line)
+{
+    int class_index = hdr->class_index == QAE_CACHE_NO_CLASS ?
+                      QAE_STATS_BIG_CLASS : hdr->class_index;
+    qae_class_stats *cs = &class_stats[class_index];
+
+    __sync_add_and_fetch(&total_allocs, 1);
+    __sync_add_and_fetch(&cs->live_allocs, 1);
+    qae_stats_update_peak(&cs->peak_live_bytes,
+                          __sync_add_and_fetch(&cs->live_bytes, hdr->size));
+    qae_stats_update_peak(&peak_live_bytes_total,
+                          __sync_add_and_fetch(&live_bytes_total, hdr->size));
+
+    hdr->site_index = QAE_NO_CALL_SITE;
+    if (__atomic_load_n(&call_site_stats_enabled, __ATOMIC_RELAXED))
+        hdr->site_index = qae_call_site_index(file, line);
+    if (hdr->site_index != QAE_NO_CALL_SITE) {
+        __sync_add_and_fetch(&call_sites[hdr->site_index].live_allocs, 1);
+        __sync_add_and_fetch(&call_sites[hdr->site_index].live_bytes,
+                             hdr->size);
+    }
+}
+
+static void qae_stats_on_free(qae_cache_hdr *hdr)
+{
+    int class_index = hdr->class_index == QAE_CACHE_NO_CLASS ?
+                      QAE_STATS_BIG_CLASS : hdr->class_index;
+    qae_class_stats *cs = &class_stats[class_index];
+
+    __sync_add_and_fetch(&total_frees, 1);
+    __sync_sub_and_fetch(&cs->live_allocs, 1);
+    __sync_sub_and_fetch(&cs->live_bytes, hdr->size);
+    __sync_sub_and_fetch(&live_bytes_total, hdr->size);
+
+    if (hdr->site_index != QAE_NO_CALL_SITE) {
+        __sync_sub_and_fetch(&call_sites[hdr->site_index].live_allocs, 1);
+        __sync_sub_and_fetch(&call_sites[hdr->site_index].live_bytes,
+                             hdr->size);
+    }
+}
+
+static inline size_t qae_cache_get_max_bytes(void)
+{
+    return __atomic_load_n(&qae_cache_max_bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * Return the calling thread's cache. It is only created when asked for and
+ * caching is enabled, but an existing cache is returned even when caching
+ * has been disabled so that it can be drained.
+ */
+static qae_thread_cache *qae_cache_get(int create)
+{
+    qae_thread_cache *cache;
+
+    if (unlikely(!qae_cache_key_created))
+        return NULL;
+
+    cache = (qae_thread_cache *)pthread_getspecific(qae_cache_key);
+    if (cache != NULL || !create || qae_cache_get_max_bytes() == 0)
+        return cache;
+
+    cache = calloc(1, sizeof(qae_thread_cache));
+    if (cache == NULL)
+        return NULL;
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache);
+        return NULL;
+    }
+    if (pthread_setspecific(qae_cache_key, (void *)cache) != 0) {
+        pthread_mutex_destroy(&cache->lock);
+        free(cache);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&qae_cache_list_mutex);
+    cache->next = qae_cache_list;
+    if (qae_cache_list != NULL)
+        qae_cache_list->prev = cache;
+    qae_cache_list = cache;
+    pthread_mutex_unlock(&qae_cache_list_mutex);
+    return cache;
+}
+
+/* return a header to USDM, the caller must hold mem_mutex */
+static inline void qae_cache_release(qae_cache_hdr *hdr)
+{
+    void *ptr = (void *)hdr;
+
+    hdr->sig = 0;
+    qaeMemFreeNUMA(&ptr);
+}
+
+/******************************************************************************
+* function:
+*         qae_cache_flush(qae_thread_cache *cache)
+*
+* @param cache [IN] - thread local cache to empty
+*
+* description:
+*   Hand every buffer held in the cache back to USDM, taking mem_mutex only
+*   once for the whole batch. The cache may belong to another thread.
+*
+******************************************************************************/
+static void qae_cache_flush(qae_thread_cache *cache)
+{
+    int i, rc;
+    qae_cache_hdr *hdr, *next;
+    qae_cache_hdr *free_list[QAE_CACHE_NUM_CLASSES];
+
+    if (cache == NULL)
+        return;
+
+    pthread_mutex_lock(&cache->lock);
+    if (cache->cached_bytes == 0) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+    for (i = 0; i < QAE_CACHE_NUM_CLASSES; i++) {
+        free_list[i] = cache->free_list[i];
+        cache->free_list[i] = NULL;
+    }
+    cache->cached_bytes = 0;
+    pthread_mutex_unlock(&cache->lock);
+
+    MEM_DEBUG("pthread_mutex_lock\n");
+    if ((rc = pthread_mutex_lock(&mem_mutex)) != 0) {
+        MEM_WARN("pthread_mutex_lock: %s\n", strerror(rc));
+        return;
+    }
+
+    for (i = 0; i < QAE_CACHE_NUM_CLASSES; i++) {
+        for (hdr = free_list[i]; hdr != NULL; hdr = next) {
+            next = hdr->next;
+            qae_cache_release(hdr);
+        }
+    }
+
+    if ((rc = pthread_mutex_unlock(&mem_mutex)) != 0) {
+        MEM_WARN("pthread_mutex_unlock: %s\n", strerror(rc));
+    }
+    MEM_DEBUG("pthread_mutex_unlock\n");
+}
+
+static void qae_cache_destructor(void *thread_key)
+{
+    qae_thread_cache *cache = (qae_thread_cache *)thread_key;
+
+    pthread_mutex_lock(&qae_cache_list_mutex);
+    if (cache->prev != NULL)
+        cache->prev->next = cache->next;
+    else
+        qae_cache_list = cache->next;
+    if (cache->next != NULL)
+        cache->next->prev = cache->prev;
+    pthread_mutex_unlock(&qae_cache_list_mutex);
+
+    qae_cache_flush(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+void qaeCryptoMemCacheFlush(void)
+{
+    qae_thread_cache *cache;
+
+    if (!crypto_inited)
+        return;
+
+    pthread_mutex_lock(&qae_cache_list_mutex);
+    for (cache = qae_cache_list; cache != NULL; cache = cache->next)
+        qae_cache_flush(cache);
+    pthread_mutex_unlock(&qae_cache_list_mutex);
+}
+
+int qaeCryptoMemSetCacheMaxBytes(size_t max_bytes)
+{
+    if (!crypto_inited)
+        crypto_init();
+
+    __atomic_store_n(&qae_cache_max_bytes, max_bytes, __ATOMIC_RELAXED);
+    /* Empty the calling thread's cache. The other threads drain theirs on
+     * their next allocation or free if they are above the new budget. */
+    qae_cache_flush(qae_cache_get(0));
+    return 1;
+}
+
+int qaeCryptoMemEnableCallSiteStats(void)
+{
+    __atomic_store_n(&call_site_stats_enabled, 1, __ATOMIC_RELAXED);
+    return 1;
+}
 
 void qaeCryptoMemFree(void *ptr)
 {
     int rc;
+    int drain;
+    size_t class_size, max_bytes;
+    qae_cache_hdr *hdr;
+    qae_thread_cache *cache;
 
     MEM_DEBUG("Address: %p\n", ptr);
 
@@ -77,13 +471,41 @@ void qaeCryptoMemFree(void *ptr)
         return;
     }
 
+    hdr = (qae_cache_hdr *)((unsigned char *)ptr - QAE_CACHE_HDR_SIZE);
+    if (unlikely(hdr->sig != QAE_CACHE_SIG_ALLOC)) {
+        MEM_WARN("error trying to free buffer that hasn't been alloc'd %p\n",
+                 ptr);
+        return;
+    }
+    qae_stats_on_free(hdr);
+
+    if (hdr->class_index != QAE_CACHE_NO_CLASS &&
+        (cache = qae_cache_get(1)) != NULL) {
+        class_size = qae_cache_class_size(hdr->class_index);
+        max_bytes = qae_cache_get_max_bytes();
+        pthread_mutex_lock(&cache->lock);
+        if (cache->cached_bytes + class_size <= max_bytes) {
+            hdr->sig = QAE_CACHE_SIG_FREE;
+            hdr->next = cache->free_list[hdr->class_index];
+            cache->free_list[hdr->class_index] = hdr;
+            cache->cached_bytes += class_size;
+            pthread_mutex_unlock(&cache->lock);
+            return;
+        }
+        drain = cache->cached_bytes > max_bytes;
+        pthread_mutex_unlock(&cache->lock);
+        /* The budget has been lowered since the buffers were cached */
+        if (drain)
+            qae_cache_flush(cache);
+    }
+
     MEM_DEBUG("pthread_mutex_lock\n");
     if ((rc = pthread_mutex_lock(&mem_mutex)) != 0) {
         MEM_WARN("pthread_mutex_lock: %s\n", strerror(rc));
         return;
     }
 
-    qaeMemFreeNUMA(&ptr);
+    qae_cache_release(hdr);
 
     if ((rc = pthread_mutex_unlock(&mem_mutex)) != 0) {
         MEM_WARN("pthread_mutex_unlock: %s\n", strerror(rc));
@@ -96,25 +518,136 @@ void *qaeCryptoMemAlloc(size_t memsize, const char *file, int line)
 {
     /* Input params should already have been sanity-checked by calling function. */
     int rc;
-    void *pAddress = NULL;
+    int drain;
+    int class_index;
+    size_t alloc_size;
+    qae_cache_hdr *hdr = NULL;
+    qae_thread_cache *cache;
 
     if (!crypto_inited)
         crypto_init();
 
+    class_index = qae_cache_class_index(memsize);
+    if (class_index != QAE_CACHE_NO_CLASS) {
+        alloc_size = qae_cache_class_size(class_index);
+        cache = qae_cache_get(0);
+        if (cache != NULL) {
+            pthread_mutex_lock(&cache->lock);
+            /* Drain the cache when the budget has been lowered below what
+             * it holds, rather than serving from it */
+            drain = cache->cached_bytes > qae_cache_get_max_bytes();
+            if (!drain && cache->free_list[class_index] != NULL) {
+                hdr = cache->free_list[class_index];
+                cache->free_list[class_index] = hdr->next;
+                cache->cached_bytes -= alloc_size;
+            }
+            pthread_mutex_unlock(&cache->lock);
+            if (hdr != NULL)
+                goto done;
+            if (drain)
+                qae_cache_flush(cache);
+        }
+    } else {
+        alloc_size = memsize;
+    }
+
     MEM_DEBUG("pthread_mutex_lock\n");
     if ((rc = pthread_mutex_lock(&mem_mutex)) != 0) {
         MEM_WARN("pthread_mutex_lock: %s\n", strerror(rc));
         return NULL;
     }
 
-    pAddress = qaeMemAllocNUMA(memsize, NUMA_ANY_NODE, QAT_BYTE_ALIGNMENT);
-    MEM_DEBUG("Address: %p Size: %zd File: %s:%d\n", pAddress,
-          memsize, file, line);
+    hdr = qaeMemAllocNUMA(alloc_size + QAE_CACHE_HDR_SIZE, NUMA_ANY_NODE,
+                          QAT_BYTE_ALIGNMENT);
+
     if ((rc = pthread_mutex_unlock(&mem_mutex)) != 0) {
         MEM_WARN("pthread_mutex_unlock: %s\n", strerror(rc));
     }
     MEM_DEBUG("pthread_mutex_unlock\n");
-    return pAddress;
+
+    if (hdr == NULL) {
+        MEM_WARN("qaeMemAllocNUMA failed for size %zd\n", memsize);
+        __sync_add_and_fetch(&failed_allocs, 1);
+        return NULL;
+    }
+    hdr->class_index = class_index;
+    hdr->size = alloc_size;
+
+ done:
+    hdr->next = NULL;
+    hdr->sig = QAE_CACHE_SIG_ALLOC;
+    qae_stats_on_alloc(hdr, file, line);
+    MEM_DEBUG("Address: %p Size: %zd File: %s:%d\n",
+              (unsigned char *)hdr + QAE_CACHE_HDR_SIZE, memsize, file, line);
+    return (void *)((unsigned char *)hdr + QAE_CACHE_HDR_SIZE);
+}
+
+/* order call sites by decreasing live bytes */
+static int call_site_cmp(const void *a, const void *b)
+{
+    const qae_mem_call_site_stats *sa = a;
+    const qae_mem_call_site_stats *sb = b;
+
+    if (sa->live_bytes == sb->live_bytes)
+        return 0;
+    return sa->live_bytes < sb->live_bytes ? 1 : -1;
+}
+
+int qaeCryptoMemGetStats(qae_mem_stats *stats)
+{
+    struct timespec ts = { 0 };
+    qae_mem_call_site_stats *sites = NULL;
+    unsigned int num_sites = 0;
+    int i;
+
+    if (unlikely(stats == NULL)) {
+        MEM_WARN("NULL stats pointer passed to function\n");
+        return 0;
+    }
+
+    memset(stats, 0, sizeof(qae_mem_stats));
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    stats->timestamp_ns = (unsigned long long)ts.tv_sec * 1000000000ULL +
+                          ts.tv_nsec;
+
+    /* USDM manages its own pages so there are no slab counts to report */
+    stats->total_allocs = total_allocs;
+    stats->total_frees = total_frees;
+    stats->failed_allocs = failed_allocs;
+    stats->live_bytes = live_bytes_total;
+    stats->peak_live_bytes = peak_live_bytes_total;
+    stats->num_classes = QAE_STATS_NUM_CLASSES;
+    for (i = 0; i < QAE_STATS_NUM_CLASSES; i++) {
+        stats->classes[i].slot_size = i == QAE_STATS_BIG_CLASS ?
+                                      0 : qae_cache_class_size(i);
+        stats->classes[i].live_allocs = class_stats[i].live_allocs;
+        stats->classes[i].live_bytes = class_stats[i].live_bytes;
+        stats->classes[i].peak_live_bytes = class_stats[i].peak_live_bytes;
+    }
+
+    sites = calloc(QAE_MAX_CALL_SITES, sizeof(qae_mem_call_site_stats));
+    if (sites == NULL) {
+        MEM_WARN("Failed to allocate call site table\n");
+        return 0;
+    }
+    for (i = 0; i < QAE_MAX_CALL_SITES; i++) {
+        if (call_sites[i].file == NULL || call_sites[i].live_allocs == 0)
+            continue;
+        strncpy(sites[num_sites].file, call_sites[i].file,
+                QAE_MEM_STATS_FILE_NAME_LEN - 1);
+        sites[num_sites].line = call_sites[i].line;
+        sites[num_sites].live_allocs = call_sites[i].live_allocs;
+        sites[num_sites].live_bytes = call_sites[i].live_bytes;
+        num_sites++;
+    }
+
+    qsort(sites, num_sites, sizeof(qae_mem_call_site_stats), call_site_cmp);
+    stats->num_call_sites = num_sites < QAE_MEM_STATS_MAX_CALL_SITES ?
+                            num_sites : QAE_MEM_STATS_MAX_CALL_SITES;
+    memcpy(stats->call_sites, sites,
+           stats->num_call_sites * sizeof(qae_mem_call_site_stats));
+    free(sites);
+    return 1;
 }
 
 void *qaeCryptoMemRealloc(void *ptr, size_t memsize, const char *file,
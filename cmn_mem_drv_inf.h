@@ -50,6 +50,7 @@
 # include <stdio.h>
 # include <pthread.h>
 # include "cpa.h"
+# include "qae_mem_stats.h"
 
 extern FILE* qatDebugLogFile;
 
@@ -82,6 +83,12 @@ extern FILE* qatDebugLogFile;
 # define MEM_WARN(...)
 #endif
 
+/*
+ * Default upper bound, in bytes, on the amount of freed pinned memory each
+ * thread keeps in its local cache for reuse.
+ */
+# define QAE_CACHE_DEFAULT_MAX_BYTES (256 * 1024)
+
 void qaeCryptoMemFree(void *ptr);
 void *qaeCryptoMemAlloc(size_t memsize, const char *file, int line);
 void *qaeCryptoMemRealloc(void *ptr, size_t memsize, const char *file,
@@ -97,4 +104,46 @@ void *copyAllocPinnedMemoryClean(void *ptr, size_t size, size_t original_size,
                                  const char *file, int line);
 int copyFreePinnedMemory(void *uptr, void *kptr, int size);
 
+/*****************************************************************************
+ * function:
+ *         qaeCryptoMemCacheFlush(void)
+ *
+ * @description
+ *      Return all the buffers held in the caches of freed pinned memory of
+ *      every thread to the USDM component.
+ *
+ *****************************************************************************/
+void qaeCryptoMemCacheFlush(void);
+
+/*****************************************************************************
+ * function:
+ *         qaeCryptoMemSetCacheMaxBytes(size_t max_bytes)
+ *
+ * @description
+ *      Set the maximum number of bytes of freed pinned memory each thread may
+ *      keep cached. A value of 0 disables the thread local cache. The calling
+ *      thread's cache is emptied, the other threads empty theirs on their
+ *      next allocation or free if they hold more than the new budget.
+ *
+ * @param[in] max_bytes, the per-thread cache budget in bytes
+ *
+ * @retval 1 on success
+ *
+ *****************************************************************************/
+int qaeCryptoMemSetCacheMaxBytes(size_t max_bytes);
+
+/*****************************************************************************
+ * function:
+ *         qaeCryptoMemEnableCallSiteStats(void)
+ *
+ * @description
+ *      Start attributing allocations to their call site so that they are
+ *      reported by qaeCryptoMemGetStats(). Allocations made before this call
+ *      are not attributed to any call site.
+ *
+ * @retval 1 on success
+ *
+ *****************************************************************************/
+int qaeCryptoMemEnableCallSiteStats(void);
+
 #endif                          /* CMN_MEM_DRV_INF_H */
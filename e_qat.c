@@ -78,6 +78,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include <time.h>
+#include <limits.h>
 
 /* Local Includes */
 #include "e_qat.h"
@@ -93,6 +94,7 @@
 #include "qat_utils.h"
 #include "e_qat_err.h"
 #include "qat_prf.h"
+#include "qat_asym_common.h"
 
 /* OpenSSL Includes */
 #include <openssl/err.h>
@@ -111,6 +113,7 @@
 #endif
 #include "cpa.h"
 #include "cpa_cy_im.h"
+#include "cpa_cy_sym.h"
 #include "cpa_cy_common.h"
 #include "cpa_types.h"
 #include "icp_sal_user.h"
@@ -118,6 +121,7 @@
 #include "qat_parseconf.h"
 
 #define QAT_MAX_INPUT_STRING_LENGTH 1024
+#define QAT_MAX_USDM_THREAD_CACHE_SIZE (64 * 1024 * 1024)
 
 /* Qat engine id declaration */
 const char *engine_qat_id = "qat";
@@ -141,6 +145,12 @@ int enable_heuristic_polling = 0;
 int enable_instance_for_thread = 0;
 int enable_sw_fallback = 0;
 int disable_qat_offload = 0;
+int enable_hw_lenstra_check = 0;
+int enable_asym_auto_tune = 0;
+/* Set at init if every instance can multiply Montgomery and Edwards points */
+int qat_ecx_offload_supported = 0;
+/* Set at init if every instance can run ChaCha20-Poly1305 */
+int qat_chacha_poly_offload_supported = 0;
 pthread_mutex_t qat_instance_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t qat_engine_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -362,6 +372,17 @@ thread_local_variables_t * qat_check_create_local_variables(void)
     return tlv;
 }
 
+BN_CTX *qat_get_local_bn_ctx(void)
+{
+    thread_local_variables_t *tlv = qat_check_create_local_variables();
+
+    if (unlikely(tlv == NULL))
+        return NULL;
+    if (tlv->localBnCtx == NULL)
+        tlv->localBnCtx = BN_CTX_new();
+    return tlv->localBnCtx;
+}
+
 
 /******************************************************************************
  * function:
@@ -375,8 +396,10 @@ thread_local_variables_t * qat_check_create_local_variables(void)
  *****************************************************************************/
 static void qat_local_variable_destructor(void *tlv)
 {
-    if (tlv)
+    if (tlv) {
+       BN_CTX_free(((thread_local_variables_t *)tlv)->localBnCtx);
        OPENSSL_free(tlv);
+    }
     pthread_setspecific(thread_local_variables, NULL);
 }
 
@@ -571,6 +594,13 @@ int qat_engine_init(ENGINE *e)
         }
     }
 
+#ifdef QAT_ECX_ENABLED
+    qat_ecx_offload_supported = 1;
+#endif
+#ifdef QAT_CHACHA_POLY_ENABLED
+    qat_chacha_poly_offload_supported = 1;
+#endif
+
     /* Set translation function and start each instance */
     for (instNum = 0; instNum < qat_num_instances; instNum++) {
         /* Retrieve CpaInstanceInfo2 structure for that instance */
@@ -614,6 +644,38 @@ int qat_engine_init(ENGINE *e)
         qat_instance_details[instNum].qat_instance_started = 1;
         DEBUG("Started Instance No: %d Located on Device: %d\n", instNum, package_id);
 
+#ifdef QAT_ECX_ENABLED
+        {
+            CpaCyCapabilitiesInfo cap;
+
+            /* Devices without it keep X25519, X448, Ed25519 and Ed448
+             * in software */
+            if (cpaCyQueryCapabilities(qat_instance_handles[instNum], &cap)
+                != CPA_STATUS_SUCCESS || cap.ecEdMontSupported != CPA_TRUE) {
+                DEBUG("Instance No: %d cannot offload Montgomery and Edwards curves\n",
+                      instNum);
+                qat_ecx_offload_supported = 0;
+            }
+        }
+#endif
+
+#ifdef QAT_CHACHA_POLY_ENABLED
+        {
+            CpaCySymCapabilitiesInfo sym_cap;
+
+            /* Devices without it keep ChaCha20-Poly1305 in software */
+            if (cpaCySymQueryCapabilities(qat_instance_handles[instNum],
+                                          &sym_cap) != CPA_STATUS_SUCCESS ||
+                !CPA_BITMAP_BIT_TEST(sym_cap.ciphers,
+                                     CPA_CY_SYM_CIPHER_CHACHA) ||
+                !CPA_BITMAP_BIT_TEST(sym_cap.hashes, CPA_CY_SYM_HASH_POLY)) {
+                DEBUG("Instance No: %d cannot offload ChaCha20-Poly1305\n",
+                      instNum);
+                qat_chacha_poly_offload_supported = 0;
+            }
+        }
+#endif
+
 #ifdef OPENSSL_ENABLE_QAT_UPSTREAM_DRIVER
         if (enable_sw_fallback) {
             DEBUG("cpaCyInstanceSetNotificationCb instNum = %d\n", instNum);
@@ -691,6 +753,21 @@ int qat_engine_init(ENGINE *e)
 #define QAT_CMD_ENABLE_SW_FALLBACK (ENGINE_CMD_BASE + 17)
 #define QAT_CMD_HEARTBEAT_POLL (ENGINE_CMD_BASE + 18)
 #define QAT_CMD_DISABLE_QAT_OFFLOAD (ENGINE_CMD_BASE + 19)
+#define QAT_CMD_SET_USDM_THREAD_CACHE_SIZE (ENGINE_CMD_BASE + 20)
+#define QAT_CMD_GET_MEM_STATS (ENGINE_CMD_BASE + 21)
+#define QAT_CMD_ENABLE_HW_LENSTRA_CHECK (ENGINE_CMD_BASE + 22)
+#define QAT_CMD_RSA_SIGN_BATCH (ENGINE_CMD_BASE + 23)
+#define QAT_CMD_SET_ASYM_OFFLOAD_THRESHOLD (ENGINE_CMD_BASE + 24)
+#define QAT_CMD_ENABLE_ASYM_AUTO_TUNE (ENGINE_CMD_BASE + 25)
+#define QAT_CMD_SET_ECDSA_NONCE_POOL_SIZE (ENGINE_CMD_BASE + 26)
+#define QAT_CMD_SET_ECDSA_NONCE_POOL_REFILL_THRESHOLD (ENGINE_CMD_BASE + 27)
+#define QAT_CMD_SET_ECDH_KEY_POOL_SIZE (ENGINE_CMD_BASE + 28)
+#define QAT_CMD_SET_ECDH_KEY_POOL_REFILL_THRESHOLD (ENGINE_CMD_BASE + 29)
+#define QAT_CMD_SET_DH_KEY_POOL_SIZE (ENGINE_CMD_BASE + 30)
+#define QAT_CMD_ECDSA_VERIFY_BATCH (ENGINE_CMD_BASE + 31)
+#define QAT_CMD_REGISTER_PINNED_BUFFER (ENGINE_CMD_BASE + 32)
+#define QAT_CMD_UNREGISTER_PINNED_BUFFER (ENGINE_CMD_BASE + 33)
+#define QAT_CMD_ENABLE_USDM_CALL_SITE_STATS (ENGINE_CMD_BASE + 34)
 
 static const ENGINE_CMD_DEFN qat_cmd_defns[] = {
     {
@@ -793,6 +870,81 @@ static const ENGINE_CMD_DEFN qat_cmd_defns[] = {
      "DISABLE_QAT_OFFLOAD",
      "Perform crypto operations on core",
      ENGINE_CMD_FLAG_NO_INPUT},
+    {
+     QAT_CMD_SET_USDM_THREAD_CACHE_SIZE,
+     "SET_USDM_THREAD_CACHE_SIZE",
+     "Set the per-thread budget in bytes for caching freed USDM buffers",
+     ENGINE_CMD_FLAG_NUMERIC},
+    {
+     QAT_CMD_GET_MEM_STATS,
+     "GET_MEM_STATS",
+     "Get a snapshot of the pinned memory allocator statistics",
+     ENGINE_CMD_FLAG_NO_INPUT},
+    {
+     QAT_CMD_ENABLE_HW_LENSTRA_CHECK,
+     "ENABLE_HW_LENSTRA_CHECK",
+     "Perform the RSA Lenstra attack protection check on the accelerator",
+     ENGINE_CMD_FLAG_NO_INPUT},
+    {
+     QAT_CMD_RSA_SIGN_BATCH,
+     "RSA_SIGN_BATCH",
+     "Perform a batch of RSA sign operations",
+     ENGINE_CMD_FLAG_INTERNAL},
+    {
+     QAT_CMD_SET_ASYM_OFFLOAD_THRESHOLD,
+     "SET_ASYM_OFFLOAD_THRESHOLD",
+     "Set the key size in bits below which asymmetric operations are performed on core",
+     ENGINE_CMD_FLAG_STRING},
+    {
+     QAT_CMD_ENABLE_ASYM_AUTO_TUNE,
+     "ENABLE_ASYM_AUTO_TUNE",
+     "Dispatch asymmetric operations to the accelerator or core from measured latencies",
+     ENGINE_CMD_FLAG_NO_INPUT},
+    {
+     QAT_CMD_SET_ECDSA_NONCE_POOL_SIZE,
+     "SET_ECDSA_NONCE_POOL_SIZE",
+     "Set the number of ECDSA nonces precomputed per curve",
+     ENGINE_CMD_FLAG_NUMERIC},
+    {
+     QAT_CMD_SET_ECDSA_NONCE_POOL_REFILL_THRESHOLD,
+     "SET_ECDSA_NONCE_POOL_REFILL_THRESHOLD",
+     "Set the number of ECDSA nonces left at which a pool is refilled",
+     ENGINE_CMD_FLAG_NUMERIC},
+    {
+     QAT_CMD_SET_ECDH_KEY_POOL_SIZE,
+     "SET_ECDH_KEY_POOL_SIZE",
+     "Set the number of ephemeral ECDH keys pregenerated per curve",
+     ENGINE_CMD_FLAG_NUMERIC},
+    {
+     QAT_CMD_SET_ECDH_KEY_POOL_REFILL_THRESHOLD,
+     "SET_ECDH_KEY_POOL_REFILL_THRESHOLD",
+     "Set the number of ephemeral ECDH keys left at which a pool is refilled",
+     ENGINE_CMD_FLAG_NUMERIC},
+    {
+     QAT_CMD_SET_DH_KEY_POOL_SIZE,
+     "SET_DH_KEY_POOL_SIZE",
+     "Set the number of ephemeral DH keys pregenerated per prime size",
+     ENGINE_CMD_FLAG_STRING},
+    {
+     QAT_CMD_ECDSA_VERIFY_BATCH,
+     "ECDSA_VERIFY_BATCH",
+     "Perform a batch of ECDSA verify operations",
+     ENGINE_CMD_FLAG_INTERNAL},
+    {
+     QAT_CMD_REGISTER_PINNED_BUFFER,
+     "REGISTER_PINNED_BUFFER",
+     "Register a pinned buffer region whose records are processed in place",
+     ENGINE_CMD_FLAG_INTERNAL},
+    {
+     QAT_CMD_UNREGISTER_PINNED_BUFFER,
+     "UNREGISTER_PINNED_BUFFER",
+     "Unregister a pinned buffer region",
+     ENGINE_CMD_FLAG_INTERNAL},
+    {
+     QAT_CMD_ENABLE_USDM_CALL_SITE_STATS,
+     "ENABLE_USDM_CALL_SITE_STATS",
+     "Report the call sites of the USDM buffers in the memory statistics",
+     ENGINE_CMD_FLAG_NO_INPUT},
     {0, NULL, NULL, 0}
 };
 
@@ -1048,6 +1200,199 @@ qat_engine_ctrl(ENGINE *e, int cmd, long i, void *p, void (*f) (void))
         CRYPTO_QAT_LOG("QAT Engine Offload disabled - %s\n", __func__);
         break;
 
+    case QAT_CMD_SET_USDM_THREAD_CACHE_SIZE:
+#ifdef USE_QAE_MEM
+        BREAK_IF(i < 0 || i > QAT_MAX_USDM_THREAD_CACHE_SIZE,
+                "The USDM thread cache size is out of range\n");
+        DEBUG("Set USDM thread cache size = %ld bytes\n", i);
+        retVal = qaeCryptoMemSetCacheMaxBytes((size_t)i);
+#else
+        WARN("QAT_CMD_SET_USDM_THREAD_CACHE_SIZE is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_GET_MEM_STATS:
+        BREAK_IF(p == NULL, "GET_MEM_STATS failed as the input parameter was NULL\n");
+        retVal = qaeCryptoMemGetStats((qae_mem_stats *)p);
+        break;
+
+    case QAT_CMD_ENABLE_HW_LENSTRA_CHECK:
+#ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
+        DEBUG("Enabled HW Lenstra check\n");
+        enable_hw_lenstra_check = 1;
+#else
+        WARN("QAT_CMD_ENABLE_HW_LENSTRA_CHECK is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_RSA_SIGN_BATCH:
+#ifndef OPENSSL_DISABLE_QAT_RSA
+        BREAK_IF(!engine_inited, \
+                "RSA_SIGN_BATCH failed as the engine is not initialized\n");
+        BREAK_IF(p == NULL || i <= 0 || i > INT_MAX,
+                "RSA_SIGN_BATCH failed as the input parameters were invalid\n");
+        retVal = qat_rsa_priv_enc_batch((qat_rsa_sign_req_t *)p, (int)i);
+#else
+        WARN("QAT_CMD_RSA_SIGN_BATCH is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_SET_ASYM_OFFLOAD_THRESHOLD:
+        if (p != NULL) {
+            char *token;
+            char str_p[QAT_MAX_INPUT_STRING_LENGTH];
+            char *itr = str_p;
+            strncpy(str_p, (const char *)p, QAT_MAX_INPUT_STRING_LENGTH - 1);
+            str_p[QAT_MAX_INPUT_STRING_LENGTH - 1] = '\0';
+            while ((token = strsep(&itr, ","))) {
+                char *name_token = strsep(&token,":");
+                char *value_token = strsep(&token,":");
+                if (name_token && value_token) {
+                    retVal = qat_asym_threshold_table_set_threshold(
+                                name_token, atoi(value_token));
+                } else {
+                    WARN("Invalid name_token or value_token\n");
+                    retVal = 0;
+                }
+            }
+        } else {
+            WARN("Invalid p parameter\n");
+            retVal = 0;
+        }
+        break;
+
+    case QAT_CMD_ENABLE_ASYM_AUTO_TUNE:
+        DEBUG("Enabled asymmetric auto-tuning\n");
+        enable_asym_auto_tune = 1;
+        break;
+
+    case QAT_CMD_SET_ECDSA_NONCE_POOL_SIZE:
+#if !defined(OPENSSL_DISABLE_QAT_ECDSA) && !defined(OPENSSL_DISABLE_QAT_ECDH)
+        BREAK_IF(engine_inited, \
+                "SET_ECDSA_NONCE_POOL_SIZE failed as the engine is already initialized\n");
+        DEBUG("Set ECDSA nonce pool size = %ld\n", i);
+        retVal = qat_ec_pool_set_size(QAT_EC_POOL_ECDSA_NONCE, i);
+#else
+        WARN("QAT_CMD_SET_ECDSA_NONCE_POOL_SIZE is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_SET_ECDSA_NONCE_POOL_REFILL_THRESHOLD:
+#if !defined(OPENSSL_DISABLE_QAT_ECDSA) && !defined(OPENSSL_DISABLE_QAT_ECDH)
+        DEBUG("Set ECDSA nonce pool refill threshold = %ld\n", i);
+        retVal = qat_ec_pool_set_refill_threshold(QAT_EC_POOL_ECDSA_NONCE, i);
+#else
+        WARN("QAT_CMD_SET_ECDSA_NONCE_POOL_REFILL_THRESHOLD is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_SET_ECDH_KEY_POOL_SIZE:
+#ifndef OPENSSL_DISABLE_QAT_ECDH
+        BREAK_IF(engine_inited, \
+                "SET_ECDH_KEY_POOL_SIZE failed as the engine is already initialized\n");
+        DEBUG("Set ECDH key pool size = %ld\n", i);
+        retVal = qat_ec_pool_set_size(QAT_EC_POOL_ECDH_KEY, i);
+#else
+        WARN("QAT_CMD_SET_ECDH_KEY_POOL_SIZE is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_SET_ECDH_KEY_POOL_REFILL_THRESHOLD:
+#ifndef OPENSSL_DISABLE_QAT_ECDH
+        DEBUG("Set ECDH key pool refill threshold = %ld\n", i);
+        retVal = qat_ec_pool_set_refill_threshold(QAT_EC_POOL_ECDH_KEY, i);
+#else
+        WARN("QAT_CMD_SET_ECDH_KEY_POOL_REFILL_THRESHOLD is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_SET_DH_KEY_POOL_SIZE:
+#ifndef OPENSSL_DISABLE_QAT_DH
+        BREAK_IF(engine_inited, \
+                "SET_DH_KEY_POOL_SIZE failed as the engine is already initialized\n");
+        if (p != NULL) {
+            char *token;
+            char str_p[QAT_MAX_INPUT_STRING_LENGTH];
+            char *itr = str_p;
+            strncpy(str_p, (const char *)p, QAT_MAX_INPUT_STRING_LENGTH - 1);
+            str_p[QAT_MAX_INPUT_STRING_LENGTH - 1] = '\0';
+            while ((token = strsep(&itr, ","))) {
+                char *name_token = strsep(&token,":");
+                char *value_token = strsep(&token,":");
+                if (name_token && value_token) {
+                    DEBUG("Set DH key pool size for %s bits = %s\n",
+                          name_token, value_token);
+                    retVal = qat_dh_key_pool_set_size(atoi(name_token),
+                                                      atoi(value_token));
+                } else {
+                    WARN("Invalid name_token or value_token\n");
+                    retVal = 0;
+                }
+            }
+        } else {
+            WARN("Invalid p parameter\n");
+            retVal = 0;
+        }
+#else
+        WARN("QAT_CMD_SET_DH_KEY_POOL_SIZE is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_ECDSA_VERIFY_BATCH:
+#ifndef OPENSSL_DISABLE_QAT_ECDSA
+        BREAK_IF(!engine_inited, \
+                "ECDSA_VERIFY_BATCH failed as the engine is not initialized\n");
+        BREAK_IF(p == NULL || i <= 0 || i > INT_MAX,
+                "ECDSA_VERIFY_BATCH failed as the input parameters were invalid\n");
+        retVal = qat_ecdsa_do_verify_batch((qat_ecdsa_verify_req_t *)p, (int)i);
+#else
+        WARN("QAT_CMD_ECDSA_VERIFY_BATCH is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_REGISTER_PINNED_BUFFER:
+#ifndef OPENSSL_DISABLE_QAT_CIPHERS
+        BREAK_IF(!engine_inited, \
+                "REGISTER_PINNED_BUFFER failed as the engine is not initialized\n");
+        BREAK_IF(p == NULL || i <= 0,
+                "REGISTER_PINNED_BUFFER failed as the input parameters were invalid\n");
+        retVal = qat_register_pinned_buffer(p, (size_t)i);
+#else
+        WARN("QAT_CMD_REGISTER_PINNED_BUFFER is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_UNREGISTER_PINNED_BUFFER:
+#ifndef OPENSSL_DISABLE_QAT_CIPHERS
+        BREAK_IF(p == NULL,
+                "UNREGISTER_PINNED_BUFFER failed as the input parameter was NULL\n");
+        retVal = qat_unregister_pinned_buffer(p);
+#else
+        WARN("QAT_CMD_UNREGISTER_PINNED_BUFFER is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
+    case QAT_CMD_ENABLE_USDM_CALL_SITE_STATS:
+#ifdef USE_QAE_MEM
+        DEBUG("Enabled USDM call site statistics\n");
+        retVal = qaeCryptoMemEnableCallSiteStats();
+#else
+        WARN("QAT_CMD_ENABLE_USDM_CALL_SITE_STATS is not supported\n");
+        retVal = 0;
+#endif
+        break;
+
     default:
         WARN("CTRL command not implemented\n");
         retVal = 0;
@@ -1070,6 +1415,9 @@ int qat_engine_finish_int(ENGINE *e, int reset_globals)
 
     DEBUG("---- Engine Finishing...\n\n");
 
+    /* Stop precomputing on the instances before they are stopped */
+    qat_asym_pools_stop();
+
     pthread_mutex_lock(&qat_engine_mutex);
     keep_polling = 0;
     if (qat_use_signals_no_engine_start()) {
@@ -1096,6 +1444,13 @@ int qat_engine_finish_int(ENGINE *e, int reset_globals)
         }
     }
 
+#ifndef OPENSSL_DISABLE_QAT_CIPHERS
+    /* Session contexts returned from now on are freed as the instances are
+     * no longer available, so the pools can be emptied.
+     */
+    qat_sym_session_pools_free();
+#endif
+
     /* If polling thread is different from the main thread, wait for polling
      * thread to finish. pthread_equal returns 0 when threads are different.
      */
@@ -1187,6 +1542,7 @@ static int qat_engine_finish(ENGINE *e) {
 static int qat_engine_destroy(ENGINE *e)
 {
     DEBUG("---- Destroying Engine...\n\n");
+    qat_asym_pools_free();
     qat_free_ciphers();
     qat_free_EC_methods();
     qat_free_DH_methods();
@@ -1197,6 +1553,68 @@ static int qat_engine_destroy(ENGINE *e)
     return 1;
 }
 
+/* nids of the EVP_PKEY_METHODs of the engine */
+static int qat_pkey_nids[] = {
+    EVP_PKEY_TLS1_PRF,
+#if !defined(OPENSSL_DISABLE_QAT_ECDH) && defined(QAT_ECX_ENABLED)
+    EVP_PKEY_X25519,
+    EVP_PKEY_X448,
+#endif
+#if !defined(OPENSSL_DISABLE_QAT_ECDSA) && defined(QAT_ECX_ENABLED)
+    EVP_PKEY_ED25519,
+    EVP_PKEY_ED448
+#endif
+};
+
+/******************************************************************************
+* function:
+*         qat_pkey_methods(ENGINE *e,
+*                          EVP_PKEY_METHOD **pmeth,
+*                          const int **nids,
+*                          int nid)
+*
+* @param e      [IN] - OpenSSL engine pointer
+* @param pmeth  [IN] - EVP_PKEY_METHOD structure pointer
+* @param nids   [IN] - EVP_PKEY_METHOD nids
+* @param nid    [IN] - EVP_PKEY_METHOD id
+*
+* description:
+*   Qat engine EVP_PKEY_METHOD registrar, for the TLS PRF, the X25519 and
+*   X448 key agreements and the Ed25519 and Ed448 signatures.
+******************************************************************************/
+static int qat_pkey_methods(ENGINE *e, EVP_PKEY_METHOD **pmeth,
+                            const int **nids, int nid)
+{
+    if (pmeth == NULL) {
+        if (unlikely(nids == NULL)) {
+            WARN("Invalid input params.\n");
+            return 0;
+        }
+        *nids = qat_pkey_nids;
+        return sizeof(qat_pkey_nids) / sizeof(qat_pkey_nids[0]);
+    }
+
+    switch (nid) {
+    case EVP_PKEY_TLS1_PRF:
+        return qat_PRF_pkey_methods(e, pmeth, NULL, nid);
+#if !defined(OPENSSL_DISABLE_QAT_ECDH) && defined(QAT_ECX_ENABLED)
+    case EVP_PKEY_X25519:
+    case EVP_PKEY_X448:
+        *pmeth = qat_ecx_pmeth(nid);
+        return *pmeth != NULL;
+#endif
+#if !defined(OPENSSL_DISABLE_QAT_ECDSA) && defined(QAT_ECX_ENABLED)
+    case EVP_PKEY_ED25519:
+    case EVP_PKEY_ED448:
+        *pmeth = qat_ecx_pmeth(nid);
+        return *pmeth != NULL;
+#endif
+    default:
+        *pmeth = NULL;
+        return 0;
+    }
+}
+
 /******************************************************************************
 * function:
 *         bind_qat(ENGINE *e,
@@ -1294,7 +1712,7 @@ static int bind_qat(ENGINE *e, const char *id)
         goto end;
     }
 
-    if (!ENGINE_set_pkey_meths(e, qat_PRF_pkey_methods)) {
+    if (!ENGINE_set_pkey_meths(e, qat_pkey_methods)) {
         WARN("ENGINE_set_pkey_meths failed\n");
         QATerr(QAT_F_BIND_QAT, QAT_R_ENGINE_SET_PKEY_FAILURE);
         goto end;
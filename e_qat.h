@@ -53,6 +53,7 @@
 
 # include "cpa.h"
 # include "cpa_types.h"
+# include "cpa_cy_common.h"
 
 # include "qat_aux.h"
 
@@ -64,9 +65,28 @@
 #  define ERR_R_RETRY 57
 # endif
 
+/*
+ * X25519 and X448 point multiplication came with version 2.2 of the
+ * QuickAssist crypto API, and the keys the engine handles with OpenSSL 1.1.1.
+ */
+# if OPENSSL_VERSION_NUMBER >= 0x10101000L && \
+     (CPA_CY_API_VERSION_NUM_MAJOR > 2 || \
+      (CPA_CY_API_VERSION_NUM_MAJOR == 2 && CPA_CY_API_VERSION_NUM_MINOR >= 2))
+#  define QAT_ECX_ENABLED
+# endif
+
+/*
+ * ChaCha20-Poly1305 also came with version 2.2 of the QuickAssist crypto API.
+ */
+# if CPA_CY_API_VERSION_NUM_MAJOR > 2 || \
+     (CPA_CY_API_VERSION_NUM_MAJOR == 2 && CPA_CY_API_VERSION_NUM_MINOR >= 2)
+#  define QAT_CHACHA_POLY_ENABLED
+# endif
+
 typedef struct {
     int qatInstanceNumForThread;
     unsigned int localOpsInFlight;
+    BN_CTX *localBnCtx;
 } thread_local_variables_t;
 
 typedef struct {
@@ -234,6 +254,10 @@ extern int enable_inline_polling;
 extern int enable_event_driven_polling;
 extern int enable_heuristic_polling;
 extern int enable_instance_for_thread;
+extern int enable_hw_lenstra_check;
+extern int enable_asym_auto_tune;
+extern int qat_ecx_offload_supported;
+extern int qat_chacha_poly_offload_supported;
 extern int qatPerformOpRetries;
 extern pthread_mutex_t qat_instance_mutex;
 extern pthread_mutex_t qat_engine_mutex;
@@ -336,6 +360,20 @@ int get_next_inst_num(void);
  ******************************************************************************/
 thread_local_variables_t * qat_check_create_local_variables(void);
 
+/******************************************************************************
+ * function:
+ *         qat_get_local_bn_ctx(void)
+ *
+ * description:
+ *   Returns a BN_CTX owned by the current thread, creating it on first use,
+ *   or NULL if it could not be created. It saves a BN_CTX_new/BN_CTX_free
+ *   pair per operation for the pre and post processing done on-core. As the
+ *   BN_CTX frames are stacked the caller must not pause the async job
+ *   between BN_CTX_start and BN_CTX_end, and must not free the BN_CTX.
+ *
+ ******************************************************************************/
+BN_CTX *qat_get_local_bn_ctx(void);
+
 /******************************************************************************
  * function:
  *         qat_engine_init(ENGINE *e)
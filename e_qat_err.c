@@ -31,6 +31,7 @@ static ERR_STRING_DATA QAT_str_functs[] = {
     {ERR_PACK(0, QAT_F_QAT_CRYPTO_CALLBACKFN, 0), "qat_crypto_callbackFn"},
     {ERR_PACK(0, QAT_F_QAT_DH_COMPUTE_KEY, 0), "qat_dh_compute_key"},
     {ERR_PACK(0, QAT_F_QAT_DH_GENERATE_KEY, 0), "qat_dh_generate_key"},
+    {ERR_PACK(0, QAT_F_QAT_DH_GENERATE_PARAMS, 0), "qat_dh_generate_params"},
     {ERR_PACK(0, QAT_F_QAT_DSA_DO_SIGN, 0), "qat_dsa_do_sign"},
     {ERR_PACK(0, QAT_F_QAT_DSA_DO_VERIFY, 0), "qat_dsa_do_verify"},
     {ERR_PACK(0, QAT_F_QAT_DSA_SIGN_SETUP, 0), "qat_dsa_sign_setup"},
@@ -38,8 +39,17 @@ static ERR_STRING_DATA QAT_str_functs[] = {
     {ERR_PACK(0, QAT_F_QAT_ECDH_GENERATE_KEY, 0), "qat_ecdh_generate_key"},
     {ERR_PACK(0, QAT_F_QAT_ECDSA_DO_SIGN, 0), "qat_ecdsa_do_sign"},
     {ERR_PACK(0, QAT_F_QAT_ECDSA_DO_VERIFY, 0), "qat_ecdsa_do_verify"},
+    {ERR_PACK(0, QAT_F_QAT_ECDSA_DO_VERIFY_BATCH, 0),
+     "qat_ecdsa_do_verify_batch"},
     {ERR_PACK(0, QAT_F_QAT_ECDSA_SIGN, 0), "qat_ecdsa_sign"},
     {ERR_PACK(0, QAT_F_QAT_ECDSA_VERIFY, 0), "qat_ecdsa_verify"},
+    {ERR_PACK(0, QAT_F_QAT_ECX_DERIVE, 0), "qat_ecx_derive"},
+    {ERR_PACK(0, QAT_F_QAT_ECX_KEYGEN, 0), "qat_ecx_keygen"},
+    {ERR_PACK(0, QAT_F_QAT_ECX_PMETH, 0), "qat_ecx_pmeth"},
+    {ERR_PACK(0, QAT_F_QAT_ECX_POINT_MULTIPLY, 0), "qat_ecx_point_multiply"},
+    {ERR_PACK(0, QAT_F_QAT_ED_POINT_MULTIPLY, 0), "qat_ed_point_multiply"},
+    {ERR_PACK(0, QAT_F_QAT_ED_SIGN, 0), "qat_ed_sign"},
+    {ERR_PACK(0, QAT_F_QAT_ED_VERIFY, 0), "qat_ed_verify"},
     {ERR_PACK(0, QAT_F_QAT_ENGINE_CTRL, 0), "qat_engine_ctrl"},
     {ERR_PACK(0, QAT_F_QAT_ENGINE_ECDH_COMPUTE_KEY, 0),
      "qat_engine_ecdh_compute_key"},
@@ -50,6 +60,7 @@ static ERR_STRING_DATA QAT_str_functs[] = {
     {ERR_PACK(0, QAT_F_QAT_FREE_DSA_METHODS, 0), "qat_free_DSA_methods"},
     {ERR_PACK(0, QAT_F_QAT_FREE_EC_METHODS, 0), "qat_free_EC_methods"},
     {ERR_PACK(0, QAT_F_QAT_FREE_RSA_METHODS, 0), "qat_free_RSA_methods"},
+    {ERR_PACK(0, QAT_F_QAT_GENERATE_PRIME, 0), "qat_generate_prime"},
     {ERR_PACK(0, QAT_F_QAT_GET_DH_METHODS, 0), "qat_get_DH_methods"},
     {ERR_PACK(0, QAT_F_QAT_GET_DSA_METHODS, 0), "qat_get_DSA_methods"},
     {ERR_PACK(0, QAT_F_QAT_GET_EC_METHODS, 0), "qat_get_EC_methods"},
@@ -59,13 +70,17 @@ static ERR_STRING_DATA QAT_str_functs[] = {
     {ERR_PACK(0, QAT_F_QAT_INIT_OP_DONE_RSA_CRT, 0),
      "qat_init_op_done_rsa_crt"},
     {ERR_PACK(0, QAT_F_QAT_MOD_EXP, 0), "qat_mod_exp"},
+    {ERR_PACK(0, QAT_F_QAT_MOD_INV, 0), "qat_mod_inv"},
     {ERR_PACK(0, QAT_F_QAT_PRF_PMETH, 0), "qat_prf_pmeth"},
     {ERR_PACK(0, QAT_F_QAT_PRF_TLS_DERIVE, 0), "qat_prf_tls_derive"},
+    {ERR_PACK(0, QAT_F_QAT_PRIME_TEST_BATCH, 0), "qat_prime_test_batch"},
     {ERR_PACK(0, QAT_F_QAT_RSA_DECRYPT, 0), "qat_rsa_decrypt"},
     {ERR_PACK(0, QAT_F_QAT_RSA_DECRYPT_CRT, 0), "qat_rsa_decrypt_CRT"},
     {ERR_PACK(0, QAT_F_QAT_RSA_ENCRYPT, 0), "qat_rsa_encrypt"},
+    {ERR_PACK(0, QAT_F_QAT_RSA_KEYGEN, 0), "qat_rsa_keygen"},
     {ERR_PACK(0, QAT_F_QAT_RSA_PRIV_DEC, 0), "qat_rsa_priv_dec"},
     {ERR_PACK(0, QAT_F_QAT_RSA_PRIV_ENC, 0), "qat_rsa_priv_enc"},
+    {ERR_PACK(0, QAT_F_QAT_RSA_PRIV_ENC_BATCH, 0), "qat_rsa_priv_enc_batch"},
     {ERR_PACK(0, QAT_F_QAT_RSA_PUB_DEC, 0), "qat_rsa_pub_dec"},
     {ERR_PACK(0, QAT_F_QAT_RSA_PUB_ENC, 0), "qat_rsa_pub_enc"},
     {ERR_PACK(0, QAT_F_QAT_SET_AFFINE_COORDINATES, 0),
@@ -188,6 +203,7 @@ static ERR_STRING_DATA QAT_str_reasons[] = {
     {ERR_PACK(0, 0, QAT_R_MODULO_P_FAILURE), "modulo p failure"},
     {ERR_PACK(0, 0, QAT_R_MOD_GET_NEXT_INST_FAIL), "mod get next inst fail"},
     {ERR_PACK(0, 0, QAT_R_MOD_LN_MOD_EXP_FAIL), "mod ln mod exp fail"},
+    {ERR_PACK(0, 0, QAT_R_MOD_LN_MOD_INV_FAIL), "mod ln mod inv fail"},
     {ERR_PACK(0, 0, QAT_R_MOD_SETUP_ASYNC_EVENT_FAIL),
     "mod setup async event fail"},
     {ERR_PACK(0, 0, QAT_R_MULTIPLY_QINV_FAILURE), "multiply qinv failure"},
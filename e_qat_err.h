@@ -41,6 +41,7 @@ void ERR_QAT_error(int function, int reason, char *file, int line);
 # define QAT_F_QAT_CRYPTO_CALLBACKFN                      111
 # define QAT_F_QAT_DH_COMPUTE_KEY                         112
 # define QAT_F_QAT_DH_GENERATE_KEY                        113
+# define QAT_F_QAT_DH_GENERATE_PARAMS                     161
 # define QAT_F_QAT_DSA_DO_SIGN                            114
 # define QAT_F_QAT_DSA_DO_VERIFY                          115
 # define QAT_F_QAT_DSA_SIGN_SETUP                         116
@@ -48,8 +49,16 @@ void ERR_QAT_error(int function, int reason, char *file, int line);
 # define QAT_F_QAT_ECDH_GENERATE_KEY                      118
 # define QAT_F_QAT_ECDSA_DO_SIGN                          119
 # define QAT_F_QAT_ECDSA_DO_VERIFY                        120
+# define QAT_F_QAT_ECDSA_DO_VERIFY_BATCH                  160
 # define QAT_F_QAT_ECDSA_SIGN                             121
 # define QAT_F_QAT_ECDSA_VERIFY                           122
+# define QAT_F_QAT_ECX_DERIVE                             153
+# define QAT_F_QAT_ECX_KEYGEN                             154
+# define QAT_F_QAT_ECX_PMETH                              155
+# define QAT_F_QAT_ECX_POINT_MULTIPLY                     156
+# define QAT_F_QAT_ED_POINT_MULTIPLY                      157
+# define QAT_F_QAT_ED_SIGN                                158
+# define QAT_F_QAT_ED_VERIFY                              159
 # define QAT_F_QAT_ENGINE_CTRL                            123
 # define QAT_F_QAT_ENGINE_ECDH_COMPUTE_KEY                124
 # define QAT_F_QAT_ENGINE_FINISH_INT                      125
@@ -59,6 +68,7 @@ void ERR_QAT_error(int function, int reason, char *file, int line);
 # define QAT_F_QAT_FREE_DSA_METHODS                       129
 # define QAT_F_QAT_FREE_EC_METHODS                        130
 # define QAT_F_QAT_FREE_RSA_METHODS                       131
+# define QAT_F_QAT_GENERATE_PRIME                         162
 # define QAT_F_QAT_GET_DH_METHODS                         132
 # define QAT_F_QAT_GET_DSA_METHODS                        133
 # define QAT_F_QAT_GET_EC_METHODS                         134
@@ -67,13 +77,17 @@ void ERR_QAT_error(int function, int reason, char *file, int line);
 # define QAT_F_QAT_INIT_OP_DONE_PIPE                      137
 # define QAT_F_QAT_INIT_OP_DONE_RSA_CRT                   138
 # define QAT_F_QAT_MOD_EXP                                139
+# define QAT_F_QAT_MOD_INV                                163
 # define QAT_F_QAT_PRF_PMETH                              140
 # define QAT_F_QAT_PRF_TLS_DERIVE                         141
+# define QAT_F_QAT_PRIME_TEST_BATCH                       164
 # define QAT_F_QAT_RSA_DECRYPT                            142
 # define QAT_F_QAT_RSA_DECRYPT_CRT                        143
 # define QAT_F_QAT_RSA_ENCRYPT                            144
+# define QAT_F_QAT_RSA_KEYGEN                             165
 # define QAT_F_QAT_RSA_PRIV_DEC                           145
 # define QAT_F_QAT_RSA_PRIV_ENC                           146
+# define QAT_F_QAT_RSA_PRIV_ENC_BATCH                     152
 # define QAT_F_QAT_RSA_PUB_DEC                            147
 # define QAT_F_QAT_RSA_PUB_ENC                            148
 # define QAT_F_QAT_SET_AFFINE_COORDINATES                 149
@@ -164,6 +178,7 @@ void ERR_QAT_error(int function, int reason, char *file, int line);
 # define QAT_R_MODULO_P_FAILURE                           178
 # define QAT_R_MOD_GET_NEXT_INST_FAIL                     179
 # define QAT_R_MOD_LN_MOD_EXP_FAIL                        180
+# define QAT_R_MOD_LN_MOD_INV_FAIL                        280
 # define QAT_R_MOD_SETUP_ASYNC_EVENT_FAIL                 181
 # define QAT_R_MULTIPLY_QINV_FAILURE                      182
 # define QAT_R_N_E_CONVERT_TO_FB_FAILURE                  183
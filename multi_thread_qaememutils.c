@@ -60,6 +60,7 @@
 #include <dirent.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 /*
  * Error from file descriptor operation
@@ -101,6 +102,9 @@
 #define MAX_ALLOC (SLAB_SIZE - sizeof(qat_contig_mem_config) - sizeof(qae_slab) - QAE_BYTE_ALIGNMENT)
 #define MAX_EMPTY_SLAB     128
 
+/* number of distinct call sites tracked while taking a stats snapshot */
+#define QAE_MEM_STATS_MAX_SITES_SCANNED 256
+
 #define IN_EMPTY_LIST      0
 #define IN_AVAILABLE_LIST  1
 #define IN_FULL_LIST       2
@@ -149,6 +153,13 @@ typedef qae_slab qae_slab_pool;
 static pthread_key_t qae_key;
 static pthread_once_t qae_key_once = PTHREAD_ONCE_INIT;
 
+/* allocation statistics by slot size */
+typedef struct {
+    unsigned long live_allocs;
+    unsigned long live_bytes;
+    unsigned long peak_live_bytes;
+} qae_pool_stats;
+
 typedef struct {
     int crypto_qat_contig_memfd;
     /* slab list containing full used slabs */
@@ -157,6 +168,13 @@ typedef struct {
     qae_slab_pool empty_slab_list[NUM_SLOT_SIZE];
     /* array of slab lists containing partially used slabs by slot size */
     qae_slab_pool available_slab_list[NUM_SLOT_SIZE];
+    /* statistics of the slab pools of this thread */
+    qae_pool_stats pool_stats[NUM_SLOT_SIZE];
+    unsigned long live_bytes;
+    unsigned long peak_live_bytes;
+    unsigned long long total_allocs;
+    unsigned long long total_frees;
+    unsigned long long failed_allocs;
 } qae_slab_pools_local;
 
 void crypto_cleanup_slabs(void *thread_key);
@@ -444,6 +462,60 @@ static qae_slab *crypto_get_empty_slab(int size, int pool_index,
     return result;
 }
 
+/*****************************************************************************
+ * function:
+ *         crypto_pool_get_size(int pool_index)
+ *
+ * @param[in] pool_index, the index of the slot pool
+ * @retval int, the usable size in bytes of the slots in the pool
+ *
+ * @description
+ *      get the usable memory size in bytes of the slots of a pool
+ *
+ *****************************************************************************/
+static int crypto_pool_get_size(int pool_index)
+{
+    if (pool_index == (NUM_SLOT_SIZE - 1)) {
+        return MAX_ALLOC;
+    } else if (pool_index >= 0 && pool_index <= NUM_SLOT_SIZE - 2) {
+        return slot_sizes_available[pool_index] - sizeof(qae_slot) -
+            QAE_BYTE_ALIGNMENT;
+    } else {
+        MEM_WARN("error invalid pool_index %d\n", pool_index);
+        return 0;
+    }
+}
+
+/* update the statistics of a pool owned by the calling thread */
+static void crypto_stats_on_alloc(qae_slab_pools_local *tls_ptr,
+                                  int pool_index)
+{
+    qae_pool_stats *ps = &tls_ptr->pool_stats[pool_index];
+    int size = crypto_pool_get_size(pool_index);
+
+    tls_ptr->total_allocs++;
+    ps->live_allocs++;
+    ps->live_bytes += size;
+    if (ps->live_bytes > ps->peak_live_bytes)
+        ps->peak_live_bytes = ps->live_bytes;
+    tls_ptr->live_bytes += size;
+    if (tls_ptr->live_bytes > tls_ptr->peak_live_bytes)
+        tls_ptr->peak_live_bytes = tls_ptr->live_bytes;
+}
+
+/* update the statistics of a pool owned by the calling thread */
+static void crypto_stats_on_free(qae_slab_pools_local *tls_ptr,
+                                 int pool_index)
+{
+    qae_pool_stats *ps = &tls_ptr->pool_stats[pool_index];
+    int size = crypto_pool_get_size(pool_index);
+
+    tls_ptr->total_frees++;
+    ps->live_allocs--;
+    ps->live_bytes -= size;
+    tls_ptr->live_bytes -= size;
+}
+
 /*****************************************************************************
  * function:
  *         crypto_alloc_from_slab(int size, const char *file, int line)
@@ -520,6 +592,8 @@ static void *crypto_alloc_from_slab(int size, const char *file, int line)
     slt->file = strdup(file);
     slt->line = line;
 
+    crypto_stats_on_alloc(tls_ptr, i);
+
     /* increase the reference counter */
     slb->used_slots++;
     /* get the available slot from the head of available slab list */
@@ -536,6 +610,8 @@ static void *crypto_alloc_from_slab(int size, const char *file, int line)
     result = (void *)((unsigned char *)slt + sizeof(qae_slot));
 
 exit:
+    if (result == NULL && tls_ptr != NULL)
+        tls_ptr->failed_allocs++;
     return result;
 }
 
@@ -605,6 +681,8 @@ static void crypto_free_to_slab(void *ptr)
     slt->file = NULL;
     slt->line = 0;
 
+    crypto_stats_on_free(tls_ptr, i);
+
     /* insert the slot into the slab */
     slt->next = slb->next_slot;
     slb->next_slot = slt;
@@ -667,15 +745,7 @@ static int crypto_slot_get_size(void *ptr)
         return 0;
     }
     qae_slot *slt = (qae_slot *)((unsigned char *)ptr - sizeof(qae_slot));
-    if (slt->pool_index == (NUM_SLOT_SIZE - 1)) {
-        return MAX_ALLOC;
-    } else if (slt->pool_index >= 0 && slt->pool_index <= NUM_SLOT_SIZE - 2) {
-        return slot_sizes_available[slt->pool_index] - sizeof(qae_slot) -
-            QAE_BYTE_ALIGNMENT;
-    } else {
-        MEM_WARN("error invalid pool_index %d\n", slt->pool_index);
-        return 0;
-    }
+    return crypto_pool_get_size(slt->pool_index);
 }
 
 /*****************************************************************************
@@ -832,6 +902,148 @@ void slab_list_stat(qae_slab_pool * list)
     return;
 }
 
+/*****************************************************************************
+ * function:
+ *        slab_list_call_sites(qae_slab_pool *list,
+ *                             qae_mem_call_site_stats *sites,
+ *                             int *num_sites, int max_sites)
+ * @param[in] list, pointer to a slab list
+ * @param[in,out] sites, array the live slots are accounted into
+ * @param[in,out] num_sites, number of entries used in sites
+ * @param[in] max_sites, number of entries available in sites
+ *
+ * @description
+ *      walk every allocated slot of the slabs in a list and account its size
+ *      to the call site recorded in the slot.
+ *
+ *****************************************************************************/
+static void slab_list_call_sites(qae_slab_pool *list,
+                                 qae_mem_call_site_stats *sites,
+                                 int *num_sites, int max_sites)
+{
+    qae_slab *slb;
+    qae_slot *slt;
+    QAE_UINT alignment;
+    int index, i, j, size;
+
+    for (slb = list->next, index = 0; index < list->slot_size;
+         slb = slb->next, index++) {
+        for (i = sizeof(qae_slab); SLAB_SIZE - i >= slb->slot_size;
+             i += slb->slot_size) {
+            slt = (qae_slot *) ((unsigned char *)slb + i);
+            alignment =
+                QAE_BYTE_ALIGNMENT -
+                (((QAE_UINT) slt + sizeof(qae_slot)) % QAE_BYTE_ALIGNMENT);
+            slt = (qae_slot *) (((QAE_UINT) slt) + alignment);
+            if (slt->sig != SIG_ALLOC || slt->file == NULL)
+                continue;
+
+            size = crypto_pool_get_size(slt->pool_index);
+            for (j = 0; j < *num_sites; j++) {
+                if (sites[j].line == slt->line &&
+                    strncmp(sites[j].file, slt->file,
+                            QAE_MEM_STATS_FILE_NAME_LEN - 1) == 0)
+                    break;
+            }
+            if (j == *num_sites) {
+                if (*num_sites >= max_sites)
+                    continue;
+                strncpy(sites[j].file, slt->file,
+                        QAE_MEM_STATS_FILE_NAME_LEN - 1);
+                sites[j].file[QAE_MEM_STATS_FILE_NAME_LEN - 1] = '\0';
+                sites[j].line = slt->line;
+                (*num_sites)++;
+            }
+            sites[j].live_allocs++;
+            sites[j].live_bytes += size;
+        }
+    }
+}
+
+/* order call sites by decreasing live bytes */
+static int call_site_cmp(const void *a, const void *b)
+{
+    const qae_mem_call_site_stats *sa = a;
+    const qae_mem_call_site_stats *sb = b;
+
+    if (sa->live_bytes == sb->live_bytes)
+        return 0;
+    return sa->live_bytes < sb->live_bytes ? 1 : -1;
+}
+
+/******************************************************************************
+* function:
+*         qaeCryptoMemGetStats(qae_mem_stats *stats)
+*
+* @param[out] stats, pointer to the structure to fill in
+*
+* description:
+*   Take a snapshot of the allocator statistics. As the slab pools are local
+*   to each thread the snapshot describes the pools of the calling thread.
+*
+******************************************************************************/
+int qaeCryptoMemGetStats(qae_mem_stats *stats)
+{
+    struct timespec ts = { 0 };
+    qae_mem_call_site_stats *sites = NULL;
+    qae_slab_pools_local *tls_ptr;
+    int num_sites = 0;
+    int i;
+
+    if (unlikely(stats == NULL)) {
+        MEM_WARN("NULL stats pointer passed to function\n");
+        return 0;
+    }
+
+    memset(stats, 0, sizeof(qae_mem_stats));
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    stats->timestamp_ns = (unsigned long long)ts.tv_sec * 1000000000ULL +
+                          ts.tv_nsec;
+    stats->num_classes = NUM_SLOT_SIZE;
+    for (i = 0; i < NUM_SLOT_SIZE; i++)
+        stats->classes[i].slot_size = crypto_pool_get_size(i);
+
+    pthread_once(&qae_key_once, qae_make_key);
+    tls_ptr = (qae_slab_pools_local *)pthread_getspecific(qae_key);
+    if (tls_ptr == NULL)
+        return 1;
+
+    sites = calloc(QAE_MEM_STATS_MAX_SITES_SCANNED,
+                   sizeof(qae_mem_call_site_stats));
+    if (sites == NULL) {
+        MEM_WARN("Failed to allocate call site table\n");
+        return 0;
+    }
+
+    stats->total_allocs = tls_ptr->total_allocs;
+    stats->total_frees = tls_ptr->total_frees;
+    stats->failed_allocs = tls_ptr->failed_allocs;
+    stats->live_bytes = tls_ptr->live_bytes;
+    stats->peak_live_bytes = tls_ptr->peak_live_bytes;
+    stats->full_slabs = tls_ptr->full_slab_list.slot_size;
+    for (i = 0; i < NUM_SLOT_SIZE; i++) {
+        stats->classes[i].live_allocs = tls_ptr->pool_stats[i].live_allocs;
+        stats->classes[i].live_bytes = tls_ptr->pool_stats[i].live_bytes;
+        stats->classes[i].peak_live_bytes =
+            tls_ptr->pool_stats[i].peak_live_bytes;
+        stats->classes[i].available_slabs =
+            tls_ptr->available_slab_list[i].slot_size;
+        stats->classes[i].empty_slabs = tls_ptr->empty_slab_list[i].slot_size;
+        slab_list_call_sites(&tls_ptr->available_slab_list[i], sites,
+                             &num_sites, QAE_MEM_STATS_MAX_SITES_SCANNED);
+    }
+    slab_list_call_sites(&tls_ptr->full_slab_list, sites, &num_sites,
+                         QAE_MEM_STATS_MAX_SITES_SCANNED);
+
+    qsort(sites, num_sites, sizeof(qae_mem_call_site_stats), call_site_cmp);
+    stats->num_call_sites = num_sites < QAE_MEM_STATS_MAX_CALL_SITES ?
+                            num_sites : QAE_MEM_STATS_MAX_CALL_SITES;
+    memcpy(stats->call_sites, sites,
+           stats->num_call_sites * sizeof(qae_mem_call_site_stats));
+    free(sites);
+    return 1;
+}
+
 /*****************************************************************************
  * function:
  *         crypto_cleanup_slabs(void *thread_key)
@@ -875,7 +1087,7 @@ static void crypto_init(void)
 
     if ((tls_ptr = (qae_slab_pools_local *)pthread_getspecific(qae_key))
         == NULL) {
-        tls_ptr = malloc(sizeof(qae_slab_pools_local));
+        tls_ptr = calloc(1, sizeof(qae_slab_pools_local));
         pthread_setspecific(qae_key, (void *)tls_ptr);
     }
 
@@ -0,0 +1,108 @@
+/* ====================================================================
+ *
+ *
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2016-2019 Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * ====================================================================
+ */
+
+
+/*****************************************************************************
+ * @file qae_mem_stats.h
+ *
+ * This file provides the layout of the pinned memory allocator statistics
+ * snapshot returned by the GET_MEM_STATS engine message.
+ *
+ *****************************************************************************/
+
+#ifndef QAE_MEM_STATS_H
+# define QAE_MEM_STATS_H
+
+/* Maximum number of slot size classes reported in a snapshot */
+# define QAE_MEM_STATS_MAX_CLASSES 16
+
+/* Number of call sites reported, ordered by live bytes */
+# define QAE_MEM_STATS_MAX_CALL_SITES 16
+
+/* Maximum length of a call site file name including NULL terminator */
+# define QAE_MEM_STATS_FILE_NAME_LEN 64
+
+typedef struct {
+    /* usable bytes per slot, 0 for allocations bigger than any slot */
+    unsigned long slot_size;
+    unsigned long live_allocs;
+    unsigned long live_bytes;
+    unsigned long peak_live_bytes;
+    /* slabs of this slot size in the available and empty lists */
+    unsigned long available_slabs;
+    unsigned long empty_slabs;
+} qae_mem_class_stats;
+
+typedef struct {
+    char file[QAE_MEM_STATS_FILE_NAME_LEN];
+    int line;
+    unsigned long live_allocs;
+    unsigned long live_bytes;
+} qae_mem_call_site_stats;
+
+typedef struct {
+    /* CLOCK_MONOTONIC time the snapshot was taken at, used to derive
+     * allocation and free rates from two successive snapshots */
+    unsigned long long timestamp_ns;
+    unsigned long long total_allocs;
+    unsigned long long total_frees;
+    unsigned long long failed_allocs;
+    unsigned long live_bytes;
+    unsigned long peak_live_bytes;
+    unsigned long full_slabs;
+    unsigned int num_classes;
+    qae_mem_class_stats classes[QAE_MEM_STATS_MAX_CLASSES];
+    unsigned int num_call_sites;
+    qae_mem_call_site_stats call_sites[QAE_MEM_STATS_MAX_CALL_SITES];
+} qae_mem_stats;
+
+/*****************************************************************************
+ * function:
+ *         qaeCryptoMemGetStats(qae_mem_stats *stats)
+ *
+ * @description
+ *      Fill in a snapshot of the pinned memory allocator statistics.
+ *
+ * @param[out] stats, pointer to the structure to fill in
+ *
+ * @retval 1 on success, 0 on failure
+ *
+ *****************************************************************************/
+int qaeCryptoMemGetStats(qae_mem_stats *stats);
+
+#endif                          /* QAE_MEM_STATS_H */
@@ -63,6 +63,7 @@
 #include <dirent.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 /*
  * Error from file descriptor operation
@@ -123,6 +124,9 @@ static pthread_mutex_t crypto_bsal = PTHREAD_MUTEX_INITIALIZER;
 #define MAX_ALLOC (SLAB_SIZE - sizeof(qae_slab) - QAE_BYTE_ALIGNMENT)
 #define MAX_EMPTY_SLAB     128
 
+/* number of distinct call sites tracked while taking a stats snapshot */
+#define QAE_MEM_STATS_MAX_SITES_SCANNED 256
+
 #define IN_EMPTY_LIST      0
 #define IN_AVAILABLE_LIST  1
 #define IN_FULL_LIST       2
@@ -179,6 +183,20 @@ static qae_slab_pool empty_slab_list[NUM_SLOT_SIZE];
 /* array of slab lists containing partially used slabs by slot size */
 static qae_slab_pool available_slab_list[NUM_SLOT_SIZE];
 
+/* allocation statistics by slot size, protected by crypto_bsal */
+typedef struct {
+    unsigned long live_allocs;
+    unsigned long live_bytes;
+    unsigned long peak_live_bytes;
+} qae_pool_stats;
+
+static qae_pool_stats pool_stats[NUM_SLOT_SIZE];
+static unsigned long live_bytes_total = 0;
+static unsigned long peak_live_bytes_total = 0;
+static unsigned long long total_allocs = 0;
+static unsigned long long total_frees = 0;
+static unsigned long long failed_allocs = 0;
+
 /* init the head node of a linked list */
 static void init_pool(qae_slab_pool *list)
 {
@@ -451,6 +469,58 @@ static qae_slab *crypto_get_empty_slab(int size, int pool_index)
     return result;
 }
 
+/*****************************************************************************
+ * function:
+ *         crypto_pool_get_size(int pool_index)
+ *
+ * @param[in] pool_index, the index of the slot pool
+ * @retval int, the usable size in bytes of the slots in the pool
+ *
+ * @description
+ *      get the usable memory size in bytes of the slots of a pool
+ *
+ *****************************************************************************/
+static int crypto_pool_get_size(int pool_index)
+{
+    if (pool_index == (NUM_SLOT_SIZE - 1)) {
+        return MAX_ALLOC;
+    } else if (pool_index >= 0 && pool_index <= NUM_SLOT_SIZE - 2) {
+        return slot_sizes_available[pool_index] - sizeof(qae_slot) -
+            QAE_BYTE_ALIGNMENT;
+    } else {
+        MEM_WARN("error invalid pool_index %d\n", pool_index);
+        return 0;
+    }
+}
+
+/* update the statistics of a pool, the caller must hold crypto_bsal */
+static void crypto_stats_on_alloc(int pool_index)
+{
+    qae_pool_stats *ps = &pool_stats[pool_index];
+    int size = crypto_pool_get_size(pool_index);
+
+    total_allocs++;
+    ps->live_allocs++;
+    ps->live_bytes += size;
+    if (ps->live_bytes > ps->peak_live_bytes)
+        ps->peak_live_bytes = ps->live_bytes;
+    live_bytes_total += size;
+    if (live_bytes_total > peak_live_bytes_total)
+        peak_live_bytes_total = live_bytes_total;
+}
+
+/* update the statistics of a pool, the caller must hold crypto_bsal */
+static void crypto_stats_on_free(int pool_index)
+{
+    qae_pool_stats *ps = &pool_stats[pool_index];
+    int size = crypto_pool_get_size(pool_index);
+
+    total_frees++;
+    ps->live_allocs--;
+    ps->live_bytes -= size;
+    live_bytes_total -= size;
+}
+
 /*****************************************************************************
  * function:
  *         crypto_alloc_from_slab(int size, const char *file, int line)
@@ -535,6 +605,8 @@ static void *crypto_alloc_from_slab(int size, const char *file, int line)
     slt->file = strdup(file);
     slt->line = line;
 
+    crypto_stats_on_alloc(i);
+
    /* increase the reference couter */
     slb->used_slots++;
     /* get the available slot from the head of available slab list */
@@ -556,6 +628,8 @@ static void *crypto_alloc_from_slab(int size, const char *file, int line)
     MEM_DEBUG("pthread_mutex_unlock\n");
 
  exit:
+    if (result == NULL)
+        __sync_add_and_fetch(&failed_allocs, 1);
     return result;
 }
 
@@ -627,6 +701,8 @@ static void crypto_free_to_slab(void *ptr)
     slt->file = NULL;
     slt->line = 0;
 
+    crypto_stats_on_free(i);
+
     /* insert the slot into the slab */
     slt->next = slb->next_slot;
     slb->next_slot = slt;
@@ -694,15 +770,7 @@ static int crypto_slot_get_size(void *ptr)
         return 0;
     }
     qae_slot *slt = (qae_slot *)((unsigned char *)ptr - sizeof(qae_slot));
-    if (slt->pool_index == (NUM_SLOT_SIZE - 1)) {
-        return MAX_ALLOC;
-    } else if (slt->pool_index >= 0 && slt->pool_index <= NUM_SLOT_SIZE - 2) {
-        return slot_sizes_available[slt->pool_index] - sizeof(qae_slot) -
-            QAE_BYTE_ALIGNMENT;
-    } else {
-        MEM_WARN("error invalid pool_index %d\n", slt->pool_index);
-        return 0;
-    }
+    return crypto_pool_get_size(slt->pool_index);
 }
 
 /*****************************************************************************
@@ -879,6 +947,157 @@ void slab_list_stat(qae_slab_pool * list)
     return;
 }
 
+/*****************************************************************************
+ * function:
+ *        slab_list_call_sites(qae_slab_pool *list,
+ *                             qae_mem_call_site_stats *sites,
+ *                             int *num_sites, int max_sites)
+ * @param[in] list, pointer to a slab list
+ * @param[in,out] sites, array the live slots are accounted into
+ * @param[in,out] num_sites, number of entries used in sites
+ * @param[in] max_sites, number of entries available in sites
+ *
+ * @description
+ *      walk every allocated slot of the slabs in a list and account its size
+ *      to the call site recorded in the slot. The caller must hold
+ *      crypto_bsal.
+ *
+ ******************************************************************************/
+static void slab_list_call_sites(qae_slab_pool *list,
+                                 qae_mem_call_site_stats *sites,
+                                 int *num_sites, int max_sites)
+{
+    qae_slab *slb;
+    qae_slot *slt;
+    QAE_UINT alignment;
+    int index, i, j, size;
+
+    for (slb = list->next, index = 0; index < list->slot_size;
+         slb = slb->next, index++) {
+        for (i = sizeof(qae_slab); SLAB_SIZE - i >= slb->slot_size;
+             i += slb->slot_size) {
+            slt = (qae_slot *) ((unsigned char *)slb + i);
+            alignment =
+                QAE_BYTE_ALIGNMENT -
+                (((QAE_UINT) slt + sizeof(qae_slot)) % QAE_BYTE_ALIGNMENT);
+            slt = (qae_slot *) (((QAE_UINT) slt) + alignment);
+            if (slt->sig != SIG_ALLOC || slt->file == NULL)
+                continue;
+
+            size = crypto_pool_get_size(slt->pool_index);
+            for (j = 0; j < *num_sites; j++) {
+                if (sites[j].line == slt->line &&
+                    strncmp(sites[j].file, slt->file,
+                            QAE_MEM_STATS_FILE_NAME_LEN - 1) == 0)
+                    break;
+            }
+            if (j == *num_sites) {
+                if (*num_sites >= max_sites)
+                    continue;
+                strncpy(sites[j].file, slt->file,
+                        QAE_MEM_STATS_FILE_NAME_LEN - 1);
+                sites[j].file[QAE_MEM_STATS_FILE_NAME_LEN - 1] = '\0';
+                sites[j].line = slt->line;
+                (*num_sites)++;
+            }
+            sites[j].live_allocs++;
+            sites[j].live_bytes += size;
+        }
+    }
+}
+
+/* order call sites by decreasing live bytes */
+static int call_site_cmp(const void *a, const void *b)
+{
+    const qae_mem_call_site_stats *sa = a;
+    const qae_mem_call_site_stats *sb = b;
+
+    if (sa->live_bytes == sb->live_bytes)
+        return 0;
+    return sa->live_bytes < sb->live_bytes ? 1 : -1;
+}
+
+/******************************************************************************
+* function:
+*         qaeCryptoMemGetStats(qae_mem_stats *stats)
+*
+* @param[out] stats, pointer to the structure to fill in
+*
+* description:
+*   Take a snapshot of the allocator statistics: live and peak bytes for each
+*   slot size, the number of slabs in each list, cumulative allocation and
+*   free counts and the call sites holding the most live memory.
+*
+******************************************************************************/
+int qaeCryptoMemGetStats(qae_mem_stats *stats)
+{
+    struct timespec ts = { 0 };
+    qae_mem_call_site_stats *sites = NULL;
+    int num_sites = 0;
+    int i, rc;
+
+    if (unlikely(stats == NULL)) {
+        MEM_WARN("NULL stats pointer passed to function\n");
+        return 0;
+    }
+
+    memset(stats, 0, sizeof(qae_mem_stats));
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    stats->timestamp_ns = (unsigned long long)ts.tv_sec * 1000000000ULL +
+                          ts.tv_nsec;
+    stats->num_classes = NUM_SLOT_SIZE;
+    for (i = 0; i < NUM_SLOT_SIZE; i++)
+        stats->classes[i].slot_size = crypto_pool_get_size(i);
+
+    if (!crypto_inited)
+        return 1;
+
+    sites = calloc(QAE_MEM_STATS_MAX_SITES_SCANNED,
+                   sizeof(qae_mem_call_site_stats));
+    if (sites == NULL) {
+        MEM_WARN("Failed to allocate call site table\n");
+        return 0;
+    }
+
+    MEM_DEBUG("pthread_mutex_lock\n");
+    if ((rc = pthread_mutex_lock(&crypto_bsal)) != 0) {
+        MEM_WARN("pthread_mutex_lock: %s\n", strerror(rc));
+        free(sites);
+        return 0;
+    }
+
+    stats->total_allocs = total_allocs;
+    stats->total_frees = total_frees;
+    stats->failed_allocs = failed_allocs;
+    stats->live_bytes = live_bytes_total;
+    stats->peak_live_bytes = peak_live_bytes_total;
+    stats->full_slabs = full_slab_list.slot_size;
+    for (i = 0; i < NUM_SLOT_SIZE; i++) {
+        stats->classes[i].live_allocs = pool_stats[i].live_allocs;
+        stats->classes[i].live_bytes = pool_stats[i].live_bytes;
+        stats->classes[i].peak_live_bytes = pool_stats[i].peak_live_bytes;
+        stats->classes[i].available_slabs = available_slab_list[i].slot_size;
+        stats->classes[i].empty_slabs = empty_slab_list[i].slot_size;
+        slab_list_call_sites(&available_slab_list[i], sites, &num_sites,
+                             QAE_MEM_STATS_MAX_SITES_SCANNED);
+    }
+    slab_list_call_sites(&full_slab_list, sites, &num_sites,
+                         QAE_MEM_STATS_MAX_SITES_SCANNED);
+
+    if ((rc = pthread_mutex_unlock(&crypto_bsal)) != 0) {
+        MEM_WARN("pthread_mutex_unlock: %s\n", strerror(rc));
+    }
+    MEM_DEBUG("pthread_mutex_unlock\n");
+
+    qsort(sites, num_sites, sizeof(qae_mem_call_site_stats), call_site_cmp);
+    stats->num_call_sites = num_sites < QAE_MEM_STATS_MAX_CALL_SITES ?
+                            num_sites : QAE_MEM_STATS_MAX_CALL_SITES;
+    memcpy(stats->call_sites, sites,
+           stats->num_call_sites * sizeof(qae_mem_call_site_stats));
+    free(sites);
+    return 1;
+}
+
 /*****************************************************************************
  * function:
  *         crypto_cleanup_slabs(void)
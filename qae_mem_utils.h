@@ -47,6 +47,7 @@
 # define __QAE_MEM_UTILS_H
 
 # include "cpa.h"
+# include "qae_mem_stats.h"
 
 /*
  * define types which need to vary between 32 and 64 bit
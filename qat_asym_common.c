@@ -54,6 +54,9 @@
 
 #include <pthread.h>
 #include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L
 #include <openssl/async.h>
@@ -62,6 +65,7 @@
 #include <openssl/bn.h>
 
 #include "cpa_cy_ln.h"
+#include "cpa_cy_prime.h"
 
 #include "qat_asym_common.h"
 #ifdef USE_QAT_CONTIG_MEM
@@ -76,9 +80,64 @@
 #include "qat_polling.h"
 #include "qat_events.h"
 #include "e_qat_err.h"
+#include "icp_sal_poll.h"
 
 #define QAT_PERFORMOP_RETRIES 3
 
+/* Prime candidates tested on the accelerator at once */
+#define QAT_PRIME_TEST_BATCH 16
+/* Primes smaller than this are generated in software */
+#define QAT_PRIME_TEST_MIN_BITS 512
+/* Largest number of Miller-Rabin rounds of a prime test request */
+#define QAT_PRIME_TEST_MAX_ROUNDS 50
+/* Candidates are sieved by the odd primes below this bound */
+#define QAT_PRIME_SIEVE_LIMIT 2048
+
+/* Key sizes for which latencies are tracked per operation */
+#define QAT_ASYM_TUNE_SLOTS 8
+/* Samples of each path needed before the measured latencies are used */
+#define QAT_ASYM_TUNE_WARMUP 16
+/* One in QAT_ASYM_TUNE_PROBE operations is sent to the slower path */
+#define QAT_ASYM_TUNE_PROBE 256
+/* Weight of a new sample in the moving averages is 1/(2^SHIFT) */
+#define QAT_ASYM_TUNE_EWMA_SHIFT 3
+#define QAT_ASYM_THRESHOLD_MAX 16384
+
+typedef struct {
+    volatile int bits;
+    volatile unsigned int calls;
+    volatile unsigned int qat_samples;
+    volatile unsigned int sw_samples;
+    volatile unsigned long qat_ns;
+    volatile unsigned long sw_ns;
+} qat_asym_tune_slot_t;
+
+typedef struct {
+    const char *name;
+    int threshold;
+    qat_asym_tune_slot_t slots[QAT_ASYM_TUNE_SLOTS];
+} qat_asym_dispatch_t;
+
+/*
+ * Operations on keys smaller than the threshold, in bits, are performed in
+ * software. Routing to the core is opt-in: the thresholds default to 0 so
+ * that, unless they are set with SET_ASYM_OFFLOAD_THRESHOLD or auto-tuning
+ * is enabled, all the sizes supported by the accelerator are offloaded as
+ * they were before the thresholds existed. The cross-over point depends on
+ * the device, the core and the load, so no size is assumed to be cheaper
+ * on-core by default.
+ */
+static qat_asym_dispatch_t qat_asym_dispatch_table[QAT_ASYM_NUM_OPS] = {
+    [QAT_ASYM_RSA_PUB] = {"RSA-PUB", 0},
+    [QAT_ASYM_RSA_PRIV] = {"RSA-PRIV", 0},
+    [QAT_ASYM_ECDSA_SIGN] = {"ECDSA-SIGN", 0},
+    [QAT_ASYM_ECDSA_VERIFY] = {"ECDSA-VERIFY", 0},
+    [QAT_ASYM_ECDH] = {"ECDH", 0},
+    [QAT_ASYM_DH] = {"DH", 0},
+    [QAT_ASYM_DSA_SIGN] = {"DSA-SIGN", 0},
+    [QAT_ASYM_DSA_VERIFY] = {"DSA-VERIFY", 0}
+};
+
 /******************************************************************************
 * function:
 *         qat_BN_to_FB(CpaFlatBuffer *fb,
@@ -121,9 +180,12 @@ int qat_BN_to_FB(CpaFlatBuffer * fb, const BIGNUM *bn)
     return 1;
 }
 
-/* Callback to indicate QAT completion of bignum modular exponentiation */
-static void qat_modexpCallbackFn(void *pCallbackTag, CpaStatus status,
-                                 void *pOpData, CpaFlatBuffer * pOut)
+/*
+ * Callback to indicate QAT completion of bignum modular exponentiation or
+ * modular inversion
+ */
+static void qat_lnCallbackFn(void *pCallbackTag, CpaStatus status,
+                             void *pOpData, CpaFlatBuffer * pOut)
 {
     if (enable_heuristic_polling) {
         QAT_ATOMIC_DEC(num_asym_requests_in_flight);
@@ -132,66 +194,45 @@ static void qat_modexpCallbackFn(void *pCallbackTag, CpaStatus status,
                           NULL, CPA_TRUE);
 }
 
+/* Bignum operations performed by qat_ln_perform */
+typedef enum {
+    QAT_LN_MOD_EXP = 0,
+    QAT_LN_MOD_INV
+} qat_ln_op_t;
+
 /******************************************************************************
 * function:
-          qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
-                      const BIGNUM *mod, int *fallback)
+*         qat_ln_perform(qat_ln_op_t op, const void *opData,
+*                        CpaFlatBuffer *result, int *fallback)
 *
-* @param res       [IN] - Result bignum of mod_exp
-* @param base      [IN] - Base used for mod_exp
-* @param exp       [IN] - Exponent used for mod_exp
-* @param mod       [IN] - Modulus used for mod_exp
+* @param op       [IN]  - bignum operation
+* @param opData   [IN]  - CpaCyLnModExpOpData or CpaCyLnModInvOpData of op
+* @param result   [OUT] - pinned buffer the result is written to
 * @param fallback [OUT] - Pointer to Software Fallback flag
 *
 * description:
-*   Bignum modular exponentiation function used in DH and DSA.
+*   Submits a bignum operation to an instance and waits for its completion,
+*   pausing the async job if any. Returns 1 on success and 0 on failure.
 *
 ******************************************************************************/
-int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
-                const BIGNUM *mod, int *fallback)
+static int qat_ln_perform(qat_ln_op_t op, const void *opData,
+                          CpaFlatBuffer *result, int *fallback)
 {
-    CpaCyLnModExpOpData opData;
-    CpaFlatBuffer result = { 0, };
     CpaStatus status = 0;
-    int retval = 1, job_ret = 0;
+    int job_ret = 0;
     int inst_num = QAT_INVALID_INSTANCE;
     int qatPerformOpRetries = 0;
     op_done_t op_done;
     int iMsgRetry = getQatMsgRetryCount();
     useconds_t ulPollInterval = getQatPollInterval();
     thread_local_variables_t *tlv = NULL;
-
-    DEBUG(" - Started\n");
-
-    opData.base.pData = NULL;
-    opData.exponent.pData = NULL;
-    opData.modulus.pData = NULL;
-
-    if (qat_BN_to_FB(&opData.base, (BIGNUM *)base) != 1 ||
-        qat_BN_to_FB(&opData.exponent, (BIGNUM *)exp) != 1 ||
-        qat_BN_to_FB(&opData.modulus, (BIGNUM *)mod) != 1) {
-        WARN("Failed to convert base, exponent or modulus to flatbuffer\n");
-        QATerr(QAT_F_QAT_MOD_EXP, QAT_R_BUF_CONV_FAIL);
-        retval = 0;
-        goto exit;
-    }
-
-    result.dataLenInBytes = BN_num_bytes(mod);
-    result.pData =
-        qaeCryptoMemAlloc(result.dataLenInBytes, __FILE__, __LINE__);
-    if (NULL == result.pData) {
-        WARN("Failed to allocate result.pData\n");
-        QATerr(QAT_F_QAT_MOD_EXP, QAT_R_RESULT_PDATA_ALLOC_FAIL);
-        retval = 0;
-        goto exit;
-    }
+    int func = (op == QAT_LN_MOD_INV) ? QAT_F_QAT_MOD_INV : QAT_F_QAT_MOD_EXP;
 
     tlv = qat_check_create_local_variables();
     if (NULL == tlv) {
             WARN("could not create local variables\n");
-            QATerr(QAT_F_QAT_MOD_EXP, ERR_R_INTERNAL_ERROR);
-            retval = 0;
-            goto exit;
+            QATerr(func, ERR_R_INTERNAL_ERROR);
+            return 0;
     }
 
     QAT_INC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
@@ -199,10 +240,9 @@ int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
         if (tlv->localOpsInFlight == 1) {
             if (pthread_kill(timer_poll_func_thread, SIGUSR1) != 0) {
                 WARN("pthread_kill error\n");
-                QATerr(QAT_F_QAT_MOD_EXP, ERR_R_INTERNAL_ERROR);
-                retval = 0;
+                QATerr(func, ERR_R_INTERNAL_ERROR);
                 QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
-                goto exit;
+                return 0;
             }
         }
     }
@@ -211,11 +251,10 @@ int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
     if (op_done.job != NULL) {
         if (qat_setup_async_event_notification(0) == 0) {
             WARN("Failed to setup async event notifications\n");
-            QATerr(QAT_F_QAT_MOD_EXP, QAT_R_MOD_SETUP_ASYNC_EVENT_FAIL);
-            retval = 0;
+            QATerr(func, QAT_R_MOD_SETUP_ASYNC_EVENT_FAIL);
             qat_cleanup_op_done(&op_done);
             QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
-            goto exit;
+            return 0;
         }
     }
 
@@ -226,19 +265,24 @@ int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
                 CRYPTO_QAT_LOG("Failed to get an instance - fallback to SW - %s\n", __func__);
                 *fallback = 1;
             } else {
-                QATerr(QAT_F_QAT_MOD_EXP, QAT_R_MOD_GET_NEXT_INST_FAIL);
+                QATerr(func, QAT_R_MOD_GET_NEXT_INST_FAIL);
             }
             if (op_done.job != NULL) {
                 qat_clear_async_event_notification();
             }
-            retval = 0;
             qat_cleanup_op_done(&op_done);
             QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
-            goto exit;
+            return 0;
         }
 
-        status = cpaCyLnModExp(qat_instance_handles[inst_num], qat_modexpCallbackFn, &op_done,
-                               &opData, &result);
+        if (op == QAT_LN_MOD_INV)
+            status = cpaCyLnModInv(qat_instance_handles[inst_num],
+                                   qat_lnCallbackFn, &op_done,
+                                   (const CpaCyLnModInvOpData *)opData, result);
+        else
+            status = cpaCyLnModExp(qat_instance_handles[inst_num],
+                                   qat_lnCallbackFn, &op_done,
+                                   (const CpaCyLnModExpOpData *)opData, result);
         if (status == CPA_STATUS_RETRY) {
             if (op_done.job == NULL) {
                 usleep(ulPollInterval +
@@ -271,15 +315,15 @@ int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
                            __func__);
             *fallback = 1;
         } else {
-            QATerr(QAT_F_QAT_MOD_EXP, QAT_R_MOD_LN_MOD_EXP_FAIL);
+            QATerr(func, op == QAT_LN_MOD_INV ?
+                   QAT_R_MOD_LN_MOD_INV_FAIL : QAT_R_MOD_LN_MOD_EXP_FAIL);
         }
         if (op_done.job != NULL) {
             qat_clear_async_event_notification();
         }
-        retval = 0;
         qat_cleanup_op_done(&op_done);
         QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
-        goto exit;
+        return 0;
     }
     if (qat_get_sw_fallback_enabled()) {
         CRYPTO_QAT_LOG("Submit success qat inst_num %d device_id %d - %s\n",
@@ -322,15 +366,69 @@ int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
                            __func__);
             *fallback = 1;
         } else {
-            QATerr(QAT_F_QAT_MOD_EXP, ERR_R_INTERNAL_ERROR);
+            QATerr(func, ERR_R_INTERNAL_ERROR);
         }
-        retval = 0;
         qat_cleanup_op_done(&op_done);
-        goto exit;
+        return 0;
     }
 
     qat_cleanup_op_done(&op_done);
 
+    return 1;
+}
+
+/******************************************************************************
+* function:
+          qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
+                      const BIGNUM *mod, int *fallback)
+*
+* @param res       [IN] - Result bignum of mod_exp
+* @param base      [IN] - Base used for mod_exp
+* @param exp       [IN] - Exponent used for mod_exp
+* @param mod       [IN] - Modulus used for mod_exp
+* @param fallback [OUT] - Pointer to Software Fallback flag
+*
+* description:
+*   Bignum modular exponentiation function used in DH and DSA.
+*
+******************************************************************************/
+int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
+                const BIGNUM *mod, int *fallback)
+{
+    CpaCyLnModExpOpData opData;
+    CpaFlatBuffer result = { 0, };
+    int retval = 1;
+
+    DEBUG(" - Started\n");
+
+    opData.base.pData = NULL;
+    opData.exponent.pData = NULL;
+    opData.modulus.pData = NULL;
+
+    if (qat_BN_to_FB(&opData.base, (BIGNUM *)base) != 1 ||
+        qat_BN_to_FB(&opData.exponent, (BIGNUM *)exp) != 1 ||
+        qat_BN_to_FB(&opData.modulus, (BIGNUM *)mod) != 1) {
+        WARN("Failed to convert base, exponent or modulus to flatbuffer\n");
+        QATerr(QAT_F_QAT_MOD_EXP, QAT_R_BUF_CONV_FAIL);
+        retval = 0;
+        goto exit;
+    }
+
+    result.dataLenInBytes = BN_num_bytes(mod);
+    result.pData =
+        qaeCryptoMemAlloc(result.dataLenInBytes, __FILE__, __LINE__);
+    if (NULL == result.pData) {
+        WARN("Failed to allocate result.pData\n");
+        QATerr(QAT_F_QAT_MOD_EXP, QAT_R_RESULT_PDATA_ALLOC_FAIL);
+        retval = 0;
+        goto exit;
+    }
+
+    if (!qat_ln_perform(QAT_LN_MOD_EXP, &opData, &result, fallback)) {
+        retval = 0;
+        goto exit;
+    }
+
     /* Convert the flatbuffer results back to a BN */
     BN_bin2bn(result.pData, result.dataLenInBytes, res);
 
@@ -347,3 +445,896 @@ int qat_mod_exp(BIGNUM *res, const BIGNUM *base, const BIGNUM *exp,
 
     return retval;
 }
+
+/******************************************************************************
+* function:
+          qat_mod_inv(BIGNUM *res, const BIGNUM *a, const BIGNUM *mod,
+                      int *fallback)
+*
+* @param res      [OUT] - Result bignum, the inverse of a modulo mod
+* @param a        [IN]  - Bignum to invert
+* @param mod      [IN]  - Modulus, a and mod must not both be even
+* @param fallback [OUT] - Pointer to Software Fallback flag
+*
+* description:
+*   Bignum modular inversion function used in key generation. Fails when a
+*   has no inverse modulo mod.
+*
+******************************************************************************/
+int qat_mod_inv(BIGNUM *res, const BIGNUM *a, const BIGNUM *mod,
+                int *fallback)
+{
+    CpaCyLnModInvOpData opData;
+    CpaFlatBuffer result = { 0, };
+    int retval = 1;
+
+    DEBUG(" - Started\n");
+
+    opData.A.pData = NULL;
+    opData.B.pData = NULL;
+
+    if (qat_BN_to_FB(&opData.A, a) != 1 ||
+        qat_BN_to_FB(&opData.B, mod) != 1) {
+        WARN("Failed to convert a or modulus to flatbuffer\n");
+        QATerr(QAT_F_QAT_MOD_INV, QAT_R_BUF_CONV_FAIL);
+        retval = 0;
+        goto exit;
+    }
+
+    result.dataLenInBytes = BN_num_bytes(mod);
+    result.pData =
+        qaeCryptoMemAlloc(result.dataLenInBytes, __FILE__, __LINE__);
+    if (NULL == result.pData) {
+        WARN("Failed to allocate result.pData\n");
+        QATerr(QAT_F_QAT_MOD_INV, QAT_R_RESULT_PDATA_ALLOC_FAIL);
+        retval = 0;
+        goto exit;
+    }
+
+    if (!qat_ln_perform(QAT_LN_MOD_INV, &opData, &result, fallback)) {
+        retval = 0;
+        goto exit;
+    }
+
+    /* Convert the flatbuffer results back to a BN */
+    BN_bin2bn(result.pData, result.dataLenInBytes, res);
+
+ exit:
+
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData.A);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData.B);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(result);
+
+    return retval;
+}
+
+/* Per candidate state of a batch of prime tests */
+typedef struct {
+    CpaCyPrimeTestOpData opData;
+    op_done_rsa_crt_t *op_done;
+    CpaStatus status;
+    CpaBoolean testPassed;
+} qat_prime_test_op_t;
+
+/*
+ * Callback of each of the requests of a batch of prime tests. The response
+ * count is updated last as the requesting thread may release the batch as
+ * soon as it sees all the responses.
+ */
+static void qat_primeTestCallbackFn(void *pCallbackTag, CpaStatus status,
+                                    void *pOpData, CpaBoolean testPassed)
+{
+    qat_prime_test_op_t *op = (qat_prime_test_op_t *)pCallbackTag;
+    op_done_rsa_crt_t *op_done = op->op_done;
+    ASYNC_JOB *job = (ASYNC_JOB *)op_done->opDone.job;
+    unsigned int num_reqs = op_done->num_reqs;
+
+    if (enable_heuristic_polling) {
+        QAT_ATOMIC_DEC(num_asym_requests_in_flight);
+    }
+
+    op->testPassed = testPassed;
+    op->status = status;
+
+    if (QAT_ATOMIC_INC(op_done->resp) == num_reqs && job != NULL)
+        qat_wake_job(job, ASYNC_STATUS_OK);
+}
+
+/******************************************************************************
+* function:
+*         qat_prime_test_batch(BIGNUM **cands, int num, int *passed)
+*
+* @param cands  [IN]  - prime candidates, odd and of at most
+*                       QAT_PRIME_TEST_MAX_BITS bits
+* @param num    [IN]  - number of candidates
+* @param passed [OUT] - set to 1 for the candidates which are probably prime
+*                       and to 0 for the others
+*
+* description:
+*   Tests a batch of prime candidates on the accelerator, the requests being
+*   submitted back to back to the same instance and waited for once. Each
+*   candidate goes through a GCD test against small primes, a Fermat test,
+*   the number of Miller-Rabin rounds OpenSSL uses for its size, with random
+*   witnesses, and a Lucas test. Returns 1 if all the candidates were tested
+*   and 0 otherwise, in which case the caller tests them in software.
+******************************************************************************/
+int qat_prime_test_batch(BIGNUM **cands, int num, int *passed)
+{
+    qat_prime_test_op_t *ops = NULL;
+    op_done_rsa_crt_t op_done;
+    BIGNUM *range = NULL, *witness = NULL;
+    CpaStatus sts = CPA_STATUS_FAIL;
+    int inst_num = QAT_INVALID_INSTANCE;
+    int job_ret = 0, i = 0, j = 0, ret = 0;
+    Cpa32U len = 0, rounds = 0;
+    int qatPerformOpRetries = 0;
+    int iMsgRetry = getQatMsgRetryCount();
+    useconds_t ulPollInterval = getQatPollInterval();
+    thread_local_variables_t *tlv = NULL;
+
+    DEBUG("- Started.\n");
+
+    if (unlikely(cands == NULL || passed == NULL || num <= 0)) {
+        WARN("Invalid batch of %d candidates\n", num);
+        QATerr(QAT_F_QAT_PRIME_TEST_BATCH, QAT_R_INPUT_PARAM_INVALID);
+        return 0;
+    }
+
+    if (qat_get_qat_offload_disabled())
+        return 0;
+
+    ops = OPENSSL_zalloc(num * sizeof(qat_prime_test_op_t));
+    range = BN_new();
+    witness = BN_new();
+    if (ops == NULL || range == NULL || witness == NULL) {
+        WARN("Failed to allocate the batch state\n");
+        QATerr(QAT_F_QAT_PRIME_TEST_BATCH, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (BN_num_bits(cands[i]) > QAT_PRIME_TEST_MAX_BITS ||
+            !BN_is_odd(cands[i]) || BN_cmp(cands[i], BN_value_one()) <= 0) {
+            WARN("Candidate %d cannot be tested on the accelerator\n", i);
+            goto err;
+        }
+        len = BN_num_bytes(cands[i]);
+        rounds = BN_prime_checks_for_size(BN_num_bits(cands[i]));
+        if (rounds > QAT_PRIME_TEST_MAX_ROUNDS)
+            rounds = QAT_PRIME_TEST_MAX_ROUNDS;
+
+        ops[i].op_done = &op_done;
+        ops[i].status = CPA_STATUS_FAIL;
+        ops[i].opData.performGcdTest = CPA_TRUE;
+        ops[i].opData.performFermatTest = CPA_TRUE;
+        ops[i].opData.numMillerRabinRounds = rounds;
+        ops[i].opData.performLucasTest = CPA_TRUE;
+        if (qat_BN_to_FB(&ops[i].opData.primeCandidate, cands[i]) != 1) {
+            WARN("Failed to convert candidate %d to flatbuffer\n", i);
+            QATerr(QAT_F_QAT_PRIME_TEST_BATCH, QAT_R_BUF_CONV_FAIL);
+            goto err;
+        }
+
+        /* One witness per round, each of the size of the candidate */
+        ops[i].opData.millerRabinRandomInput.pData =
+            qaeCryptoMemAlloc(rounds * len, __FILE__, __LINE__);
+        if (ops[i].opData.millerRabinRandomInput.pData == NULL) {
+            WARN("Failed to allocate millerRabinRandomInput\n");
+            QATerr(QAT_F_QAT_PRIME_TEST_BATCH, QAT_R_RESULT_PDATA_ALLOC_FAIL);
+            goto err;
+        }
+        ops[i].opData.millerRabinRandomInput.dataLenInBytes = rounds * len;
+
+        /* witnesses are drawn from [2, candidate - 2] */
+        if (!BN_sub(range, cands[i], BN_value_one()) ||
+            !BN_sub_word(range, 2))
+            goto err;
+        for (j = 0; j < rounds; j++) {
+            if (!BN_rand_range(witness, range) ||
+                !BN_add_word(witness, 2) ||
+                BN_bn2binpad(witness,
+                             ops[i].opData.millerRabinRandomInput.pData + j * len,
+                             len) < 0) {
+                WARN("Failed to generate the Miller-Rabin witnesses\n");
+                QATerr(QAT_F_QAT_PRIME_TEST_BATCH, ERR_R_BN_LIB);
+                goto err;
+            }
+        }
+    }
+
+    tlv = qat_check_create_local_variables();
+    if (NULL == tlv) {
+        WARN("could not create local variables\n");
+        QATerr(QAT_F_QAT_PRIME_TEST_BATCH, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    QAT_INC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+    if (qat_use_signals()) {
+        if (tlv->localOpsInFlight == 1) {
+            if (pthread_kill(timer_poll_func_thread, SIGUSR1) != 0) {
+                WARN("pthread_kill error\n");
+                QATerr(QAT_F_QAT_PRIME_TEST_BATCH, ERR_R_INTERNAL_ERROR);
+                QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+                goto err;
+            }
+        }
+    }
+
+    if (qat_init_op_done_rsa_crt(&op_done, num) != 1) {
+        WARN("failed to init opdone for the batch\n");
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        goto err;
+    }
+
+    if ((inst_num = get_next_inst_num()) == QAT_INVALID_INSTANCE) {
+        WARN("Failure to get an instance\n");
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
+        qat_cleanup_op_done_rsa_crt(&op_done);
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        goto err;
+    }
+
+    /* send the requests back to back so that the ring is kept full */
+    for (i = 0; i < num; i++) {
+        do {
+            sts = cpaCyPrimeTest(qat_instance_handles[inst_num],
+                                 qat_primeTestCallbackFn, &ops[i],
+                                 &ops[i].opData, &ops[i].testPassed);
+            if (sts == CPA_STATUS_RETRY) {
+                if (op_done.opDone.job == NULL) {
+                    usleep(ulPollInterval +
+                           (qatPerformOpRetries % QAT_RETRY_BACKOFF_MODULO_DIVISOR));
+                    qatPerformOpRetries++;
+                    if (iMsgRetry != QAT_INFINITE_MAX_NUM_RETRIES) {
+                        if (qatPerformOpRetries >= iMsgRetry) {
+                            WARN("No. of retries exceeded max retry : %d\n", iMsgRetry);
+                            break;
+                        }
+                    }
+                } else {
+                    if ((qat_wake_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0) ||
+                        (qat_pause_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0)) {
+                        WARN("qat_wake_job or qat_pause_job failed\n");
+                        break;
+                    }
+                }
+            }
+        }
+        while (sts == CPA_STATUS_RETRY);
+
+        if (sts != CPA_STATUS_SUCCESS) {
+            WARN("Failed to submit request %d to qat - status = %d\n", i, sts);
+            break;
+        }
+
+        op_done.req++;
+        if (enable_heuristic_polling) {
+            QAT_ATOMIC_INC(num_asym_requests_in_flight);
+        }
+    }
+
+    /* wait for replies */
+    if (op_done.req == num && op_done.opDone.job != NULL) {
+        do {
+            /* If we get a failure on qat_pause_job then we will
+               not flag an error here and quit because we have
+               asynchronous requests in flight.
+               We don't want to start cleaning up data
+               structures that are still being used. If
+               qat_pause_job fails we will just yield and
+               loop around and try again until the requests
+               complete and we can continue. */
+            if ((job_ret = qat_pause_job(op_done.opDone.job, ASYNC_STATUS_OK)) == 0)
+                pthread_yield();
+        } while (op_done.resp != op_done.req ||
+                 QAT_CHK_JOB_RESUMED_UNEXPECTEDLY(job_ret));
+    } else {
+        /*
+         * Sync mode, or a submission failed in which case the callback
+         * will not wake the job and the outstanding responses are polled
+         * for here before the buffers are released.
+         */
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
+        while (op_done.resp != op_done.req) {
+            if(getEnableInlinePolling()) {
+                icp_sal_CyPollInstance(qat_instance_handles[inst_num], 0);
+            }
+            else
+                pthread_yield();
+        }
+    }
+    QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+    qat_cleanup_op_done_rsa_crt(&op_done);
+
+    for (i = 0; i < num; i++) {
+        if (ops[i].status != CPA_STATUS_SUCCESS) {
+            WARN("Prime test %d failed - status = %d\n", i, ops[i].status);
+            goto err;
+        }
+        passed[i] = (ops[i].testPassed == CPA_TRUE);
+    }
+    ret = 1;
+
+ err:
+    if (ops != NULL) {
+        for (i = 0; i < num; i++) {
+            QAT_CHK_CLNSE_QMFREE_FLATBUFF(ops[i].opData.primeCandidate);
+            QAT_CHK_QMFREE_FLATBUFF(ops[i].opData.millerRabinRandomInput);
+        }
+        OPENSSL_free(ops);
+    }
+    BN_free(range);
+    BN_free(witness);
+    DEBUG("- Finished\n");
+    return ret;
+}
+
+/* Odd primes below QAT_PRIME_SIEVE_LIMIT, used to sieve the candidates */
+static unsigned short qat_sieve_primes[QAT_PRIME_SIEVE_LIMIT / 2];
+static int qat_num_sieve_primes = 0;
+static pthread_once_t qat_sieve_primes_once = PTHREAD_ONCE_INIT;
+
+static void qat_sieve_primes_init(void)
+{
+    unsigned char composite[QAT_PRIME_SIEVE_LIMIT] = { 0 };
+    int i = 0, j = 0;
+
+    for (i = 3; i < QAT_PRIME_SIEVE_LIMIT; i += 2) {
+        if (composite[i])
+            continue;
+        qat_sieve_primes[qat_num_sieve_primes++] = i;
+        for (j = i * i; j < QAT_PRIME_SIEVE_LIMIT; j += 2 * i)
+            composite[j] = 1;
+    }
+}
+
+/******************************************************************************
+* function:
+*         qat_prime_candidate(BIGNUM *cand, BIGNUM *tmp, int bits, int safe,
+*                             const BIGNUM *add, const BIGNUM *rem,
+*                             BN_CTX *ctx)
+*
+* description:
+*   Draws a random prime candidate as BN_generate_prime_ex does: of exactly
+*   bits bits with the top two bits set, or congruent to rem modulo add, and
+*   such that (cand - 1) / 2 is also a candidate when safe is set. Returns 1
+*   if the candidate has no small factor, 0 if it has one and -1 on error.
+******************************************************************************/
+static int qat_prime_candidate(BIGNUM *cand, BIGNUM *tmp, int bits, int safe,
+                               const BIGNUM *add, const BIGNUM *rem,
+                               BN_CTX *ctx)
+{
+    BN_ULONG mod = 0;
+    int i = 0;
+
+    if (safe) {
+        /* draw q and set cand to 2q + 1 */
+        if (!BN_rand(cand, bits - 1, BN_RAND_TOP_ONE, BN_RAND_BOTTOM_ODD))
+            return -1;
+        if (add != NULL) {
+            if (!BN_rshift1(tmp, add) ||
+                !BN_mod(tmp, cand, tmp, ctx) ||
+                !BN_sub(cand, cand, tmp))
+                return -1;
+            if (rem == NULL) {
+                if (!BN_add_word(cand, 1))
+                    return -1;
+            } else {
+                if (!BN_rshift1(tmp, rem) || !BN_add(cand, cand, tmp))
+                    return -1;
+            }
+        }
+        if (!BN_lshift1(cand, cand) || !BN_add_word(cand, 1))
+            return -1;
+    } else {
+        if (!BN_rand(cand, bits,
+                     add == NULL ? BN_RAND_TOP_TWO : BN_RAND_TOP_ONE,
+                     BN_RAND_BOTTOM_ODD))
+            return -1;
+        if (add != NULL) {
+            if (!BN_mod(tmp, cand, add, ctx) || !BN_sub(cand, cand, tmp))
+                return -1;
+            if (rem == NULL) {
+                if (!BN_add_word(cand, 1))
+                    return -1;
+            } else {
+                if (!BN_add(cand, cand, rem))
+                    return -1;
+            }
+        }
+    }
+
+    if (BN_num_bits(cand) != bits || !BN_is_odd(cand))
+        return 0;
+
+    for (i = 0; i < qat_num_sieve_primes; i++) {
+        if ((mod = BN_mod_word(cand, qat_sieve_primes[i])) == (BN_ULONG)-1)
+            return -1;
+        /* (cand - 1) / 2 is divisible by an odd prime which cand - 1 is */
+        if (mod == 0 || (safe && mod == 1))
+            return 0;
+    }
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*         qat_generate_prime(BIGNUM *ret, int bits, int safe,
+*                            const BIGNUM *add, const BIGNUM *rem,
+*                            BN_GENCB *cb)
+*
+* @param ret  [OUT] - the prime
+* @param bits [IN]  - size of the prime in bits
+* @param safe [IN]  - whether (ret - 1) / 2 must also be prime
+* @param add  [IN]  - if not NULL, ret modulo add must be rem, or 1 if rem is
+*                     NULL
+* @param rem  [IN]  - see add
+* @param cb   [IN]  - callback reporting the progress as for
+*                     BN_generate_prime_ex
+*
+* description:
+*   Generates a probable prime as BN_generate_prime_ex does. The candidates
+*   are sieved on core and tested by batches of QAT_PRIME_TEST_BATCH on the
+*   accelerator, the first one of a batch to pass being the prime. A batch
+*   that cannot be tested on the accelerator is tested on core. Sizes the
+*   accelerator does not test are generated by BN_generate_prime_ex.
+*   Returns 1 on success and 0 on failure.
+******************************************************************************/
+int qat_generate_prime(BIGNUM *ret, int bits, int safe, const BIGNUM *add,
+                       const BIGNUM *rem, BN_GENCB *cb)
+{
+    BIGNUM *tests[2 * QAT_PRIME_TEST_BATCH] = { NULL, };
+    int passed[2 * QAT_PRIME_TEST_BATCH] = { 0, };
+    BIGNUM *tmp = NULL;
+    BN_CTX *ctx = NULL;
+    int i = 0, n = 0, num_tests = 0, found = 0, res = 0, count = 0;
+
+    if (bits < QAT_PRIME_TEST_MIN_BITS || bits > QAT_PRIME_TEST_MAX_BITS ||
+        qat_get_qat_offload_disabled())
+        return BN_generate_prime_ex(ret, bits, safe, add, rem, cb);
+
+    pthread_once(&qat_sieve_primes_once, qat_sieve_primes_init);
+
+    if ((ctx = BN_CTX_new()) == NULL) {
+        WARN("Failure to allocate ctx\n");
+        QATerr(QAT_F_QAT_GENERATE_PRIME, QAT_R_CTX_MALLOC_FAILURE);
+        return 0;
+    }
+    BN_CTX_start(ctx);
+    tmp = BN_CTX_get(ctx);
+    num_tests = safe ? 2 * QAT_PRIME_TEST_BATCH : QAT_PRIME_TEST_BATCH;
+    for (i = 0; i < num_tests; i++)
+        tests[i] = BN_CTX_get(ctx);
+    if (tests[num_tests - 1] == NULL) {
+        WARN("Failure to allocate the candidates\n");
+        QATerr(QAT_F_QAT_GENERATE_PRIME, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    while (!found) {
+        for (n = 0; n < QAT_PRIME_TEST_BATCH;) {
+            res = qat_prime_candidate(tests[n], tmp, bits, safe, add, rem, ctx);
+            if (res < 0) {
+                WARN("Failure to draw a candidate\n");
+                QATerr(QAT_F_QAT_GENERATE_PRIME, ERR_R_BN_LIB);
+                goto err;
+            }
+            if (res == 0)
+                continue;
+            if (!BN_GENCB_call(cb, 0, count++))
+                goto err;
+            n++;
+        }
+
+        /* the halves of safe prime candidates are tested alongside them */
+        if (safe) {
+            for (n = 0; n < QAT_PRIME_TEST_BATCH; n++) {
+                if (!BN_rshift1(tests[QAT_PRIME_TEST_BATCH + n], tests[n])) {
+                    QATerr(QAT_F_QAT_GENERATE_PRIME, ERR_R_BN_LIB);
+                    goto err;
+                }
+            }
+        }
+
+        if (!qat_prime_test_batch(tests, num_tests, passed)) {
+            WARN("Prime test batch failed - testing on core\n");
+            for (i = 0; i < num_tests; i++) {
+                passed[i] = BN_is_prime_fasttest_ex(tests[i], BN_prime_checks,
+                                                    ctx, 0, cb);
+                if (passed[i] < 0)
+                    goto err;
+            }
+        }
+
+        for (n = 0; n < QAT_PRIME_TEST_BATCH && !found; n++) {
+            if (passed[n] && (!safe || passed[QAT_PRIME_TEST_BATCH + n])) {
+                if (BN_copy(ret, tests[n]) == NULL) {
+                    QATerr(QAT_F_QAT_GENERATE_PRIME, ERR_R_BN_LIB);
+                    goto err;
+                }
+                found = 1;
+            }
+        }
+        if (!BN_GENCB_call(cb, 1, found))
+            goto err;
+    }
+
+ err:
+    BN_CTX_end(ctx);
+    BN_CTX_free(ctx);
+    return found;
+}
+
+/******************************************************************************
+* function:
+*         qat_asym_threshold_table_set_threshold(const char *op_name,
+*                                                int threshold)
+*
+* @param op_name   [IN] - name of the operation, e.g. "RSA-PUB"
+* @param threshold [IN] - smallest key size in bits offloaded
+*
+* description:
+*   Sets the size below which an asymmetric operation is performed in
+*   software. Returns 1 on success and 0 if the operation is unknown.
+******************************************************************************/
+int qat_asym_threshold_table_set_threshold(const char *op_name, int threshold)
+{
+    int i = 0;
+
+    if (threshold < 0)
+        threshold = 0;
+    else if (threshold > QAT_ASYM_THRESHOLD_MAX)
+        threshold = QAT_ASYM_THRESHOLD_MAX;
+
+    DEBUG("Set asymmetric offload threshold for %s: %d\n", op_name, threshold);
+
+    for (i = 0; i < QAT_ASYM_NUM_OPS; i++) {
+        if (strcmp(qat_asym_dispatch_table[i].name, op_name) == 0) {
+            qat_asym_dispatch_table[i].threshold = threshold;
+            return 1;
+        }
+    }
+
+    WARN("%s not found in the asymmetric threshold table\n", op_name);
+    return 0;
+}
+
+static qat_asym_tune_slot_t *qat_asym_tune_get_slot(qat_asym_dispatch_t *entry,
+                                                    int bits)
+{
+    int i = 0;
+
+    for (i = 0; i < QAT_ASYM_TUNE_SLOTS; i++) {
+        if (entry->slots[i].bits == 0)
+            __sync_bool_compare_and_swap(&entry->slots[i].bits, 0, bits);
+        if (entry->slots[i].bits == bits)
+            return &entry->slots[i];
+    }
+    return NULL;
+}
+
+/******************************************************************************
+* function:
+*         qat_asym_dispatch_begin(qat_asym_sample_t *sample,
+*                                 qat_asym_op_t op,
+*                                 int bits)
+*
+* @param sample [OUT] - latency sample to pass to qat_asym_dispatch_end
+* @param op     [IN]  - asymmetric operation
+* @param bits   [IN]  - key size in bits
+*
+* description:
+*   Decides whether an operation is offloaded, returning 1, or performed in
+*   software, returning 0. Keys smaller than the threshold of the operation
+*   stay in software. With auto-tuning enabled the operations performed
+*   outside of an async job are timed, the time of an operation paused in
+*   an async job not being its cost, and each key size goes to the path with
+*   the lowest average latency once both paths have been sampled. A small
+*   share of the operations keeps probing the other path so that the choice
+*   follows the load of the accelerator.
+******************************************************************************/
+int qat_asym_dispatch_begin(qat_asym_sample_t *sample, qat_asym_op_t op,
+                            int bits)
+{
+    qat_asym_dispatch_t *entry = &qat_asym_dispatch_table[op];
+    qat_asym_tune_slot_t *slot = NULL;
+    unsigned int calls = 0;
+
+    sample->slot = NULL;
+    sample->offload = (bits >= entry->threshold);
+
+    if (!sample->offload || !enable_asym_auto_tune ||
+        ASYNC_get_current_job() != NULL ||
+        (slot = qat_asym_tune_get_slot(entry, bits)) == NULL)
+        return sample->offload;
+
+    calls = QAT_ATOMIC_INC(slot->calls);
+    if (slot->qat_samples < QAT_ASYM_TUNE_WARMUP ||
+        slot->sw_samples < QAT_ASYM_TUNE_WARMUP) {
+        sample->offload = calls & 1;
+    } else {
+        sample->offload = (slot->qat_ns <= slot->sw_ns);
+        if (calls % QAT_ASYM_TUNE_PROBE == 0)
+            sample->offload = !sample->offload;
+    }
+
+    sample->slot = slot;
+    clock_gettime(CLOCK_MONOTONIC, &sample->start);
+    return sample->offload;
+}
+
+static void qat_asym_tune_update(volatile unsigned long *avg,
+                                 volatile unsigned int *samples,
+                                 unsigned long ns)
+{
+    if (*samples == 0)
+        *avg = ns;
+    else
+        *avg = *avg - (*avg >> QAT_ASYM_TUNE_EWMA_SHIFT) +
+               (ns >> QAT_ASYM_TUNE_EWMA_SHIFT);
+    if (*samples < QAT_ASYM_TUNE_WARMUP)
+        QAT_ATOMIC_INC(*samples);
+}
+
+/******************************************************************************
+* function:
+*         qat_asym_dispatch_end(qat_asym_sample_t *sample)
+*
+* @param sample [IN] - latency sample filled in by qat_asym_dispatch_begin
+*
+* description:
+*   Records the latency of a completed operation if it was timed. Only
+*   successful operations are recorded, failed ones simply do not call it.
+******************************************************************************/
+void qat_asym_dispatch_end(qat_asym_sample_t *sample)
+{
+    qat_asym_tune_slot_t *slot = (qat_asym_tune_slot_t *)sample->slot;
+    struct timespec now;
+    unsigned long ns = 0;
+
+    if (slot == NULL)
+        return;
+    sample->slot = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ns = (now.tv_sec - sample->start.tv_sec) * 1000000000UL +
+         now.tv_nsec - sample->start.tv_nsec;
+
+    if (sample->offload)
+        qat_asym_tune_update(&slot->qat_ns, &slot->qat_samples, ns);
+    else
+        qat_asym_tune_update(&slot->sw_ns, &slot->sw_samples, ns);
+}
+
+/*
+ * Pools of values that only depend on the parameters of an operation, such
+ * as ECDSA nonces or ephemeral keys, precomputed on the accelerator by a
+ * background thread so that the expensive part of the operation is off its
+ * critical path. Every value is handed out once. The pools are emptied
+ * whenever the engine is finished, including before a fork, so that a value
+ * is never shared between two processes.
+ */
+typedef struct {
+    const qat_asym_pool_ops_t *ops;
+    void *ctx;                  /* Parameters, only used by the refill thread */
+    int size;
+    int count;
+    int filling;
+    void **items;
+} qat_asym_pool_t;
+
+#define QAT_ASYM_POOL_MAX_POOLS 32
+/* Requests in flight above which the accelerator is not considered idle */
+#define QAT_ASYM_POOL_BUSY_REQUESTS 32
+
+static qat_asym_pool_t *qat_asym_pools[QAT_ASYM_POOL_MAX_POOLS];
+static pthread_mutex_t qat_asym_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t qat_asym_pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t qat_asym_pool_thread;
+static int qat_asym_pool_thread_running = 0;
+static pid_t qat_asym_pool_pid = 0;
+
+static void qat_asym_pool_empty(qat_asym_pool_t *pool)
+{
+    while (pool->count > 0) {
+        pool->count--;
+        pool->ops->item_free(pool->items[pool->count]);
+        pool->items[pool->count] = NULL;
+    }
+    pool->filling = 0;
+}
+
+static int qat_asym_pool_device_busy(void)
+{
+    return num_requests_in_flight >= QAT_ASYM_POOL_BUSY_REQUESTS ||
+           num_asym_requests_in_flight >= QAT_ASYM_POOL_BUSY_REQUESTS;
+}
+
+static void *qat_asym_pool_refill_func(void *arg)
+{
+    qat_asym_pool_t *pool = NULL;
+    void *item = NULL;
+    int i = 0;
+
+    pthread_mutex_lock(&qat_asym_pool_mutex);
+    while (qat_asym_pool_thread_running) {
+        pool = NULL;
+        for (i = 0; i < QAT_ASYM_POOL_MAX_POOLS && qat_asym_pools[i] != NULL; i++) {
+            if (qat_asym_pools[i]->filling) {
+                pool = qat_asym_pools[i];
+                break;
+            }
+        }
+        if (pool == NULL) {
+            pthread_cond_wait(&qat_asym_pool_cond, &qat_asym_pool_mutex);
+            continue;
+        }
+
+        /* Leave the accelerator to the application while it is busy */
+        if (!engine_inited || qat_asym_pool_device_busy()) {
+            pthread_mutex_unlock(&qat_asym_pool_mutex);
+            usleep(getQatPollInterval());
+            pthread_mutex_lock(&qat_asym_pool_mutex);
+            continue;
+        }
+
+        /* The items only change under the lock, the context is ours */
+        pthread_mutex_unlock(&qat_asym_pool_mutex);
+        item = pool->ops->item_new(pool->ctx);
+        pthread_mutex_lock(&qat_asym_pool_mutex);
+
+        if (item == NULL) {
+            /* Retried on the next draw from the pool */
+            WARN("Failed to precompute an item for a pool\n");
+            pool->filling = 0;
+            continue;
+        }
+        if (pool->count < pool->size) {
+            pool->items[pool->count++] = item;
+            item = NULL;
+        }
+        if (pool->count == pool->size)
+            pool->filling = 0;
+        if (item != NULL)
+            pool->ops->item_free(item);
+    }
+    pthread_mutex_unlock(&qat_asym_pool_mutex);
+
+    return NULL;
+}
+
+/******************************************************************************
+* function:
+*         qat_asym_pool_get(const qat_asym_pool_ops_t *ops, const void *params,
+*                           int size, int refill)
+*
+* @param ops    [IN] - Operations of the type of pool
+* @param params [IN] - Parameters of the operation, e.g. the EC_GROUP or DH
+* @param size   [IN] - Size of the pool if it has to be created
+* @param refill [IN] - Number of items left at which the pool is refilled,
+*                      or a negative value for half the size
+*
+* description:
+*   Takes a precomputed value for the parameters out of their pool, creating
+*   the pool and starting the refill thread on first use. The caller owns the
+*   value and must free it. Returns NULL when the pool is disabled, full of
+*   pools or empty, in which case the caller computes the value inline.
+******************************************************************************/
+void *qat_asym_pool_get(const qat_asym_pool_ops_t *ops, const void *params,
+                        int size, int refill)
+{
+    qat_asym_pool_t *pool = NULL;
+    void *item = NULL;
+    pid_t pid = getpid();
+    int i = 0;
+
+    if (size <= 0 || !engine_inited)
+        return NULL;
+
+    pthread_mutex_lock(&qat_asym_pool_mutex);
+
+    if (qat_asym_pool_pid != pid) {
+        /* Never hand out a value that was inherited from the parent */
+        for (i = 0; i < QAT_ASYM_POOL_MAX_POOLS && qat_asym_pools[i] != NULL; i++)
+            qat_asym_pool_empty(qat_asym_pools[i]);
+        qat_asym_pool_thread_running = 0;
+        qat_asym_pool_pid = pid;
+    }
+
+    for (i = 0; i < QAT_ASYM_POOL_MAX_POOLS && qat_asym_pools[i] != NULL; i++) {
+        if (qat_asym_pools[i]->ops == ops &&
+            ops->ctx_match(qat_asym_pools[i]->ctx, params)) {
+            pool = qat_asym_pools[i];
+            break;
+        }
+    }
+
+    if (pool == NULL && i < QAT_ASYM_POOL_MAX_POOLS) {
+        if ((pool = OPENSSL_zalloc(sizeof(qat_asym_pool_t))) == NULL ||
+            (pool->items = OPENSSL_zalloc(size * sizeof(void *))) == NULL ||
+            (pool->ctx = ops->ctx_new(params)) == NULL) {
+            WARN("Failed to allocate a pool\n");
+            if (pool != NULL) {
+                OPENSSL_free(pool->items);
+                OPENSSL_free(pool);
+                pool = NULL;
+            }
+        } else {
+            pool->ops = ops;
+            pool->size = size;
+            qat_asym_pools[i] = pool;
+        }
+    }
+
+    if (pool != NULL) {
+        if (pool->count > 0) {
+            item = pool->items[--pool->count];
+            pool->items[pool->count] = NULL;
+        }
+        if (refill < 0)
+            refill = pool->size / 2;
+        if (!pool->filling && pool->count < pool->size &&
+            pool->count <= refill) {
+            pool->filling = 1;
+            if (!qat_asym_pool_thread_running) {
+                qat_asym_pool_thread_running = 1;
+                if (qat_create_thread(&qat_asym_pool_thread, NULL,
+                                      qat_asym_pool_refill_func, NULL)) {
+                    WARN("Failed to create the pool refill thread\n");
+                    qat_asym_pool_thread_running = 0;
+                    pool->filling = 0;
+                }
+            }
+            pthread_cond_signal(&qat_asym_pool_cond);
+        }
+    }
+
+    pthread_mutex_unlock(&qat_asym_pool_mutex);
+
+    return item;
+}
+
+/******************************************************************************
+* function:
+*         qat_asym_pools_stop(void)
+*
+* description:
+*   Stops the pool refill thread and discards every precomputed value. Called
+*   when the engine is finished, before the instances are stopped.
+******************************************************************************/
+void qat_asym_pools_stop(void)
+{
+    int running = 0;
+    int i = 0;
+
+    pthread_mutex_lock(&qat_asym_pool_mutex);
+    running = qat_asym_pool_thread_running && qat_asym_pool_pid == getpid();
+    qat_asym_pool_thread_running = 0;
+    pthread_cond_broadcast(&qat_asym_pool_cond);
+    pthread_mutex_unlock(&qat_asym_pool_mutex);
+
+    if (running && qat_join_thread(qat_asym_pool_thread, NULL) != 0) {
+        WARN("Pool refill thread join failed\n");
+    }
+
+    pthread_mutex_lock(&qat_asym_pool_mutex);
+    for (i = 0; i < QAT_ASYM_POOL_MAX_POOLS && qat_asym_pools[i] != NULL; i++)
+        qat_asym_pool_empty(qat_asym_pools[i]);
+    pthread_mutex_unlock(&qat_asym_pool_mutex);
+}
+
+void qat_asym_pools_free(void)
+{
+    int i = 0;
+
+    qat_asym_pools_stop();
+    for (i = 0; i < QAT_ASYM_POOL_MAX_POOLS && qat_asym_pools[i] != NULL; i++) {
+        qat_asym_pools[i]->ops->ctx_free(qat_asym_pools[i]->ctx);
+        OPENSSL_free(qat_asym_pools[i]->items);
+        OPENSSL_free(qat_asym_pools[i]);
+        qat_asym_pools[i] = NULL;
+    }
+}
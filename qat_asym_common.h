@@ -46,12 +46,63 @@
 #ifndef QAT_ASYM_COMMON_H
 # define QAT_ASYM_COMMON_H
 
+# include <time.h>
 # include <openssl/ossl_typ.h>
 
 # include "cpa.h"
 
+/* Asymmetric operations dispatched between the accelerator and software */
+typedef enum {
+    QAT_ASYM_RSA_PUB = 0,
+    QAT_ASYM_RSA_PRIV,
+    QAT_ASYM_ECDSA_SIGN,
+    QAT_ASYM_ECDSA_VERIFY,
+    QAT_ASYM_ECDH,
+    QAT_ASYM_DH,
+    QAT_ASYM_DSA_SIGN,
+    QAT_ASYM_DSA_VERIFY,
+    QAT_ASYM_NUM_OPS
+} qat_asym_op_t;
+
+/* Latency sample of an operation, filled in by qat_asym_dispatch_begin */
+typedef struct {
+    void *slot;
+    int offload;
+    struct timespec start;
+} qat_asym_sample_t;
+
 int qat_BN_to_FB(CpaFlatBuffer * fb, const BIGNUM *bn);
 int qat_mod_exp(BIGNUM *r, const BIGNUM *a, const BIGNUM *p, const BIGNUM *m,
                 int *fallback);
+int qat_mod_inv(BIGNUM *res, const BIGNUM *a, const BIGNUM *mod,
+                int *fallback);
+
+/* Largest prime candidate tested on the accelerator */
+# define QAT_PRIME_TEST_MAX_BITS 4096
+
+int qat_prime_test_batch(BIGNUM **cands, int num, int *passed);
+int qat_generate_prime(BIGNUM *ret, int bits, int safe, const BIGNUM *add,
+                       const BIGNUM *rem, BN_GENCB *cb);
+
+int qat_asym_threshold_table_set_threshold(const char *op_name, int threshold);
+int qat_asym_dispatch_begin(qat_asym_sample_t *sample, qat_asym_op_t op,
+                            int bits);
+void qat_asym_dispatch_end(qat_asym_sample_t *sample);
+
+/* Operations of a type of pool of precomputed values */
+typedef struct {
+    void *(*ctx_new)(const void *params);
+    void (*ctx_free)(void *ctx);
+    int (*ctx_match)(const void *ctx, const void *params);
+    void *(*item_new)(void *ctx);   /* Run by the refill thread */
+    void (*item_free)(void *item);
+} qat_asym_pool_ops_t;
+
+# define QAT_ASYM_POOL_MAX_SIZE 4096
+
+void *qat_asym_pool_get(const qat_asym_pool_ops_t *ops, const void *params,
+                        int size, int refill);
+void qat_asym_pools_stop(void);
+void qat_asym_pools_free(void);
 
 #endif                          /* QAT_ASYM_COMMON_H */
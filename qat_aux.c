@@ -56,6 +56,8 @@
 #include <openssl/crypto.h>
 
 #include "qat_aux.h"
+#include "qat_ec.h"
+#include "qat_dh.h"
 
 int qatPerformOpRetries = 0;
 
@@ -134,6 +136,21 @@ void qat_free_EC_methods(void)
     return;
 }
 
+int qat_ec_pool_set_size(qat_ec_pool_type_t type, long size)
+{
+    return 0;
+}
+
+int qat_ec_pool_set_refill_threshold(qat_ec_pool_type_t type, long threshold)
+{
+    return 0;
+}
+
+int qat_ecdsa_do_verify_batch(qat_ecdsa_verify_req_t *reqs, int num_reqs)
+{
+    return 0;
+}
+
 int ENGINE_set_EC(ENGINE *e, const EC_KEY_METHOD *ec_meth)
 {
     return 1;
@@ -149,6 +166,11 @@ void qat_free_DH_methods(void)
     return;
 }
 
+int qat_dh_key_pool_set_size(int bits, long size)
+{
+    return 0;
+}
+
 DSA_METHOD *qat_get_DSA_methods(void)
 {
     return NULL;
@@ -123,10 +123,10 @@ int qat_init_op_done_pipe(op_done_pipe_t *opdpipe, unsigned int npipes)
     return 1;
 }
 
-int qat_init_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt)
+int qat_init_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt, unsigned int num_reqs)
 {
-    if (unlikely(opdcrt == NULL)) {
-        WARN("opdcrt is NULL\n");
+    if (unlikely(opdcrt == NULL || num_reqs == 0)) {
+        WARN("opdcrt is NULL or num_reqs is 0\n");
         QATerr(QAT_F_QAT_INIT_OP_DONE_RSA_CRT, QAT_R_OPDCRT_NULL);
         return 0;
     }
@@ -136,11 +136,21 @@ int qat_init_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt)
     opdcrt->opDone.verifyResult = CPA_TRUE;
     opdcrt->opDone.status = CPA_STATUS_SUCCESS;
 
-    opdcrt->opDone.job = NULL;
-
+    opdcrt->num_reqs = num_reqs;
     opdcrt->req = 0;
     opdcrt->resp = 0;
 
+    opdcrt->opDone.job = ASYNC_get_current_job();
+
+    /* Setup async notification if using async jobs. */
+    if (opdcrt->opDone.job != NULL &&
+        (qat_setup_async_event_notification(0) == 0)) {
+        WARN("Failure to setup async event notifications\n");
+        QATerr(QAT_F_QAT_INIT_OP_DONE_RSA_CRT, QAT_R_SETUP_ASYNC_EVENT_FAILURE);
+        qat_cleanup_op_done_rsa_crt(opdcrt);
+        return 0;
+    }
+
     return 1;
 }
 
@@ -87,6 +87,7 @@ typedef struct {
      * to allow inter-changeability by casting pointers.
      */
     op_done_t opDone;
+    unsigned int num_reqs;
     unsigned int req;
     volatile unsigned int resp;
 } op_done_rsa_crt_t;
@@ -123,16 +124,19 @@ int qat_init_op_done_pipe(op_done_pipe_t *opDone, unsigned int npipes);
 
 /******************************************************************************
  * function:
- *         qat_init_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt)
+ *         qat_init_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt,
+ *                                  unsigned int num_reqs)
  *
- * @param opdcrt [IN] - pointer to op_done_rsa_crt_t callback structure.
+ * @param opdcrt   [IN] - pointer to op_done_rsa_crt_t callback structure.
+ * @param num_reqs [IN] - number of requests the operation is made of.
  *
  * description:
- *   Initialise the QAT RSA synchronous operation "done" callback structure.
- *   The function returns 1 for success and 0 for failure.
+ *   Initialise the QAT RSA CRT operation "done" callback structure.
+ *   Setup async event notification if required. The function returns
+ *   1 for success and 0 for failure.
  *
  ******************************************************************************/
-int qat_init_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt);
+int qat_init_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt, unsigned int num_reqs);
 
 
 /******************************************************************************
@@ -168,7 +172,7 @@ void qat_cleanup_op_done_pipe(op_done_pipe_t *opDone);
  * @param opdcrt [IN] - pointer to op_done_rsa_crt_t callback structure.
  *
  * description:
- *   Cleanup the QAT RSA synchronous operation "done" callback structure.
+ *   Cleanup the QAT RSA CRT operation "done" callback structure.
  *
  ******************************************************************************/
 void qat_cleanup_op_done_rsa_crt(op_done_rsa_crt_t *opdcrt);
@@ -90,6 +90,7 @@
 #include <openssl/tls1.h>
 #include <openssl/async.h>
 #include <openssl/lhash.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
 #include <string.h>
 
@@ -117,6 +118,14 @@
                     (b2).dataLenInBytes = len; \
                 } while(0)
 
+#define FLATBUFF_SET_AND_CHAIN(b1, b2, buf, len) \
+                do { \
+                    (b1).pData = (buf); \
+                    (b2).pData = (b1).pData; \
+                    (b1).dataLenInBytes = len; \
+                    (b2).dataLenInBytes = len; \
+                } while(0)
+
 # define GET_SW_CIPHER(ctx) \
     qat_chained_cipher_sw_impl(EVP_CIPHER_CTX_nid((ctx)))
 
@@ -135,6 +144,13 @@ static int qat_chained_ciphers_do_cipher(EVP_CIPHER_CTX *ctx,
                                          const unsigned char *in, size_t len);
 static int qat_chained_ciphers_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg,
                                     void *ptr);
+static int qat_aead_init(EVP_CIPHER_CTX *ctx, const unsigned char *inkey,
+                         const unsigned char *iv, int enc);
+static int qat_aead_cleanup(EVP_CIPHER_CTX *ctx);
+static int qat_aead_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+                              const unsigned char *in, size_t len);
+static int qat_aead_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg,
+                         void *ptr);
 
 #endif
 static CpaStatus qat_sym_perform_op(int inst_num,
@@ -157,6 +173,11 @@ static chained_info info[] = {
     {NID_aes_128_cbc_hmac_sha256, NULL, AES_KEY_SIZE_128},
     {NID_aes_256_cbc_hmac_sha1, NULL, AES_KEY_SIZE_256},
     {NID_aes_256_cbc_hmac_sha256, NULL, AES_KEY_SIZE_256},
+    {NID_aes_128_gcm, NULL, AES_KEY_SIZE_128},
+    {NID_aes_256_gcm, NULL, AES_KEY_SIZE_256},
+#ifdef QAT_CHACHA_POLY_CIPHER
+    {NID_chacha20_poly1305, NULL, QAT_CHACHA_KEY_SIZE},
+#endif
 };
 
 static const unsigned int num_cc = sizeof(info) / sizeof(chained_info);
@@ -167,6 +188,11 @@ int qat_cipher_nids[] = {
     NID_aes_128_cbc_hmac_sha256,
     NID_aes_256_cbc_hmac_sha1,
     NID_aes_256_cbc_hmac_sha256,
+    NID_aes_128_gcm,
+    NID_aes_256_gcm,
+#ifdef QAT_CHACHA_POLY_CIPHER
+    NID_chacha20_poly1305,
+#endif
 };
 
 /* Setup template for Session Setup Data as most of the fields
@@ -212,6 +238,48 @@ static const CpaCySymOpData template_opData = {
     .pAdditionalAuthData = NULL
 };
 
+/* AEAD (AES-GCM and ChaCha20-Poly1305) equivalents of the templates above.
+ * The tag is appended to the data and compared in software when decrypting.
+ */
+static const CpaCySymSessionSetupData template_aead_ssd = {
+    .sessionPriority = CPA_CY_PRIORITY_HIGH,
+    .symOperation = CPA_CY_SYM_OP_ALGORITHM_CHAINING,
+    .cipherSetupData = {
+                        .cipherAlgorithm = CPA_CY_SYM_CIPHER_AES_GCM,
+                        .cipherKeyLenInBytes = 0,
+                        .pCipherKey = NULL,
+                        .cipherDirection = CPA_CY_SYM_CIPHER_DIRECTION_ENCRYPT,
+                        },
+    .hashSetupData = {
+                      .hashAlgorithm = CPA_CY_SYM_HASH_AES_GCM,
+                      .hashMode = CPA_CY_SYM_HASH_MODE_AUTH,
+                      .digestResultLenInBytes = QAT_AEAD_TAG_LEN,
+                      .authModeSetupData = {
+                                            .authKey = NULL,
+                                            .authKeyLenInBytes = 0,
+                                            .aadLenInBytes = 0,
+                                            },
+                      .nestedModeSetupData = {0},
+                      },
+    .algChainOrder = CPA_CY_SYM_ALG_CHAIN_ORDER_CIPHER_THEN_HASH,
+    .digestIsAppended = CPA_TRUE,
+    .verifyDigest = CPA_FALSE,
+    .partialsNotRequired = CPA_TRUE,
+};
+
+static const CpaCySymOpData template_aead_opData = {
+    .sessionCtx = NULL,
+    .packetType = CPA_CY_SYM_PACKET_TYPE_FULL,
+    .pIv = NULL,
+    .ivLenInBytes = QAT_AEAD_IV_LEN,
+    .cryptoStartSrcOffsetInBytes = 0,
+    .messageLenToCipherInBytes = 0,
+    .hashStartSrcOffsetInBytes = 0,
+    .messageLenToHashInBytes = 0,
+    .pDigestResult = NULL,
+    .pAdditionalAuthData = NULL
+};
+
 static inline int get_digest_len(int nid)
 {
     return (((nid) == NID_aes_128_cbc_hmac_sha1 ||
@@ -230,6 +298,14 @@ static inline const EVP_CIPHER *qat_chained_cipher_sw_impl(int nid)
             return EVP_aes_128_cbc_hmac_sha256();
         case NID_aes_256_cbc_hmac_sha256:
             return EVP_aes_256_cbc_hmac_sha256();
+        case NID_aes_128_gcm:
+            return EVP_aes_128_gcm();
+        case NID_aes_256_gcm:
+            return EVP_aes_256_gcm();
+#ifdef QAT_CHACHA_POLY_CIPHER
+        case NID_chacha20_poly1305:
+            return EVP_chacha20_poly1305();
+#endif
         default:
             WARN("Invalid nid %d\n", nid);
             return NULL;
@@ -260,7 +336,10 @@ static inline void qat_chained_ciphers_free_qop(qat_op_params **pqop,
     if (pqop != NULL && ((qop = *pqop) != NULL)) {
         for (i = 0; i < *num_elem; i++) {
             QAT_CHK_QMFREE_FLATBUFF(qop[i].src_fbuf[0]);
-            QAT_CHK_QMFREE_FLATBUFF(qop[i].src_fbuf[1]);
+            if (qop[i].rec_buf != NULL) {
+                OPENSSL_cleanse(qop[i].rec_buf, qop[i].rec_buf_len);
+                qaeCryptoMemFree(qop[i].rec_buf);
+            }
             QAT_QMEMFREE_BUFF(qop[i].src_sgl.pPrivateMetaData);
             QAT_QMEMFREE_BUFF(qop[i].dst_sgl.pPrivateMetaData);
             QAT_QMEMFREE_BUFF(qop[i].op_data.pIv);
@@ -271,12 +350,70 @@ static inline void qat_chained_ciphers_free_qop(qat_op_params **pqop,
     }
 }
 
+static inline void qat_aead_free_qop(qat_op_params **pqop,
+                                     unsigned int *num_elem)
+{
+    unsigned int i = 0;
+    qat_op_params *qop = NULL;
+    if (pqop != NULL && ((qop = *pqop) != NULL)) {
+        for (i = 0; i < *num_elem; i++) {
+            /* The data flatbuffer points into the record buffer */
+            if (qop[i].rec_buf != NULL) {
+                OPENSSL_cleanse(qop[i].rec_buf, qop[i].rec_buf_len);
+                qaeCryptoMemFree(qop[i].rec_buf);
+            }
+            QAT_QMEMFREE_BUFF(qop[i].src_sgl.pPrivateMetaData);
+            QAT_QMEMFREE_BUFF(qop[i].op_data.pIv);
+            QAT_QMEMFREE_BUFF(qop[i].op_data.pAdditionalAuthData);
+        }
+        OPENSSL_free(qop);
+        *pqop = NULL;
+        *num_elem = 0;
+    }
+}
+
+#ifndef OPENSSL_DISABLE_QAT_CIPHERS
+static const EVP_CIPHER *qat_create_aead_meth(int nid, int keylen)
+{
+    EVP_CIPHER *c = NULL;
+    int res = 1;
+
+    if ((c = EVP_CIPHER_meth_new(nid, 1, keylen)) == NULL) {
+        WARN("Failed to allocate cipher methods for nid %d\n", nid);
+        return NULL;
+    }
+
+    res &= EVP_CIPHER_meth_set_iv_length(c, QAT_AEAD_IV_LEN);
+    res &= EVP_CIPHER_meth_set_flags(c, nid == NID_chacha20_poly1305 ?
+                                     QAT_CHACHA_POLY_FLAGS : QAT_GCM_FLAGS);
+    res &= EVP_CIPHER_meth_set_init(c, qat_aead_init);
+    res &= EVP_CIPHER_meth_set_do_cipher(c, qat_aead_do_cipher);
+    res &= EVP_CIPHER_meth_set_cleanup(c, qat_aead_cleanup);
+    res &= EVP_CIPHER_meth_set_impl_ctx_size(c, sizeof(qat_aead_ctx));
+    res &= EVP_CIPHER_meth_set_set_asn1_params(c, NULL);
+    res &= EVP_CIPHER_meth_set_get_asn1_params(c, NULL);
+    res &= EVP_CIPHER_meth_set_ctrl(c, qat_aead_ctrl);
+
+    if (res == 0) {
+        WARN("Failed to set cipher methods for nid %d\n", nid);
+        EVP_CIPHER_meth_free(c);
+        c = NULL;
+    }
+
+    return c;
+}
+#endif
+
 static const EVP_CIPHER *qat_create_cipher_meth(int nid, int keylen)
 {
 #ifndef OPENSSL_DISABLE_QAT_CIPHERS
     EVP_CIPHER *c = NULL;
     int res = 1;
 
+    if (nid == NID_aes_128_gcm || nid == NID_aes_256_gcm ||
+        nid == NID_chacha20_poly1305)
+        return qat_create_aead_meth(nid, keylen);
+
     if ((c = EVP_CIPHER_meth_new(nid, AES_BLOCK_SIZE, keylen)) == NULL) {
         WARN("Failed to allocate cipher methods for nid %d\n", nid);
         return NULL;
@@ -345,7 +482,12 @@ static PKT_THRESHOLD qat_pkt_threshold_table[] = {
     {NID_aes_256_cbc_hmac_sha1, CRYPTO_SMALL_PACKET_OFFLOAD_THRESHOLD_DEFAULT},
     {NID_aes_128_cbc_hmac_sha256,
      CRYPTO_SMALL_PACKET_OFFLOAD_THRESHOLD_DEFAULT},
-    {NID_aes_256_cbc_hmac_sha256, CRYPTO_SMALL_PACKET_OFFLOAD_THRESHOLD_DEFAULT}
+    {NID_aes_256_cbc_hmac_sha256, CRYPTO_SMALL_PACKET_OFFLOAD_THRESHOLD_DEFAULT},
+    {NID_aes_128_gcm, CRYPTO_SMALL_PACKET_OFFLOAD_THRESHOLD_DEFAULT},
+    {NID_aes_256_gcm, CRYPTO_SMALL_PACKET_OFFLOAD_THRESHOLD_DEFAULT},
+#ifdef QAT_CHACHA_POLY_CIPHER
+    {NID_chacha20_poly1305, CRYPTO_SMALL_PACKET_OFFLOAD_THRESHOLD_DEFAULT}
+#endif
 };
 
 static int pkt_threshold_table_size =
@@ -364,7 +506,12 @@ int qat_pkt_threshold_table_set_threshold(const char *cn,
 
     DEBUG("Set small packet threshold for %s: %d\n", cn, threshold);
 
-    nid = OBJ_sn2nid(cn);
+    /* The AEAD short names are id-aes128-GCM, id-aes256-GCM and
+     * ChaCha20-Poly1305, also accept the usual aes-128-gcm, aes-256-gcm and
+     * chacha20-poly1305 long names.
+     */
+    if ((nid = OBJ_sn2nid(cn)) == NID_undef)
+        nid = OBJ_ln2nid(cn);
     do {
         if (qat_pkt_threshold_table[i].nid == nid) {
             qat_pkt_threshold_table[i].threshold = threshold;
@@ -390,6 +537,159 @@ static inline int qat_pkt_threshold_table_get_threshold(int nid)
 }
 #endif
 
+#ifndef OPENSSL_DISABLE_QAT_CIPHERS
+/* Application buffers registered with QAT_CMD_REGISTER_PINNED_BUFFER */
+typedef struct qat_pinned_region_s {
+    unsigned char *start;
+    size_t len;
+} qat_pinned_region;
+
+static qat_pinned_region qat_pinned_regions[QAT_MAX_PINNED_REGIONS];
+/* Only changed under the write lock, read with __atomic builtins outside
+ * of it */
+static int qat_num_pinned_regions = 0;
+static pthread_rwlock_t qat_pinned_regions_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/******************************************************************************
+* function:
+*         qat_register_pinned_buffer(void *buf, size_t len)
+*
+* @param buf    [IN]  - start of the buffer region
+* @param len    [IN]  - length of the buffer region
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    Registers a buffer region the application allocated from the engine's
+*  pinned memory allocator. Records whose output lies in a registered region
+*  are given to QAT in place, without copying them through the record buffer
+*  of the pipe. The region must remain allocated until it is unregistered.
+*
+******************************************************************************/
+int qat_register_pinned_buffer(void *buf, size_t len)
+{
+    unsigned char *start = (unsigned char *)buf;
+    CpaPhysicalAddr phys = 0;
+    size_t off;
+    int i, ret = 0;
+
+    if (start == NULL || len == 0 || len > UINT32_MAX) {
+        WARN("Invalid pinned buffer %p of length %zu\n", buf, len);
+        return 0;
+    }
+
+    /* QAT addresses a flat buffer through the physical address of its
+     * start, so the region must be pinned and physically contiguous.
+     */
+    if ((phys = qaeCryptoMemV2P(start)) == 0) {
+        WARN("Buffer %p is not pinned memory\n", buf);
+        return 0;
+    }
+    for (off = QAT_PINNED_PAGE_SIZE -
+               ((uintptr_t)start & (QAT_PINNED_PAGE_SIZE - 1));
+         off < len; off += QAT_PINNED_PAGE_SIZE) {
+        if (qaeCryptoMemV2P(start + off) != phys + off) {
+            WARN("Buffer %p is not physically contiguous\n", buf);
+            return 0;
+        }
+    }
+
+    pthread_rwlock_wrlock(&qat_pinned_regions_lock);
+    for (i = 0; i < qat_num_pinned_regions; i++) {
+        if (start < qat_pinned_regions[i].start + qat_pinned_regions[i].len &&
+            qat_pinned_regions[i].start < start + len) {
+            WARN("Buffer %p overlaps a registered buffer\n", buf);
+            goto end;
+        }
+    }
+    if (qat_num_pinned_regions == QAT_MAX_PINNED_REGIONS) {
+        WARN("Maximum number of pinned buffers registered\n");
+        goto end;
+    }
+    qat_pinned_regions[qat_num_pinned_regions].start = start;
+    qat_pinned_regions[qat_num_pinned_regions].len = len;
+    __atomic_store_n(&qat_num_pinned_regions, qat_num_pinned_regions + 1,
+                     __ATOMIC_RELEASE);
+    DEBUG("Registered pinned buffer %p of length %zu\n", buf, len);
+    ret = 1;
+
+ end:
+    pthread_rwlock_unlock(&qat_pinned_regions_lock);
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_unregister_pinned_buffer(void *buf)
+*
+* @param buf    [IN]  - start of a registered buffer region
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    Removes a region registered with qat_register_pinned_buffer(). No
+*  operation on a record in the region may be in progress.
+*
+******************************************************************************/
+int qat_unregister_pinned_buffer(void *buf)
+{
+    int i, ret = 0;
+
+    pthread_rwlock_wrlock(&qat_pinned_regions_lock);
+    for (i = 0; i < qat_num_pinned_regions; i++) {
+        if (qat_pinned_regions[i].start == buf) {
+            qat_pinned_regions[i] =
+                qat_pinned_regions[qat_num_pinned_regions - 1];
+            __atomic_store_n(&qat_num_pinned_regions,
+                             qat_num_pinned_regions - 1, __ATOMIC_RELEASE);
+            DEBUG("Unregistered pinned buffer %p\n", buf);
+            ret = 1;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&qat_pinned_regions_lock);
+
+    if (!ret) {
+        WARN("Buffer %p is not registered\n", buf);
+    }
+    return ret;
+}
+
+/* Returns 1 when [buf, buf + len) lies in a registered pinned region */
+static int qat_is_pinned_buffer(const unsigned char *buf, size_t len)
+{
+    int i, ret = 0;
+
+    /* Avoid the lock for the applications which register no buffer. The
+     * regions themselves are only read under the lock as unregistering
+     * moves them.
+     */
+    if (__atomic_load_n(&qat_num_pinned_regions, __ATOMIC_ACQUIRE) == 0)
+        return 0;
+
+    pthread_rwlock_rdlock(&qat_pinned_regions_lock);
+    for (i = 0; i < qat_num_pinned_regions; i++) {
+        if (buf >= qat_pinned_regions[i].start &&
+            len <= qat_pinned_regions[i].len &&
+            (size_t)(buf - qat_pinned_regions[i].start) <=
+            qat_pinned_regions[i].len - len) {
+            ret = 1;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&qat_pinned_regions_lock);
+    return ret;
+}
+#else
+/* No buffer can be registered when the ciphers are disabled */
+static int qat_is_pinned_buffer(const unsigned char *buf, size_t len)
+{
+    return 0;
+}
+#endif
+
 /******************************************************************************
 * function:
 *         qat_chained_callbackFn(void *callbackTag, CpaStatus status,
@@ -589,6 +889,8 @@ static int qat_setup_op_params(EVP_CIPHER_CTX *ctx)
 
         qctx->qop[i].src_fbuf[1].pData = NULL;
         qctx->qop[i].dst_fbuf[1].pData = NULL;
+        qctx->qop[i].rec_buf = NULL;
+        qctx->qop[i].rec_buf_len = 0;
 
         qctx->qop[i].src_sgl.numBuffers = 2;
         qctx->qop[i].src_sgl.pBuffers = qctx->qop[i].src_fbuf;
@@ -651,6 +953,242 @@ static int qat_setup_op_params(EVP_CIPHER_CTX *ctx)
     return 0;
 }
 
+/******************************************************************************
+* function:
+*         qat_reserve_rec_buf(qat_op_params *qop, Cpa32U len)
+*
+* @param qop    [IN]  - pointer to the operation parameters of a pipe
+* @param len    [IN]  - length of the record to be processed
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    This function makes sure the pinned record buffer of a pipe can hold
+*  len bytes. The buffer is kept across calls and is only (re)allocated
+*  when it does not exist yet or is too small for the record, so a TLS
+*  connection does not allocate pinned memory per record. It is released
+*  with the operation parameters of the pipe.
+*
+******************************************************************************/
+static int qat_reserve_rec_buf(qat_op_params *qop, Cpa32U len)
+{
+    if (qop->rec_buf == NULL || qop->rec_buf_len < len) {
+        if (qop->rec_buf != NULL) {
+            OPENSSL_cleanse(qop->rec_buf, qop->rec_buf_len);
+            qaeCryptoMemFree(qop->rec_buf);
+            qop->rec_buf = NULL;
+        }
+        qop->rec_buf_len = len > QAT_CHAINED_REC_BUF_SIZE ?
+                           len : QAT_CHAINED_REC_BUF_SIZE;
+        qop->rec_buf = qaeCryptoMemAlloc(qop->rec_buf_len, __FILE__, __LINE__);
+        if (qop->rec_buf == NULL) {
+            WARN("Unable to allocate memory[%u bytes] for record buffer\n",
+                 qop->rec_buf_len);
+            qop->rec_buf_len = 0;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*         qat_chained_get_rec_buf(qat_op_params *qop, Cpa32U len)
+*
+* @param qop    [IN]  - pointer to the operation parameters of a pipe
+* @param len    [IN]  - length of the record to be processed
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    This function points the record flatbuffers of a pipe at its pinned
+*  record buffer, see qat_reserve_rec_buf().
+*
+******************************************************************************/
+static int qat_chained_get_rec_buf(qat_op_params *qop, Cpa32U len)
+{
+    if (!qat_reserve_rec_buf(qop, len))
+        return 0;
+
+    FLATBUFF_SET_AND_CHAIN(qop->src_fbuf[1], qop->dst_fbuf[1],
+                           qop->rec_buf, len);
+    return 1;
+}
+
+/* Session contexts whose session has been removed, kept for reuse by the
+ * contexts initialised later on the same instance with the same cipher and
+ * direction. The size of these session contexts is recorded the first time
+ * one is allocated so that it is not queried again.
+ */
+typedef struct qat_sym_session_bucket_s {
+    Cpa32U size;
+    unsigned int count;
+    CpaCySymSessionCtx sctx[QAT_SYM_SESSION_POOL_SIZE];
+} qat_sym_session_bucket;
+
+static qat_sym_session_bucket *qat_sym_session_pools[QAT_MAX_CRYPTO_INSTANCES];
+static pthread_mutex_t qat_sym_session_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Returns the bucket of the pool of the instance, allocating the pool on
+ * first use. Called with qat_sym_session_pool_mutex held.
+ */
+static qat_sym_session_bucket *qat_sym_session_bucket_get(int inst_num,
+                                                          int nid,
+                                                          CpaCySymCipherDirection dir)
+{
+    unsigned int i;
+
+    if (inst_num < 0 || inst_num >= QAT_MAX_CRYPTO_INSTANCES)
+        return NULL;
+
+    for (i = 0; i < num_cc; i++) {
+        if (info[i].nid == nid)
+            break;
+    }
+    if (i == num_cc)
+        return NULL;
+
+    if (qat_sym_session_pools[inst_num] == NULL) {
+        qat_sym_session_pools[inst_num] =
+            OPENSSL_zalloc(sizeof(qat_sym_session_bucket) * num_cc * 2);
+        if (qat_sym_session_pools[inst_num] == NULL) {
+            WARN("Unable to allocate memory for session pool\n");
+            return NULL;
+        }
+    }
+    return &qat_sym_session_pools[inst_num]
+        [i * 2 + (dir == CPA_CY_SYM_CIPHER_DIRECTION_DECRYPT)];
+}
+
+/******************************************************************************
+* function:
+*         qat_sym_session_ctx_get(int inst_num, int nid,
+*                                 CpaCySymSessionSetupData *ssd,
+*                                 CpaCySymSessionCtx *sctx)
+*
+* @param inst_num [IN]  - instance the session is to be initialised on
+* @param nid      [IN]  - nid of the cipher
+* @param ssd      [IN]  - session setup data
+* @param sctx     [OUT] - session context
+*
+* @retval CPA_STATUS_SUCCESS   a session context was returned
+* @retval CPA_STATUS_RESOURCE  the session context could not be allocated
+* @retval other                status of cpaCySymSessionCtxGetSize()
+*
+* description:
+*    Takes a session context for the cipher and direction of ssd out of the
+*  pool of the instance, or allocates one when the pool is empty.
+*
+******************************************************************************/
+static CpaStatus qat_sym_session_ctx_get(int inst_num, int nid,
+                                         CpaCySymSessionSetupData *ssd,
+                                         CpaCySymSessionCtx *sctx)
+{
+    qat_sym_session_bucket *bucket = NULL;
+    Cpa32U sctx_size = 0;
+    CpaStatus sts;
+
+    *sctx = NULL;
+    pthread_mutex_lock(&qat_sym_session_pool_mutex);
+    bucket = qat_sym_session_bucket_get(inst_num, nid,
+                                        ssd->cipherSetupData.cipherDirection);
+    if (bucket != NULL) {
+        if (bucket->count > 0)
+            *sctx = bucket->sctx[--bucket->count];
+        sctx_size = bucket->size;
+    }
+    pthread_mutex_unlock(&qat_sym_session_pool_mutex);
+    if (*sctx != NULL)
+        return CPA_STATUS_SUCCESS;
+
+    if (sctx_size == 0) {
+        sts = cpaCySymSessionCtxGetSize(qat_instance_handles[inst_num], ssd,
+                                        &sctx_size);
+        if (sts != CPA_STATUS_SUCCESS) {
+            WARN("Failed to get SessionCtx size.\n");
+            return sts;
+        }
+        pthread_mutex_lock(&qat_sym_session_pool_mutex);
+        bucket = qat_sym_session_bucket_get(inst_num, nid,
+                                            ssd->cipherSetupData.cipherDirection);
+        if (bucket != NULL)
+            bucket->size = sctx_size;
+        pthread_mutex_unlock(&qat_sym_session_pool_mutex);
+    }
+
+    DEBUG("Size of session ctx = %d\n", sctx_size);
+    *sctx = (CpaCySymSessionCtx) qaeCryptoMemAlloc(sctx_size, __FILE__,
+                                                   __LINE__);
+    if (*sctx == NULL) {
+        WARN("QMEM alloc failed for session ctx!\n");
+        return CPA_STATUS_RESOURCE;
+    }
+    return CPA_STATUS_SUCCESS;
+}
+
+/******************************************************************************
+* function:
+*         qat_sym_session_ctx_put(int inst_num, int nid,
+*                                 CpaCySymCipherDirection dir,
+*                                 CpaCySymSessionCtx sctx)
+*
+* @param inst_num [IN]  - instance the session was initialised on
+* @param nid      [IN]  - nid of the cipher
+* @param dir      [IN]  - direction the session context was obtained for
+* @param sctx     [IN]  - session context, its session must have been removed
+*
+* description:
+*    Returns a session context to the pool of the instance. It is freed
+*  instead when the pool is full or the instance is no longer available.
+*
+******************************************************************************/
+static void qat_sym_session_ctx_put(int inst_num, int nid,
+                                    CpaCySymCipherDirection dir,
+                                    CpaCySymSessionCtx sctx)
+{
+    qat_sym_session_bucket *bucket = NULL;
+
+    if (sctx == NULL)
+        return;
+
+    if (is_instance_available(inst_num)) {
+        pthread_mutex_lock(&qat_sym_session_pool_mutex);
+        bucket = qat_sym_session_bucket_get(inst_num, nid, dir);
+        if (bucket != NULL && bucket->size != 0 &&
+            bucket->count < QAT_SYM_SESSION_POOL_SIZE) {
+            /* Do not keep the key material of the removed session */
+            OPENSSL_cleanse(sctx, bucket->size);
+            bucket->sctx[bucket->count++] = sctx;
+            sctx = NULL;
+        }
+        pthread_mutex_unlock(&qat_sym_session_pool_mutex);
+    }
+    if (sctx != NULL)
+        qaeCryptoMemFree(sctx);
+}
+
+/* Frees the session contexts of the pools, when the engine is finished */
+void qat_sym_session_pools_free(void)
+{
+    int i;
+    unsigned int j, k;
+
+    pthread_mutex_lock(&qat_sym_session_pool_mutex);
+    for (i = 0; i < QAT_MAX_CRYPTO_INSTANCES; i++) {
+        if (qat_sym_session_pools[i] == NULL)
+            continue;
+        for (j = 0; j < num_cc * 2; j++) {
+            for (k = 0; k < qat_sym_session_pools[i][j].count; k++)
+                qaeCryptoMemFree(qat_sym_session_pools[i][j].sctx[k]);
+        }
+        OPENSSL_free(qat_sym_session_pools[i]);
+        qat_sym_session_pools[i] = NULL;
+    }
+    pthread_mutex_unlock(&qat_sym_session_pool_mutex);
+}
+
 /******************************************************************************
 * function:
 *         qat_chained_ciphers_init(EVP_CIPHER_CTX *ctx,
@@ -676,7 +1214,6 @@ int qat_chained_ciphers_init(EVP_CIPHER_CTX *ctx,
                              const unsigned char *iv, int enc)
 {
     CpaCySymSessionSetupData *ssd = NULL;
-    Cpa32U sctx_size = 0;
     CpaCySymSessionCtx sctx = NULL;
     CpaStatus sts = 0;
     qat_chained_ctx *qctx = NULL;
@@ -799,10 +1336,12 @@ int qat_chained_ciphers_init(EVP_CIPHER_CTX *ctx,
 
     DEBUG("inst_num = %d\n", qctx->inst_num);
     DUMP_SESSION_SETUP_DATA(ssd);
-    sts = cpaCySymSessionCtxGetSize(qat_instance_handles[qctx->inst_num], ssd, &sctx_size);
+    sts = qat_sym_session_ctx_get(qctx->inst_num, EVP_CIPHER_CTX_nid(ctx),
+                                  ssd, &sctx);
+    if (sts == CPA_STATUS_RESOURCE)
+        goto err;
 
     if (sts != CPA_STATUS_SUCCESS) {
-        WARN("Failed to get SessionCtx size.\n");
         if (qat_get_sw_fallback_enabled()) {
             CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
                            qctx->inst_num,
@@ -813,14 +1352,6 @@ int qat_chained_ciphers_init(EVP_CIPHER_CTX *ctx,
         goto err;
     }
 
-    DEBUG("Size of session ctx = %d\n", sctx_size);
-    sctx = (CpaCySymSessionCtx) qaeCryptoMemAlloc(sctx_size, __FILE__,
-                                                  __LINE__);
-    if (sctx == NULL) {
-        WARN("QMEM alloc failed for session ctx!\n");
-        goto err;
-    }
-
     qctx->session_ctx = sctx;
 
     qctx->qop = NULL;
@@ -1142,6 +1673,15 @@ int qat_chained_ciphers_cleanup(EVP_CIPHER_CTX *ctx)
                 }
             }
         }
+        /* A session context whose session could not be removed is not
+         * reused.
+         */
+        if (retVal == 1) {
+            qat_sym_session_ctx_put(qctx->inst_num, EVP_CIPHER_CTX_nid(ctx),
+                                    ssd->cipherSetupData.cipherDirection,
+                                    qctx->session_ctx);
+            qctx->session_ctx = NULL;
+        }
         QAT_QMEMFREE_BUFF(qctx->session_ctx);
         QAT_CLEANSE_FREE_BUFF(ssd->hashSetupData.authModeSetupData.authKey,
                               ssd->hashSetupData.authModeSetupData.
@@ -1183,7 +1723,6 @@ int qat_chained_ciphers_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
     CpaCySymOpData *opd = NULL;
     CpaBufferList *s_sgl = NULL;
     CpaBufferList *d_sgl = NULL;
-    CpaFlatBuffer *s_fbuf = NULL;
     CpaFlatBuffer *d_fbuf = NULL;
     int retVal = 0, job_ret = 0;
     unsigned int pad_check = 1;
@@ -1427,7 +1966,6 @@ int qat_chained_ciphers_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
         opd = &qctx->qop[pipe].op_data;
         tls_hdr = GET_TLS_HDR(qctx, pipe);
         vtls = GET_TLS_VERSION(tls_hdr);
-        s_fbuf = qctx->qop[pipe].src_fbuf;
         d_fbuf = qctx->qop[pipe].dst_fbuf;
         s_sgl = &qctx->qop[pipe].src_sgl;
         d_sgl = &qctx->qop[pipe].src_sgl;
@@ -1568,15 +2106,27 @@ int qat_chained_ciphers_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
                              (d_fbuf[0].dataLenInBytes - TLS_VIRT_HDR_SIZE)),
                             plen);
 
-        FLATBUFF_ALLOC_AND_CHAIN(s_fbuf[1], d_fbuf[1], buflen);
-        if ((s_fbuf[1].pData) == NULL) {
-            WARN("Failure in src buffer allocation.\n");
-            error = 1;
-            break;
+        /* A record whose output lies in a registered pinned buffer is
+         * processed in place there instead of in the pipe's record buffer.
+         * In place processing overwrites the input, so it is not used when
+         * a failed request may be resubmitted to software from that input.
+         */
+        if (discardlen == 0 &&
+            (inb != outb + plen_adj || !qat_get_sw_fallback_enabled()) &&
+            qat_is_pinned_buffer(outb + plen_adj, buflen)) {
+            FLATBUFF_SET_AND_CHAIN(qctx->qop[pipe].src_fbuf[1], d_fbuf[1],
+                                   outb + plen_adj, buflen);
+            if (inb != outb + plen_adj)
+                memmove(d_fbuf[1].pData, inb, buflen);
+        } else {
+            if (!qat_chained_get_rec_buf(&qctx->qop[pipe], buflen)) {
+                WARN("Failure in src buffer allocation.\n");
+                error = 1;
+                break;
+            }
+            memcpy(d_fbuf[1].pData, inb, buflen - discardlen);
         }
 
-        memcpy(d_fbuf[1].pData, inb, buflen - discardlen);
-
         if (enc) {
             /* Add padding to input buffer at end of digest */
             for (i = plen + dlen; i < buflen; i++)
@@ -1678,14 +2228,12 @@ int qat_chained_ciphers_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
     pipe = 0;
     do {
         if (retVal == 1) {
-            memcpy(qctx->p_out[pipe] + plen_adj,
-                   qctx->qop[pipe].dst_fbuf[1].pData,
-                   qctx->p_inlen[pipe] - discardlen - plen_adj);
+            if (qctx->qop[pipe].dst_fbuf[1].pData == qctx->qop[pipe].rec_buf)
+                memcpy(qctx->p_out[pipe] + plen_adj,
+                       qctx->qop[pipe].dst_fbuf[1].pData,
+                       qctx->p_inlen[pipe] - discardlen - plen_adj);
             outlen += buflen + plen_adj - discardlen;
         }
-        qaeCryptoMemFree(qctx->qop[pipe].src_fbuf[1].pData);
-        qctx->qop[pipe].src_fbuf[1].pData = NULL;
-        qctx->qop[pipe].dst_fbuf[1].pData = NULL;
     } while (++pipe < qctx->numpipes);
 
     if (enc && vtls < TLS1_1_VERSION)
@@ -1800,3 +2348,1450 @@ CpaStatus qat_sym_perform_op(int inst_num,
     while (status == CPA_STATUS_RETRY);
     return status;
 }
+
+/* State of a message processed outside of the TLS 1.2 record mode */
+#define QAT_AEAD_MSG_NONE        0
+#define QAT_AEAD_MSG_HW          1
+#define QAT_AEAD_MSG_SW          2
+
+/******************************************************************************
+* function:
+*         qat_aead_sw_init(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                          const unsigned char *key,
+*                          const unsigned char *iv, int enc)
+*         qat_aead_sw_cipher(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                            unsigned char *out, const unsigned char *in,
+*                            size_t len)
+*         qat_aead_sw_ctrl(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                          int type, int arg, void *ptr)
+*
+* description:
+*   Run the software AEAD cipher on the software context data held by
+*   qctx. The software cipher is only ever driven one whole message at a
+*   time, the QAT context keeping the key, IV and TLS record state. The
+*   software ChaCha20-Poly1305 allocates its context data itself, hence the
+*   context data pointer is read back after each call.
+*
+******************************************************************************/
+static int qat_aead_sw_init(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                            const unsigned char *key,
+                            const unsigned char *iv, int enc)
+{
+    int ret;
+
+    EVP_CIPHER_CTX_set_cipher_data(ctx, qctx->sw_ctx_cipher_data);
+    ret = EVP_CIPHER_meth_get_init(GET_SW_CIPHER(ctx))(ctx, key, iv, enc);
+    qctx->sw_ctx_cipher_data = EVP_CIPHER_CTX_get_cipher_data(ctx);
+    EVP_CIPHER_CTX_set_cipher_data(ctx, qctx);
+    return ret;
+}
+
+static int qat_aead_sw_cipher(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                              unsigned char *out, const unsigned char *in,
+                              size_t len)
+{
+    int ret;
+
+    EVP_CIPHER_CTX_set_cipher_data(ctx, qctx->sw_ctx_cipher_data);
+    ret = EVP_CIPHER_meth_get_do_cipher(GET_SW_CIPHER(ctx))(ctx, out, in, len);
+    qctx->sw_ctx_cipher_data = EVP_CIPHER_CTX_get_cipher_data(ctx);
+    EVP_CIPHER_CTX_set_cipher_data(ctx, qctx);
+    return ret;
+}
+
+static int qat_aead_sw_ctrl(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                            int type, int arg, void *ptr)
+{
+    int ret;
+
+    EVP_CIPHER_CTX_set_cipher_data(ctx, qctx->sw_ctx_cipher_data);
+    ret = EVP_CIPHER_meth_get_ctrl(GET_SW_CIPHER(ctx))(ctx, type, arg, ptr);
+    qctx->sw_ctx_cipher_data = EVP_CIPHER_CTX_get_cipher_data(ctx);
+    EVP_CIPHER_CTX_set_cipher_data(ctx, qctx);
+    return ret;
+}
+
+/* Whether the cipher of ctx can be offloaded at all */
+static int qat_aead_offload_supported(EVP_CIPHER_CTX *ctx)
+{
+    if (EVP_CIPHER_CTX_nid(ctx) != NID_chacha20_poly1305)
+        return 1;
+#ifdef QAT_CHACHA_POLY_ENABLED
+    return qat_chacha_poly_offload_supported;
+#else
+    return 0;
+#endif
+}
+
+/* Increment the 64 bit big endian invocation field of a GCM IV */
+static void qat_aes_gcm_ctr64_inc(unsigned char *counter)
+{
+    int n = 8;
+    unsigned char c;
+
+    do {
+        --n;
+        c = counter[n];
+        ++c;
+        counter[n] = c;
+        if (c)
+            return;
+    } while (n);
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_session_remove(qat_aead_ctx *qctx)
+*
+* @param qctx    [IN]  - pointer to the qat aead context
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    Removes the QAT session of the context, if one has been initialised, so
+*  that it can be initialised again with new parameters.
+*
+******************************************************************************/
+static int qat_aead_session_remove(qat_aead_ctx *qctx)
+{
+    CpaStatus sts;
+
+    if (!INIT_SEQ_IS_FLAG_SET(qctx, INIT_SEQ_QAT_SESSION_INIT))
+        return 1;
+
+    INIT_SEQ_CLEAR_FLAG(qctx, INIT_SEQ_QAT_SESSION_INIT);
+    if (!is_instance_available(qctx->inst_num))
+        return 1;
+
+    sts = cpaCySymRemoveSession(qat_instance_handles[qctx->inst_num],
+                                qctx->session_ctx);
+    if (sts != CPA_STATUS_SUCCESS) {
+        WARN("cpaCySymRemoveSession FAILED, sts = %d\n", sts);
+        return 0;
+    }
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_session_init(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                               unsigned int aad_len)
+*
+* @param ctx     [IN]  - pointer to existing ctx
+* @param qctx    [IN]  - pointer to the qat aead context
+* @param aad_len [IN]  - length of the AAD of the messages to be processed
+*
+* @retval 1      function succeeded
+* @retval 0      function failed, qctx->fallback is set when the request
+*                should be processed in software instead
+*
+* description:
+*    Makes sure a QAT session matching the key, the direction and the AAD
+*  length of the messages to be processed is initialised. The session is
+*  only initialised again when one of these changes, which for TLS records
+*  (13 bytes of AAD) does not happen during the life of the context.
+*
+******************************************************************************/
+static int qat_aead_session_init(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                                 unsigned int aad_len)
+{
+    CpaCySymSessionSetupData *ssd = qctx->session_data;
+    CpaCySymCipherDirection dir;
+    CpaStatus sts;
+
+    dir = EVP_CIPHER_CTX_encrypting(ctx) ?
+          CPA_CY_SYM_CIPHER_DIRECTION_ENCRYPT :
+          CPA_CY_SYM_CIPHER_DIRECTION_DECRYPT;
+
+    if (INIT_SEQ_IS_FLAG_SET(qctx, INIT_SEQ_QAT_SESSION_INIT)) {
+        if (ssd->cipherSetupData.cipherDirection == dir &&
+            ssd->hashSetupData.authModeSetupData.aadLenInBytes == aad_len)
+            return 1;
+        if (!qat_aead_session_remove(qctx))
+            return 0;
+    }
+
+    /* The pooled session contexts are bucketed by direction, so return the
+     * session context to its pool when the direction changes.
+     */
+    if (qctx->session_ctx != NULL &&
+        ssd->cipherSetupData.cipherDirection != dir) {
+        qat_sym_session_ctx_put(qctx->inst_num, EVP_CIPHER_CTX_nid(ctx),
+                                ssd->cipherSetupData.cipherDirection,
+                                qctx->session_ctx);
+        qctx->session_ctx = NULL;
+    }
+
+    if (qctx->inst_num == QAT_INVALID_INSTANCE)
+        qctx->inst_num = get_next_inst_num();
+
+    if (qctx->inst_num == QAT_INVALID_INSTANCE ||
+        !is_instance_available(qctx->inst_num)) {
+        WARN("No QAT instance available so not initialising session.\n");
+        if (qat_get_sw_fallback_enabled()) {
+            CRYPTO_QAT_LOG("Failed to get an instance - fallback to SW - %s\n", __func__);
+            qctx->fallback = 1;
+        }
+        return 0;
+    }
+
+    if (ssd == NULL) {
+        ssd = OPENSSL_malloc(sizeof(CpaCySymSessionSetupData));
+        if (ssd == NULL) {
+            WARN("Failed to allocate session setup data\n");
+            return 0;
+        }
+        /* Copy over the template for most of the values */
+        memcpy(ssd, &template_aead_ssd, sizeof(template_aead_ssd));
+        qctx->session_data = ssd;
+    }
+
+#ifdef QAT_CHACHA_POLY_ENABLED
+    if (EVP_CIPHER_CTX_nid(ctx) == NID_chacha20_poly1305) {
+        ssd->cipherSetupData.cipherAlgorithm = CPA_CY_SYM_CIPHER_CHACHA;
+        ssd->hashSetupData.hashAlgorithm = CPA_CY_SYM_HASH_POLY;
+    }
+#endif
+    ssd->cipherSetupData.cipherKeyLenInBytes = EVP_CIPHER_CTX_key_length(ctx);
+    ssd->cipherSetupData.pCipherKey = qctx->cipher_key;
+    ssd->cipherSetupData.cipherDirection = dir;
+    ssd->algChainOrder = dir == CPA_CY_SYM_CIPHER_DIRECTION_ENCRYPT ?
+                         CPA_CY_SYM_ALG_CHAIN_ORDER_CIPHER_THEN_HASH :
+                         CPA_CY_SYM_ALG_CHAIN_ORDER_HASH_THEN_CIPHER;
+    ssd->hashSetupData.authModeSetupData.aadLenInBytes = aad_len;
+
+    DEBUG("inst_num = %d\n", qctx->inst_num);
+    DUMP_SESSION_SETUP_DATA(ssd);
+
+    if (qctx->session_ctx == NULL) {
+        sts = qat_sym_session_ctx_get(qctx->inst_num, EVP_CIPHER_CTX_nid(ctx),
+                                      ssd, &qctx->session_ctx);
+        if (sts == CPA_STATUS_RESOURCE)
+            return 0;
+        if (sts != CPA_STATUS_SUCCESS) {
+            if (qat_get_sw_fallback_enabled()) {
+                CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
+                               qctx->inst_num,
+                               qat_instance_details[qctx->inst_num].qat_instance_info.physInstId.packageId,
+                               __func__);
+                qctx->fallback = 1;
+            }
+            return 0;
+        }
+    }
+
+    sts = cpaCySymInitSession(qat_instance_handles[qctx->inst_num],
+                              qat_chained_callbackFn, ssd, qctx->session_ctx);
+    if (sts != CPA_STATUS_SUCCESS) {
+        WARN("cpaCySymInitSession failed! Status = %d\n", sts);
+        if (qat_get_sw_fallback_enabled() &&
+            ((sts == CPA_STATUS_RESTARTING) || (sts == CPA_STATUS_FAIL))) {
+            CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
+                           qctx->inst_num,
+                           qat_instance_details[qctx->inst_num].qat_instance_info.physInstId.packageId,
+                           __func__);
+            qctx->fallback = 1;
+        }
+        return 0;
+    }
+    if (qat_get_sw_fallback_enabled()) {
+        CRYPTO_QAT_LOG("Submit success qat inst_num %d device_id %d - %s\n",
+                       qctx->inst_num,
+                       qat_instance_details[qctx->inst_num].qat_instance_info.physInstId.packageId,
+                       __func__);
+    }
+    INIT_SEQ_SET_FLAG(qctx, INIT_SEQ_QAT_SESSION_INIT);
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_setup_op_params(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+*
+* @param ctx     [IN]  - pointer to existing ctx
+* @param qctx    [IN]  - pointer to the qat aead context
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    AEAD counterpart of qat_setup_op_params(). Each pipe uses a single
+*  in-place flat buffer holding the data followed by the tag, pointing into
+*  the record buffer of the pipe, and pinned buffers for the IV and the AAD.
+*
+******************************************************************************/
+static int qat_aead_setup_op_params(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+{
+    CpaCySymOpData *opd = NULL;
+    Cpa32U msize = 0;
+    int i = 0;
+    unsigned int start;
+
+    if (PIPELINE_USED(qctx)) {
+        start = qctx->npipes_last_used;
+    } else {
+        start = 1;
+        if (qctx->qop != NULL && qctx->qop_len < qctx->numpipes) {
+            qat_aead_free_qop(&qctx->qop, &qctx->qop_len);
+            DEBUG_PPL("[%p] qop memory freed\n", ctx);
+        }
+    }
+
+    if (qctx->qop == NULL) {
+        if (PIPELINE_USED(qctx)) {
+            WARN("Pipeline used but no data allocated. Possible memory leak\n");
+        }
+
+        qctx->qop_len = qctx->numpipes > 1 ? QAT_MAX_PIPELINES : 1;
+        qctx->qop = (qat_op_params *) OPENSSL_zalloc(sizeof(qat_op_params)
+                                                     * qctx->qop_len);
+        if (qctx->qop == NULL) {
+            WARN("Unable to allocate memory[%lu bytes] for qat op params\n",
+                 sizeof(qat_op_params) * qctx->qop_len);
+            return 0;
+        }
+        start = 0;
+    }
+
+    for (i = start; i < qctx->numpipes; i++) {
+        qctx->qop[i].src_fbuf[0].pData = NULL;
+        qctx->qop[i].src_fbuf[0].dataLenInBytes = 0;
+        qctx->qop[i].rec_buf = NULL;
+        qctx->qop[i].rec_buf_len = 0;
+
+        qctx->qop[i].src_sgl.numBuffers = 1;
+        qctx->qop[i].src_sgl.pBuffers = qctx->qop[i].src_fbuf;
+        qctx->qop[i].src_sgl.pUserData = NULL;
+        qctx->qop[i].src_sgl.pPrivateMetaData = NULL;
+
+        if (msize == 0 &&
+            cpaCyBufferListGetMetaSize(qat_instance_handles[qctx->inst_num],
+                                       qctx->qop[i].src_sgl.numBuffers,
+                                       &msize) != CPA_STATUS_SUCCESS) {
+            WARN("cpaCyBufferListGetBufferSize failed.\n");
+            goto err;
+        }
+
+        if (msize) {
+            qctx->qop[i].src_sgl.pPrivateMetaData =
+                qaeCryptoMemAlloc(msize, __FILE__, __LINE__);
+            if (qctx->qop[i].src_sgl.pPrivateMetaData == NULL) {
+                WARN("QMEM alloc failed for PrivateData\n");
+                goto err;
+            }
+        }
+
+        opd = &qctx->qop[i].op_data;
+        memcpy(opd, &template_aead_opData, sizeof(template_aead_opData));
+        opd->sessionCtx = qctx->session_ctx;
+        opd->pIv = qaeCryptoMemAlloc(AES_BLOCK_SIZE, __FILE__, __LINE__);
+        opd->pAdditionalAuthData = qaeCryptoMemAlloc(QAT_AEAD_MAX_AAD_LEN,
+                                                     __FILE__, __LINE__);
+        if (opd->pIv == NULL || opd->pAdditionalAuthData == NULL) {
+            WARN("QMEM Mem Alloc failed for pIv or AAD for pipe %d.\n", i);
+            goto err;
+        }
+    }
+
+    DEBUG_PPL("[%p] qop setup for %u elements\n", ctx, qctx->qop_len);
+    return 1;
+
+ err:
+    qat_aead_free_qop(&qctx->qop, &qctx->qop_len);
+    return 0;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_prepare_op(qat_aead_ctx *qctx, unsigned int pipe,
+*                             const unsigned char *iv,
+*                             const unsigned char *aad,
+*                             unsigned int aad_len,
+*                             const unsigned char *in, size_t len)
+*
+* description:
+*    Copies the IV, the AAD and the data of a pipe into pinned memory. Room
+*  is left after the data for the tag computed by QAT. The data is copied
+*  into the record buffer of the pipe, which is kept across operations.
+*
+******************************************************************************/
+static int qat_aead_prepare_op(qat_aead_ctx *qctx, unsigned int pipe,
+                               const unsigned char *iv,
+                               const unsigned char *aad,
+                               unsigned int aad_len,
+                               const unsigned char *in, size_t len)
+{
+    qat_op_params *qop = &qctx->qop[pipe];
+    CpaCySymOpData *opd = &qop->op_data;
+
+    if (len > UINT32_MAX - QAT_AEAD_TAG_LEN ||
+        !qat_reserve_rec_buf(qop, len + QAT_AEAD_TAG_LEN)) {
+        WARN("Failure in src buffer allocation.\n");
+        return 0;
+    }
+    qop->src_fbuf[0].pData = qop->rec_buf;
+    qop->src_fbuf[0].dataLenInBytes = len + QAT_AEAD_TAG_LEN;
+    memcpy(qop->src_fbuf[0].pData, in, len);
+
+    memcpy(opd->pIv, iv, QAT_AEAD_IV_LEN);
+    memset(opd->pAdditionalAuthData, 0, QAT_AEAD_MAX_AAD_LEN);
+    memcpy(opd->pAdditionalAuthData, aad, aad_len);
+    opd->messageLenToCipherInBytes = len;
+    opd->messageLenToHashInBytes = len;
+    return 1;
+}
+
+/* Detach the data buffers of the pipes from their record buffers after an
+ * operation, the record buffers being kept for the next one */
+static void qat_aead_release_op_bufs(qat_aead_ctx *qctx)
+{
+    unsigned int pipe;
+
+    for (pipe = 0; pipe < qctx->numpipes; pipe++) {
+        qctx->qop[pipe].src_fbuf[0].pData = NULL;
+        qctx->qop[pipe].src_fbuf[0].dataLenInBytes = 0;
+    }
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_perform_op(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+*
+* @param ctx     [IN]  - pointer to existing ctx
+* @param qctx    [IN]  - pointer to the qat aead context
+*
+* @retval 1      all the pipes have been processed
+* @retval 0      function failed, qctx->fallback is set when the request
+*                should be processed in software instead
+*
+* description:
+*    Submits the operations prepared for qctx->numpipes pipes and waits for
+*  all of them to complete, pausing the job in asynchronous mode.
+*
+******************************************************************************/
+static int qat_aead_perform_op(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+{
+    CpaStatus sts = 0;
+    CpaCySymOpData *opd = NULL;
+    CpaBufferList *s_sgl = NULL;
+    CpaBoolean verify = CPA_FALSE;
+    op_done_pipe_t done;
+    thread_local_variables_t *tlv = NULL;
+    unsigned int pipe = 0;
+    int error = 0, job_ret = 0;
+    int ret = 0;
+
+    tlv = qat_check_create_local_variables();
+    if (NULL == tlv) {
+            WARN("could not create local variables\n");
+            return 0;
+    }
+
+    QAT_INC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+    if (qat_use_signals()) {
+        if (tlv->localOpsInFlight == 1) {
+            if (pthread_kill(timer_poll_func_thread, SIGUSR1) != 0) {
+                WARN("pthread_kill error\n");
+                QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+                return 0;
+            }
+        }
+    }
+
+    if (qat_init_op_done_pipe(&done, qctx->numpipes) != 1) {
+        WARN("Failure in qat_init_op_done_pipe\n");
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        return 0;
+    }
+
+    do {
+        opd = &qctx->qop[pipe].op_data;
+        s_sgl = &qctx->qop[pipe].src_sgl;
+
+        DUMP_SYM_PERFORM_OP(qat_instance_handles[qctx->inst_num], opd, s_sgl, s_sgl);
+
+        /* Increment prior to successful submission */
+        done.num_submitted++;
+
+        sts = qat_sym_perform_op(qctx->inst_num, &done, opd, s_sgl, s_sgl,
+                                 &verify);
+        if (sts != CPA_STATUS_SUCCESS) {
+            if (qat_get_sw_fallback_enabled() &&
+                ((sts == CPA_STATUS_RESTARTING) || (sts == CPA_STATUS_FAIL))) {
+                CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
+                               qctx->inst_num,
+                               qat_instance_details[qctx->inst_num].qat_instance_info.physInstId.packageId,
+                               __func__);
+                qctx->fallback = 1;
+            }
+            WARN("Failed to submit request to qat - status = %d\n", sts);
+            error = 1;
+            /* Decrement after failed submission */
+            done.num_submitted--;
+            break;
+        }
+        if (qat_get_sw_fallback_enabled()) {
+            CRYPTO_QAT_LOG("Submit success qat inst_num %d device_id %d - %s\n",
+                           qctx->inst_num,
+                           qat_instance_details[qctx->inst_num].qat_instance_info.physInstId.packageId,
+                           __func__);
+        }
+    } while (++pipe < qctx->numpipes);
+
+    /* If there has been an error during submission of the pipes
+     * indicate to the callback function not to wait for the entire
+     * pipeline.
+     */
+    if (error == 1)
+        done.num_pipes = pipe;
+
+    /* If there is nothing to wait for, do not pause or yield */
+    if (done.num_submitted == 0 || (done.num_submitted == done.num_processed)) {
+        if (done.opDone.job != NULL) {
+            qat_clear_async_event_notification();
+        }
+        goto end;
+    }
+
+    if (enable_heuristic_polling) {
+        QAT_ATOMIC_INC(num_cipher_pipeline_requests_in_flight);
+    }
+
+    do {
+        if (done.opDone.job != NULL) {
+            /* If we get a failure on qat_pause_job then we will
+               not flag an error here and quit because we have
+               an asynchronous request in flight.
+               We don't want to start cleaning up data
+               structures that are still being used. If
+               qat_pause_job fails we will just yield and
+               loop around and try again until the request
+               completes and we can continue. */
+            if ((job_ret = qat_pause_job(done.opDone.job, ASYNC_STATUS_OK)) == 0)
+                pthread_yield();
+        } else {
+            pthread_yield();
+        }
+    } while (!done.opDone.flag ||
+             QAT_CHK_JOB_RESUMED_UNEXPECTEDLY(job_ret));
+
+ end:
+    QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+
+    if (error == 0 && (done.opDone.verifyResult == CPA_TRUE)) {
+        ret = 1;
+    } else if (qat_get_sw_fallback_enabled() &&
+               done.opDone.verifyResult == CPA_FALSE) {
+        CRYPTO_QAT_LOG("Verification of result failed for qat inst_num %d device_id %d - fallback to SW - %s\n",
+                       qctx->inst_num,
+                       qat_instance_details[qctx->inst_num].qat_instance_info.physInstId.packageId,
+                       __func__);
+        qctx->fallback = 1;
+    }
+    qat_cleanup_op_done_pipe(&done);
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_tls_sw_record(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                                unsigned int pipe, const unsigned char *iv,
+*                                int eivlen)
+*
+* @retval x      the payload length of the record
+* @retval -1     function failed
+*
+* description:
+*    Encrypts or decrypts one TLS 1.2 record in software, in place. The
+*  record is made of the explicit IV (eivlen bytes), the payload and the tag.
+*
+******************************************************************************/
+static int qat_aead_tls_sw_record(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                                  unsigned int pipe, const unsigned char *iv,
+                                  int eivlen)
+{
+    int enc = EVP_CIPHER_CTX_encrypting(ctx);
+    unsigned char *buf = qctx->p_out[pipe] + eivlen;
+    size_t plen = qctx->p_inlen[pipe] - eivlen - QAT_AEAD_TAG_LEN;
+    int ok;
+
+    ok = qat_aead_sw_init(ctx, qctx, NULL, iv, enc) == 1 &&
+         qat_aead_sw_cipher(ctx, qctx, NULL, qctx->tls_aad[pipe],
+                            EVP_AEAD_TLS1_AAD_LEN) >= 0 &&
+         (plen == 0 || qat_aead_sw_cipher(ctx, qctx, buf, buf, plen) >= 0);
+    if (ok && !enc)
+        ok = qat_aead_sw_ctrl(ctx, qctx, EVP_CTRL_AEAD_SET_TAG,
+                              QAT_AEAD_TAG_LEN, buf + plen) > 0;
+    if (ok)
+        ok = qat_aead_sw_cipher(ctx, qctx, NULL, NULL, 0) >= 0;
+    if (ok && enc)
+        ok = qat_aead_sw_ctrl(ctx, qctx, EVP_CTRL_AEAD_GET_TAG,
+                              QAT_AEAD_TAG_LEN, buf + plen) > 0;
+
+    if (!ok) {
+        if (!enc)
+            OPENSSL_cleanse(buf, plen);
+        return -1;
+    }
+    return (int)plen;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_tls_record_iv(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                                unsigned int pipe, unsigned char *iv)
+*
+* description:
+*    Derives the IV of the TLS 1.2 record of a pipe. For AES-GCM it is made
+*  of the fixed field and of the explicit part, generated when encrypting and
+*  read from the record when decrypting. For ChaCha20-Poly1305 it is the
+*  fixed IV xored with the record sequence number (RFC 7905).
+*
+******************************************************************************/
+static int qat_aead_tls_record_iv(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                                  unsigned int pipe, unsigned char *iv)
+{
+    int i;
+
+    if (EVP_CIPHER_CTX_nid(ctx) == NID_chacha20_poly1305) {
+        if (qctx->iv_len != QAT_AEAD_IV_LEN)
+            return 0;
+        memcpy(iv, qctx->gen_iv, QAT_AEAD_IV_LEN);
+        for (i = 0; i < 8; i++)
+            iv[QAT_AEAD_IV_LEN - 8 + i] ^= qctx->tls_aad[pipe][i];
+        return 1;
+    }
+
+    if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CIPHER_CTX_encrypting(ctx) ?
+                            EVP_CTRL_GCM_IV_GEN : EVP_CTRL_GCM_SET_IV_INV,
+                            EVP_GCM_TLS_EXPLICIT_IV_LEN,
+                            qctx->p_out[pipe]) <= 0)
+        return 0;
+    memcpy(iv, qctx->iv, qctx->iv_len);
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_tls_cipher(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                             unsigned char *out, const unsigned char *in,
+*                             size_t len)
+*
+* @retval x      the total length of the records, or of their payload when
+*                decrypting with AES-GCM as OpenSSL does
+* @retval -1     function failed
+*
+* description:
+*    Encrypts or decrypts TLS 1.2 records, one per pipe, in place. All the
+*  pipes are submitted to QAT together. Small single records, and all the
+*  records when the cipher cannot be offloaded, are processed in software
+*  within this same call.
+*
+******************************************************************************/
+static int qat_aead_tls_cipher(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                               unsigned char *out, const unsigned char *in,
+                               size_t len)
+{
+    unsigned char ivs[QAT_MAX_PIPELINES][EVP_MAX_IV_LENGTH];
+    int enc = EVP_CIPHER_CTX_encrypting(ctx);
+    int eivlen = EVP_CIPHER_CTX_nid(ctx) == NID_chacha20_poly1305 ?
+                 0 : EVP_GCM_TLS_EXPLICIT_IV_LEN;
+    unsigned char *buf = NULL;
+    unsigned char *res = NULL;
+    size_t plen = 0;
+    unsigned int pipe = 0;
+    int offload = !qctx->fallback && qat_aead_offload_supported(ctx);
+    int outlen = -1;
+    int retVal = 0;
+
+    if (PIPELINE_INCOMPLETE_INIT(qctx)) {
+        WARN("Pipeline not initialised completely\n");
+        goto end;
+    }
+
+    if (PIPELINE_SET(qctx)) {
+        /* All the aad data (tls header) should be present */
+        if (qctx->aad_ctr != qctx->numpipes) {
+            WARN("AAD data missing supplied %u of %u\n",
+                 qctx->aad_ctr, qctx->numpipes);
+            goto end;
+        }
+    } else {
+        if (qctx->aad_ctr != 1) {
+            WARN("%u TLS AADs supplied without pipelines\n", qctx->aad_ctr);
+            goto end;
+        }
+#ifndef OPENSSL_ENABLE_QAT_SMALL_PACKET_CIPHER_OFFLOADS
+        if (len <=
+            qat_pkt_threshold_table_get_threshold(EVP_CIPHER_CTX_nid(ctx)))
+            offload = 0;
+#endif
+        CLEAR_PIPELINE(qctx);
+        qctx->p_in = (unsigned char **)&in;
+        qctx->p_out = &out;
+        qctx->p_inlen = &len;
+    }
+
+    if (qctx->iv_len != QAT_AEAD_IV_LEN)
+        offload = 0;
+
+    /* Derive the IV of every record before any of them is processed */
+    do {
+        if (qctx->p_out[pipe] != qctx->p_in[pipe] ||
+            qctx->p_inlen[pipe] < eivlen + QAT_AEAD_TAG_LEN) {
+            WARN("Pipe %u: TLS record must be processed in place\n", pipe);
+            goto end;
+        }
+        if (!qat_aead_tls_record_iv(ctx, qctx, pipe, ivs[pipe])) {
+            WARN("Pipe %u: failed to set the record IV\n", pipe);
+            goto end;
+        }
+        if (qctx->p_inlen[pipe] == eivlen + QAT_AEAD_TAG_LEN)
+            offload = 0;
+    } while (++pipe < qctx->numpipes);
+
+    if (offload) {
+        retVal = qat_aead_session_init(ctx, qctx, EVP_AEAD_TLS1_AAD_LEN) &&
+                 qat_aead_setup_op_params(ctx, qctx);
+
+        for (pipe = 0; retVal && pipe < qctx->numpipes; pipe++) {
+            plen = qctx->p_inlen[pipe] - eivlen - QAT_AEAD_TAG_LEN;
+            retVal = qat_aead_prepare_op(qctx, pipe, ivs[pipe],
+                                         qctx->tls_aad[pipe],
+                                         EVP_AEAD_TLS1_AAD_LEN,
+                                         qctx->p_in[pipe] + eivlen, plen);
+        }
+
+        if (retVal)
+            retVal = qat_aead_perform_op(ctx, qctx);
+
+        if (retVal) {
+            outlen = 0;
+            for (pipe = 0; pipe < qctx->numpipes; pipe++) {
+                plen = qctx->p_inlen[pipe] - eivlen - QAT_AEAD_TAG_LEN;
+                buf = qctx->p_out[pipe] + eivlen;
+                res = qctx->qop[pipe].src_fbuf[0].pData;
+                if (enc) {
+                    memcpy(buf, res, plen + QAT_AEAD_TAG_LEN);
+                } else if (CRYPTO_memcmp(res + plen, buf + plen,
+                                         QAT_AEAD_TAG_LEN) != 0) {
+                    WARN("Pipe %u: tag verification failed\n", pipe);
+                    outlen = -1;
+                    break;
+                }
+                outlen += plen;
+            }
+            /* Only release plaintext once every record has been verified */
+            for (pipe = 0; !enc && outlen >= 0 && pipe < qctx->numpipes;
+                 pipe++) {
+                plen = qctx->p_inlen[pipe] - eivlen - QAT_AEAD_TAG_LEN;
+                memcpy(qctx->p_out[pipe] + eivlen,
+                       qctx->qop[pipe].src_fbuf[0].pData, plen);
+            }
+            if (!enc && outlen < 0) {
+                for (pipe = 0; pipe < qctx->numpipes; pipe++)
+                    OPENSSL_cleanse(qctx->qop[pipe].src_fbuf[0].pData,
+                                    qctx->qop[pipe].src_fbuf[0].dataLenInBytes);
+            }
+        }
+        if (qctx->qop != NULL)
+            qat_aead_release_op_bufs(qctx);
+
+        if (retVal || !qctx->fallback)
+            goto end;
+
+        DEBUG("- Switched to software mode.\n");
+        CRYPTO_QAT_LOG("Resubmitting request to SW - %s\n", __func__);
+    }
+
+    outlen = 0;
+    for (pipe = 0; pipe < qctx->numpipes; pipe++) {
+        if ((retVal = qat_aead_tls_sw_record(ctx, qctx, pipe, ivs[pipe],
+                                             eivlen)) < 0) {
+            outlen = -1;
+            break;
+        }
+        outlen += retVal;
+    }
+
+ end:
+    /* Encryption, and ChaCha20-Poly1305 decryption, return the length of
+     * the whole records.
+     */
+    if (outlen >= 0 && (enc || eivlen == 0)) {
+        for (outlen = 0, pipe = 0; pipe < qctx->numpipes; pipe++)
+            outlen += qctx->p_inlen[pipe];
+    }
+
+    /* Reset the AAD counter forcing that new AAD information is provided
+     * before each repeat invocation of this function.
+     */
+    qctx->aad_ctr = 0;
+    qctx->iv_set = 0;
+
+    /* This function can be called again with the same evp_cipher_ctx. */
+    if (PIPELINE_SET(qctx)) {
+        INIT_SEQ_CLEAR_FLAG(qctx, INIT_SEQ_PPL_AADCTR_SET);
+        INIT_SEQ_SET_FLAG(qctx, INIT_SEQ_PPL_USED);
+        qctx->npipes_last_used = qctx->numpipes > qctx->npipes_last_used
+            ? qctx->numpipes : qctx->npipes_last_used;
+    }
+    return outlen;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_sw_start(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+*
+* description:
+*    Starts processing the current message in software, feeding it the AAD
+*  collected so far.
+*
+******************************************************************************/
+static int qat_aead_sw_start(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+{
+    if (qat_aead_sw_init(ctx, qctx, NULL, qctx->iv,
+                         EVP_CIPHER_CTX_encrypting(ctx)) != 1 ||
+        (qctx->aad_len > 0 &&
+         qat_aead_sw_cipher(ctx, qctx, NULL, qctx->aad,
+                            qctx->aad_len) < 0)) {
+        WARN("Failed to start s/w AEAD message\n");
+        return 0;
+    }
+    qctx->msg_state = QAT_AEAD_MSG_SW;
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_hw_message(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                             unsigned char *out, const unsigned char *in,
+*                             size_t len)
+*
+* @retval 1      function succeeded
+* @retval 0      function failed, qctx->fallback is set when the message
+*                should be processed in software instead
+*
+* description:
+*    Encrypts or decrypts a whole message with the AAD collected so far. The
+*  tag is kept in qctx->calc_tag until the message is finalised.
+*
+******************************************************************************/
+static int qat_aead_hw_message(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                               unsigned char *out, const unsigned char *in,
+                               size_t len)
+{
+    unsigned char *res = NULL;
+    int ret;
+
+    CLEAR_PIPELINE(qctx);
+
+    ret = qat_aead_session_init(ctx, qctx, qctx->aad_len) &&
+          qat_aead_setup_op_params(ctx, qctx) &&
+          qat_aead_prepare_op(qctx, 0, qctx->iv, qctx->aad, qctx->aad_len,
+                              in, len) &&
+          qat_aead_perform_op(ctx, qctx);
+
+    if (ret) {
+        res = qctx->qop[0].src_fbuf[0].pData;
+        memcpy(out, res, len);
+        memcpy(qctx->calc_tag, res + len, QAT_AEAD_TAG_LEN);
+    }
+    if (qctx->qop != NULL)
+        qat_aead_release_op_bufs(qctx);
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_update(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+*                         unsigned char *out, const unsigned char *in,
+*                         size_t len)
+*
+* @retval x      the number of bytes processed
+* @retval -1     function failed
+*
+* description:
+*    Processes AAD (out == NULL) or data of a message. The AAD is collected
+*  until the data is supplied, at which point the whole message is offloaded.
+*  Hence only a single data update per IV is offloaded; a message too small
+*  to be worth offloading or too much AAD is processed in software, where it
+*  can be streamed.
+*
+******************************************************************************/
+static int qat_aead_update(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx,
+                           unsigned char *out, const unsigned char *in,
+                           size_t len)
+{
+    int offload = 0;
+
+    if (out == NULL) {
+        if (qctx->msg_state == QAT_AEAD_MSG_NONE &&
+            len <= QAT_AEAD_MAX_AAD_LEN - qctx->aad_len) {
+            memcpy(qctx->aad + qctx->aad_len, in, len);
+            qctx->aad_len += len;
+            return len;
+        }
+        if (qctx->msg_state == QAT_AEAD_MSG_HW) {
+            WARN("AAD supplied after the data\n");
+            return -1;
+        }
+        if (qctx->msg_state == QAT_AEAD_MSG_NONE &&
+            !qat_aead_sw_start(ctx, qctx))
+            return -1;
+        return qat_aead_sw_cipher(ctx, qctx, NULL, in, len);
+    }
+
+    switch (qctx->msg_state) {
+        case QAT_AEAD_MSG_NONE:
+            offload = !qctx->fallback && qat_aead_offload_supported(ctx) &&
+                      qctx->iv_len == QAT_AEAD_IV_LEN && len > 0;
+#ifndef OPENSSL_ENABLE_QAT_SMALL_PACKET_CIPHER_OFFLOADS
+            if (len <=
+                qat_pkt_threshold_table_get_threshold(EVP_CIPHER_CTX_nid(ctx)))
+                offload = 0;
+#endif
+            if (offload) {
+                if (qat_aead_hw_message(ctx, qctx, out, in, len)) {
+                    qctx->msg_state = QAT_AEAD_MSG_HW;
+                    return len;
+                }
+                if (!qctx->fallback)
+                    return -1;
+                DEBUG("- Switched to software mode.\n");
+                CRYPTO_QAT_LOG("Resubmitting request to SW - %s\n", __func__);
+            }
+            if (!qat_aead_sw_start(ctx, qctx))
+                return -1;
+            return qat_aead_sw_cipher(ctx, qctx, out, in, len);
+
+        case QAT_AEAD_MSG_SW:
+            return qat_aead_sw_cipher(ctx, qctx, out, in, len);
+
+        default:
+            WARN("Only a single data update per IV is supported\n");
+            return -1;
+    }
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_final(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+*
+* @retval 0      function succeeded
+* @retval -1     function failed, including a tag mismatch
+*
+* description:
+*    Finalises a message: the tag is made available when encrypting and
+*  compared with the expected one when decrypting.
+*
+******************************************************************************/
+static int qat_aead_final(EVP_CIPHER_CTX *ctx, qat_aead_ctx *qctx)
+{
+    int enc = EVP_CIPHER_CTX_encrypting(ctx);
+    int ret = -1;
+
+    if (qctx->msg_state == QAT_AEAD_MSG_NONE && !qat_aead_sw_start(ctx, qctx))
+        goto end;
+
+    if (qctx->msg_state == QAT_AEAD_MSG_HW) {
+        if (enc) {
+            memcpy(qctx->tag, qctx->calc_tag, QAT_AEAD_TAG_LEN);
+            qctx->tag_len = QAT_AEAD_TAG_LEN;
+            ret = 0;
+        } else if (qctx->tag_len > 0 &&
+                   CRYPTO_memcmp(qctx->calc_tag, qctx->tag,
+                                 qctx->tag_len) == 0) {
+            ret = 0;
+        }
+        OPENSSL_cleanse(qctx->calc_tag, QAT_AEAD_TAG_LEN);
+        goto end;
+    }
+
+    if (!enc && (qctx->tag_len <= 0 ||
+                 qat_aead_sw_ctrl(ctx, qctx, EVP_CTRL_AEAD_SET_TAG,
+                                  qctx->tag_len, qctx->tag) <= 0))
+        goto end;
+    if (qat_aead_sw_cipher(ctx, qctx, NULL, NULL, 0) < 0)
+        goto end;
+    if (enc) {
+        if (qat_aead_sw_ctrl(ctx, qctx, EVP_CTRL_AEAD_GET_TAG,
+                             QAT_AEAD_TAG_LEN, qctx->tag) <= 0)
+            goto end;
+        qctx->tag_len = QAT_AEAD_TAG_LEN;
+    }
+    ret = 0;
+
+ end:
+    qctx->iv_set = 0;
+    qctx->msg_state = QAT_AEAD_MSG_NONE;
+    qctx->aad_len = 0;
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_aead_init(EVP_CIPHER_CTX *ctx,
+*                       const unsigned char *inkey,
+*                       const unsigned char *iv,
+*                       int enc)
+*
+* @param ctx    [IN]  - pointer to existing ctx
+* @param inKey  [IN]  - input cipher key
+* @param iv     [IN]  - initialisation vector
+* @param enc    [IN]  - 1 encrypt 0 decrypt
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    This function sets the key and/or the IV of the AEAD context. The QAT
+*  session is initialised when the first message is offloaded. The IV of a
+*  ChaCha20-Poly1305 context is also the fixed IV of the TLS 1.2 records.
+*
+******************************************************************************/
+int qat_aead_init(EVP_CIPHER_CTX *ctx, const unsigned char *inkey,
+                  const unsigned char *iv, int enc)
+{
+    qat_aead_ctx *qctx = NULL;
+    int keylen;
+
+    if (ctx == NULL) {
+        WARN("ctx is NULL.\n");
+        return 0;
+    }
+
+    qctx = qat_aead_data(ctx);
+    if (qctx == NULL || qctx->sw_ctx_cipher_data == NULL) {
+        WARN("qctx is not initialised.\n");
+        return 0;
+    }
+
+    if (inkey == NULL && iv == NULL)
+        return 1;
+
+    if (inkey != NULL) {
+        keylen = EVP_CIPHER_CTX_key_length(ctx);
+        if (qctx->cipher_key == NULL &&
+            (qctx->cipher_key = OPENSSL_malloc(keylen)) == NULL) {
+            WARN("Unable to allocate memory for Cipher key.\n");
+            return 0;
+        }
+        memcpy(qctx->cipher_key, inkey, keylen);
+
+        /* A new key needs a new session */
+        if (!qat_aead_session_remove(qctx))
+            return 0;
+        if (qat_aead_sw_init(ctx, qctx, inkey, NULL, enc) != 1)
+            return 0;
+        qctx->key_set = 1;
+    }
+
+    if (iv != NULL) {
+        memcpy(qctx->iv, iv, qctx->iv_len);
+        if (EVP_CIPHER_CTX_nid(ctx) == NID_chacha20_poly1305)
+            memcpy(qctx->gen_iv, iv, qctx->iv_len);
+        qctx->iv_set = 1;
+        qctx->iv_gen = 0;
+    }
+
+    qctx->msg_state = QAT_AEAD_MSG_NONE;
+    qctx->aad_len = 0;
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*    qat_aead_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg, void *ptr)
+*
+* @param ctx    [IN]  - pointer to existing ctx
+* @param type   [IN]  - type of request
+* @param arg    [IN]  - size of the pointed to by ptr
+* @param ptr    [IN]  - input buffer contain the necessary parameters
+*
+* @retval x      The return value is dependent on the type of request being made
+*       EVP_CTRL_AEAD_TLS1_AAD return value is the length of the tag appended
+*               to the TLS record
+* @retval 0      function failed
+* @retval -1     unknown request type
+*
+* description:
+*    This function is the generic control interface of the AEAD ciphers.
+*  It implements the same requests as the OpenSSL implementations, the IV
+*  length, the tag and the TLS 1.2 requests (fixed IV field, AES-GCM
+*  explicit IV generation and record AAD) plus the pipeline requests.
+*  A copied context gets its own key and software context; it does not share
+*  the QAT session, which is initialised again on its first offload.
+*
+******************************************************************************/
+int qat_aead_ctrl(EVP_CIPHER_CTX *ctx, int type, int arg, void *ptr)
+{
+    qat_aead_ctx *qctx = NULL;
+    qat_aead_ctx *qctx_out = NULL;
+    EVP_CIPHER_CTX *out = NULL;
+    const EVP_CIPHER *sw_cipher = NULL;
+    unsigned int sw_size = 0;
+    unsigned char *aad = NULL;
+    unsigned int len = 0;
+    int enc, chacha, ret;
+
+    if (ctx == NULL) {
+        WARN("ctx parameter is NULL.\n");
+        return -1;
+    }
+
+    qctx = qat_aead_data(ctx);
+    if (qctx == NULL) {
+        WARN("qctx is NULL.\n");
+        return -1;
+    }
+
+    enc = EVP_CIPHER_CTX_encrypting(ctx);
+    chacha = EVP_CIPHER_CTX_nid(ctx) == NID_chacha20_poly1305;
+
+    switch (type) {
+        case EVP_CTRL_INIT:
+            sw_cipher = GET_SW_CIPHER(ctx);
+            sw_size = EVP_CIPHER_impl_ctx_size(sw_cipher);
+            /* The s/w ChaCha20-Poly1305 allocates its own context data */
+            if (sw_size != 0) {
+                qctx->sw_ctx_cipher_data = OPENSSL_zalloc(sw_size);
+                if (qctx->sw_ctx_cipher_data == NULL) {
+                    WARN("Unable to allocate memory [%u bytes] for sw_ctx_cipher_data\n",
+                         sw_size);
+                    return 0;
+                }
+            }
+            if (qat_aead_sw_ctrl(ctx, qctx, type, arg, ptr) <= 0 ||
+                qctx->sw_ctx_cipher_data == NULL) {
+                WARN("s/w AEAD ctrl function failed.\n");
+                return 0;
+            }
+            qctx->iv_len = EVP_CIPHER_CTX_iv_length(ctx);
+            qctx->tag_len = -1;
+            qctx->inst_num = QAT_INVALID_INSTANCE;
+            qctx->numpipes = 1;
+            qctx->npipes_last_used = 1;
+            /* As for the chained ciphers, a context initialised while the
+             * offload is disabled stays in software until it is cleaned up.
+             */
+            qctx->fallback = qat_get_qat_offload_disabled() ? 1 : 0;
+            return 1;
+
+        case EVP_CTRL_COPY:
+            /* out holds a shallow copy of qctx, drop what it must not share
+             * before anything can fail so that cleaning it up is safe.
+             */
+            out = (EVP_CIPHER_CTX *)ptr;
+            qctx_out = qat_aead_data(out);
+            qctx_out->sw_ctx_cipher_data = NULL;
+            qctx_out->cipher_key = NULL;
+            qctx_out->session_data = NULL;
+            qctx_out->session_ctx = NULL;
+            qctx_out->qop = NULL;
+            qctx_out->qop_len = 0;
+            INIT_SEQ_CLEAR_FLAG(qctx_out, INIT_SEQ_QAT_SESSION_INIT);
+
+            if (qctx->cipher_key != NULL) {
+                qctx_out->cipher_key =
+                    OPENSSL_memdup(qctx->cipher_key,
+                                   EVP_CIPHER_CTX_key_length(ctx));
+                if (qctx_out->cipher_key == NULL) {
+                    WARN("Unable to copy the cipher key\n");
+                    return 0;
+                }
+            }
+
+            if (qctx->sw_ctx_cipher_data == NULL)
+                return 1;
+            sw_cipher = GET_SW_CIPHER(ctx);
+            sw_size = EVP_CIPHER_impl_ctx_size(sw_cipher);
+            if (sw_size != 0) {
+                qctx_out->sw_ctx_cipher_data =
+                    OPENSSL_memdup(qctx->sw_ctx_cipher_data, sw_size);
+                if (qctx_out->sw_ctx_cipher_data == NULL) {
+                    WARN("Unable to allocate memory [%u bytes] for sw_ctx_cipher_data\n",
+                         sw_size);
+                    return 0;
+                }
+            }
+            if (!(EVP_CIPHER_flags(sw_cipher) & EVP_CIPH_CUSTOM_COPY))
+                return 1;
+            /* The s/w ChaCha20-Poly1305 sets the context data of out itself */
+            EVP_CIPHER_CTX_set_cipher_data(out, qctx_out->sw_ctx_cipher_data);
+            ret = qat_aead_sw_ctrl(ctx, qctx, type, arg, ptr);
+            qctx_out->sw_ctx_cipher_data = EVP_CIPHER_CTX_get_cipher_data(out);
+            EVP_CIPHER_CTX_set_cipher_data(out, qctx_out);
+            return ret > 0 ? 1 : 0;
+
+        case EVP_CTRL_AEAD_SET_IVLEN:
+            if (arg <= 0 || arg > EVP_MAX_IV_LENGTH)
+                return 0;
+            if (qat_aead_sw_ctrl(ctx, qctx, type, arg, ptr) <= 0)
+                return 0;
+            qctx->iv_len = arg;
+            return 1;
+
+        case EVP_CTRL_AEAD_SET_TAG:
+            if (arg <= 0 || arg > QAT_AEAD_TAG_LEN || (enc && !chacha))
+                return 0;
+            /* ChaCha20-Poly1305 accepts a tag length without a tag */
+            if (ptr != NULL) {
+                memcpy(qctx->tag, ptr, arg);
+                qctx->tag_len = arg;
+            }
+            return 1;
+
+        case EVP_CTRL_AEAD_GET_TAG:
+            if (arg <= 0 || arg > QAT_AEAD_TAG_LEN || !enc ||
+                qctx->tag_len < 0)
+                return 0;
+            memcpy(ptr, qctx->tag, arg);
+            return 1;
+
+        case EVP_CTRL_AEAD_SET_IV_FIXED:
+            if (chacha) {
+                if (arg != QAT_AEAD_IV_LEN)
+                    return 0;
+                memcpy(qctx->gen_iv, ptr, arg);
+                return 1;
+            }
+            /* Special case: -1 length restores whole IV */
+            if (arg == -1) {
+                memcpy(qctx->gen_iv, ptr, qctx->iv_len);
+                qctx->iv_gen = 1;
+                return 1;
+            }
+            /* Fixed field must be at least 4 bytes and invocation field
+             * at least 8.
+             */
+            if (arg < 4 || (qctx->iv_len - arg) < 8)
+                return 0;
+            memcpy(qctx->gen_iv, ptr, arg);
+            if (enc && RAND_bytes(qctx->gen_iv + arg, qctx->iv_len - arg) <= 0)
+                return 0;
+            qctx->iv_gen = 1;
+            return 1;
+
+        case EVP_CTRL_GCM_IV_GEN:
+            if (chacha || qctx->iv_gen == 0 || qctx->key_set == 0)
+                return 0;
+            memcpy(qctx->iv, qctx->gen_iv, qctx->iv_len);
+            if (arg <= 0 || arg > qctx->iv_len)
+                arg = qctx->iv_len;
+            memcpy(ptr, qctx->iv + qctx->iv_len - arg, arg);
+            /* Invocation field will be at least 8 bytes in size and so no
+             * need to check wrap around or increment more than last 8 bytes.
+             */
+            qat_aes_gcm_ctr64_inc(qctx->gen_iv + qctx->iv_len - 8);
+            qctx->iv_set = 1;
+            qctx->msg_state = QAT_AEAD_MSG_NONE;
+            qctx->aad_len = 0;
+            return 1;
+
+        case EVP_CTRL_GCM_SET_IV_INV:
+            if (chacha || qctx->iv_gen == 0 || qctx->key_set == 0 || enc ||
+                arg <= 0 || arg > qctx->iv_len)
+                return 0;
+            memcpy(qctx->gen_iv + qctx->iv_len - arg, ptr, arg);
+            memcpy(qctx->iv, qctx->gen_iv, qctx->iv_len);
+            qctx->iv_set = 1;
+            qctx->msg_state = QAT_AEAD_MSG_NONE;
+            qctx->aad_len = 0;
+            return 1;
+
+        case EVP_CTRL_AEAD_TLS1_AAD:
+            /* Save the AAD of the record, one per pipe */
+            if (arg != EVP_AEAD_TLS1_AAD_LEN ||
+                qctx->aad_ctr >= QAT_MAX_PIPELINES) {
+                WARN("Invalid argument for AEAD_TLS1_AAD.\n");
+                return 0;
+            }
+            aad = qctx->tls_aad[qctx->aad_ctr];
+            memcpy(aad, ptr, arg);
+            len = aad[arg - 2] << QAT_BYTE_SHIFT | aad[arg - 1];
+            /* Correct length for explicit IV, ChaCha20-Poly1305 has none */
+            if (!chacha) {
+                if (len < EVP_GCM_TLS_EXPLICIT_IV_LEN)
+                    return 0;
+                len -= EVP_GCM_TLS_EXPLICIT_IV_LEN;
+            }
+            /* If decrypting correct for tag too */
+            if (!enc) {
+                if (len < QAT_AEAD_TAG_LEN)
+                    return 0;
+                len -= QAT_AEAD_TAG_LEN;
+            }
+            aad[arg - 2] = len >> QAT_BYTE_SHIFT;
+            aad[arg - 1] = len & 0xff;
+            qctx->aad_ctr++;
+            if (qctx->aad_ctr > 1)
+                INIT_SEQ_SET_FLAG(qctx, INIT_SEQ_PPL_AADCTR_SET);
+            /* Extra padding: tag appended to record */
+            return QAT_AEAD_TAG_LEN;
+
+        case EVP_CTRL_AEAD_SET_MAC_KEY:
+            /* No MAC key, ChaCha20-Poly1305 accepts it as OpenSSL does */
+            return chacha ? 1 : -1;
+
+        case EVP_CTRL_SET_PIPELINE_OUTPUT_BUFS:
+            if (arg > QAT_MAX_PIPELINES) {
+                WARN("PIPELINE_OUTPUT_BUFS npipes(%d) > Max(%d).\n",
+                     arg, QAT_MAX_PIPELINES);
+                return -1;
+            }
+            qctx->p_out = (unsigned char **)ptr;
+            qctx->numpipes = arg;
+            INIT_SEQ_SET_FLAG(qctx, INIT_SEQ_PPL_OBUF_SET);
+            return 1;
+
+        case EVP_CTRL_SET_PIPELINE_INPUT_BUFS:
+            if (arg > QAT_MAX_PIPELINES) {
+                WARN("PIPELINE_INPUT_BUFS npipes(%d) > Max(%d).\n",
+                     arg, QAT_MAX_PIPELINES);
+                return -1;
+            }
+            qctx->p_in = (unsigned char **)ptr;
+            qctx->numpipes = arg;
+            INIT_SEQ_SET_FLAG(qctx, INIT_SEQ_PPL_IBUF_SET);
+            return 1;
+
+        case EVP_CTRL_SET_PIPELINE_INPUT_LENS:
+            if (arg > QAT_MAX_PIPELINES) {
+                WARN("PIPELINE_INPUT_LENS npipes(%d) > Max(%d).\n",
+                     arg, QAT_MAX_PIPELINES);
+                return -1;
+            }
+            qctx->p_inlen = (size_t *)ptr;
+            qctx->numpipes = arg;
+            INIT_SEQ_SET_FLAG(qctx, INIT_SEQ_PPL_BUF_LEN_SET);
+            return 1;
+
+        default:
+            return -1;
+    }
+}
+
+/******************************************************************************
+* function:
+*    qat_aead_cleanup(EVP_CIPHER_CTX *ctx)
+*
+* @param ctx    [IN]  - pointer to existing ctx
+*
+* @retval 1      function succeeded
+* @retval 0      function failed
+*
+* description:
+*    This function will cleanup all allocated resources of the AEAD
+*  context.
+*
+******************************************************************************/
+int qat_aead_cleanup(EVP_CIPHER_CTX *ctx)
+{
+    qat_aead_ctx *qctx = NULL;
+    const EVP_CIPHER *sw_cipher = NULL;
+    int retVal = 1;
+
+    if (ctx == NULL) {
+        WARN("ctx parameter is NULL.\n");
+        return 0;
+    }
+
+    qctx = qat_aead_data(ctx);
+    if (qctx == NULL) {
+        WARN("qctx parameter is NULL.\n");
+        return 0;
+    }
+
+    if (qctx->sw_ctx_cipher_data != NULL) {
+        sw_cipher = GET_SW_CIPHER(ctx);
+        if (EVP_CIPHER_meth_get_cleanup(sw_cipher) != NULL) {
+            EVP_CIPHER_CTX_set_cipher_data(ctx, qctx->sw_ctx_cipher_data);
+            EVP_CIPHER_meth_get_cleanup(sw_cipher)(ctx);
+            EVP_CIPHER_CTX_set_cipher_data(ctx, qctx);
+        }
+        /* The s/w cleanup has cleansed the data it allocated itself */
+        if (EVP_CIPHER_impl_ctx_size(sw_cipher) != 0)
+            OPENSSL_clear_free(qctx->sw_ctx_cipher_data,
+                               EVP_CIPHER_impl_ctx_size(sw_cipher));
+        else
+            OPENSSL_free(qctx->sw_ctx_cipher_data);
+        qctx->sw_ctx_cipher_data = NULL;
+    }
+
+    /* ctx may be cleaned before it gets a chance to allocate qop */
+    qat_aead_free_qop(&qctx->qop, &qctx->qop_len);
+
+    if (!qat_aead_session_remove(qctx))
+        retVal = 0;
+    /* A session context whose session could not be removed is not reused */
+    if (retVal == 1 && qctx->session_data != NULL) {
+        qat_sym_session_ctx_put(qctx->inst_num, EVP_CIPHER_CTX_nid(ctx),
+                                qctx->session_data->cipherSetupData.cipherDirection,
+                                qctx->session_ctx);
+        qctx->session_ctx = NULL;
+    }
+    QAT_QMEMFREE_BUFF(qctx->session_ctx);
+    if (qctx->session_data != NULL) {
+        OPENSSL_free(qctx->session_data);
+        qctx->session_data = NULL;
+    }
+    QAT_CLEANSE_FREE_BUFF(qctx->cipher_key, EVP_CIPHER_CTX_key_length(ctx));
+
+    qctx->key_set = 0;
+    qctx->fallback = 0;
+    INIT_SEQ_CLEAR_ALL_FLAGS(qctx);
+    DEBUG_PPL("[%p] EVP CTX cleaned up\n", ctx);
+    return retVal;
+}
+
+/******************************************************************************
+* function:
+*    qat_aead_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+*                       const unsigned char *in, size_t len)
+*
+* @param ctx    [IN]  - pointer to existing ctx
+* @param out   [OUT]  - output buffer for transform result
+* @param in     [IN]  - input buffer
+* @param len    [IN]  - length of input buffer
+*
+* @retval x      the number of bytes processed, 0 on finalisation
+* @retval -1     function failed
+*
+* description:
+*    This function encrypts or decrypts TLS 1.2 records when their AAD has
+*  been supplied through EVP_CTRL_AEAD_TLS1_AAD. Otherwise it processes the
+*  AAD (out == NULL), the data or finalises (in == NULL) the current message.
+*
+******************************************************************************/
+int qat_aead_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+                       const unsigned char *in, size_t len)
+{
+    qat_aead_ctx *qctx = NULL;
+
+    if (ctx == NULL) {
+        WARN("CTX parameter is NULL.\n");
+        return -1;
+    }
+
+    qctx = qat_aead_data(ctx);
+    if (qctx == NULL) {
+        WARN("QAT CTX NULL\n");
+        return -1;
+    }
+
+    if (!qctx->key_set)
+        return -1;
+
+    if (qctx->aad_ctr > 0)
+        return qat_aead_tls_cipher(ctx, qctx, out, in, len);
+
+    if (!qctx->iv_set)
+        return -1;
+
+    if (in == NULL)
+        return qat_aead_final(ctx, qctx);
+
+    return qat_aead_update(ctx, qctx, out, in, len);
+}
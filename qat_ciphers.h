@@ -58,6 +58,27 @@
 # define HMAC_KEY_SIZE              64
 # define TLS_VIRT_HDR_SIZE          13
 # define TLS_MAX_PADDING_LENGTH     255
+/* Initial size of the pinned record buffer each pipe of a chained cipher
+ * keeps across calls: a full TLS record with its MAC and padding.
+ */
+# define QAT_CHAINED_REC_BUF_SIZE   SSL3_RT_MAX_ENCRYPTED_LENGTH
+/* Application pinned buffer regions that can be registered at a time */
+# define QAT_MAX_PINNED_REGIONS     64
+# define QAT_PINNED_PAGE_SIZE       4096
+/* Session contexts kept per instance, cipher and direction */
+# define QAT_SYM_SESSION_POOL_SIZE  64
+# define QAT_AEAD_IV_LEN             12
+# define QAT_AEAD_TAG_LEN            16
+/* Largest AAD a QAT AES-GCM or ChaCha20-Poly1305 session accepts */
+# define QAT_AEAD_MAX_AAD_LEN        240
+# define QAT_CHACHA_KEY_SIZE        32
+
+/* ChaCha20-Poly1305 is registered whenever OpenSSL provides it, as the
+ * engine relies on it when the devices cannot offload the cipher.
+ */
+# if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+#  define QAT_CHACHA_POLY_CIPHER
+# endif
 
 /* QAT max supported pipelines may be different from
  * SSL max supported ones.
@@ -80,6 +101,8 @@
 
 # define qat_chained_data(ctx) \
     ((qat_chained_ctx *)EVP_CIPHER_CTX_get_cipher_data(ctx))
+# define qat_aead_data(ctx) \
+    ((qat_aead_ctx *)EVP_CIPHER_CTX_get_cipher_data(ctx))
 
 # define QAT_COMMON_CIPHER_FLAG     EVP_CIPH_FLAG_DEFAULT_ASN1
 # define QAT_CBC_FLAGS              (QAT_COMMON_CIPHER_FLAG | \
@@ -89,6 +112,23 @@
                                      EVP_CIPH_FLAG_CUSTOM_CIPHER | \
                                      EVP_CIPH_FLAG_AEAD_CIPHER | \
                                      EVP_CIPH_FLAG_PIPELINE)
+# define QAT_GCM_FLAGS              (QAT_COMMON_CIPHER_FLAG | \
+                                     EVP_CIPH_GCM_MODE | \
+                                     EVP_CIPH_CUSTOM_IV | \
+                                     EVP_CIPH_FLAG_CUSTOM_CIPHER | \
+                                     EVP_CIPH_ALWAYS_CALL_INIT | \
+                                     EVP_CIPH_CTRL_INIT | \
+                                     EVP_CIPH_CUSTOM_COPY | \
+                                     EVP_CIPH_FLAG_AEAD_CIPHER | \
+                                     EVP_CIPH_FLAG_PIPELINE)
+# define QAT_CHACHA_POLY_FLAGS      (QAT_COMMON_CIPHER_FLAG | \
+                                     EVP_CIPH_CUSTOM_IV | \
+                                     EVP_CIPH_FLAG_CUSTOM_CIPHER | \
+                                     EVP_CIPH_ALWAYS_CALL_INIT | \
+                                     EVP_CIPH_CTRL_INIT | \
+                                     EVP_CIPH_CUSTOM_COPY | \
+                                     EVP_CIPH_FLAG_AEAD_CIPHER | \
+                                     EVP_CIPH_FLAG_PIPELINE)
 
 # define INIT_SEQ_PPL_INIT_COMPLETE  (INIT_SEQ_PPL_IBUF_SET | \
                                       INIT_SEQ_PPL_OBUF_SET | \
@@ -125,6 +165,11 @@ typedef struct qat_op_params_t {
     CpaBufferList dst_sgl;
     CpaFlatBuffer src_fbuf[2];
     CpaFlatBuffer dst_fbuf[2];
+    /* Pinned record buffer of the pipe and its allocated size. src_fbuf[1]
+     * points either to it or to a registered application buffer.
+     */
+    Cpa8U *rec_buf;
+    Cpa32U rec_buf_len;
 } qat_op_params;
 
 typedef struct qat_chained_ctx_t {
@@ -161,6 +206,54 @@ typedef struct qat_chained_ctx_t {
     unsigned int fallback;
 } qat_chained_ctx;
 
+typedef struct qat_aead_ctx_t {
+    /* Pointer to context cipher data of the software AEAD cipher used by
+     * the small packet offload feature and the s/w fallback feature. It is
+     * driven one message at a time, this context keeping the AEAD state. */
+    void *sw_ctx_cipher_data;
+
+    /* Crypto */
+    unsigned char *cipher_key;
+    int key_set;
+    unsigned char iv[EVP_MAX_IV_LENGTH];
+    int iv_len;
+    int iv_set;
+    /* Fixed part of the TLS 1.2 record IVs, followed by the invocation
+     * counter for AES-GCM */
+    unsigned char gen_iv[EVP_MAX_IV_LENGTH];
+    int iv_gen;
+    unsigned char tag[QAT_AEAD_TAG_LEN];
+    int tag_len;
+    unsigned char calc_tag[QAT_AEAD_TAG_LEN];
+
+    /* Message being processed outside of the TLS record mode */
+    int msg_state;
+    unsigned int aad_len;
+    unsigned char aad[QAT_AEAD_MAX_AAD_LEN];
+
+    /* QAT Session Params */
+    int inst_num;
+    CpaCySymSessionSetupData *session_data;
+    CpaCySymSessionCtx session_ctx;
+    int init_flags;
+
+    /* TLS 1.2 record AAD, one per pipe */
+    unsigned int aad_ctr;
+    unsigned char tls_aad[QAT_MAX_PIPELINES][EVP_AEAD_TLS1_AAD_LEN];
+
+    /* QAT Operation Params, one per pipe */
+    qat_op_params *qop;
+    unsigned int qop_len;
+
+    /* Pipeline related Data */
+    unsigned char **p_in;
+    unsigned char **p_out;
+    size_t  *p_inlen;
+    unsigned int numpipes;
+    unsigned int npipes_last_used;
+    unsigned int fallback;
+} qat_aead_ctx;
+
 void qat_create_ciphers(void);
 void qat_free_ciphers(void);
 int qat_ciphers(ENGINE *e, const EVP_CIPHER **cipher, const int **nids,
@@ -169,4 +262,9 @@ int qat_ciphers(ENGINE *e, const EVP_CIPHER **cipher, const int **nids,
 int qat_pkt_threshold_table_set_threshold(const char *cipher_name,
                                           int threshold);
 # endif
+# ifndef OPENSSL_DISABLE_QAT_CIPHERS
+int qat_register_pinned_buffer(void *buf, size_t len);
+int qat_unregister_pinned_buffer(void *buf);
+void qat_sym_session_pools_free(void);
+# endif
 #endif                          /* QAT_CIPHERS_H */
@@ -89,12 +89,52 @@ static int qat_dh_compute_key(unsigned char *key, const BIGNUM *pub_key,
 static int qat_dh_mod_exp(const DH *dh, BIGNUM *r, const BIGNUM *a,
                           const BIGNUM *p, const BIGNUM *m, BN_CTX *ctx,
                           BN_MONT_CTX *m_ctx);
+static int qat_dh_generate_params(DH *dh, int prime_len, int generator,
+                                  BN_GENCB *cb);
 static int qat_dh_init(DH *dh);
 static int qat_dh_finish(DH *dh);
 #endif
 
 static DH_METHOD *qat_dh_method = NULL;
 
+#ifndef OPENSSL_DISABLE_QAT_DH
+/*
+ * Domain parameters in the pinned flat buffer form expected by the QAT API,
+ * with copies of the prime and the generator they were converted from.
+ */
+typedef struct {
+    pid_t pid;
+    BIGNUM *p;
+    BIGNUM *g;
+    CpaFlatBuffer P;
+    CpaFlatBuffer G;
+} qat_dh_pg_t;
+
+/*
+ * Process wide cache of the domain parameters, keyed by value so that the
+ * few groups in use, such as the well-known groups of TLS DHE where every
+ * handshake creates a DH object of its own, are converted once. Entries are
+ * added on first use and only read afterwards, so they stay valid until the
+ * DH methods are freed. The pid records the owning process as pinned memory
+ * is not inherited across fork.
+ */
+# define QAT_DH_PG_CACHE_SIZE 16
+static qat_dh_pg_t *qat_dh_pg_cache[QAT_DH_PG_CACHE_SIZE];
+static CRYPTO_RWLOCK *qat_dh_pg_cache_lock = NULL;
+
+static void qat_dh_pg_cache_free(void);
+#endif
+
+/* Depth of the pools of pregenerated keys, per size of the prime */
+#define QAT_DH_KEY_POOL_MAX_SIZES 8
+
+typedef struct {
+    int bits;
+    int size;
+} qat_dh_key_pool_size_t;
+
+static qat_dh_key_pool_size_t qat_dh_key_pool_sizes[QAT_DH_KEY_POOL_MAX_SIZES];
+
 DH_METHOD *qat_get_DH_methods(void)
 {
 #ifndef OPENSSL_DISABLE_QAT_DH
@@ -105,6 +145,12 @@ DH_METHOD *qat_get_DH_methods(void)
         return qat_dh_method;
 
 #ifndef OPENSSL_DISABLE_QAT_DH
+    /* Not fatal, the parameters are then converted on every operation */
+    if (qat_dh_pg_cache_lock == NULL &&
+        (qat_dh_pg_cache_lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        WARN("Failed to allocate the DH parameter cache lock\n");
+    }
+
     if ((qat_dh_method = DH_meth_new("QAT DH method", 0)) == NULL) {
         WARN("Failure allocating DH methods\n");
         QATerr(QAT_F_QAT_GET_DH_METHODS, QAT_R_QAT_ALLOC_DH_METH_FAILURE);
@@ -114,6 +160,7 @@ DH_METHOD *qat_get_DH_methods(void)
     res &= DH_meth_set_generate_key(qat_dh_method, qat_dh_generate_key);
     res &= DH_meth_set_compute_key(qat_dh_method, qat_dh_compute_key);
     res &= DH_meth_set_bn_mod_exp(qat_dh_method, qat_dh_mod_exp);
+    res &= DH_meth_set_generate_params(qat_dh_method, qat_dh_generate_params);
     res &= DH_meth_set_init(qat_dh_method, qat_dh_init);
     res &= DH_meth_set_finish(qat_dh_method, qat_dh_finish);
 
@@ -132,6 +179,7 @@ DH_METHOD *qat_get_DH_methods(void)
 void qat_free_DH_methods(void)
 {
 #ifndef OPENSSL_DISABLE_QAT_DH
+    qat_dh_pg_cache_free();
     if (qat_dh_method != NULL) {
         DH_meth_free(qat_dh_method);
         qat_dh_method = NULL;
@@ -142,6 +190,26 @@ void qat_free_DH_methods(void)
 #endif
 }
 
+int qat_dh_key_pool_set_size(int bits, long size)
+{
+    int i = 0;
+
+    if (bits <= 0 || size < 0 || size > QAT_ASYM_POOL_MAX_SIZE) {
+        WARN("Invalid prime size %d or pool size %ld\n", bits, size);
+        return 0;
+    }
+    for (i = 0; i < QAT_DH_KEY_POOL_MAX_SIZES; i++) {
+        if (qat_dh_key_pool_sizes[i].bits == bits ||
+            qat_dh_key_pool_sizes[i].bits == 0) {
+            qat_dh_key_pool_sizes[i].bits = bits;
+            qat_dh_key_pool_sizes[i].size = (int)size;
+            return 1;
+        }
+    }
+    WARN("No room for the pool size of %d bits primes\n", bits);
+    return 0;
+}
+
 
 #ifndef OPENSSL_DISABLE_QAT_DH
 /*
@@ -169,6 +237,263 @@ static void qat_dhCallbackFn(void *pCallbackTag, CpaStatus status, void *pOpData
                           NULL, CPA_TRUE);
 }
 
+static void qat_dh_pg_free(qat_dh_pg_t *pg)
+{
+    if (pg == NULL)
+        return;
+
+    /* Pinned memory inherited across a fork is not valid in the child */
+    if (pg->pid == getpid()) {
+        QAT_CHK_QMFREE_FLATBUFF(pg->P);
+        QAT_CHK_QMFREE_FLATBUFF(pg->G);
+    }
+    BN_free(pg->p);
+    BN_free(pg->g);
+    OPENSSL_free(pg);
+}
+
+static void qat_dh_pg_cache_free(void)
+{
+    int i = 0;
+
+    for (i = 0; i < QAT_DH_PG_CACHE_SIZE; i++) {
+        qat_dh_pg_free(qat_dh_pg_cache[i]);
+        qat_dh_pg_cache[i] = NULL;
+    }
+    CRYPTO_THREAD_lock_free(qat_dh_pg_cache_lock);
+    qat_dh_pg_cache_lock = NULL;
+}
+
+static qat_dh_pg_t *qat_dh_pg_new(const BIGNUM *p, const BIGNUM *g)
+{
+    qat_dh_pg_t *pg = NULL;
+
+    if ((pg = OPENSSL_zalloc(sizeof(qat_dh_pg_t))) == NULL) {
+        WARN("Failed to allocate the domain parameters\n");
+        return NULL;
+    }
+    pg->pid = getpid();
+
+    if ((pg->p = BN_dup(p)) == NULL || (pg->g = BN_dup(g)) == NULL ||
+        qat_BN_to_FB(&pg->P, p) != 1 || qat_BN_to_FB(&pg->G, g) != 1) {
+        WARN("Failed to convert the domain parameters\n");
+        qat_dh_pg_free(pg);
+        return NULL;
+    }
+    return pg;
+}
+
+# define QAT_DH_PG_MATCH(pg, p, g)                                  \
+    (BN_cmp((pg)->p, (p)) == 0 && BN_cmp((pg)->g, (g)) == 0)
+
+/******************************************************************************
+* function:
+*         qat_dh_get_cached_pg(const BIGNUM *p, const BIGNUM *g)
+*
+* @param p  [IN] - Prime
+* @param g  [IN] - Generator
+*
+* description:
+*   Returns the pinned prime and generator of the domain parameters with
+*   the values of p and g, converting them on first use. The result is
+*   valid until the DH methods are freed and must not be freed by the
+*   caller. Returns NULL, without raising an error, when the cache is full,
+*   in which case the caller converts its own copy.
+******************************************************************************/
+static const qat_dh_pg_t *qat_dh_get_cached_pg(const BIGNUM *p,
+                                               const BIGNUM *g)
+{
+    const qat_dh_pg_t *pg = NULL;
+    pid_t pid = getpid();
+    int i = 0, slot = -1;
+
+    if (p == NULL || g == NULL || qat_dh_pg_cache_lock == NULL)
+        return NULL;
+
+    if (!CRYPTO_THREAD_read_lock(qat_dh_pg_cache_lock))
+        return NULL;
+    for (i = 0; i < QAT_DH_PG_CACHE_SIZE && qat_dh_pg_cache[i] != NULL; i++) {
+        if (qat_dh_pg_cache[i]->pid == pid &&
+            QAT_DH_PG_MATCH(qat_dh_pg_cache[i], p, g)) {
+            pg = qat_dh_pg_cache[i];
+            break;
+        }
+    }
+    CRYPTO_THREAD_unlock(qat_dh_pg_cache_lock);
+
+    if (pg != NULL)
+        return pg;
+
+    if (!CRYPTO_THREAD_write_lock(qat_dh_pg_cache_lock))
+        return NULL;
+    for (i = 0; i < QAT_DH_PG_CACHE_SIZE; i++) {
+        if (qat_dh_pg_cache[i] == NULL) {
+            if (slot < 0)
+                slot = i;
+            break;
+        }
+        if (qat_dh_pg_cache[i]->pid != pid) {
+            /* Inherited from the parent, never handed out in this process */
+            if (slot < 0)
+                slot = i;
+        } else if (QAT_DH_PG_MATCH(qat_dh_pg_cache[i], p, g)) {
+            pg = qat_dh_pg_cache[i];
+            break;
+        }
+    }
+    if (pg == NULL && slot >= 0) {
+        qat_dh_pg_t *new_pg = qat_dh_pg_new(p, g);
+
+        if (new_pg != NULL) {
+            qat_dh_pg_free(qat_dh_pg_cache[slot]);
+            qat_dh_pg_cache[slot] = new_pg;
+            pg = new_pg;
+        }
+    }
+    CRYPTO_THREAD_unlock(qat_dh_pg_cache_lock);
+
+    return pg;
+}
+
+# undef QAT_DH_PG_MATCH
+
+/*
+ * Pools of pregenerated ephemeral keys are keyed by the domain parameters,
+ * each keeping a DH holding a copy of them for the refill thread.
+ */
+typedef struct {
+    BIGNUM *priv;
+    BIGNUM *pub;
+} qat_dh_key_t;
+
+static void *qat_dh_key_pool_ctx_new(const void *params)
+{
+    const BIGNUM *p = NULL, *q = NULL, *g = NULL;
+    BIGNUM *p2 = NULL, *q2 = NULL, *g2 = NULL;
+    DH *dh = NULL;
+
+    DH_get0_pqg((const DH *)params, &p, &q, &g);
+    if ((dh = DH_new()) == NULL ||
+        (p2 = BN_dup(p)) == NULL ||
+        (g2 = BN_dup(g)) == NULL ||
+        (q != NULL && (q2 = BN_dup(q)) == NULL) ||
+        !DH_set0_pqg(dh, p2, q2, g2)) {
+        BN_free(p2);
+        BN_free(q2);
+        BN_free(g2);
+        DH_free(dh);
+        return NULL;
+    }
+    DH_set_length(dh, DH_get_length((const DH *)params));
+    return dh;
+}
+
+static void qat_dh_key_pool_ctx_free(void *ctx)
+{
+    DH_free((DH *)ctx);
+}
+
+static int qat_dh_key_pool_ctx_match(const void *ctx, const void *params)
+{
+    const BIGNUM *p1 = NULL, *q1 = NULL, *g1 = NULL;
+    const BIGNUM *p2 = NULL, *q2 = NULL, *g2 = NULL;
+
+    DH_get0_pqg((const DH *)ctx, &p1, &q1, &g1);
+    DH_get0_pqg((const DH *)params, &p2, &q2, &g2);
+    return BN_cmp(p1, p2) == 0 && BN_cmp(g1, g2) == 0 &&
+           (q1 == NULL ? q2 == NULL : q2 != NULL && BN_cmp(q1, q2) == 0) &&
+           DH_get_length((const DH *)ctx) == DH_get_length((const DH *)params);
+}
+
+static void qat_dh_key_free(void *item)
+{
+    qat_dh_key_t *key = (qat_dh_key_t *)item;
+
+    if (key == NULL)
+        return;
+    BN_clear_free(key->priv);
+    BN_free(key->pub);
+    OPENSSL_free(key);
+}
+
+/******************************************************************************
+* function:
+*         qat_dh_key_new(void *ctx_dh)
+*
+* @param ctx_dh [IN] - DH holding the domain parameters of the pool
+*
+* description:
+*   Generates an ephemeral key pair the way qat_dh_generate_key() does, the
+*   public key being computed with a modular exponentiation on the
+*   accelerator. Run by the pool refill thread.
+******************************************************************************/
+static void *qat_dh_key_new(void *ctx_dh)
+{
+    const DH *dh = (const DH *)ctx_dh;
+    const BIGNUM *p = NULL, *q = NULL, *g = NULL;
+    qat_dh_key_t *key = NULL;
+    unsigned length = 0;
+    int fallback = 0, ok = 0;
+
+    DH_get0_pqg(dh, &p, &q, &g);
+
+    if ((key = OPENSSL_zalloc(sizeof(qat_dh_key_t))) == NULL ||
+        (key->priv = BN_new()) == NULL ||
+        (key->pub = BN_new()) == NULL) {
+        WARN("Failed to allocate the key\n");
+        goto err;
+    }
+
+    if (q) {
+        do {
+            if (!BN_rand_range(key->priv, q)) {
+                WARN("Failed to generate random number for range %d\n", BN_num_bits(q));
+                goto err;
+            }
+        }
+        while (BN_is_zero(key->priv) || BN_is_one(key->priv));
+    } else {
+        /* secret exponent length */
+        length = DH_get_length(dh) ? DH_get_length(dh) : BN_num_bits(p) - 1;
+        if (!BN_rand(key->priv, length, 0, 0)) {
+            WARN("Failed to generate random number of length %d\n", length);
+            goto err;
+        }
+    }
+
+    if (!qat_mod_exp(key->pub, g, key->priv, p, &fallback) || fallback) {
+        WARN("Failed to compute the public key\n");
+        goto err;
+    }
+    ok = 1;
+
+err:
+    if (!ok) {
+        /* The pool retries on a later draw, leave no error behind */
+        ERR_clear_error();
+        qat_dh_key_free(key);
+        key = NULL;
+    }
+    return key;
+}
+
+static const qat_asym_pool_ops_t qat_dh_key_pool_ops = {
+    qat_dh_key_pool_ctx_new, qat_dh_key_pool_ctx_free,
+    qat_dh_key_pool_ctx_match, qat_dh_key_new, qat_dh_key_free
+};
+
+static int qat_dh_key_pool_size(int bits)
+{
+    int i = 0;
+
+    for (i = 0; i < QAT_DH_KEY_POOL_MAX_SIZES &&
+                qat_dh_key_pool_sizes[i].bits != 0; i++) {
+        if (qat_dh_key_pool_sizes[i].bits == bits)
+            return qat_dh_key_pool_sizes[i].size;
+    }
+    return 0;
+}
+
 /******************************************************************************
 * function:
 *         qat_dh_generate_key(DH * dh)
@@ -188,6 +513,7 @@ int qat_dh_generate_key(DH *dh)
     const BIGNUM *temp_pub_key = NULL, *temp_priv_key = NULL;
     int inst_num = QAT_INVALID_INSTANCE;
     CpaCyDhPhase1KeyGenOpData *opData = NULL;
+    const qat_dh_pg_t *pg = NULL;
     CpaFlatBuffer *pPV = NULL;
     int qatPerformOpRetries = 0;
     useconds_t ulPollInterval = getQatPollInterval();
@@ -197,6 +523,8 @@ int qat_dh_generate_key(DH *dh)
     size_t buflen;
     const DH_METHOD *sw_dh_method = DH_OpenSSL();
     thread_local_variables_t *tlv = NULL;
+    qat_asym_sample_t sample;
+    qat_dh_key_t *key = NULL;
 
     DEBUG("- Started\n");
 
@@ -234,6 +562,25 @@ int qat_dh_generate_key(DH *dh)
 
     DH_get0_key(dh, &temp_pub_key, &temp_priv_key);
 
+    /* A new ephemeral key can be taken from the pool of the parameters */
+    if (temp_priv_key == NULL &&
+        (key = qat_asym_pool_get(&qat_dh_key_pool_ops, dh,
+                                 qat_dh_key_pool_size(BN_num_bits(p)),
+                                 -1)) != NULL) {
+        if (DH_set0_key(dh, key->pub, key->priv)) {
+            OPENSSL_free(key);
+            return 1;
+        }
+        qat_dh_key_free(key);
+    }
+
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_DH, BN_num_bits(p))) {
+        ok = DH_meth_get_generate_key(sw_dh_method)(dh);
+        if (ok)
+            qat_asym_dispatch_end(&sample);
+        return ok;
+    }
+
     opData = (CpaCyDhPhase1KeyGenOpData *)
         OPENSSL_malloc(sizeof(CpaCyDhPhase1KeyGenOpData));
     if (opData == NULL) {
@@ -314,8 +661,14 @@ int qat_dh_generate_key(DH *dh)
     }
     pPV->dataLenInBytes = (Cpa32U) buflen;
 
-    if ((qat_BN_to_FB(&(opData->primeP), (BIGNUM *)p) != 1) ||
-        (qat_BN_to_FB(&(opData->baseG), (BIGNUM *)g) != 1) ||
+    if ((pg = qat_dh_get_cached_pg(p, g)) != NULL) {
+        opData->primeP = pg->P;
+        opData->baseG = pg->G;
+    }
+
+    if ((pg == NULL &&
+         ((qat_BN_to_FB(&(opData->primeP), (BIGNUM *)p) != 1) ||
+          (qat_BN_to_FB(&(opData->baseG), (BIGNUM *)g) != 1))) ||
         (qat_BN_to_FB(&(opData->privateValueX), (BIGNUM *)priv_key) != 1)) {
         WARN("Failed to convert p, g or priv_key to a flat buffer\n");
         QATerr(QAT_F_QAT_DH_GENERATE_KEY, QAT_R_P_G_PRIV_KEY_CONVERT_TO_FB_FAILURE);
@@ -486,10 +839,13 @@ err:
     }
 
     if (opData) {
-        if (opData->primeP.pData)
-            qaeCryptoMemFree(opData->primeP.pData);
-        if (opData->baseG.pData)
-            qaeCryptoMemFree(opData->baseG.pData);
+        /* Cached parameters are owned by the cache */
+        if (pg == NULL) {
+            if (opData->primeP.pData)
+                qaeCryptoMemFree(opData->primeP.pData);
+            if (opData->baseG.pData)
+                qaeCryptoMemFree(opData->baseG.pData);
+        }
         QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData->privateValueX);
         OPENSSL_free(opData);
     }
@@ -507,6 +863,8 @@ err:
         return DH_meth_get_generate_key(sw_dh_method)(dh);
     }
 
+    if (ok)
+        qat_asym_dispatch_end(&sample);
     return ok;
 }
 
@@ -524,6 +882,7 @@ int qat_dh_compute_key(unsigned char *key, const BIGNUM *in_pub_key, DH *dh)
     int check_result;
     int inst_num = QAT_INVALID_INSTANCE;
     CpaCyDhPhase2SecretKeyGenOpData *opData = NULL;
+    const qat_dh_pg_t *pg = NULL;
     CpaFlatBuffer *pSecretKey = NULL;
     int qatPerformOpRetries = 0;
     useconds_t ulPollInterval = getQatPollInterval();
@@ -537,6 +896,7 @@ int qat_dh_compute_key(unsigned char *key, const BIGNUM *in_pub_key, DH *dh)
     const BIGNUM *pub_key = NULL, *priv_key = NULL;
     const DH_METHOD *sw_dh_method = DH_OpenSSL();
     thread_local_variables_t *tlv = NULL;
+    qat_asym_sample_t sample;
 
     DEBUG("- Started\n");
 
@@ -580,6 +940,13 @@ int qat_dh_compute_key(unsigned char *key, const BIGNUM *in_pub_key, DH *dh)
         return DH_meth_get_compute_key(sw_dh_method)(key, in_pub_key, dh);
     }
 
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_DH, BN_num_bits(p))) {
+        ret = DH_meth_get_compute_key(sw_dh_method)(key, in_pub_key, dh);
+        if (ret > 0)
+            qat_asym_dispatch_end(&sample);
+        return ret;
+    }
+
     if (!DH_check_pub_key(dh, in_pub_key, &check_result) || check_result) {
         WARN("Failure checking pub key\n");
         QATerr(QAT_F_QAT_DH_COMPUTE_KEY, QAT_R_INVALID_PUB_KEY);
@@ -615,7 +982,10 @@ int qat_dh_compute_key(unsigned char *key, const BIGNUM *in_pub_key, DH *dh)
     }
     pSecretKey->dataLenInBytes = (Cpa32U) buflen;
 
-    if ((qat_BN_to_FB(&(opData->primeP), (BIGNUM *)p) != 1) ||
+    if ((pg = qat_dh_get_cached_pg(p, g)) != NULL)
+        opData->primeP = pg->P;
+
+    if ((pg == NULL && qat_BN_to_FB(&(opData->primeP), (BIGNUM *)p) != 1) ||
             (qat_BN_to_FB(&(opData->remoteOctetStringPV), (BIGNUM *)in_pub_key) != 1)
             || (qat_BN_to_FB(&(opData->privateValueX), (BIGNUM *)priv_key) !=
                 1)) {
@@ -788,7 +1158,8 @@ int qat_dh_compute_key(unsigned char *key, const BIGNUM *in_pub_key, DH *dh)
     }
 
     if (opData) {
-        if (opData->primeP.pData)
+        /* A cached prime is owned by the cache */
+        if (pg == NULL && opData->primeP.pData)
             qaeCryptoMemFree(opData->primeP.pData);
         if (opData->remoteOctetStringPV.pData)
             qaeCryptoMemFree(opData->remoteOctetStringPV.pData);
@@ -802,6 +1173,8 @@ int qat_dh_compute_key(unsigned char *key, const BIGNUM *in_pub_key, DH *dh)
         return DH_meth_get_compute_key(sw_dh_method)(key, in_pub_key, dh);
     }
 
+    if (ret > 0)
+        qat_asym_dispatch_end(&sample);
     return ret;
 }
 
@@ -849,6 +1222,85 @@ int qat_dh_mod_exp(const DH *dh, BIGNUM *r, const BIGNUM *a,
 
 }
 
+/******************************************************************************
+* function:
+*         qat_dh_generate_params(DH *dh, int prime_len, int generator,
+*                                BN_GENCB *cb)
+*
+* @param dh        [OUT] - Pointer to a OpenSSL DH struct.
+* @param prime_len [IN]  - size of the prime in bits
+* @param generator [IN]  - generator, usually DH_GENERATOR_2 or 5
+* @param cb        [IN]  - callback reporting the progress
+*
+* description:
+*   Generates DH parameters as DH_generate_parameters_ex does on core: a
+*   safe prime with the congruence that makes generator a generator of the
+*   subgroup of the quadratic residues. The safe prime comes from
+*   qat_generate_prime which tests the candidates, and their halves, by
+*   batches on the accelerator.
+*
+******************************************************************************/
+int qat_dh_generate_params(DH *dh, int prime_len, int generator,
+                           BN_GENCB *cb)
+{
+    BIGNUM *p = NULL, *g = NULL, *add = NULL, *rem = NULL;
+    BN_ULONG add_word = 12, rem_word = 11;
+    int ok = 0;
+
+    DEBUG("- Started\n");
+
+    if (unlikely(dh == NULL || generator <= 1 ||
+                 prime_len > OPENSSL_DH_MAX_MODULUS_BITS)) {
+        WARN("Invalid input params.\n");
+        QATerr(QAT_F_QAT_DH_GENERATE_PARAMS, QAT_R_INPUT_PARAM_INVALID);
+        return 0;
+    }
+
+    p = BN_new();
+    g = BN_new();
+    add = BN_new();
+    rem = BN_new();
+    if (p == NULL || g == NULL || add == NULL || rem == NULL) {
+        WARN("Failure to allocate p or g\n");
+        QATerr(QAT_F_QAT_DH_GENERATE_PARAMS, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    /* the same congruences as OpenSSL for the usual generators */
+    if (generator == DH_GENERATOR_2) {
+        add_word = 24;
+        rem_word = 23;
+    } else if (generator == DH_GENERATOR_5) {
+        add_word = 60;
+        rem_word = 59;
+    }
+    if (!BN_set_word(add, add_word) || !BN_set_word(rem, rem_word) ||
+        !BN_set_word(g, generator)) {
+        QATerr(QAT_F_QAT_DH_GENERATE_PARAMS, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    if (!qat_generate_prime(p, prime_len, 1, add, rem, cb) ||
+        !BN_GENCB_call(cb, 3, 0))
+        goto err;
+
+    if (!DH_set0_pqg(dh, p, NULL, g)) {
+        WARN("Failure to set p and g\n");
+        QATerr(QAT_F_QAT_DH_GENERATE_PARAMS, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    p = g = NULL;
+    ok = 1;
+
+ err:
+    BN_free(p);
+    BN_free(g);
+    BN_free(add);
+    BN_free(rem);
+    DEBUG("- Finished\n");
+    return ok;
+}
+
 /******************************************************************************
 * function:
 *         qat_dh_init(DH * dh)
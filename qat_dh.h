@@ -54,4 +54,6 @@ DH_METHOD *qat_get_DH_methods(void);
 
 void qat_free_DH_methods(void);
 
+int qat_dh_key_pool_set_size(int bits, long size);
+
 #endif                          /* QAT_DH_H */
@@ -97,6 +97,50 @@ static int qat_dsa_finish(DSA *dsa);
 /* Qat DSA method structure declaration. */
 static DSA_METHOD *qat_dsa_method = NULL;
 
+#ifndef OPENSSL_DISABLE_QAT_DSA
+/*
+ * Domain parameters in the pinned flat buffer form expected by the QAT API,
+ * with copies of the parameters they were converted from.
+ */
+typedef struct {
+    pid_t pid;
+    BIGNUM *p;
+    BIGNUM *q;
+    BIGNUM *g;
+    CpaFlatBuffer P;
+    CpaFlatBuffer Q;
+    CpaFlatBuffer G;
+} qat_dsa_pqg_t;
+
+/*
+ * Process wide cache of the domain parameters, keyed by value as the same
+ * parameters are usually shared by many keys. Entries are added on first
+ * use and only read afterwards, so they stay valid until the DSA methods
+ * are freed. The pid records the owning process as pinned memory is not
+ * inherited across fork.
+ */
+# define QAT_DSA_PQG_CACHE_SIZE 16
+static qat_dsa_pqg_t *qat_dsa_pqg_cache[QAT_DSA_PQG_CACHE_SIZE];
+
+/*
+ * The public key is specific to the key, it is cached on the DSA object as
+ * ex_data on its first verification and freed in qat_dsa_finish. A copy of
+ * y records the value it was converted from.
+ */
+typedef struct {
+    pid_t pid;
+    BIGNUM *y;
+    CpaFlatBuffer Y;
+} qat_dsa_pub_key_t;
+
+static int qat_dsa_pub_key_idx = -1;
+
+/* Guards the parameter cache and the setting of the public key ex_data */
+static CRYPTO_RWLOCK *qat_dsa_cache_lock = NULL;
+
+static void qat_dsa_pqg_cache_free(void);
+#endif
+
 DSA_METHOD *qat_get_DSA_methods(void)
 {
 #ifndef OPENSSL_DISABLE_QAT_DSA
@@ -107,6 +151,16 @@ DSA_METHOD *qat_get_DSA_methods(void)
         return qat_dsa_method;
 
 #ifndef OPENSSL_DISABLE_QAT_DSA
+    /* The index is kept for the life of the process, failure disables caching */
+    if (qat_dsa_pub_key_idx == -1)
+        qat_dsa_pub_key_idx = DSA_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+
+    /* Not fatal, the parameters are then converted on every operation */
+    if (qat_dsa_cache_lock == NULL &&
+        (qat_dsa_cache_lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        WARN("Failed to allocate the DSA cache lock\n");
+    }
+
     if ((qat_dsa_method = DSA_meth_new("QAT DSA method", 0)) == NULL) {
         WARN("Failed to allocate DSA methods\n");
         QATerr(QAT_F_QAT_GET_DSA_METHODS, QAT_R_ALLOC_QAT_DSA_METH_FAILURE);
@@ -135,6 +189,7 @@ DSA_METHOD *qat_get_DSA_methods(void)
 void qat_free_DSA_methods(void)
 {
 #ifndef OPENSSL_DISABLE_QAT_DSA
+    qat_dsa_pqg_cache_free();
     if (qat_dsa_method != NULL) {
         DSA_meth_free(qat_dsa_method);
         qat_dsa_method = NULL;
@@ -200,6 +255,237 @@ static void qat_dsaVerifyCallbackFn(void *pCallbackTag, CpaStatus status,
                           NULL, bDsaVerifyStatus);
 }
 
+/******************************************************************************
+* function:
+*         qat_dsa_pqg_free(qat_dsa_pqg_t *pqg)
+*
+* @param pqg [IN] - Domain parameters to free
+*
+* description:
+*   Frees the domain parameters, including their pinned flat buffers when
+*   they were allocated by this process.
+******************************************************************************/
+static void qat_dsa_pqg_free(qat_dsa_pqg_t *pqg)
+{
+    if (pqg == NULL)
+        return;
+
+    /* Pinned memory inherited across a fork is not valid in the child */
+    if (pqg->pid == getpid()) {
+        QAT_CHK_QMFREE_FLATBUFF(pqg->P);
+        QAT_CHK_QMFREE_FLATBUFF(pqg->Q);
+        QAT_CHK_QMFREE_FLATBUFF(pqg->G);
+    }
+    BN_free(pqg->p);
+    BN_free(pqg->q);
+    BN_free(pqg->g);
+    OPENSSL_free(pqg);
+}
+
+static void qat_dsa_pqg_cache_free(void)
+{
+    int i = 0;
+
+    for (i = 0; i < QAT_DSA_PQG_CACHE_SIZE; i++) {
+        qat_dsa_pqg_free(qat_dsa_pqg_cache[i]);
+        qat_dsa_pqg_cache[i] = NULL;
+    }
+    CRYPTO_THREAD_lock_free(qat_dsa_cache_lock);
+    qat_dsa_cache_lock = NULL;
+}
+
+/******************************************************************************
+* function:
+*         qat_dsa_pqg_new(const BIGNUM *p, const BIGNUM *q, const BIGNUM *g)
+*
+* @param p [IN] - Prime modulus
+* @param q [IN] - Subgroup order
+* @param g [IN] - Generator
+*
+* description:
+*   Builds a qat_dsa_pqg_t holding copies of p, q and g and their pinned
+*   flat buffer form. Returns NULL on failure.
+******************************************************************************/
+static qat_dsa_pqg_t *qat_dsa_pqg_new(const BIGNUM *p, const BIGNUM *q,
+                                      const BIGNUM *g)
+{
+    qat_dsa_pqg_t *pqg = NULL;
+
+    if ((pqg = OPENSSL_zalloc(sizeof(qat_dsa_pqg_t))) == NULL) {
+        WARN("Failed to allocate the domain parameters\n");
+        return NULL;
+    }
+    pqg->pid = getpid();
+
+    if ((pqg->p = BN_dup(p)) == NULL || (pqg->q = BN_dup(q)) == NULL ||
+        (pqg->g = BN_dup(g)) == NULL ||
+        qat_BN_to_FB(&pqg->P, p) != 1 ||
+        qat_BN_to_FB(&pqg->Q, q) != 1 ||
+        qat_BN_to_FB(&pqg->G, g) != 1) {
+        WARN("Failed to convert the domain parameters\n");
+        qat_dsa_pqg_free(pqg);
+        return NULL;
+    }
+    return pqg;
+}
+
+# define QAT_DSA_PQG_MATCH(pqg, p, q, g)                            \
+    (BN_cmp((pqg)->p, (p)) == 0 && BN_cmp((pqg)->q, (q)) == 0 &&    \
+     BN_cmp((pqg)->g, (g)) == 0)
+
+/******************************************************************************
+* function:
+*         qat_dsa_get_cached_pqg(const BIGNUM *p, const BIGNUM *q,
+*                                const BIGNUM *g)
+*
+* @param p   [IN] - Prime modulus
+* @param q   [IN] - Subgroup order
+* @param g   [IN] - Generator
+*
+* description:
+*   Returns the pinned domain parameters with the values of p, q and g,
+*   converting them on first use. The result is valid until the DSA methods
+*   are freed and must not be freed by the caller. Returns NULL, without
+*   raising an error, when the cache is full, in which case the caller
+*   converts its own copy.
+******************************************************************************/
+static const qat_dsa_pqg_t *qat_dsa_get_cached_pqg(const BIGNUM *p,
+                                                   const BIGNUM *q,
+                                                   const BIGNUM *g)
+{
+    const qat_dsa_pqg_t *pqg = NULL;
+    pid_t pid = getpid();
+    int i = 0, slot = -1;
+
+    if (qat_dsa_cache_lock == NULL)
+        return NULL;
+
+    if (!CRYPTO_THREAD_read_lock(qat_dsa_cache_lock))
+        return NULL;
+    for (i = 0; i < QAT_DSA_PQG_CACHE_SIZE && qat_dsa_pqg_cache[i] != NULL; i++) {
+        if (qat_dsa_pqg_cache[i]->pid == pid &&
+            QAT_DSA_PQG_MATCH(qat_dsa_pqg_cache[i], p, q, g)) {
+            pqg = qat_dsa_pqg_cache[i];
+            break;
+        }
+    }
+    CRYPTO_THREAD_unlock(qat_dsa_cache_lock);
+
+    if (pqg != NULL)
+        return pqg;
+
+    if (!CRYPTO_THREAD_write_lock(qat_dsa_cache_lock))
+        return NULL;
+    for (i = 0; i < QAT_DSA_PQG_CACHE_SIZE; i++) {
+        if (qat_dsa_pqg_cache[i] == NULL) {
+            if (slot < 0)
+                slot = i;
+            break;
+        }
+        if (qat_dsa_pqg_cache[i]->pid != pid) {
+            /* Inherited from the parent, never handed out in this process */
+            if (slot < 0)
+                slot = i;
+        } else if (QAT_DSA_PQG_MATCH(qat_dsa_pqg_cache[i], p, q, g)) {
+            pqg = qat_dsa_pqg_cache[i];
+            break;
+        }
+    }
+    if (pqg == NULL && slot >= 0) {
+        qat_dsa_pqg_t *new_pqg = qat_dsa_pqg_new(p, q, g);
+
+        if (new_pqg != NULL) {
+            qat_dsa_pqg_free(qat_dsa_pqg_cache[slot]);
+            qat_dsa_pqg_cache[slot] = new_pqg;
+            pqg = new_pqg;
+        }
+    }
+    CRYPTO_THREAD_unlock(qat_dsa_cache_lock);
+
+    return pqg;
+}
+
+# undef QAT_DSA_PQG_MATCH
+
+static void qat_dsa_pub_key_free(qat_dsa_pub_key_t *pub)
+{
+    if (pub == NULL)
+        return;
+
+    if (pub->pid == getpid())
+        QAT_CHK_QMFREE_FLATBUFF(pub->Y);
+    BN_free(pub->y);
+    OPENSSL_free(pub);
+}
+
+/******************************************************************************
+* function:
+*         qat_dsa_get_cached_pub_key(DSA *dsa, const BIGNUM *y)
+*
+* @param dsa [IN] - DSA object owning the cache
+* @param y   [IN] - Public key
+*
+* description:
+*   Returns the pinned public key cached on the DSA object, converting it on
+*   first use. The result is valid until qat_dsa_finish and must not be
+*   freed by the caller. Returns NULL, without raising an error, when no
+*   cached copy can be used, in which case the caller converts its own copy.
+******************************************************************************/
+static const CpaFlatBuffer *qat_dsa_get_cached_pub_key(DSA *dsa,
+                                                       const BIGNUM *y)
+{
+    qat_dsa_pub_key_t *pub = NULL, *new_pub = NULL;
+    const CpaFlatBuffer *key = NULL;
+    pid_t pid = getpid();
+
+    if (qat_dsa_pub_key_idx < 0 || qat_dsa_cache_lock == NULL)
+        return NULL;
+
+# define QAT_DSA_PUB_KEY_CACHE_HIT(pub)                             \
+    ((pub) != NULL && (pub)->pid == pid && BN_cmp((pub)->y, y) == 0)
+
+    if (!CRYPTO_THREAD_read_lock(qat_dsa_cache_lock))
+        return NULL;
+    pub = DSA_get_ex_data(dsa, qat_dsa_pub_key_idx);
+    if (QAT_DSA_PUB_KEY_CACHE_HIT(pub))
+        key = &pub->Y;
+    CRYPTO_THREAD_unlock(qat_dsa_cache_lock);
+
+    if (key != NULL)
+        return key;
+
+    if (!CRYPTO_THREAD_write_lock(qat_dsa_cache_lock))
+        return NULL;
+
+    /*
+     * A public key replaced after first use is served from per op copies as
+     * other threads may still be using the cached buffer. One inherited from
+     * the parent was never handed out in this process and is replaced.
+     */
+    pub = DSA_get_ex_data(dsa, qat_dsa_pub_key_idx);
+    if (pub == NULL || pub->pid != pid) {
+        if ((new_pub = OPENSSL_zalloc(sizeof(qat_dsa_pub_key_t))) != NULL) {
+            new_pub->pid = pid;
+            if ((new_pub->y = BN_dup(y)) != NULL &&
+                qat_BN_to_FB(&new_pub->Y, y) == 1 &&
+                DSA_set_ex_data(dsa, qat_dsa_pub_key_idx, new_pub)) {
+                qat_dsa_pub_key_free(pub);
+                pub = new_pub;
+            } else {
+                qat_dsa_pub_key_free(new_pub);
+            }
+        }
+    }
+
+    if (QAT_DSA_PUB_KEY_CACHE_HIT(pub))
+        key = &pub->Y;
+    CRYPTO_THREAD_unlock(qat_dsa_cache_lock);
+
+# undef QAT_DSA_PUB_KEY_CACHE_HIT
+
+    return key;
+}
+
 /******************************************************************************
 * function:
 *         qat_dsa_bn_mod_exp(DSA *dsa, BIGNUM *r, const BIGNUM *a,
@@ -263,6 +549,7 @@ DSA_SIG *qat_dsa_do_sign(const unsigned char *dgst, int dlen,
     CpaFlatBuffer *pResultS = NULL;
     int inst_num = QAT_INVALID_INSTANCE;
     CpaCyDsaRSSignOpData *opData = NULL;
+    const qat_dsa_pqg_t *pqg = NULL;
     CpaBoolean bDsaSignStatus;
     CpaStatus status;
     size_t buflen;
@@ -273,6 +560,7 @@ DSA_SIG *qat_dsa_do_sign(const unsigned char *dgst, int dlen,
     const DSA_METHOD *default_dsa_method = DSA_OpenSSL();
     int i = 0, job_ret = 0, fallback = 0;
     thread_local_variables_t *tlv = NULL;
+    qat_asym_sample_t sample;
 
     DEBUG("- Started\n");
 
@@ -318,6 +606,13 @@ DSA_SIG *qat_dsa_do_sign(const unsigned char *dgst, int dlen,
         return DSA_meth_get_sign(default_dsa_method)(dgst, dlen, dsa);
     }
 
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_DSA_SIGN, BN_num_bits(p))) {
+        sig = DSA_meth_get_sign(default_dsa_method)(dgst, dlen, dsa);
+        if (sig != NULL)
+            qat_asym_dispatch_end(&sample);
+        return sig;
+    }
+
     opData = (CpaCyDsaRSSignOpData *)
         OPENSSL_malloc(sizeof(CpaCyDsaRSSignOpData));
     if (opData == NULL) {
@@ -395,9 +690,16 @@ DSA_SIG *qat_dsa_do_sign(const unsigned char *dgst, int dlen,
         goto err;
     }
 
-    if ((qat_BN_to_FB(&(opData->P), p) != 1) ||
-        (qat_BN_to_FB(&(opData->Q), q) != 1) ||
-        (qat_BN_to_FB(&(opData->G), g) != 1) ||
+    if ((pqg = qat_dsa_get_cached_pqg(p, q, g)) != NULL) {
+        opData->P = pqg->P;
+        opData->Q = pqg->Q;
+        opData->G = pqg->G;
+    }
+
+    if ((pqg == NULL &&
+         ((qat_BN_to_FB(&(opData->P), p) != 1) ||
+          (qat_BN_to_FB(&(opData->Q), q) != 1) ||
+          (qat_BN_to_FB(&(opData->G), g) != 1))) ||
         (qat_BN_to_FB(&(opData->X), priv_key) != 1) ||
         (qat_BN_to_FB(&(opData->K), k) != 1)) {
         WARN("Failed to convert p, q, g, priv_key or k to a flat buffer\n");
@@ -606,9 +908,12 @@ DSA_SIG *qat_dsa_do_sign(const unsigned char *dgst, int dlen,
     }
 
     if (opData) {
-        QAT_CHK_QMFREE_FLATBUFF(opData->P);
-        QAT_CHK_QMFREE_FLATBUFF(opData->Q);
-        QAT_CHK_QMFREE_FLATBUFF(opData->G);
+        /* Cached parameters are owned by the cache */
+        if (pqg == NULL) {
+            QAT_CHK_QMFREE_FLATBUFF(opData->P);
+            QAT_CHK_QMFREE_FLATBUFF(opData->Q);
+            QAT_CHK_QMFREE_FLATBUFF(opData->G);
+        }
         QAT_CHK_QMFREE_FLATBUFF(opData->Z);
         QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData->X);
         QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData->K);
@@ -628,6 +933,8 @@ DSA_SIG *qat_dsa_do_sign(const unsigned char *dgst, int dlen,
         return DSA_meth_get_sign(default_dsa_method)(dgst, dlen, dsa);
     }
 
+    if (sig != NULL)
+        qat_asym_dispatch_end(&sample);
     return sig;
 }
 
@@ -674,6 +981,8 @@ int qat_dsa_do_verify(const unsigned char *dgst, int dgst_len,
     int ret = -1, i = 0, job_ret = 0, fallback = 0;
     int inst_num = QAT_INVALID_INSTANCE;
     CpaCyDsaVerifyOpData *opData = NULL;
+    const qat_dsa_pqg_t *pqg = NULL;
+    const CpaFlatBuffer *pub_fb = NULL;
     CpaBoolean bDsaVerifyStatus;
     CpaStatus status;
     op_done_t op_done;
@@ -682,6 +991,7 @@ int qat_dsa_do_verify(const unsigned char *dgst, int dgst_len,
     int iMsgRetry = getQatMsgRetryCount();
     const DSA_METHOD *default_dsa_method = DSA_OpenSSL();
     thread_local_variables_t *tlv = NULL;
+    qat_asym_sample_t sample;
 
     DEBUG("- Started\n");
 
@@ -728,6 +1038,13 @@ int qat_dsa_do_verify(const unsigned char *dgst, int dgst_len,
         return DSA_meth_get_verify(default_dsa_method)(dgst, dgst_len, sig, dsa);
     }
 
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_DSA_VERIFY, BN_num_bits(p))) {
+        ret = DSA_meth_get_verify(default_dsa_method)(dgst, dgst_len, sig, dsa);
+        if (ret >= 0)
+            qat_asym_dispatch_end(&sample);
+        return ret;
+    }
+
     opData = (CpaCyDsaVerifyOpData *)
         OPENSSL_malloc(sizeof(CpaCyDsaVerifyOpData));
     if (opData == NULL) {
@@ -794,10 +1111,19 @@ int qat_dsa_do_verify(const unsigned char *dgst, int dgst_len,
         goto err;
     }
 
-    if ((qat_BN_to_FB(&(opData->P), p) != 1) ||
-        (qat_BN_to_FB(&(opData->Q), q) != 1) ||
-        (qat_BN_to_FB(&(opData->G), g) != 1) ||
-        (qat_BN_to_FB(&(opData->Y), pub_key) != 1) ||
+    if ((pqg = qat_dsa_get_cached_pqg(p, q, g)) != NULL) {
+        opData->P = pqg->P;
+        opData->Q = pqg->Q;
+        opData->G = pqg->G;
+    }
+    if ((pub_fb = qat_dsa_get_cached_pub_key(dsa, pub_key)) != NULL)
+        opData->Y = *pub_fb;
+
+    if ((pqg == NULL &&
+         ((qat_BN_to_FB(&(opData->P), p) != 1) ||
+          (qat_BN_to_FB(&(opData->Q), q) != 1) ||
+          (qat_BN_to_FB(&(opData->G), g) != 1))) ||
+        (pub_fb == NULL && qat_BN_to_FB(&(opData->Y), pub_key) != 1) ||
         (qat_BN_to_FB(&(opData->Z), z) != 1) ||
         (qat_BN_to_FB(&(opData->R), r) != 1) ||
         (qat_BN_to_FB(&(opData->S), s) != 1)) {
@@ -949,10 +1275,14 @@ int qat_dsa_do_verify(const unsigned char *dgst, int dgst_len,
 
  err:
     if (opData) {
-        QAT_CHK_QMFREE_FLATBUFF(opData->P);
-        QAT_CHK_QMFREE_FLATBUFF(opData->Q);
-        QAT_CHK_QMFREE_FLATBUFF(opData->G);
-        QAT_CHK_QMFREE_FLATBUFF(opData->Y);
+        /* Cached parameters and public key are owned by the caches */
+        if (pqg == NULL) {
+            QAT_CHK_QMFREE_FLATBUFF(opData->P);
+            QAT_CHK_QMFREE_FLATBUFF(opData->Q);
+            QAT_CHK_QMFREE_FLATBUFF(opData->G);
+        }
+        if (pub_fb == NULL)
+            QAT_CHK_QMFREE_FLATBUFF(opData->Y);
         QAT_CHK_QMFREE_FLATBUFF(opData->Z);
         QAT_CHK_QMFREE_FLATBUFF(opData->R);
         QAT_CHK_QMFREE_FLATBUFF(opData->S);
@@ -969,6 +1299,9 @@ int qat_dsa_do_verify(const unsigned char *dgst, int dgst_len,
         CRYPTO_QAT_LOG("Resubmitting request to SW - %s\n", __func__);
         return DSA_meth_get_verify(default_dsa_method)(dgst, dgst_len, sig, dsa);
     }
+
+    if (ret >= 0)
+        qat_asym_dispatch_end(&sample);
     return ret;
 }
 
@@ -996,11 +1329,17 @@ int qat_dsa_init(DSA *dsa)
 *
 * description:
 *   Override DSA Finish function.
-*   Call SW Implementation to ensure cleanup of cached data.
+*   Frees the pinned public key cached on the DSA object and calls
+*   SW Implementation to ensure cleanup of cached data.
 *
 ******************************************************************************/
 int qat_dsa_finish(DSA *dsa)
 {
+    if (qat_dsa_pub_key_idx >= 0) {
+        qat_dsa_pub_key_free(DSA_get_ex_data(dsa, qat_dsa_pub_key_idx));
+        DSA_set_ex_data(dsa, qat_dsa_pub_key_idx, NULL);
+    }
+
     return DSA_meth_get_finish(DSA_OpenSSL())(dsa);
 }
 
@@ -59,6 +59,7 @@
 #include <openssl/obj_mac.h>
 #include <openssl/bn.h>
 #include <openssl/rand.h>
+#include <openssl/evp.h>
 
 #include "cpa.h"
 #include "cpa_types.h"
@@ -69,6 +70,7 @@
 #include "qat_polling.h"
 #include "qat_events.h"
 #include "qat_asym_common.h"
+#include "icp_sal_poll.h"
 #ifdef USE_QAT_CONTIG_MEM
 # include "qae_mem_utils.h"
 #endif
@@ -122,6 +124,11 @@ static int qat_engine_ecdh_compute_key(unsigned char **out, size_t *outlen,
 static int qat_ecdh_generate_key(EC_KEY *ecdh);
 #endif
 
+#if defined(QAT_ECX_ENABLED) && \
+    (!defined(OPENSSL_DISABLE_QAT_ECDH) || !defined(OPENSSL_DISABLE_QAT_ECDSA))
+static void qat_ecx_pmeths_free(void);
+#endif
+
 typedef int (*PFUNC_COMP_KEY)(unsigned char **,
                               size_t *,
                               const EC_POINT *,
@@ -163,11 +170,72 @@ typedef int (*PFUNC_VERIFY_SIG)(const unsigned char *,
 
 static EC_KEY_METHOD *qat_ec_method = NULL;
 
+#if !defined (OPENSSL_DISABLE_QAT_ECDSA) || !defined (OPENSSL_DISABLE_QAT_ECDH)
+/*
+ * Pinned constants of a named curve. The entries are shared by all the
+ * threads and are immutable once published in the cache, which only grows
+ * until the EC methods are freed.
+ */
+typedef struct {
+    int nid;
+    pid_t pid;
+    CpaCyEcFieldType fieldType;
+    CpaFlatBuffer p;
+    CpaFlatBuffer a;
+    CpaFlatBuffer b;
+    CpaFlatBuffer xg;
+    CpaFlatBuffer yg;
+    CpaFlatBuffer order;
+} qat_ec_curve_t;
+
+# define QAT_EC_CURVE_CACHE_SIZE 16
+static qat_ec_curve_t *qat_ec_curve_cache[QAT_EC_CURVE_CACHE_SIZE];
+static CRYPTO_RWLOCK *qat_ec_curve_cache_lock = NULL;
+
+static void qat_ec_curve_cache_free(void);
+#endif
+
+/* Configured size and refill threshold of each type of precompute pool */
+static int qat_ec_pool_size[QAT_EC_POOL_NUM_TYPES];
+static int qat_ec_pool_refill[QAT_EC_POOL_NUM_TYPES] = { -1, -1 };
+
+#ifndef OPENSSL_DISABLE_QAT_ECDH
+static void *qat_ec_pool_get(qat_ec_pool_type_t type, const EC_GROUP *group);
+
+/* A pregenerated ephemeral ECDH key pair */
+typedef struct {
+    BIGNUM *priv;
+    EC_POINT *pub;
+} qat_ecdh_key_t;
+
+static void *qat_ecdh_key_new(void *ctx_eckey);
+static void qat_ecdh_key_free(void *item);
+#endif
+
+#if !defined (OPENSSL_DISABLE_QAT_ECDSA) && !defined (OPENSSL_DISABLE_QAT_ECDH)
+/* A precomputed ECDSA nonce, ready for the in_kinv/in_r sign path */
+typedef struct {
+    BIGNUM *kinv;
+    BIGNUM *r;
+} qat_ecdsa_nonce_t;
+
+static void *qat_ecdsa_nonce_new(void *ctx_eckey);
+static void qat_ecdsa_nonce_free(void *item);
+#endif
+
 EC_KEY_METHOD *qat_get_EC_methods(void)
 {
     if (qat_ec_method != NULL)
         return qat_ec_method;
 
+#if !defined (OPENSSL_DISABLE_QAT_ECDSA) || !defined (OPENSSL_DISABLE_QAT_ECDH)
+    /* Not fatal, the curve constants are then converted on every operation */
+    if (qat_ec_curve_cache_lock == NULL &&
+        (qat_ec_curve_cache_lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        WARN("Failed to allocate the curve cache lock\n");
+    }
+#endif
+
 #if defined (OPENSSL_DISABLE_QAT_ECDSA) || defined (OPENSSL_DISABLE_QAT_ECDH)
     EC_KEY_METHOD *def_ec_meth = (EC_KEY_METHOD *)EC_KEY_get_default_method();
 #endif
@@ -229,6 +297,13 @@ EC_KEY_METHOD *qat_get_EC_methods(void)
 
 void qat_free_EC_methods(void)
 {
+#if !defined (OPENSSL_DISABLE_QAT_ECDSA) || !defined (OPENSSL_DISABLE_QAT_ECDH)
+    qat_ec_curve_cache_free();
+#endif
+#if defined(QAT_ECX_ENABLED) && \
+    (!defined(OPENSSL_DISABLE_QAT_ECDH) || !defined(OPENSSL_DISABLE_QAT_ECDSA))
+    qat_ecx_pmeths_free();
+#endif
     if (NULL != qat_ec_method) {
         EC_KEY_METHOD_free(qat_ec_method);
         qat_ec_method = NULL;
@@ -238,6 +313,28 @@ void qat_free_EC_methods(void)
     }
 }
 
+int qat_ec_pool_set_size(qat_ec_pool_type_t type, long size)
+{
+    if (type < 0 || type >= QAT_EC_POOL_NUM_TYPES ||
+        size < 0 || size > QAT_ASYM_POOL_MAX_SIZE) {
+        WARN("Invalid pool type %d or size %ld\n", type, size);
+        return 0;
+    }
+    qat_ec_pool_size[type] = (int)size;
+    return 1;
+}
+
+int qat_ec_pool_set_refill_threshold(qat_ec_pool_type_t type, long threshold)
+{
+    if (type < 0 || type >= QAT_EC_POOL_NUM_TYPES ||
+        threshold < 0 || threshold > QAT_ASYM_POOL_MAX_SIZE) {
+        WARN("Invalid pool type %d or refill threshold %ld\n", type, threshold);
+        return 0;
+    }
+    qat_ec_pool_refill[type] = (int)threshold;
+    return 1;
+}
+
 
 #if !defined (OPENSSL_DISABLE_QAT_ECDSA) || !defined (OPENSSL_DISABLE_QAT_ECDH)
 CpaCyEcFieldType qat_get_field_type(const EC_GROUP *group)
@@ -329,6 +426,172 @@ int qat_set_affine_coordinates(const EC_GROUP *group, EC_POINT *p,
 # endif
     return 1;
 }
+
+static void qat_ec_curve_free(qat_ec_curve_t *curve)
+{
+    if (curve == NULL)
+        return;
+
+    /* Pinned memory inherited across a fork is not valid in the child */
+    if (curve->pid == getpid()) {
+        QAT_CHK_QMFREE_FLATBUFF(curve->p);
+        QAT_CHK_QMFREE_FLATBUFF(curve->a);
+        QAT_CHK_QMFREE_FLATBUFF(curve->b);
+        QAT_CHK_QMFREE_FLATBUFF(curve->xg);
+        QAT_CHK_QMFREE_FLATBUFF(curve->yg);
+        QAT_CHK_QMFREE_FLATBUFF(curve->order);
+    }
+    OPENSSL_free(curve);
+}
+
+static void qat_ec_curve_cache_free(void)
+{
+    int i = 0;
+
+    for (i = 0; i < QAT_EC_CURVE_CACHE_SIZE; i++) {
+        qat_ec_curve_free(qat_ec_curve_cache[i]);
+        qat_ec_curve_cache[i] = NULL;
+    }
+    CRYPTO_THREAD_lock_free(qat_ec_curve_cache_lock);
+    qat_ec_curve_cache_lock = NULL;
+}
+
+static qat_ec_curve_t *qat_ec_curve_new(const EC_GROUP *group, int nid)
+{
+    qat_ec_curve_t *curve = NULL;
+    BN_CTX *ctx = NULL;
+    BIGNUM *p = NULL, *a = NULL, *b = NULL;
+    BIGNUM *xg = NULL, *yg = NULL, *order = NULL;
+    const EC_POINT *gen = NULL;
+    int ok = 0;
+
+    if ((gen = EC_GROUP_get0_generator(group)) == NULL ||
+        (curve = OPENSSL_zalloc(sizeof(qat_ec_curve_t))) == NULL ||
+        (ctx = BN_CTX_new()) == NULL) {
+        WARN("Failed to allocate the curve\n");
+        OPENSSL_free(curve);
+        return NULL;
+    }
+
+    curve->nid = nid;
+    curve->pid = getpid();
+    curve->fieldType = qat_get_field_type(group);
+
+    BN_CTX_start(ctx);
+    p = BN_CTX_get(ctx);
+    a = BN_CTX_get(ctx);
+    b = BN_CTX_get(ctx);
+    xg = BN_CTX_get(ctx);
+    yg = BN_CTX_get(ctx);
+    order = BN_CTX_get(ctx);
+
+    if (order == NULL ||
+        !qat_get_curve(group, p, a, b, ctx, curve->fieldType) ||
+        !qat_get_affine_coordinates(group, gen, xg, yg, ctx,
+                                    curve->fieldType) ||
+        !EC_GROUP_get_order(group, order, ctx)) {
+        WARN("Failed to get the curve parameters\n");
+        goto err;
+    }
+
+    if (qat_BN_to_FB(&curve->p, p) != 1 ||
+        qat_BN_to_FB(&curve->a, a) != 1 ||
+        qat_BN_to_FB(&curve->b, b) != 1 ||
+        qat_BN_to_FB(&curve->xg, xg) != 1 ||
+        qat_BN_to_FB(&curve->yg, yg) != 1 ||
+        qat_BN_to_FB(&curve->order, order) != 1) {
+        WARN("Failed to convert the curve parameters to flatbuffers\n");
+        goto err;
+    }
+
+    /* A zero 'a' co-efficient is passed as a flatbuffer of size 1 */
+    if (curve->a.pData == NULL && curve->a.dataLenInBytes == 0) {
+        if ((curve->a.pData = qaeCryptoMemAlloc(1, __FILE__, __LINE__)) == NULL) {
+            WARN("Failure to allocate curve->a.pData\n");
+            goto err;
+        }
+        curve->a.dataLenInBytes = 1;
+        curve->a.pData[0] = 0;
+    }
+
+    ok = 1;
+
+err:
+    BN_CTX_end(ctx);
+    BN_CTX_free(ctx);
+    if (!ok) {
+        qat_ec_curve_free(curve);
+        curve = NULL;
+    }
+    return curve;
+}
+
+/******************************************************************************
+* function:
+*         qat_ec_get_cached_curve(const EC_GROUP *group)
+*
+* @param group [IN] - EC group of the operation
+*
+* description:
+*   Returns the pinned constants of a named curve, converting them on first
+*   use. The result is valid until the EC methods are freed and must not be
+*   freed by the caller. Returns NULL, without raising an error, for curves
+*   without a name or when the cache is full, in which case the caller
+*   converts the constants itself.
+******************************************************************************/
+static const qat_ec_curve_t *qat_ec_get_cached_curve(const EC_GROUP *group)
+{
+    const qat_ec_curve_t *curve = NULL;
+    int nid = EC_GROUP_get_curve_name(group);
+    pid_t pid = getpid();
+    int i = 0, slot = -1;
+
+    if (nid == NID_undef || qat_ec_curve_cache_lock == NULL)
+        return NULL;
+
+    if (!CRYPTO_THREAD_read_lock(qat_ec_curve_cache_lock))
+        return NULL;
+    for (i = 0; i < QAT_EC_CURVE_CACHE_SIZE && qat_ec_curve_cache[i] != NULL; i++) {
+        if (qat_ec_curve_cache[i]->nid == nid && qat_ec_curve_cache[i]->pid == pid) {
+            curve = qat_ec_curve_cache[i];
+            break;
+        }
+    }
+    CRYPTO_THREAD_unlock(qat_ec_curve_cache_lock);
+
+    if (curve != NULL)
+        return curve;
+
+    if (!CRYPTO_THREAD_write_lock(qat_ec_curve_cache_lock))
+        return NULL;
+    for (i = 0; i < QAT_EC_CURVE_CACHE_SIZE; i++) {
+        if (qat_ec_curve_cache[i] == NULL) {
+            if (slot < 0)
+                slot = i;
+            break;
+        }
+        if (qat_ec_curve_cache[i]->nid == nid) {
+            if (qat_ec_curve_cache[i]->pid == pid) {
+                curve = qat_ec_curve_cache[i];
+                break;
+            }
+            /* Inherited from the parent, never handed out in this process */
+            slot = i;
+        }
+    }
+    if (curve == NULL && slot >= 0) {
+        qat_ec_curve_t *new_curve = qat_ec_curve_new(group, nid);
+
+        if (new_curve != NULL) {
+            qat_ec_curve_free(qat_ec_curve_cache[slot]);
+            qat_ec_curve_cache[slot] = new_curve;
+            curve = new_curve;
+        }
+    }
+    CRYPTO_THREAD_unlock(qat_ec_curve_cache_lock);
+
+    return curve;
+}
 #endif
 
 #ifndef OPENSSL_DISABLE_QAT_ECDH
@@ -354,6 +617,8 @@ int qat_ecdh_compute_key(unsigned char **outX, size_t *outlenX,
     BIGNUM *xg = NULL, *yg = NULL;
     const BIGNUM *priv_key = NULL;
     const EC_GROUP *group = NULL;
+    const qat_ec_curve_t *curve = NULL;
+    int gen_cached = 0;
     int ret = -1, job_ret = 0;
     size_t buflen;
 
@@ -469,24 +734,45 @@ int qat_ecdh_compute_key(unsigned char **outX, size_t *outlenX,
 
     opData->fieldType = qat_get_field_type(group);
 
-    if (!qat_get_curve(group, p, a, b, ctx, opData->fieldType)) {
+    if (qat_BN_to_FB(&(opData->k), (BIGNUM *)priv_key) != 1) {
+        WARN("Failure to convert priv_key to a flatbuffer\n");
+        QATerr(QAT_F_QAT_ECDH_COMPUTE_KEY, QAT_R_PRIV_KEY_XG_YG_A_B_P_CONVERT_TO_FB_FAILURE);
+        goto err;
+    }
+
+    /*
+     * The curve constants of named curves are shared read-only from the
+     * curve cache, the generator too when generating a key.
+     */
+    if ((curve = qat_ec_get_cached_curve(group)) != NULL) {
+        opData->a = curve->a;
+        opData->b = curve->b;
+        opData->q = curve->p;
+        if (pub_key == EC_GROUP_get0_generator(group)) {
+            opData->xg = curve->xg;
+            opData->yg = curve->yg;
+            gen_cached = 1;
+        }
+    } else if (!qat_get_curve(group, p, a, b, ctx, opData->fieldType)) {
         QATerr(QAT_F_QAT_ECDH_COMPUTE_KEY, ERR_R_INTERNAL_ERROR);
         goto err;
     }
 
-    if (!qat_get_affine_coordinates(group, pub_key, xg, yg, ctx,
+    if (!gen_cached &&
+        !qat_get_affine_coordinates(group, pub_key, xg, yg, ctx,
                                     opData->fieldType)) {
         QATerr(QAT_F_QAT_ECDH_COMPUTE_KEY, ERR_R_INTERNAL_ERROR);
         goto err;
     }
 
-    if ((qat_BN_to_FB(&(opData->k), (BIGNUM *)priv_key) != 1) ||
-        (qat_BN_to_FB(&(opData->xg), xg) != 1) ||
-        (qat_BN_to_FB(&(opData->yg), yg) != 1) ||
-        (qat_BN_to_FB(&(opData->a), a) != 1) ||
-        (qat_BN_to_FB(&(opData->b), b) != 1) ||
-        (qat_BN_to_FB(&(opData->q), p) != 1)) {
-        WARN("Failure to convert priv_key, xg, yg, a, b or p to a flatbuffer\n");
+    if ((!gen_cached &&
+         ((qat_BN_to_FB(&(opData->xg), xg) != 1) ||
+          (qat_BN_to_FB(&(opData->yg), yg) != 1))) ||
+        (curve == NULL &&
+         ((qat_BN_to_FB(&(opData->a), a) != 1) ||
+          (qat_BN_to_FB(&(opData->b), b) != 1) ||
+          (qat_BN_to_FB(&(opData->q), p) != 1)))) {
+        WARN("Failure to convert xg, yg, a, b or p to a flatbuffer\n");
         QATerr(QAT_F_QAT_ECDH_COMPUTE_KEY, QAT_R_PRIV_KEY_XG_YG_A_B_P_CONVERT_TO_FB_FAILURE);
         goto err;
     }
@@ -694,11 +980,15 @@ int qat_ecdh_compute_key(unsigned char **outX, size_t *outlenX,
         OPENSSL_free(pResultY);
     }
     QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData->k);
-    QAT_CHK_QMFREE_FLATBUFF(opData->xg);
-    QAT_CHK_QMFREE_FLATBUFF(opData->yg);
-    QAT_CHK_QMFREE_FLATBUFF(opData->a);
-    QAT_CHK_QMFREE_FLATBUFF(opData->b);
-    QAT_CHK_QMFREE_FLATBUFF(opData->q);
+    if (!gen_cached) {
+        QAT_CHK_QMFREE_FLATBUFF(opData->xg);
+        QAT_CHK_QMFREE_FLATBUFF(opData->yg);
+    }
+    if (curve == NULL) {
+        QAT_CHK_QMFREE_FLATBUFF(opData->a);
+        QAT_CHK_QMFREE_FLATBUFF(opData->b);
+        QAT_CHK_QMFREE_FLATBUFF(opData->q);
+    }
     if (opData)
         OPENSSL_free(opData);
     if (ctx) {
@@ -711,6 +1001,177 @@ int qat_ecdh_compute_key(unsigned char **outX, size_t *outlenX,
 }
 
 
+/*
+ * The pools of values that only depend on the curve are keyed by curve
+ * name, each keeping an EC_KEY of the curve for the refill thread. It only
+ * carries the group, the secret of each value is set on a key of its own
+ * built by qat_ec_pool_key_new so that no secret outlives its value.
+ */
+static void *qat_ec_pool_ctx_new(const void *params)
+{
+    EC_KEY *eckey = EC_KEY_new();
+
+    if (eckey == NULL || !EC_KEY_set_group(eckey, (const EC_GROUP *)params)) {
+        EC_KEY_free(eckey);
+        return NULL;
+    }
+    return eckey;
+}
+
+static void qat_ec_pool_ctx_free(void *ctx)
+{
+    EC_KEY_free((EC_KEY *)ctx);
+}
+
+static int qat_ec_pool_ctx_match(const void *ctx, const void *params)
+{
+    return EC_GROUP_get_curve_name(EC_KEY_get0_group((const EC_KEY *)ctx)) ==
+           EC_GROUP_get_curve_name((const EC_GROUP *)params);
+}
+
+/*
+ * Returns a key of the curve of the pool holding the secret priv, to be
+ * released with EC_KEY_free which clears it. Returns NULL on failure.
+ */
+static EC_KEY *qat_ec_pool_key_new(const EC_KEY *ctx_eckey, const BIGNUM *priv)
+{
+    EC_KEY *eckey = EC_KEY_new();
+
+    if (eckey == NULL || !EC_KEY_set_group(eckey, EC_KEY_get0_group(ctx_eckey)) ||
+        !EC_KEY_set_private_key(eckey, priv)) {
+        EC_KEY_free(eckey);
+        return NULL;
+    }
+    return eckey;
+}
+
+static const qat_asym_pool_ops_t qat_ec_pool_ops[QAT_EC_POOL_NUM_TYPES] = {
+# ifndef OPENSSL_DISABLE_QAT_ECDSA
+    { qat_ec_pool_ctx_new, qat_ec_pool_ctx_free, qat_ec_pool_ctx_match,
+      qat_ecdsa_nonce_new, qat_ecdsa_nonce_free },
+# else
+    { NULL, NULL, NULL, NULL, NULL },
+# endif
+    { qat_ec_pool_ctx_new, qat_ec_pool_ctx_free, qat_ec_pool_ctx_match,
+      qat_ecdh_key_new, qat_ecdh_key_free },
+};
+
+/*
+ * Takes a precomputed value for a named curve out of its pool, or returns
+ * NULL for the caller to compute it inline.
+ */
+static void *qat_ec_pool_get(qat_ec_pool_type_t type, const EC_GROUP *group)
+{
+    if (EC_GROUP_get_curve_name(group) == NID_undef)
+        return NULL;
+    return qat_asym_pool_get(&qat_ec_pool_ops[type], group,
+                             qat_ec_pool_size[type], qat_ec_pool_refill[type]);
+}
+
+static void qat_ecdh_key_free(void *item)
+{
+    qat_ecdh_key_t *key = (qat_ecdh_key_t *)item;
+
+    if (key == NULL)
+        return;
+    BN_clear_free(key->priv);
+    EC_POINT_clear_free(key->pub);
+    OPENSSL_free(key);
+}
+
+/******************************************************************************
+* function:
+*         qat_ecdh_key_new(void *ctx_eckey)
+*
+* @param ctx_eckey [IN] - EC_KEY of the curve of the pool
+*
+* description:
+*   Generates an ephemeral key pair, the public key being computed with a
+*   point multiply on the accelerator. The coordinates returned are checked
+*   as qat_ecdh_generate_key does. Run by the pool refill thread.
+******************************************************************************/
+static void *qat_ecdh_key_new(void *ctx_eckey)
+{
+    EC_KEY *eckey = NULL;
+    const EC_GROUP *group = EC_KEY_get0_group((const EC_KEY *)ctx_eckey);
+    qat_ecdh_key_t *key = NULL;
+    BN_CTX *ctx = NULL;
+    BIGNUM *x = NULL, *y = NULL, *tx = NULL, *ty = NULL, *order = NULL;
+    unsigned char *xbuf = NULL, *ybuf = NULL;
+    size_t xlen = 0, ylen = 0;
+    int fallback = 0, ok = 0;
+
+    if ((key = OPENSSL_zalloc(sizeof(qat_ecdh_key_t))) == NULL ||
+        (key->priv = BN_new()) == NULL ||
+        (key->pub = EC_POINT_new(group)) == NULL ||
+        (ctx = BN_CTX_new()) == NULL) {
+        WARN("Failed to allocate the key\n");
+        goto err;
+    }
+
+    BN_CTX_start(ctx);
+    x = BN_CTX_get(ctx);
+    y = BN_CTX_get(ctx);
+    tx = BN_CTX_get(ctx);
+    ty = BN_CTX_get(ctx);
+    order = BN_CTX_get(ctx);
+    if (order == NULL || !EC_GROUP_get_order(group, order, ctx)) {
+        WARN("Failed to get the order\n");
+        goto err;
+    }
+
+    do
+        if (!BN_rand_range(key->priv, order)) {
+            WARN("Failure to generate random value\n");
+            goto err;
+        }
+    while (BN_is_zero(key->priv));
+
+    xlen = ylen = (EC_GROUP_get_degree(group) + 7) / 8;
+    if ((eckey = qat_ec_pool_key_new(ctx_eckey, key->priv)) == NULL ||
+        qat_ecdh_compute_key(&xbuf, &xlen, &ybuf, &ylen,
+                             EC_GROUP_get0_generator(group),
+                             eckey, &fallback) <= 0 ||
+        fallback) {
+        WARN("Failed to compute the public key\n");
+        goto err;
+    }
+
+    if (BN_bin2bn(xbuf, xlen, x) == NULL ||
+        BN_bin2bn(ybuf, ylen, y) == NULL ||
+        !qat_set_affine_coordinates(group, key->pub, x, y, ctx,
+                                    qat_get_field_type(group)) ||
+        !qat_get_affine_coordinates(group, key->pub, tx, ty, ctx,
+                                    qat_get_field_type(group))) {
+        WARN("Failed to set the public key\n");
+        goto err;
+    }
+
+    /* Coordinates out of range do not read back as they were set */
+    if (BN_cmp(x, tx) || BN_cmp(y, ty)) {
+        WARN("Retrieved coordinates do not match the originals\n");
+        goto err;
+    }
+    ok = 1;
+
+err:
+    OPENSSL_free(xbuf);
+    OPENSSL_free(ybuf);
+    EC_KEY_free(eckey);
+    if (ctx != NULL) {
+        BN_CTX_end(ctx);
+        BN_CTX_free(ctx);
+    }
+    if (!ok) {
+        /* The pool retries on a later draw, leave no error behind */
+        ERR_clear_error();
+        qat_ecdh_key_free(key);
+        key = NULL;
+    }
+    return key;
+}
+
+
 int qat_engine_ecdh_compute_key(unsigned char **out,
                                 size_t *outlen,
                                 const EC_POINT *pub_key,
@@ -721,6 +1182,7 @@ int qat_engine_ecdh_compute_key(unsigned char **out,
     PFUNC_COMP_KEY comp_key_pfunc = NULL;
     const EC_GROUP *group = NULL;
     const BIGNUM *priv_key = NULL;
+    qat_asym_sample_t sample;
 
     DEBUG("- Started\n");
 
@@ -748,19 +1210,29 @@ int qat_engine_ecdh_compute_key(unsigned char **out,
         return ret;
     }
 
-    /* Unsupported curve: X25519.
+    /* Unsupported curve: X25519, offloaded through qat_ecx_pmeth().
      * Detect and call it's software implementation.
      */
     if (EC_GROUP_get_curve_name(group) == NID_X25519) {
         return (*comp_key_pfunc)(out, outlen, pub_key, ecdh);
     }
 
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_ECDH,
+                                 EC_GROUP_get_degree(group))) {
+        ret = (*comp_key_pfunc)(out, outlen, pub_key, ecdh);
+        if (ret > 0)
+            qat_asym_dispatch_end(&sample);
+        return ret;
+    }
+
     ret = qat_ecdh_compute_key(out, outlen, NULL, NULL, pub_key, ecdh, &fallback);
     if (fallback == 1) {
         WARN("- Fallback to software mode.\n");
         CRYPTO_QAT_LOG("Resubmitting request to SW - %s\n", __func__);
         return (*comp_key_pfunc)(out, outlen, pub_key, ecdh);
     }
+    if (ret > 0)
+        qat_asym_dispatch_end(&sample);
     DEBUG("- Finished\n");
     return ret;
 }
@@ -783,6 +1255,8 @@ int qat_ecdh_generate_key(EC_KEY *ecdh)
     size_t temp_yfield_size = 0;
     PFUNC_GEN_KEY gen_key_pfunc = NULL;
     int fallback = 0;
+    qat_asym_sample_t sample;
+    qat_ecdh_key_t *key = NULL;
 
     DEBUG("- Started\n");
 
@@ -804,13 +1278,31 @@ int qat_ecdh_generate_key(EC_KEY *ecdh)
         return 0;
     }
 
-    /* Unsupported curve: X25519.
+    /* Unsupported curve: X25519, offloaded through qat_ecx_pmeth().
      * Detect and call it's software implementation.
      */
     if (EC_GROUP_get_curve_name(group) == NID_X25519) {
         return (*gen_key_pfunc)(ecdh);
     }
 
+    if ((key = qat_ec_pool_get(QAT_EC_POOL_ECDH_KEY, group)) != NULL) {
+        ERR_set_mark();
+        ok = EC_KEY_set_private_key(ecdh, key->priv) &&
+             EC_KEY_set_public_key(ecdh, key->pub);
+        qat_ecdh_key_free(key);
+        ERR_pop_to_mark();
+        if (ok)
+            return ok;
+    }
+
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_ECDH,
+                                 EC_GROUP_get_degree(group))) {
+        ok = (*gen_key_pfunc)(ecdh);
+        if (ok)
+            qat_asym_dispatch_end(&sample);
+        return ok;
+    }
+
     if ((ctx = BN_CTX_new()) == NULL) {
         WARN("Failure to allocate ctx\n");
         QATerr(QAT_F_QAT_ECDH_GENERATE_KEY, QAT_R_CTX_MALLOC_FAILURE);
@@ -949,81 +1441,1578 @@ int qat_ecdh_generate_key(EC_KEY *ecdh)
         DEBUG("- Switched to software mode\n");
         return (*gen_key_pfunc)(ecdh);
     }
+    if (ok)
+        qat_asym_dispatch_end(&sample);
     return ok;
 }
 #endif /* #ifndef OPENSSL_DISABLE_QAT_ECDH */
 
-#ifndef OPENSSL_DISABLE_QAT_ECDSA
-/* Callback to indicate QAT completion of ECDSA Sign */
-static void qat_ecdsaSignCallbackFn(void *pCallbackTag, CpaStatus status,
-                                    void *pOpData, CpaBoolean bEcdsaSignStatus,
-                                    CpaFlatBuffer * pResultR,
-                                    CpaFlatBuffer * pResultS)
+#if defined(QAT_ECX_ENABLED) && \
+    (!defined(OPENSSL_DISABLE_QAT_ECDH) || !defined(OPENSSL_DISABLE_QAT_ECDSA))
+/*
+ * Montgomery curves of RFC 7748 and Edwards curves of RFC 8032. The
+ * accelerator works on big endian numbers, right aligned in buffers of
+ * datalen bytes, while keys and encoded points are little endian.
+ */
+# define QAT_X25519_KEYLEN 32
+# define QAT_X448_KEYLEN 56
+# define QAT_ED25519_KEYLEN 32
+# define QAT_ED448_KEYLEN 57
+# define QAT_ECX_DATALEN_25519 32
+# define QAT_ECX_DATALEN_448 64
+# define QAT_ECX_MAX_KEYLEN 57
+
+/* Methods of the engine, and of software, for X25519/X448/Ed25519/Ed448 */
+# define QAT_ECX_NUM_PMETHS 4
+static EVP_PKEY_METHOD *qat_ecx_pmeths[QAT_ECX_NUM_PMETHS] = { NULL };
+static const EVP_PKEY_METHOD *sw_ecx_pmeths[QAT_ECX_NUM_PMETHS] = { NULL };
+
+/* Layout of the keys of the X25519, X448, Ed25519 and Ed448 methods of
+ * OpenSSL 1.1.1 */
+typedef struct {
+    unsigned char pubkey[QAT_ECX_MAX_KEYLEN];
+    unsigned char *privkey;
+} qat_ecx_key_t;
+
+static int qat_ecx_pmeth_index(int nid)
 {
-    if (enable_heuristic_polling) {
-        QAT_ATOMIC_DEC(num_asym_requests_in_flight);
+    switch (nid) {
+    case EVP_PKEY_X25519:
+        return 0;
+    case EVP_PKEY_X448:
+        return 1;
+    case EVP_PKEY_ED25519:
+        return 2;
+    case EVP_PKEY_ED448:
+        return 3;
+    default:
+        return -1;
     }
-    qat_crypto_callbackFn(pCallbackTag, status, CPA_CY_SYM_OP_CIPHER, pOpData,
-                          NULL, bEcdsaSignStatus);
 }
 
-/* Callback to indicate QAT completion of ECDSA Verify */
-static void qat_ecdsaVerifyCallbackFn(void *pCallbackTag, CpaStatus status,
-                                      void *pOpData, CpaBoolean bEcdsaVerifyStatus)
+static int qat_ecx_offload(void)
+{
+    return qat_ecx_offload_supported && !qat_get_qat_offload_disabled();
+}
+
+/* Callback to indicate QAT completion of Montgomery/Edwards point multiply */
+static void qat_ecxCallbackFn(void *pCallbackTag, CpaStatus status,
+                              void *pOpData, CpaBoolean multiplyStatus,
+                              CpaFlatBuffer * pXk, CpaFlatBuffer * pYk)
 {
     if (enable_heuristic_polling) {
         QAT_ATOMIC_DEC(num_asym_requests_in_flight);
     }
     qat_crypto_callbackFn(pCallbackTag, status, CPA_CY_SYM_OP_CIPHER, pOpData,
-                          NULL, bEcdsaVerifyStatus);
+                          NULL, multiplyStatus);
 }
 
-
-int qat_ecdsa_sign(int type, const unsigned char *dgst, int dlen,
-                   unsigned char *sig, unsigned int *siglen,
-                   const BIGNUM *kinv, const BIGNUM *r, EC_KEY *eckey)
+/******************************************************************************
+* function:
+*         qat_ecx_perform(CpaCyEcMontEdwdsPointMultiplyOpData *opData,
+*                         CpaFlatBuffer *pResultX,
+*                         CpaFlatBuffer *pResultY,
+*                         int *fallback)
+*
+* @param opData   [IN]  - Point multiply request, in pinned memory
+* @param pResultX [OUT] - x coordinate of the product, in pinned memory
+* @param pResultY [OUT] - y coordinate of the product, in pinned memory
+* @param fallback [OUT] - Set to 1 if the operation should go to software
+*
+* description:
+*   Submits a Montgomery or Edwards curve point multiplication and waits
+*   for its completion. Returns 1 on success, 0 on failure.
+******************************************************************************/
+static int qat_ecx_perform(CpaCyEcMontEdwdsPointMultiplyOpData *opData,
+                           CpaFlatBuffer *pResultX, CpaFlatBuffer *pResultY,
+                           int *fallback)
 {
-    ECDSA_SIG *s;
+    CpaBoolean bEcStatus;
+    CpaStatus status;
+    op_done_t op_done;
+    thread_local_variables_t *tlv = NULL;
+    int job_ret = 0;
+    int inst_num = QAT_INVALID_INSTANCE;
+    int qatPerformOpRetries = 0;
+    useconds_t ulPollInterval = getQatPollInterval();
+    int iMsgRetry = getQatMsgRetryCount();
 
-    if (unlikely(dgst == NULL ||
-                 dlen <= 0)) { /* Check these input params before passing to
-                                * RAND_seed(). Rest of the input params. are
-                                * checked by qat_ecdsa_do_sign().
-                                */
-        WARN("Invalid input param.\n");
-        if (siglen != NULL)
-            *siglen = 0;
-        QATerr(QAT_F_QAT_ECDSA_SIGN, QAT_R_INPUT_PARAM_INVALID);
-        return 0;
-    }
-    s = qat_ecdsa_do_sign(dgst, dlen, kinv, r, eckey);
-    if (s == NULL) {
-        WARN("Error ECDSA Sign Operation Failed\n");
-        if (siglen != NULL)
-            *siglen = 0;
-        QATerr(QAT_F_QAT_ECDSA_SIGN, QAT_R_QAT_ECDSA_DO_SIGN_FAIL);
-        return 0;
+    tlv = qat_check_create_local_variables();
+    if (NULL == tlv) {
+            WARN("could not create local variables\n");
+            QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+            return 0;
     }
-    *siglen = i2d_ECDSA_SIG(s, &sig);
-    ECDSA_SIG_free(s);
-    return 1;
-}
-
 
-ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
-                             const BIGNUM *in_kinv, const BIGNUM *in_r,
-                             EC_KEY *eckey)
-{
-    int ok = 0, i, job_ret = 0, fallback = 0;
-    BIGNUM *m = NULL, *order = NULL;
-    BN_CTX *ctx = NULL;
-    const EC_GROUP *group;
-    ECDSA_SIG *ret = NULL;
-    BIGNUM *ecdsa_sig_r = NULL, *ecdsa_sig_s = NULL;
-    const BIGNUM *priv_key;
-    BIGNUM *p = NULL, *a = NULL, *b = NULL, *k = NULL;
-    BIGNUM *xg = NULL, *yg = NULL;
-    const EC_POINT *pub_key = NULL;
+    QAT_INC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+    if (qat_use_signals()) {
+        if (tlv->localOpsInFlight == 1) {
+            if (pthread_kill(timer_poll_func_thread, SIGUSR1) != 0) {
+                WARN("pthread_kill error\n");
+                QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+                QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+                return 0;
+            }
+        }
+    }
+    qat_init_op_done(&op_done);
+    if (op_done.job != NULL) {
+        if (qat_setup_async_event_notification(0) == 0) {
+            WARN("Failed to setup async event notification\n");
+            QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+            qat_cleanup_op_done(&op_done);
+            QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+            return 0;
+        }
+    }
+
+    /* Invoke the crypto engine API for Montgomery Point Multiply */
+    do {
+        if ((inst_num = get_next_inst_num()) == QAT_INVALID_INSTANCE) {
+            WARN("Failed to get an instance\n");
+            if (qat_get_sw_fallback_enabled()) {
+                CRYPTO_QAT_LOG("Failed to get an instance - fallback to SW - %s\n", __func__);
+                *fallback = 1;
+            } else {
+                QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+            }
+            if (op_done.job != NULL) {
+                qat_clear_async_event_notification();
+            }
+            qat_cleanup_op_done(&op_done);
+            QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+            return 0;
+        }
+
+        CRYPTO_QAT_LOG("KX - %s\n", __func__);
+        status = cpaCyEcMontEdwdsPointMultiply(qat_instance_handles[inst_num],
+                                               qat_ecxCallbackFn,
+                                               &op_done,
+                                               opData,
+                                               &bEcStatus, pResultX, pResultY);
+
+        if (status == CPA_STATUS_RETRY) {
+            if (op_done.job == NULL) {
+                usleep(ulPollInterval +
+                       (qatPerformOpRetries %
+                        QAT_RETRY_BACKOFF_MODULO_DIVISOR));
+                qatPerformOpRetries++;
+                if (iMsgRetry != QAT_INFINITE_MAX_NUM_RETRIES) {
+                    if (qatPerformOpRetries >= iMsgRetry) {
+                        WARN("No. of retries exceeded max retry : %d\n", iMsgRetry);
+                        break;
+                    }
+                }
+            } else {
+                if ((qat_wake_job(op_done.job, ASYNC_STATUS_EAGAIN) == 0) ||
+                    (qat_pause_job(op_done.job, ASYNC_STATUS_EAGAIN) == 0)) {
+                    WARN("qat_wake_job or qat_pause_job failed\n");
+                    break;
+                }
+            }
+        }
+    }
+    while (status == CPA_STATUS_RETRY );
+
+    if (status != CPA_STATUS_SUCCESS) {
+        WARN("Failed to submit request to qat - status = %d\n", status);
+        if (qat_get_sw_fallback_enabled() &&
+            (status == CPA_STATUS_RESTARTING || status == CPA_STATUS_FAIL)) {
+            CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
+                           inst_num,
+                           qat_instance_details[inst_num].qat_instance_info.physInstId.packageId,
+                           __func__);
+            *fallback = 1;
+        } else {
+            QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+        }
+        if (op_done.job != NULL) {
+            qat_clear_async_event_notification();
+        }
+        qat_cleanup_op_done(&op_done);
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        return 0;
+    }
+
+    if (enable_heuristic_polling) {
+        QAT_ATOMIC_INC(num_asym_requests_in_flight);
+    }
+
+    do {
+        if(op_done.job != NULL) {
+            /* If we get a failure on qat_pause_job then we will
+               not flag an error here and quit because we have
+               an asynchronous request in flight.
+               We don't want to start cleaning up data
+               structures that are still being used. If
+               qat_pause_job fails we will just yield and
+               loop around and try again until the request
+               completes and we can continue. */
+            if ((job_ret = qat_pause_job(op_done.job, ASYNC_STATUS_OK)) == 0)
+                pthread_yield();
+        } else {
+            pthread_yield();
+        }
+    }
+    while (!op_done.flag ||
+           QAT_CHK_JOB_RESUMED_UNEXPECTEDLY(job_ret));
+
+    QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+
+    if (op_done.verifyResult != CPA_TRUE) {
+        WARN("Verification of request failed\n");
+        if (qat_get_sw_fallback_enabled() && op_done.status == CPA_STATUS_FAIL) {
+            CRYPTO_QAT_LOG("Verification of result failed for qat inst_num %d device_id %d - fallback to SW - %s\n",
+                           inst_num,
+                           qat_instance_details[inst_num].qat_instance_info.physInstId.packageId,
+                           __func__);
+            *fallback = 1;
+        } else {
+            QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+        }
+        qat_cleanup_op_done(&op_done);
+        return 0;
+    }
+    qat_cleanup_op_done(&op_done);
+
+    return 1;
+}
+#endif
+
+#if defined(QAT_ECX_ENABLED) && !defined(OPENSSL_DISABLE_QAT_ECDH)
+typedef struct {
+    int nid;
+    CpaCyEcMontEdwdsCurveType curveType;
+    size_t keylen;
+    size_t datalen;
+    int bits;
+} qat_ecx_curve_t;
+
+static const qat_ecx_curve_t qat_ecx_curves[] = {
+    { EVP_PKEY_X25519, CPA_CY_EC_MONTEDWDS_CURVE25519_TYPE,
+      QAT_X25519_KEYLEN, QAT_ECX_DATALEN_25519, 255 },
+    { EVP_PKEY_X448, CPA_CY_EC_MONTEDWDS_CURVE448_TYPE,
+      QAT_X448_KEYLEN, QAT_ECX_DATALEN_448, 448 }
+};
+
+/* Copies the little endian in to the big endian, right aligned, fb */
+static void qat_ecx_to_fb(const qat_ecx_curve_t *curve, CpaFlatBuffer *fb,
+                          const unsigned char *in)
+{
+    size_t i = 0;
+
+    memset(fb->pData, 0, curve->datalen);
+    for (i = 0; i < curve->keylen; i++)
+        fb->pData[curve->datalen - 1 - i] = in[i];
+}
+
+static void qat_ecx_from_fb(const qat_ecx_curve_t *curve, unsigned char *out,
+                            const CpaFlatBuffer *fb)
+{
+    size_t i = 0;
+
+    for (i = 0; i < curve->keylen; i++)
+        out[i] = fb->pData[curve->datalen - 1 - i];
+}
+
+/******************************************************************************
+* function:
+*         qat_ecx_point_multiply(const qat_ecx_curve_t *curve,
+*                                const unsigned char *priv,
+*                                const unsigned char *peer,
+*                                unsigned char *out,
+*                                int *fallback)
+*
+* @param curve    [IN]  - Montgomery curve
+* @param priv     [IN]  - Private key, little endian
+* @param peer     [IN]  - u-coordinate of the peer, little endian, or NULL
+*                         to multiply the base point
+* @param out      [OUT] - u-coordinate of the product, little endian
+* @param fallback [OUT] - Set to 1 if the operation should go to software
+*
+* description:
+*   Computes the X25519 or X448 function of RFC 7748 on the accelerator,
+*   clamping the scalar and, for X25519, masking the top bit of the peer
+*   u-coordinate as the RFC requires. Returns 1 on success, 0 on failure.
+******************************************************************************/
+static int qat_ecx_point_multiply(const qat_ecx_curve_t *curve,
+                                  const unsigned char *priv,
+                                  const unsigned char *peer,
+                                  unsigned char *out, int *fallback)
+{
+    CpaCyEcMontEdwdsPointMultiplyOpData opData;
+    CpaFlatBuffer resultX, resultY;
+    unsigned char buf[QAT_ECX_MAX_KEYLEN];
+    int ret = 0;
+
+    memset(&opData, 0, sizeof(opData));
+    memset(&resultX, 0, sizeof(resultX));
+    memset(&resultY, 0, sizeof(resultY));
+
+    opData.curveType = curve->curveType;
+    opData.generator = peer == NULL ? CPA_TRUE : CPA_FALSE;
+    opData.k.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+    opData.k.dataLenInBytes = curve->datalen;
+    resultX.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+    resultX.dataLenInBytes = curve->datalen;
+    resultY.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+    resultY.dataLenInBytes = curve->datalen;
+    if (opData.k.pData == NULL || resultX.pData == NULL ||
+        resultY.pData == NULL) {
+        WARN("Failure to allocate the flatbuffers\n");
+        QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    memcpy(buf, priv, curve->keylen);
+    if (curve->nid == EVP_PKEY_X25519) {
+        buf[0] &= 248;
+        buf[31] &= 127;
+        buf[31] |= 64;
+    } else {
+        buf[0] &= 252;
+        buf[55] |= 128;
+    }
+    qat_ecx_to_fb(curve, &opData.k, buf);
+    OPENSSL_cleanse(buf, sizeof(buf));
+
+    if (peer != NULL) {
+        opData.x.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+        if (opData.x.pData == NULL) {
+            WARN("Failure to allocate opData.x.pData\n");
+            QATerr(QAT_F_QAT_ECX_POINT_MULTIPLY, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        opData.x.dataLenInBytes = curve->datalen;
+        memcpy(buf, peer, curve->keylen);
+        if (curve->nid == EVP_PKEY_X25519)
+            buf[31] &= 127;
+        qat_ecx_to_fb(curve, &opData.x, buf);
+    }
+
+    if (!qat_ecx_perform(&opData, &resultX, &resultY, fallback))
+        goto err;
+
+    qat_ecx_from_fb(curve, out, &resultX);
+    ret = 1;
+
+ err:
+    OPENSSL_cleanse(buf, sizeof(buf));
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData.k);
+    QAT_CHK_QMFREE_FLATBUFF(opData.x);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(resultX);
+    QAT_CHK_QMFREE_FLATBUFF(resultY);
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_ecx_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey, int nid)
+*
+* @param ctx  [IN]  - PKEY Context structure pointer
+* @param pkey [OUT] - Generated key pair
+* @param nid  [IN]  - EVP_PKEY_X25519 or EVP_PKEY_X448
+*
+* description:
+*   Generates a random private key and computes its public key on the
+*   accelerator, or in software when the devices cannot.
+******************************************************************************/
+static int qat_ecx_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey, int nid)
+{
+    int idx = qat_ecx_pmeth_index(nid);
+    const qat_ecx_curve_t *curve = &qat_ecx_curves[idx];
+    int (*sw_keygen_fn)(EVP_PKEY_CTX *, EVP_PKEY *) = NULL;
+    qat_ecx_key_t *key = NULL;
+    qat_asym_sample_t sample;
+    int fallback = 0, ok = 0;
+
+    DEBUG("- Started\n");
+
+    EVP_PKEY_meth_get_keygen((EVP_PKEY_METHOD *)sw_ecx_pmeths[idx], NULL,
+                             &sw_keygen_fn);
+    if (sw_keygen_fn == NULL) {
+        WARN("get keygen failed\n");
+        QATerr(QAT_F_QAT_ECX_KEYGEN, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    if (!qat_ecx_offload()) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_keygen_fn)(ctx, pkey);
+    }
+
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_ECDH, curve->bits)) {
+        ok = (*sw_keygen_fn)(ctx, pkey);
+        if (ok)
+            qat_asym_dispatch_end(&sample);
+        return ok;
+    }
+
+    if ((key = OPENSSL_zalloc(sizeof(*key))) == NULL ||
+        (key->privkey = OPENSSL_secure_zalloc(curve->keylen)) == NULL) {
+        WARN("Failure to allocate the key\n");
+        QATerr(QAT_F_QAT_ECX_KEYGEN, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    if (RAND_priv_bytes(key->privkey, curve->keylen) <= 0) {
+        WARN("Failure to generate the private key\n");
+        QATerr(QAT_F_QAT_ECX_KEYGEN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    if (!qat_ecx_point_multiply(curve, key->privkey, NULL, key->pubkey,
+                                &fallback))
+        goto err;
+
+    if (!EVP_PKEY_assign(pkey, nid, key)) {
+        WARN("Failure to assign the key\n");
+        QATerr(QAT_F_QAT_ECX_KEYGEN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    key = NULL;
+    ok = 1;
+
+ err:
+    if (key != NULL) {
+        OPENSSL_secure_clear_free(key->privkey, curve->keylen);
+        OPENSSL_free(key);
+    }
+
+    DEBUG("- Finished\n");
+
+    if (fallback == 1) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_keygen_fn)(ctx, pkey);
+    }
+    if (ok)
+        qat_asym_dispatch_end(&sample);
+    return ok;
+}
+
+static int qat_x25519_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
+{
+    return qat_ecx_keygen(ctx, pkey, EVP_PKEY_X25519);
+}
+
+static int qat_x448_keygen(EVP_PKEY_CTX *ctx, EVP_PKEY *pkey)
+{
+    return qat_ecx_keygen(ctx, pkey, EVP_PKEY_X448);
+}
+
+/******************************************************************************
+* function:
+*         qat_ecx_derive(EVP_PKEY_CTX *ctx, unsigned char *key,
+*                        size_t *keylen, int nid)
+*
+* @param ctx    [IN]  - PKEY Context structure pointer
+* @param key    [OUT] - Shared secret, or NULL to query its length
+* @param keylen [OUT] - Length of the shared secret
+* @param nid    [IN]  - EVP_PKEY_X25519 or EVP_PKEY_X448
+*
+* description:
+*   Computes the shared secret of the key and peer key of the context on
+*   the accelerator, or in software when the devices cannot.
+******************************************************************************/
+static int qat_ecx_derive(EVP_PKEY_CTX *ctx, unsigned char *key,
+                          size_t *keylen, int nid)
+{
+    int idx = qat_ecx_pmeth_index(nid);
+    const qat_ecx_curve_t *curve = &qat_ecx_curves[idx];
+    int (*sw_derive_fn)(EVP_PKEY_CTX *, unsigned char *, size_t *) = NULL;
+    const qat_ecx_key_t *priv = NULL, *peer = NULL;
+    EVP_PKEY *pkey = NULL, *peerkey = NULL;
+    qat_asym_sample_t sample;
+    unsigned char acc = 0;
+    size_t i = 0;
+    int fallback = 0, ok = 0;
+
+    DEBUG("- Started\n");
+
+    EVP_PKEY_meth_get_derive((EVP_PKEY_METHOD *)sw_ecx_pmeths[idx], NULL,
+                             &sw_derive_fn);
+    if (sw_derive_fn == NULL) {
+        WARN("get derive failed\n");
+        QATerr(QAT_F_QAT_ECX_DERIVE, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    if (!qat_ecx_offload()) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_derive_fn)(ctx, key, keylen);
+    }
+
+    if ((pkey = EVP_PKEY_CTX_get0_pkey(ctx)) == NULL ||
+        (peerkey = EVP_PKEY_CTX_get0_peerkey(ctx)) == NULL ||
+        (priv = EVP_PKEY_get0(pkey)) == NULL || priv->privkey == NULL ||
+        (peer = EVP_PKEY_get0(peerkey)) == NULL) {
+        WARN("Missing private key or peer key\n");
+        QATerr(QAT_F_QAT_ECX_DERIVE, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+
+    if (key == NULL) {
+        *keylen = curve->keylen;
+        return 1;
+    }
+    if (*keylen < curve->keylen) {
+        WARN("Output buffer too small\n");
+        QATerr(QAT_F_QAT_ECX_DERIVE, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_ECDH, curve->bits)) {
+        ok = (*sw_derive_fn)(ctx, key, keylen);
+        if (ok)
+            qat_asym_dispatch_end(&sample);
+        return ok;
+    }
+
+    if (qat_ecx_point_multiply(curve, priv->privkey, peer->pubkey, key,
+                               &fallback)) {
+        /* A peer point of small order gives an all zero secret */
+        for (i = 0; i < curve->keylen; i++)
+            acc |= key[i];
+        if (acc == 0) {
+            WARN("All zero shared secret\n");
+            QATerr(QAT_F_QAT_ECX_DERIVE, ERR_R_INTERNAL_ERROR);
+        } else {
+            *keylen = curve->keylen;
+            ok = 1;
+        }
+    }
+
+    DEBUG("- Finished\n");
+
+    if (fallback == 1) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_derive_fn)(ctx, key, keylen);
+    }
+    if (ok)
+        qat_asym_dispatch_end(&sample);
+    return ok;
+}
+
+static int qat_x25519_derive(EVP_PKEY_CTX *ctx, unsigned char *key,
+                             size_t *keylen)
+{
+    return qat_ecx_derive(ctx, key, keylen, EVP_PKEY_X25519);
+}
+
+static int qat_x448_derive(EVP_PKEY_CTX *ctx, unsigned char *key,
+                           size_t *keylen)
+{
+    return qat_ecx_derive(ctx, key, keylen, EVP_PKEY_X448);
+}
+
+#endif
+
+#if defined(QAT_ECX_ENABLED) && !defined(OPENSSL_DISABLE_QAT_ECDSA)
+/*
+ * Edwards curves of RFC 8032, -x^2 + y^2 = 1 + d.x^2.y^2 for Ed25519 and
+ * x^2 + y^2 = 1 + d.x^2.y^2 for Ed448, with the order L of their base point.
+ */
+typedef struct {
+    int nid;
+    CpaCyEcMontEdwdsCurveType curveType;
+    size_t keylen;
+    size_t datalen;
+    int bits;
+    int a;
+    const char *p;
+    const char *d;
+    const char *order;
+} qat_ed_curve_t;
+
+static const qat_ed_curve_t qat_ed_curves[] = {
+    { EVP_PKEY_ED25519, CPA_CY_EC_MONTEDWDS_ED25519_TYPE,
+      QAT_ED25519_KEYLEN, QAT_ECX_DATALEN_25519, 255, -1,
+      "7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFED",
+      "52036CEE2B6FFE738CC740797779E89800700A4D4141D8AB75EB4DCA135978A3",
+      "1000000000000000000000000000000014DEF9DEA2F79CD65812631A5CF5D3ED" },
+    { EVP_PKEY_ED448, CPA_CY_EC_MONTEDWDS_ED448_TYPE,
+      QAT_ED448_KEYLEN, QAT_ECX_DATALEN_448, 448, 1,
+      "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE"
+      "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF",
+      "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE"
+      "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF6756",
+      "3FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+      "7CCA23E9C44EDB49AED63690216CC2728DC58F552378C292AB5844F3" }
+};
+
+/* Prefix of the hashes of Ed448 signatures, without context */
+static const unsigned char qat_ed448_dom4[] = {
+    'S', 'i', 'g', 'E', 'd', '4', '4', '8', 0x00, 0x00
+};
+
+/* Curve constants and scratch numbers of an operation */
+typedef struct {
+    BN_CTX *ctx;
+    BIGNUM *p;
+    BIGNUM *d;
+    BIGNUM *order;
+} qat_ed_ctx_t;
+
+static int qat_ed_ctx_init(qat_ed_ctx_t *ed, const qat_ed_curve_t *curve)
+{
+    if ((ed->ctx = BN_CTX_new()) == NULL)
+        return 0;
+    BN_CTX_start(ed->ctx);
+    ed->p = BN_CTX_get(ed->ctx);
+    ed->d = BN_CTX_get(ed->ctx);
+    ed->order = BN_CTX_get(ed->ctx);
+    return ed->order != NULL &&
+           BN_hex2bn(&ed->p, curve->p) && BN_hex2bn(&ed->d, curve->d) &&
+           BN_hex2bn(&ed->order, curve->order);
+}
+
+static void qat_ed_ctx_cleanup(qat_ed_ctx_t *ed)
+{
+    if (ed->ctx != NULL) {
+        BN_CTX_end(ed->ctx);
+        BN_CTX_free(ed->ctx);
+    }
+}
+
+/*
+ * Reduces the little endian number of len bytes at in modulo L without
+ * branching on its value, for the secret scalar and nonce of a signature.
+ * The number is folded in from its most significant end in chunks smaller
+ * than L, with Montgomery products modulo L and BN_mod_add_quick, which
+ * are constant time, rather than with a long division.
+ */
+static int qat_ed_reduce(qat_ed_ctx_t *ed, BN_MONT_CTX *mont, BIGNUM *out,
+                         const unsigned char *in, size_t len)
+{
+    size_t chunk_len = (BN_num_bits(ed->order) - 1) / 8;
+    size_t off = len, n = len % chunk_len ? len % chunk_len : chunk_len;
+    BIGNUM *chunk = NULL, *shift = NULL;
+    int ok = 0;
+
+    BN_CTX_start(ed->ctx);
+    if ((chunk = BN_CTX_get(ed->ctx)) == NULL ||
+        (shift = BN_CTX_get(ed->ctx)) == NULL)
+        goto err;
+    BN_set_flags(chunk, BN_FLG_CONSTTIME);
+
+    /* 2^(8 * chunk_len) < L, in the Montgomery domain as is the result */
+    BN_zero(out);
+    if (!BN_set_bit(shift, 8 * chunk_len) ||
+        !BN_to_montgomery(shift, shift, mont, ed->ctx))
+        goto err;
+
+    for (; off > 0; off -= n, n = chunk_len) {
+        if (BN_lebin2bn(in + off - n, n, chunk) == NULL ||
+            !BN_to_montgomery(chunk, chunk, mont, ed->ctx) ||
+            !BN_mod_mul_montgomery(out, out, shift, mont, ed->ctx) ||
+            !BN_mod_add_quick(out, out, chunk, ed->order))
+            goto err;
+    }
+    ok = BN_from_montgomery(out, out, mont, ed->ctx);
+
+ err:
+    if (chunk != NULL)
+        BN_clear(chunk);
+    BN_CTX_end(ed->ctx);
+    return ok;
+}
+
+/*
+ * H() of RFC 8032 over the concatenation of up to three buffers, SHA-512
+ * for Ed25519 and SHAKE256 for Ed448, prefixed with dom4 if sig is set.
+ */
+static int qat_ed_hash(const qat_ed_curve_t *curve, int sig, unsigned char *out,
+                       const unsigned char *in1, size_t len1,
+                       const unsigned char *in2, size_t len2,
+                       const unsigned char *in3, size_t len3)
+{
+    EVP_MD_CTX *md = NULL;
+    int ok = 0;
+
+    if ((md = EVP_MD_CTX_new()) == NULL)
+        return 0;
+
+    if (curve->nid == EVP_PKEY_ED25519) {
+        ok = EVP_DigestInit_ex(md, EVP_sha512(), NULL) &&
+             EVP_DigestUpdate(md, in1, len1) &&
+             (in2 == NULL || EVP_DigestUpdate(md, in2, len2)) &&
+             (in3 == NULL || EVP_DigestUpdate(md, in3, len3)) &&
+             EVP_DigestFinal_ex(md, out, NULL);
+    } else {
+        ok = EVP_DigestInit_ex(md, EVP_shake256(), NULL) &&
+             (!sig || EVP_DigestUpdate(md, qat_ed448_dom4,
+                                       sizeof(qat_ed448_dom4))) &&
+             EVP_DigestUpdate(md, in1, len1) &&
+             (in2 == NULL || EVP_DigestUpdate(md, in2, len2)) &&
+             (in3 == NULL || EVP_DigestUpdate(md, in3, len3)) &&
+             EVP_DigestFinalXOF(md, out, 2 * curve->keylen);
+    }
+    EVP_MD_CTX_free(md);
+    return ok;
+}
+
+/* Encodes a point as its y coordinate and the sign of its x coordinate */
+static int qat_ed_encode(const qat_ed_curve_t *curve, unsigned char *out,
+                         const BIGNUM *x, const BIGNUM *y)
+{
+    if (BN_bn2lebinpad(y, out, curve->keylen) < 0)
+        return 0;
+    if (BN_is_odd(x))
+        out[curve->keylen - 1] |= 0x80;
+    return 1;
+}
+
+/* Recovers the x coordinate of an encoded point, 0 if it is not valid */
+static int qat_ed_decode(const qat_ed_curve_t *curve, qat_ed_ctx_t *ed,
+                         const unsigned char *in, BIGNUM *x, BIGNUM *y)
+{
+    unsigned char buf[QAT_ECX_MAX_KEYLEN];
+    BIGNUM *u = NULL, *v = NULL;
+    int sign = 0, ok = 0;
+
+    memcpy(buf, in, curve->keylen);
+    sign = buf[curve->keylen - 1] >> 7;
+    buf[curve->keylen - 1] &= 0x7f;
+
+    u = BN_CTX_get(ed->ctx);
+    v = BN_CTX_get(ed->ctx);
+    if (v == NULL || BN_lebin2bn(buf, curve->keylen, y) == NULL ||
+        BN_cmp(y, ed->p) >= 0)
+        return 0;
+
+    /* x^2 = (y^2 - 1) / (d.y^2 - a) */
+    ERR_set_mark();
+    ok = BN_mod_sqr(v, y, ed->p, ed->ctx) &&
+         BN_mod_sub(u, v, BN_value_one(), ed->p, ed->ctx) &&
+         BN_mod_mul(v, v, ed->d, ed->p, ed->ctx) &&
+         (curve->a < 0 ? BN_mod_add(v, v, BN_value_one(), ed->p, ed->ctx) :
+                         BN_mod_sub(v, v, BN_value_one(), ed->p, ed->ctx)) &&
+         BN_mod_inverse(v, v, ed->p, ed->ctx) != NULL &&
+         BN_mod_mul(u, u, v, ed->p, ed->ctx) &&
+         BN_mod_sqrt(x, u, ed->p, ed->ctx) != NULL;
+    ERR_pop_to_mark();
+    if (!ok || (BN_is_zero(x) && sign))
+        return 0;
+
+    if (BN_is_odd(x) != sign && !BN_sub(x, ed->p, x))
+        return 0;
+    return 1;
+}
+
+/* (x1, y1) += (x2, y2) with the unified addition law */
+static int qat_ed_add(const qat_ed_curve_t *curve, qat_ed_ctx_t *ed,
+                      BIGNUM *x1, BIGNUM *y1,
+                      const BIGNUM *x2, const BIGNUM *y2)
+{
+    BIGNUM *xx = NULL, *yy = NULL, *t = NULL, *nx = NULL, *den = NULL;
+
+    xx = BN_CTX_get(ed->ctx);
+    yy = BN_CTX_get(ed->ctx);
+    t = BN_CTX_get(ed->ctx);
+    nx = BN_CTX_get(ed->ctx);
+    den = BN_CTX_get(ed->ctx);
+    if (den == NULL)
+        return 0;
+
+    /* t = d.x1.x2.y1.y2, nx = x1.y2 + y1.x2 */
+    if (!BN_mod_mul(xx, x1, x2, ed->p, ed->ctx) ||
+        !BN_mod_mul(yy, y1, y2, ed->p, ed->ctx) ||
+        !BN_mod_mul(t, xx, yy, ed->p, ed->ctx) ||
+        !BN_mod_mul(t, t, ed->d, ed->p, ed->ctx) ||
+        !BN_mod_mul(nx, x1, y2, ed->p, ed->ctx) ||
+        !BN_mod_mul(den, y1, x2, ed->p, ed->ctx) ||
+        !BN_mod_add(nx, nx, den, ed->p, ed->ctx))
+        return 0;
+
+    /* x3 = nx / (1 + t) */
+    if (!BN_mod_add(den, BN_value_one(), t, ed->p, ed->ctx) ||
+        BN_mod_inverse(den, den, ed->p, ed->ctx) == NULL ||
+        !BN_mod_mul(x1, nx, den, ed->p, ed->ctx))
+        return 0;
+
+    /* y3 = (y1.y2 - a.x1.x2) / (1 - t) */
+    if (!(curve->a < 0 ? BN_mod_add(yy, yy, xx, ed->p, ed->ctx) :
+                         BN_mod_sub(yy, yy, xx, ed->p, ed->ctx)) ||
+        !BN_mod_sub(den, BN_value_one(), t, ed->p, ed->ctx) ||
+        BN_mod_inverse(den, den, ed->p, ed->ctx) == NULL ||
+        !BN_mod_mul(y1, yy, den, ed->p, ed->ctx))
+        return 0;
+    return 1;
+}
+
+/******************************************************************************
+* function:
+*         qat_ed_point_multiply(const qat_ed_curve_t *curve,
+*                               const BIGNUM *k,
+*                               const BIGNUM *x, const BIGNUM *y,
+*                               BIGNUM *rx, BIGNUM *ry,
+*                               int *fallback)
+*
+* @param curve    [IN]  - Edwards curve
+* @param k        [IN]  - Scalar, 0 < k < L
+* @param x, y     [IN]  - Point to multiply, x NULL for the base point
+* @param rx, ry   [OUT] - Product
+* @param fallback [OUT] - Set to 1 if the operation should go to software
+*
+* description:
+*   Multiplies a point of Ed25519 or Ed448 on the accelerator.
+*   Returns 1 on success, 0 on failure.
+******************************************************************************/
+static int qat_ed_point_multiply(const qat_ed_curve_t *curve, const BIGNUM *k,
+                                 const BIGNUM *x, const BIGNUM *y,
+                                 BIGNUM *rx, BIGNUM *ry, int *fallback)
+{
+    CpaCyEcMontEdwdsPointMultiplyOpData opData;
+    CpaFlatBuffer resultX, resultY;
+    int ret = 0;
+
+    memset(&opData, 0, sizeof(opData));
+    memset(&resultX, 0, sizeof(resultX));
+    memset(&resultY, 0, sizeof(resultY));
+
+    opData.curveType = curve->curveType;
+    opData.generator = x == NULL ? CPA_TRUE : CPA_FALSE;
+    opData.k.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+    opData.k.dataLenInBytes = curve->datalen;
+    resultX.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+    resultX.dataLenInBytes = curve->datalen;
+    resultY.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+    resultY.dataLenInBytes = curve->datalen;
+    if (opData.k.pData == NULL || resultX.pData == NULL ||
+        resultY.pData == NULL) {
+        WARN("Failure to allocate the flatbuffers\n");
+        QATerr(QAT_F_QAT_ED_POINT_MULTIPLY, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    if (BN_bn2binpad(k, opData.k.pData, curve->datalen) < 0) {
+        WARN("Failure to convert k to a flatbuffer\n");
+        QATerr(QAT_F_QAT_ED_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    if (x != NULL) {
+        opData.x.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+        opData.x.dataLenInBytes = curve->datalen;
+        opData.y.pData = qaeCryptoMemAlloc(curve->datalen, __FILE__, __LINE__);
+        opData.y.dataLenInBytes = curve->datalen;
+        if (opData.x.pData == NULL || opData.y.pData == NULL) {
+            WARN("Failure to allocate opData.x.pData or opData.y.pData\n");
+            QATerr(QAT_F_QAT_ED_POINT_MULTIPLY, ERR_R_MALLOC_FAILURE);
+            goto err;
+        }
+        if (BN_bn2binpad(x, opData.x.pData, curve->datalen) < 0 ||
+            BN_bn2binpad(y, opData.y.pData, curve->datalen) < 0) {
+            WARN("Failure to convert x or y to a flatbuffer\n");
+            QATerr(QAT_F_QAT_ED_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+    }
+
+    if (!qat_ecx_perform(&opData, &resultX, &resultY, fallback))
+        goto err;
+
+    if (BN_bin2bn(resultX.pData, resultX.dataLenInBytes, rx) == NULL ||
+        BN_bin2bn(resultY.pData, resultY.dataLenInBytes, ry) == NULL) {
+        WARN("Failure to convert the product\n");
+        QATerr(QAT_F_QAT_ED_POINT_MULTIPLY, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    ret = 1;
+
+ err:
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData.k);
+    QAT_CHK_QMFREE_FLATBUFF(opData.x);
+    QAT_CHK_QMFREE_FLATBUFF(opData.y);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(resultX);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(resultY);
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_ed_sign(const qat_ed_curve_t *curve, const qat_ecx_key_t *key,
+*                     unsigned char *sig, const unsigned char *tbs,
+*                     size_t tbslen, int *fallback)
+*
+* @param curve    [IN]  - Edwards curve
+* @param key      [IN]  - Key pair
+* @param sig      [OUT] - Signature R || S, of 2 * keylen bytes
+* @param tbs      [IN]  - Message
+* @param tbslen   [IN]  - Length of the message
+* @param fallback [OUT] - Set to 1 if the operation should go to software
+*
+* description:
+*   Signs as specified by RFC 8032, the point multiplication R = r.B being
+*   done on the accelerator and the scalar arithmetic in software, in
+*   constant time modulo L for the values derived from the private key.
+*   Returns 1 on success, 0 on failure and -1 if software should sign.
+******************************************************************************/
+static int qat_ed_sign(const qat_ed_curve_t *curve, const qat_ecx_key_t *key,
+                       unsigned char *sig, const unsigned char *tbs,
+                       size_t tbslen, int *fallback)
+{
+    unsigned char h[2 * QAT_ECX_MAX_KEYLEN];
+    unsigned char hr[2 * QAT_ECX_MAX_KEYLEN];
+    qat_ed_ctx_t ed = { NULL, NULL, NULL, NULL };
+    BN_MONT_CTX *mont = NULL;
+    BIGNUM *s = NULL, *r = NULL, *k = NULL, *rx = NULL, *ry = NULL;
+    int ret = 0;
+
+    if (!qat_ed_ctx_init(&ed, curve) ||
+        (s = BN_CTX_get(ed.ctx)) == NULL || (r = BN_CTX_get(ed.ctx)) == NULL ||
+        (k = BN_CTX_get(ed.ctx)) == NULL || (rx = BN_CTX_get(ed.ctx)) == NULL ||
+        (ry = BN_CTX_get(ed.ctx)) == NULL ||
+        (mont = BN_MONT_CTX_new()) == NULL ||
+        !BN_MONT_CTX_set(mont, ed.order, ed.ctx)) {
+        WARN("Failure to allocate the BIGNUMs\n");
+        QATerr(QAT_F_QAT_ED_SIGN, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    BN_set_flags(s, BN_FLG_CONSTTIME);
+    BN_set_flags(r, BN_FLG_CONSTTIME);
+    BN_set_flags(k, BN_FLG_CONSTTIME);
+
+    /* Secret scalar s from the first half of H(seed), nonce from the rest */
+    if (!qat_ed_hash(curve, 0, h, key->privkey, curve->keylen,
+                     NULL, 0, NULL, 0)) {
+        WARN("Failure to hash the private key\n");
+        QATerr(QAT_F_QAT_ED_SIGN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    if (curve->nid == EVP_PKEY_ED25519) {
+        h[0] &= 248;
+        h[31] &= 127;
+        h[31] |= 64;
+    } else {
+        h[0] &= 252;
+        h[55] |= 128;
+        h[56] = 0;
+    }
+
+    /* s mod L, r = H(dom || prefix || M) mod L, R = r.B */
+    if (!qat_ed_reduce(&ed, mont, s, h, curve->keylen) ||
+        !qat_ed_hash(curve, 1, hr, h + curve->keylen, curve->keylen,
+                     tbs, tbslen, NULL, 0) ||
+        !qat_ed_reduce(&ed, mont, r, hr, 2 * curve->keylen)) {
+        WARN("Failure to compute the nonce\n");
+        QATerr(QAT_F_QAT_ED_SIGN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    if (BN_is_zero(r)) {
+        ret = -1;
+        goto err;
+    }
+    if (!qat_ed_point_multiply(curve, r, NULL, NULL, rx, ry, fallback))
+        goto err;
+
+    /*
+     * k = H(dom || R || A || M) mod L is public, S = (r + k.s) mod L with
+     * k.s the Montgomery product of k in the Montgomery domain and s.
+     */
+    if (!qat_ed_encode(curve, sig, rx, ry) ||
+        !qat_ed_hash(curve, 1, hr, sig, curve->keylen, key->pubkey,
+                     curve->keylen, tbs, tbslen) ||
+        BN_lebin2bn(hr, 2 * curve->keylen, k) == NULL ||
+        !BN_mod(k, k, ed.order, ed.ctx) ||
+        !BN_to_montgomery(k, k, mont, ed.ctx) ||
+        !BN_mod_mul_montgomery(k, k, s, mont, ed.ctx) ||
+        !BN_mod_add_quick(k, k, r, ed.order) ||
+        BN_bn2lebinpad(k, sig + curve->keylen, curve->keylen) < 0) {
+        WARN("Failure to compute S\n");
+        QATerr(QAT_F_QAT_ED_SIGN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    ret = 1;
+
+ err:
+    OPENSSL_cleanse(h, sizeof(h));
+    OPENSSL_cleanse(hr, sizeof(hr));
+    if (s != NULL)
+        BN_clear(s);
+    if (r != NULL)
+        BN_clear(r);
+    if (k != NULL)
+        BN_clear(k);
+    BN_MONT_CTX_free(mont);
+    qat_ed_ctx_cleanup(&ed);
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_ed_verify(const qat_ed_curve_t *curve, const qat_ecx_key_t *key,
+*                       const unsigned char *sig, const unsigned char *tbs,
+*                       size_t tbslen, int *fallback)
+*
+* @param curve    [IN]  - Edwards curve
+* @param key      [IN]  - Public key
+* @param sig      [IN]  - Signature R || S, of 2 * keylen bytes
+* @param tbs      [IN]  - Message
+* @param tbslen   [IN]  - Length of the message
+* @param fallback [OUT] - Set to 1 if the operation should go to software
+*
+* description:
+*   Checks that the encoding of S.B - k.A is R, as OpenSSL does. The two
+*   point multiplications are done on the accelerator, the point decoding
+*   and addition in software. Returns 1 if the signature is valid, 0 if it
+*   is not and -1 if software should verify.
+******************************************************************************/
+static int qat_ed_verify(const qat_ed_curve_t *curve, const qat_ecx_key_t *key,
+                         const unsigned char *sig, const unsigned char *tbs,
+                         size_t tbslen, int *fallback)
+{
+    unsigned char hk[2 * QAT_ECX_MAX_KEYLEN];
+    unsigned char enc[QAT_ECX_MAX_KEYLEN];
+    qat_ed_ctx_t ed = { NULL, NULL, NULL, NULL };
+    BIGNUM *s = NULL, *k = NULL, *ax = NULL, *ay = NULL;
+    BIGNUM *sx = NULL, *sy = NULL, *kx = NULL, *ky = NULL;
+    int ret = 0;
+
+    if (!qat_ed_ctx_init(&ed, curve) ||
+        (s = BN_CTX_get(ed.ctx)) == NULL || (k = BN_CTX_get(ed.ctx)) == NULL ||
+        (ax = BN_CTX_get(ed.ctx)) == NULL || (ay = BN_CTX_get(ed.ctx)) == NULL ||
+        (sx = BN_CTX_get(ed.ctx)) == NULL || (sy = BN_CTX_get(ed.ctx)) == NULL ||
+        (kx = BN_CTX_get(ed.ctx)) == NULL || (ky = BN_CTX_get(ed.ctx)) == NULL) {
+        WARN("Failure to allocate the BIGNUMs\n");
+        QATerr(QAT_F_QAT_ED_VERIFY, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    /* S must be reduced */
+    if (BN_lebin2bn(sig + curve->keylen, curve->keylen, s) == NULL ||
+        BN_cmp(s, ed.order) >= 0)
+        goto err;
+
+    /* Leave the keys OpenSSL decodes differently to it */
+    if (!qat_ed_decode(curve, &ed, key->pubkey, ax, ay)) {
+        ret = -1;
+        goto err;
+    }
+
+    if (!qat_ed_hash(curve, 1, hk, sig, curve->keylen, key->pubkey,
+                     curve->keylen, tbs, tbslen) ||
+        BN_lebin2bn(hk, 2 * curve->keylen, k) == NULL ||
+        !BN_mod(k, k, ed.order, ed.ctx)) {
+        WARN("Failure to compute k\n");
+        QATerr(QAT_F_QAT_ED_VERIFY, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    /* The accelerator takes scalars between 1 and L - 1 only */
+    if (BN_is_zero(s) || BN_is_zero(k)) {
+        ret = -1;
+        goto err;
+    }
+
+    if (!qat_ed_point_multiply(curve, s, NULL, NULL, sx, sy, fallback) ||
+        !qat_ed_point_multiply(curve, k, ax, ay, kx, ky, fallback))
+        goto err;
+
+    /* S.B + (-k.A), negating x */
+    if ((!BN_is_zero(kx) && !BN_sub(kx, ed.p, kx)) ||
+        !qat_ed_add(curve, &ed, sx, sy, kx, ky) ||
+        !qat_ed_encode(curve, enc, sx, sy)) {
+        WARN("Failure to compute S.B - k.A\n");
+        QATerr(QAT_F_QAT_ED_VERIFY, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    ret = CRYPTO_memcmp(enc, sig, curve->keylen) == 0;
+
+ err:
+    qat_ed_ctx_cleanup(&ed);
+    return ret;
+}
+
+static const qat_ed_curve_t *qat_ed_curve(int nid)
+{
+    return &qat_ed_curves[nid == EVP_PKEY_ED25519 ? 0 : 1];
+}
+
+static const qat_ecx_key_t *qat_ed_get_key(EVP_MD_CTX *ctx)
+{
+    EVP_PKEY *pkey = EVP_PKEY_CTX_get0_pkey(EVP_MD_CTX_pkey_ctx(ctx));
+
+    return pkey != NULL ? EVP_PKEY_get0(pkey) : NULL;
+}
+
+/******************************************************************************
+* function:
+*         qat_ed_digestsign(EVP_MD_CTX *ctx, unsigned char *sig,
+*                           size_t *siglen, const unsigned char *tbs,
+*                           size_t tbslen, int nid)
+*
+* @param ctx    [IN]  - Digest context of the signature
+* @param sig    [OUT] - Signature, or NULL to query its length
+* @param siglen [OUT] - Length of the signature
+* @param tbs    [IN]  - Message
+* @param tbslen [IN]  - Length of the message
+* @param nid    [IN]  - EVP_PKEY_ED25519 or EVP_PKEY_ED448
+*
+* description:
+*   Ed25519 and Ed448 one-shot signature, on the accelerator or in software
+*   when the devices cannot.
+******************************************************************************/
+static int qat_ed_digestsign(EVP_MD_CTX *ctx, unsigned char *sig,
+                             size_t *siglen, const unsigned char *tbs,
+                             size_t tbslen, int nid)
+{
+    const qat_ed_curve_t *curve = qat_ed_curve(nid);
+    int (*sw_sign_fn)(EVP_MD_CTX *, unsigned char *, size_t *,
+                      const unsigned char *, size_t) = NULL;
+    const qat_ecx_key_t *key = NULL;
+    qat_asym_sample_t sample;
+    int fallback = 0, ret = 0;
+
+    DEBUG("- Started\n");
+
+    EVP_PKEY_meth_get_digestsign(
+        (EVP_PKEY_METHOD *)sw_ecx_pmeths[qat_ecx_pmeth_index(nid)],
+        &sw_sign_fn);
+    if (sw_sign_fn == NULL) {
+        WARN("get digestsign failed\n");
+        QATerr(QAT_F_QAT_ED_SIGN, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    if (!qat_ecx_offload()) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_sign_fn)(ctx, sig, siglen, tbs, tbslen);
+    }
+
+    if ((key = qat_ed_get_key(ctx)) == NULL || key->privkey == NULL) {
+        WARN("Missing private key\n");
+        QATerr(QAT_F_QAT_ED_SIGN, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+
+    if (sig == NULL) {
+        *siglen = 2 * curve->keylen;
+        return 1;
+    }
+    if (*siglen < 2 * curve->keylen) {
+        WARN("Signature buffer too small\n");
+        QATerr(QAT_F_QAT_ED_SIGN, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_ECDSA_SIGN, curve->bits)) {
+        ret = (*sw_sign_fn)(ctx, sig, siglen, tbs, tbslen);
+        if (ret)
+            qat_asym_dispatch_end(&sample);
+        return ret;
+    }
+
+    ret = qat_ed_sign(curve, key, sig, tbs, tbslen, &fallback);
+
+    DEBUG("- Finished\n");
+
+    if (ret < 0 || fallback == 1) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_sign_fn)(ctx, sig, siglen, tbs, tbslen);
+    }
+    if (ret) {
+        *siglen = 2 * curve->keylen;
+        qat_asym_dispatch_end(&sample);
+    }
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_ed_digestverify(EVP_MD_CTX *ctx, const unsigned char *sig,
+*                             size_t siglen, const unsigned char *tbs,
+*                             size_t tbslen, int nid)
+*
+* @param ctx    [IN] - Digest context of the verification
+* @param sig    [IN] - Signature
+* @param siglen [IN] - Length of the signature
+* @param tbs    [IN] - Message
+* @param tbslen [IN] - Length of the message
+* @param nid    [IN] - EVP_PKEY_ED25519 or EVP_PKEY_ED448
+*
+* description:
+*   Ed25519 and Ed448 one-shot verification, on the accelerator or in
+*   software when the devices cannot. Returns 1 if the signature is valid.
+******************************************************************************/
+static int qat_ed_digestverify(EVP_MD_CTX *ctx, const unsigned char *sig,
+                               size_t siglen, const unsigned char *tbs,
+                               size_t tbslen, int nid)
+{
+    const qat_ed_curve_t *curve = qat_ed_curve(nid);
+    int (*sw_verify_fn)(EVP_MD_CTX *, const unsigned char *, size_t,
+                        const unsigned char *, size_t) = NULL;
+    const qat_ecx_key_t *key = NULL;
+    qat_asym_sample_t sample;
+    int fallback = 0, ret = 0;
+
+    DEBUG("- Started\n");
+
+    EVP_PKEY_meth_get_digestverify(
+        (EVP_PKEY_METHOD *)sw_ecx_pmeths[qat_ecx_pmeth_index(nid)],
+        &sw_verify_fn);
+    if (sw_verify_fn == NULL) {
+        WARN("get digestverify failed\n");
+        QATerr(QAT_F_QAT_ED_VERIFY, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    if (!qat_ecx_offload()) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_verify_fn)(ctx, sig, siglen, tbs, tbslen);
+    }
+
+    if ((key = qat_ed_get_key(ctx)) == NULL) {
+        WARN("Missing public key\n");
+        QATerr(QAT_F_QAT_ED_VERIFY, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+
+    if (siglen != 2 * curve->keylen)
+        return 0;
+
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_ECDSA_VERIFY,
+                                 curve->bits)) {
+        ret = (*sw_verify_fn)(ctx, sig, siglen, tbs, tbslen);
+        if (ret >= 0)
+            qat_asym_dispatch_end(&sample);
+        return ret;
+    }
+
+    ret = qat_ed_verify(curve, key, sig, tbs, tbslen, &fallback);
+
+    DEBUG("- Finished\n");
+
+    if (ret < 0 || fallback == 1) {
+        DEBUG("- Switched to software mode\n");
+        return (*sw_verify_fn)(ctx, sig, siglen, tbs, tbslen);
+    }
+    qat_asym_dispatch_end(&sample);
+    return ret;
+}
+
+static int qat_ed25519_digestsign(EVP_MD_CTX *ctx, unsigned char *sig,
+                                  size_t *siglen, const unsigned char *tbs,
+                                  size_t tbslen)
+{
+    return qat_ed_digestsign(ctx, sig, siglen, tbs, tbslen, EVP_PKEY_ED25519);
+}
+
+static int qat_ed448_digestsign(EVP_MD_CTX *ctx, unsigned char *sig,
+                                size_t *siglen, const unsigned char *tbs,
+                                size_t tbslen)
+{
+    return qat_ed_digestsign(ctx, sig, siglen, tbs, tbslen, EVP_PKEY_ED448);
+}
+
+static int qat_ed25519_digestverify(EVP_MD_CTX *ctx, const unsigned char *sig,
+                                    size_t siglen, const unsigned char *tbs,
+                                    size_t tbslen)
+{
+    return qat_ed_digestverify(ctx, sig, siglen, tbs, tbslen,
+                               EVP_PKEY_ED25519);
+}
+
+static int qat_ed448_digestverify(EVP_MD_CTX *ctx, const unsigned char *sig,
+                                  size_t siglen, const unsigned char *tbs,
+                                  size_t tbslen)
+{
+    return qat_ed_digestverify(ctx, sig, siglen, tbs, tbslen, EVP_PKEY_ED448);
+}
+#endif
+
+#if defined(QAT_ECX_ENABLED) && \
+    (!defined(OPENSSL_DISABLE_QAT_ECDH) || !defined(OPENSSL_DISABLE_QAT_ECDSA))
+/******************************************************************************
+* function:
+*         qat_ecx_pmeth(int nid)
+*
+* @param nid [IN] - EVP_PKEY_X25519, EVP_PKEY_X448, EVP_PKEY_ED25519 or
+*                   EVP_PKEY_ED448
+*
+* description:
+*   Returns the EVP_PKEY_METHOD of the engine for the nid, a copy of the
+*   software method whose key derivation and key generation, or signature
+*   and verification, are offloaded. Whether the devices support these
+*   curves is only known once the engine is initialized, so each operation
+*   checks it and falls back to the software method otherwise.
+******************************************************************************/
+EVP_PKEY_METHOD *qat_ecx_pmeth(int nid)
+{
+    int idx = qat_ecx_pmeth_index(nid);
+
+    if (idx < 0)
+        return NULL;
+    if (qat_ecx_pmeths[idx] != NULL)
+        return qat_ecx_pmeths[idx];
+
+    if ((sw_ecx_pmeths[idx] = EVP_PKEY_meth_find(nid)) == NULL ||
+        (qat_ecx_pmeths[idx] =
+         EVP_PKEY_meth_new(nid, nid == EVP_PKEY_ED25519 ||
+                                nid == EVP_PKEY_ED448 ?
+                                EVP_PKEY_FLAG_SIGCTX_CUSTOM : 0)) == NULL) {
+        WARN("Failure to allocate the EVP_PKEY_METHOD\n");
+        QATerr(QAT_F_QAT_ECX_PMETH, ERR_R_INTERNAL_ERROR);
+        return NULL;
+    }
+
+    EVP_PKEY_meth_copy(qat_ecx_pmeths[idx], sw_ecx_pmeths[idx]);
+    switch (nid) {
+#ifndef OPENSSL_DISABLE_QAT_ECDH
+    case EVP_PKEY_X25519:
+        EVP_PKEY_meth_set_keygen(qat_ecx_pmeths[idx], NULL, qat_x25519_keygen);
+        EVP_PKEY_meth_set_derive(qat_ecx_pmeths[idx], NULL, qat_x25519_derive);
+        break;
+    case EVP_PKEY_X448:
+        EVP_PKEY_meth_set_keygen(qat_ecx_pmeths[idx], NULL, qat_x448_keygen);
+        EVP_PKEY_meth_set_derive(qat_ecx_pmeths[idx], NULL, qat_x448_derive);
+        break;
+#endif
+#ifndef OPENSSL_DISABLE_QAT_ECDSA
+    case EVP_PKEY_ED25519:
+        EVP_PKEY_meth_set_digestsign(qat_ecx_pmeths[idx],
+                                     qat_ed25519_digestsign);
+        EVP_PKEY_meth_set_digestverify(qat_ecx_pmeths[idx],
+                                       qat_ed25519_digestverify);
+        break;
+    case EVP_PKEY_ED448:
+        EVP_PKEY_meth_set_digestsign(qat_ecx_pmeths[idx],
+                                     qat_ed448_digestsign);
+        EVP_PKEY_meth_set_digestverify(qat_ecx_pmeths[idx],
+                                       qat_ed448_digestverify);
+        break;
+#endif
+    default:
+        break;
+    }
+    return qat_ecx_pmeths[idx];
+}
+
+static void qat_ecx_pmeths_free(void)
+{
+    int i = 0;
+
+    for (i = 0; i < QAT_ECX_NUM_PMETHS; i++) {
+        EVP_PKEY_meth_free(qat_ecx_pmeths[i]);
+        qat_ecx_pmeths[i] = NULL;
+        sw_ecx_pmeths[i] = NULL;
+    }
+}
+#endif /* QAT_ECX_ENABLED */
+
+#ifndef OPENSSL_DISABLE_QAT_ECDSA
+/* Callback to indicate QAT completion of ECDSA Sign */
+static void qat_ecdsaSignCallbackFn(void *pCallbackTag, CpaStatus status,
+                                    void *pOpData, CpaBoolean bEcdsaSignStatus,
+                                    CpaFlatBuffer * pResultR,
+                                    CpaFlatBuffer * pResultS)
+{
+    if (enable_heuristic_polling) {
+        QAT_ATOMIC_DEC(num_asym_requests_in_flight);
+    }
+    qat_crypto_callbackFn(pCallbackTag, status, CPA_CY_SYM_OP_CIPHER, pOpData,
+                          NULL, bEcdsaSignStatus);
+}
+
+/* Callback to indicate QAT completion of ECDSA Verify */
+static void qat_ecdsaVerifyCallbackFn(void *pCallbackTag, CpaStatus status,
+                                      void *pOpData, CpaBoolean bEcdsaVerifyStatus)
+{
+    if (enable_heuristic_polling) {
+        QAT_ATOMIC_DEC(num_asym_requests_in_flight);
+    }
+    qat_crypto_callbackFn(pCallbackTag, status, CPA_CY_SYM_OP_CIPHER, pOpData,
+                          NULL, bEcdsaVerifyStatus);
+}
+
+/* Per request state of a batch of ECDSA verify operations */
+typedef struct {
+    CpaCyEcdsaVerifyOpData *opData;
+    const qat_ec_curve_t *curve;
+    op_done_rsa_crt_t *op_done;
+    CpaStatus status;
+    CpaBoolean verifyStatus;
+    qat_asym_sample_t sample;
+    int dispatched;
+    int batched;
+} qat_ecdsa_batch_op_t;
+
+/*
+ * Callback of each of the requests of a batch of ECDSA verify operations.
+ * An invalid signature is a result of its own request only, so the status of
+ * each request is recorded rather than folded into the batch. The response
+ * count is updated last as the requesting thread may release the batch as
+ * soon as it sees all the responses.
+ */
+static void qat_ecdsaVerifyBatchCallbackFn(void *pCallbackTag, CpaStatus status,
+                                           void *pOpData,
+                                           CpaBoolean bEcdsaVerifyStatus)
+{
+    qat_ecdsa_batch_op_t *op = (qat_ecdsa_batch_op_t *)pCallbackTag;
+    op_done_rsa_crt_t *op_done = op->op_done;
+    ASYNC_JOB *job = (ASYNC_JOB *)op_done->opDone.job;
+    unsigned int num_reqs = op_done->num_reqs;
+
+    if (enable_heuristic_polling) {
+        QAT_ATOMIC_DEC(num_asym_requests_in_flight);
+    }
+
+    op->verifyStatus = bEcdsaVerifyStatus;
+    op->status = status;
+
+    if (QAT_ATOMIC_INC(op_done->resp) == num_reqs && job != NULL)
+        qat_wake_job(job, ASYNC_STATUS_OK);
+}
+
+
+#ifndef OPENSSL_DISABLE_QAT_ECDH
+static void qat_ecdsa_nonce_free(void *item)
+{
+    qat_ecdsa_nonce_t *nonce = (qat_ecdsa_nonce_t *)item;
+
+    if (nonce == NULL)
+        return;
+    BN_clear_free(nonce->kinv);
+    BN_clear_free(nonce->r);
+    OPENSSL_free(nonce);
+}
+
+/******************************************************************************
+* function:
+*         qat_ecdsa_nonce_new(void *ctx_eckey)
+*
+* @param ctx_eckey [IN] - EC_KEY of the curve of the pool
+*
+* description:
+*   Generates a random k and computes r = x(kG) mod n with a point multiply
+*   on the accelerator, then k^-1 mod n in constant time on core. Run by the
+*   pool refill thread.
+******************************************************************************/
+static void *qat_ecdsa_nonce_new(void *ctx_eckey)
+{
+    EC_KEY *eckey = NULL;
+    const EC_GROUP *group = EC_KEY_get0_group((const EC_KEY *)ctx_eckey);
+    qat_ecdsa_nonce_t *nonce = NULL;
+    BN_CTX *ctx = NULL;
+    BIGNUM *k = NULL, *x = NULL, *order = NULL;
+    unsigned char *xbuf = NULL;
+    size_t xlen = 0;
+    int fallback = 0, ok = 0;
+
+    if ((nonce = OPENSSL_zalloc(sizeof(qat_ecdsa_nonce_t))) == NULL ||
+        (nonce->kinv = BN_new()) == NULL ||
+        (nonce->r = BN_new()) == NULL ||
+        (ctx = BN_CTX_new()) == NULL) {
+        WARN("Failed to allocate the nonce\n");
+        goto err;
+    }
+
+    BN_CTX_start(ctx);
+    k = BN_CTX_get(ctx);
+    x = BN_CTX_get(ctx);
+    order = BN_CTX_get(ctx);
+    if (order == NULL || !EC_GROUP_get_order(group, order, ctx)) {
+        WARN("Failed to get the order\n");
+        goto err;
+    }
+    BN_set_flags(k, BN_FLG_CONSTTIME);
+
+    do {
+        do
+            if (!BN_rand_range(k, order)) {
+                WARN("Failure to get random number k\n");
+                goto err;
+            }
+        while (BN_is_zero(k));
+
+        /* k is cleared along with its key as soon as kG is known */
+        if ((eckey = qat_ec_pool_key_new(ctx_eckey, k)) == NULL ||
+            qat_ecdh_compute_key(&xbuf, &xlen, NULL, NULL,
+                                 EC_GROUP_get0_generator(group),
+                                 eckey, &fallback) <= 0 ||
+            fallback) {
+            WARN("Failed to compute kG\n");
+            goto err;
+        }
+        EC_KEY_free(eckey);
+        eckey = NULL;
+        if (BN_bin2bn(xbuf, xlen, x) == NULL ||
+            !BN_nnmod(nonce->r, x, order, ctx)) {
+            WARN("Failed to compute r\n");
+            goto err;
+        }
+        OPENSSL_clear_free(xbuf, xlen);
+        xbuf = NULL;
+    } while (BN_is_zero(nonce->r));
+
+    if (BN_mod_inverse(nonce->kinv, k, order, ctx) == NULL) {
+        WARN("Failed to compute k^-1\n");
+        goto err;
+    }
+    ok = 1;
+
+err:
+    OPENSSL_clear_free(xbuf, xlen);
+    EC_KEY_free(eckey);
+    if (ctx != NULL) {
+        BN_CTX_end(ctx);
+        BN_CTX_free(ctx);
+    }
+    if (!ok) {
+        /* The pool retries on a later draw, leave no error behind */
+        ERR_clear_error();
+        qat_ecdsa_nonce_free(nonce);
+        nonce = NULL;
+    }
+    return nonce;
+}
+#endif
+
+
+int qat_ecdsa_sign(int type, const unsigned char *dgst, int dlen,
+                   unsigned char *sig, unsigned int *siglen,
+                   const BIGNUM *kinv, const BIGNUM *r, EC_KEY *eckey)
+{
+    ECDSA_SIG *s;
+
+    if (unlikely(dgst == NULL ||
+                 dlen <= 0)) { /* Check these input params before passing to
+                                * RAND_seed(). Rest of the input params. are
+                                * checked by qat_ecdsa_do_sign().
+                                */
+        WARN("Invalid input param.\n");
+        if (siglen != NULL)
+            *siglen = 0;
+        QATerr(QAT_F_QAT_ECDSA_SIGN, QAT_R_INPUT_PARAM_INVALID);
+        return 0;
+    }
+    s = qat_ecdsa_do_sign(dgst, dlen, kinv, r, eckey);
+    if (s == NULL) {
+        WARN("Error ECDSA Sign Operation Failed\n");
+        if (siglen != NULL)
+            *siglen = 0;
+        QATerr(QAT_F_QAT_ECDSA_SIGN, QAT_R_QAT_ECDSA_DO_SIGN_FAIL);
+        return 0;
+    }
+    *siglen = i2d_ECDSA_SIG(s, &sig);
+    ECDSA_SIG_free(s);
+    return 1;
+}
+
+
+ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
+                             const BIGNUM *in_kinv, const BIGNUM *in_r,
+                             EC_KEY *eckey)
+{
+    int ok = 0, i, job_ret = 0, fallback = 0;
+    BIGNUM *m = NULL, *order = NULL;
+    BN_CTX *ctx = NULL;
+    const EC_GROUP *group;
+    ECDSA_SIG *ret = NULL;
+    BIGNUM *ecdsa_sig_r = NULL, *ecdsa_sig_s = NULL;
+    const BIGNUM *priv_key;
+    BIGNUM *p = NULL, *a = NULL, *b = NULL, *k = NULL;
+    BIGNUM *xg = NULL, *yg = NULL;
+    const EC_POINT *pub_key = NULL;
     PFUNC_SIGN_SIG sign_sig_pfunc = NULL;
 
     CpaFlatBuffer *pResultR = NULL;
@@ -1039,6 +3028,11 @@ ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
     int iMsgRetry = getQatMsgRetryCount();
     const EC_POINT *ec_point = NULL;
     thread_local_variables_t *tlv = NULL;
+    qat_asym_sample_t sample;
+    const qat_ec_curve_t *curve = NULL;
+#ifndef OPENSSL_DISABLE_QAT_ECDH
+    qat_ecdsa_nonce_t *nonce = NULL;
+#endif
 
     DEBUG("- Started\n");
 
@@ -1079,6 +3073,34 @@ ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
         return ret;
     }
 
+    /*
+     * With k^-1 and r already computed only s = k^-1 (m + d * r) mod n is
+     * left, a few modular multiplications that are cheaper on core than a
+     * round trip to the accelerator.
+     */
+    if (in_kinv != NULL && in_r != NULL)
+        return (*sign_sig_pfunc)(dgst, dgst_len, in_kinv, in_r, eckey);
+
+#ifndef OPENSSL_DISABLE_QAT_ECDH
+    if ((nonce = qat_ec_pool_get(QAT_EC_POOL_ECDSA_NONCE, group)) != NULL) {
+        /* A nonce giving s == 0 is rejected, sign from scratch instead */
+        ERR_set_mark();
+        ret = (*sign_sig_pfunc)(dgst, dgst_len, nonce->kinv, nonce->r, eckey);
+        qat_ecdsa_nonce_free(nonce);
+        ERR_pop_to_mark();
+        if (ret != NULL)
+            return ret;
+    }
+#endif
+
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_ECDSA_SIGN,
+                                 EC_GROUP_get_degree(group))) {
+        ret = (*sign_sig_pfunc)(dgst, dgst_len, in_kinv, in_r, eckey);
+        if (ret != NULL)
+            qat_asym_dispatch_end(&sample);
+        return ret;
+    }
+
     opData = (CpaCyEcdsaSignRSOpData *)
         OPENSSL_malloc(sizeof(CpaCyEcdsaSignRSOpData));
     if (opData == NULL) {
@@ -1154,24 +3176,34 @@ ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
 
     opData->fieldType = qat_get_field_type(group);
 
-    if (!qat_get_curve(group, p, a, b, ctx, opData->fieldType)) {
-       QATerr(QAT_F_QAT_ECDSA_DO_SIGN, ERR_R_INTERNAL_ERROR);
-       goto err;
-    }
+    /* Named curves share their pinned constants from the curve cache */
+    if ((curve = qat_ec_get_cached_curve(group)) != NULL) {
+        opData->xg = curve->xg;
+        opData->yg = curve->yg;
+        opData->a = curve->a;
+        opData->b = curve->b;
+        opData->q = curve->p;
+    } else {
+        if (!qat_get_curve(group, p, a, b, ctx, opData->fieldType)) {
+           QATerr(QAT_F_QAT_ECDSA_DO_SIGN, ERR_R_INTERNAL_ERROR);
+           goto err;
+        }
 
-    if (!qat_get_affine_coordinates(group, ec_point, xg, yg, ctx,
-                                    opData->fieldType)) {
-       QATerr(QAT_F_QAT_ECDSA_DO_SIGN, ERR_R_INTERNAL_ERROR);
-       goto err;
+        if (!qat_get_affine_coordinates(group, ec_point, xg, yg, ctx,
+                                        opData->fieldType)) {
+           QATerr(QAT_F_QAT_ECDSA_DO_SIGN, ERR_R_INTERNAL_ERROR);
+           goto err;
+        }
     }
 
     if (qat_BN_to_FB(&(opData->d), (BIGNUM *)priv_key) != 1 ||
         qat_BN_to_FB(&(opData->m), m) != 1 ||
-        qat_BN_to_FB(&(opData->xg), xg) != 1 ||
-        qat_BN_to_FB(&(opData->yg), yg) != 1 ||
-        qat_BN_to_FB(&(opData->a), a) != 1 ||
-        qat_BN_to_FB(&(opData->b), b) != 1 ||
-        qat_BN_to_FB(&(opData->q), p) != 1) {
+        (curve == NULL &&
+         (qat_BN_to_FB(&(opData->xg), xg) != 1 ||
+          qat_BN_to_FB(&(opData->yg), yg) != 1 ||
+          qat_BN_to_FB(&(opData->a), a) != 1 ||
+          qat_BN_to_FB(&(opData->b), b) != 1 ||
+          qat_BN_to_FB(&(opData->q), p) != 1))) {
         WARN("Failed to convert d, m, xg, yg, a, b or p to a flatbuffer\n");
         QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_PRIV_KEY_M_XG_YG_A_B_P_CONVERT_TO_FB_FAILURE);
         goto err;
@@ -1194,40 +3226,26 @@ ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
         opData->a.pData[0] = 0;
     }
 
-    if (in_kinv == NULL || in_r == NULL) {
-        do
-            if (!BN_rand_range(k, order)) {
-                WARN("Failure to get random number k\n");
-                QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_K_RAND_GENERATE_FAILURE);
-                goto err;
-            }
-        while (BN_is_zero(k));
-
-        if ((qat_BN_to_FB(&(opData->k), k)) != 1) {
-            WARN("Failed to convert k to a flatbuffer\n");
-            QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_K_CONVERT_TO_FB_FAILURE);
-            goto err;
-        }
-
-        if ((qat_BN_to_FB(&(opData->n), order)) != 1) {
-            WARN("Failed to convert order to a flatbuffer\n");
-            QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_K_ORDER_CONVERT_TO_FB_FAILURE);
-            goto err;
-        }
-
-    } else {
-        if ((qat_BN_to_FB(&(opData->k), (BIGNUM *)in_kinv)) != 1) {
-            WARN("Failed to convert in_kinv to a flatbuffer\n");
-            QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_IN_KINV_CONVERT_TO_FB_FAILURE);
+    do
+        if (!BN_rand_range(k, order)) {
+            WARN("Failure to get random number k\n");
+            QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_K_RAND_GENERATE_FAILURE);
             goto err;
         }
+    while (BN_is_zero(k));
 
-        if ((qat_BN_to_FB(&(opData->n), (BIGNUM *)in_r)) != 1) {
-            WARN("Failed to convert in_r to a flatbuffer\n");
-            QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_IN_R_CONVERT_TO_FB_FAILURE);
-            goto err;
-        }
+    if ((qat_BN_to_FB(&(opData->k), k)) != 1) {
+        WARN("Failed to convert k to a flatbuffer\n");
+        QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_K_CONVERT_TO_FB_FAILURE);
+        goto err;
+    }
 
+    if (curve != NULL) {
+        opData->n = curve->order;
+    } else if ((qat_BN_to_FB(&(opData->n), order)) != 1) {
+        WARN("Failed to convert order to a flatbuffer\n");
+        QATerr(QAT_F_QAT_ECDSA_DO_SIGN, QAT_R_K_ORDER_CONVERT_TO_FB_FAILURE);
+        goto err;
     }
 
     buflen = EC_GROUP_get_degree(group);
@@ -1428,13 +3446,15 @@ ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
     }
 
     if (opData) {
-        QAT_CHK_QMFREE_FLATBUFF(opData->n);
         QAT_CHK_QMFREE_FLATBUFF(opData->m);
-        QAT_CHK_QMFREE_FLATBUFF(opData->xg);
-        QAT_CHK_QMFREE_FLATBUFF(opData->yg);
-        QAT_CHK_QMFREE_FLATBUFF(opData->a);
-        QAT_CHK_QMFREE_FLATBUFF(opData->b);
-        QAT_CHK_QMFREE_FLATBUFF(opData->q);
+        if (curve == NULL) {
+            QAT_CHK_QMFREE_FLATBUFF(opData->n);
+            QAT_CHK_QMFREE_FLATBUFF(opData->xg);
+            QAT_CHK_QMFREE_FLATBUFF(opData->yg);
+            QAT_CHK_QMFREE_FLATBUFF(opData->a);
+            QAT_CHK_QMFREE_FLATBUFF(opData->b);
+            QAT_CHK_QMFREE_FLATBUFF(opData->q);
+        }
         QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData->k);
         QAT_CHK_CLNSE_QMFREE_FLATBUFF(opData->d);
         OPENSSL_free(opData);
@@ -1450,6 +3470,8 @@ ECDSA_SIG *qat_ecdsa_do_sign(const unsigned char *dgst, int dgst_len,
         CRYPTO_QAT_LOG("Resubmitting request to SW - %s\n", __func__);
         return (*sign_sig_pfunc)(dgst, dgst_len, in_kinv, in_r, eckey);
     }
+    if (ret != NULL)
+        qat_asym_dispatch_end(&sample);
     DEBUG("- Finished\n");
     return ret;
 }
@@ -1496,70 +3518,85 @@ int qat_ecdsa_verify(int type, const unsigned char *dgst, int dgst_len,
 }
 
 
-int qat_ecdsa_do_verify(const unsigned char *dgst, int dgst_len,
-                        const ECDSA_SIG *sig, EC_KEY *eckey)
+/******************************************************************************
+* function:
+*         qat_ecdsa_verify_op_free(CpaCyEcdsaVerifyOpData *opData,
+*                                  const qat_ec_curve_t *curve)
+*
+* @param opData [IN] - request built by qat_ecdsa_verify_op_new
+* @param curve  [IN] - cached curve the request shares its constants with
+*
+* description:
+*   Releases a request built by qat_ecdsa_verify_op_new. The curve constants
+*   belong to the curve cache when curve is not NULL and are left alone.
+******************************************************************************/
+static void qat_ecdsa_verify_op_free(CpaCyEcdsaVerifyOpData *opData,
+                                     const qat_ec_curve_t *curve)
+{
+    if (opData == NULL)
+        return;
+
+    QAT_CHK_QMFREE_FLATBUFF(opData->r);
+    QAT_CHK_QMFREE_FLATBUFF(opData->s);
+    QAT_CHK_QMFREE_FLATBUFF(opData->m);
+    if (curve == NULL) {
+        QAT_CHK_QMFREE_FLATBUFF(opData->n);
+        QAT_CHK_QMFREE_FLATBUFF(opData->xg);
+        QAT_CHK_QMFREE_FLATBUFF(opData->yg);
+        QAT_CHK_QMFREE_FLATBUFF(opData->a);
+        QAT_CHK_QMFREE_FLATBUFF(opData->b);
+        QAT_CHK_QMFREE_FLATBUFF(opData->q);
+    }
+    QAT_CHK_QMFREE_FLATBUFF(opData->xp);
+    QAT_CHK_QMFREE_FLATBUFF(opData->yp);
+    OPENSSL_free(opData);
+}
+
+/******************************************************************************
+* function:
+*         qat_ecdsa_verify_op_new(const unsigned char *dgst, int dgst_len,
+*                                 const ECDSA_SIG *sig, EC_KEY *eckey,
+*                                 CpaCyEcdsaVerifyOpData **pOpData,
+*                                 const qat_ec_curve_t **pCurve)
+*
+* @param dgst     [IN]  - digest the signature is over
+* @param dgst_len [IN]  - length of the digest
+* @param sig      [IN]  - signature to verify
+* @param eckey    [IN]  - public key, its group and public key must be set
+* @param pOpData  [OUT] - cpaCyEcdsaVerify request
+* @param pCurve   [OUT] - cached curve the request shares its constants with
+*
+* description:
+*   Builds the cpaCyEcdsaVerify request of a signature. Returns 1 on
+*   success, 0 if r or s are out of range, the signature being invalid, and
+*   -1 on error. Nothing is returned in pOpData unless 1 is returned.
+******************************************************************************/
+static int qat_ecdsa_verify_op_new(const unsigned char *dgst, int dgst_len,
+                                   const ECDSA_SIG *sig, EC_KEY *eckey,
+                                   CpaCyEcdsaVerifyOpData **pOpData,
+                                   const qat_ec_curve_t **pCurve)
 {
-    int ret = -1, i, job_ret = 0, fallback = 0;
+    int ret = -1, i;
     BN_CTX *ctx = NULL;
     BIGNUM *order = NULL, *m = NULL;
-    const EC_GROUP *group;
-    const EC_POINT *pub_key;
+    const EC_GROUP *group = EC_KEY_get0_group(eckey);
+    const EC_POINT *pub_key = EC_KEY_get0_public_key(eckey);
     BIGNUM *p = NULL, *a = NULL, *b = NULL;
     BIGNUM *xg = NULL, *yg = NULL, *xp = NULL, *yp = NULL;
-    const EC_POINT *ec_point;
+    const EC_POINT *ec_point = EC_GROUP_get0_generator(group);
     const BIGNUM *sig_r = NULL, *sig_s = NULL;
-    PFUNC_VERIFY_SIG verify_sig_pfunc = NULL;
-
-    int inst_num = QAT_INVALID_INSTANCE;
     CpaCyEcdsaVerifyOpData *opData = NULL;
-    CpaBoolean bEcdsaVerifyStatus;
-    CpaStatus status;
-    op_done_t op_done;
-    int qatPerformOpRetries = 0;
-    useconds_t ulPollInterval = getQatPollInterval();
-    int iMsgRetry = getQatMsgRetryCount();
-    thread_local_variables_t *tlv = NULL;
-
-    DEBUG("- Started\n");
-    if (unlikely(dgst == NULL || dgst_len <= 0)) {
-        WARN("Invalid input param.\n");
-        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_INPUT_PARAM_INVALID);
-        return ret;
-    }
-
-    EC_KEY_METHOD_get_verify((EC_KEY_METHOD *) EC_KEY_OpenSSL(),
-                             NULL, &verify_sig_pfunc);
-    if (verify_sig_pfunc == NULL) {
-        WARN("verify_sig_pfunc is NULL\n");
-        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_SW_GET_VERIFY_SIG_PFUNC_NULL);
-        return ret;
-    }
-
-    if (qat_get_qat_offload_disabled()) {
-        DEBUG("- Switched to software mode\n");
-        return (*verify_sig_pfunc)(dgst, dgst_len, sig, eckey);
-    }
+    const qat_ec_curve_t *curve = NULL;
 
-    /* check input values */
-    if (eckey == NULL || (group = EC_KEY_get0_group(eckey)) == NULL ||
-        (pub_key = EC_KEY_get0_public_key(eckey)) == NULL || sig == NULL) {
-        WARN("eckey, group, pub_key or sig are NULL\n");
-        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_ECKEY_GROUP_PUBKEY_SIG_NULL);
-        return ret;
-    }
-
-    if ((ec_point = EC_GROUP_get0_generator(group)) == NULL) {
-        WARN("Failure to retrieve ec_point\n");
-        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_RETRIEVE_EC_POINT_FAILURE);
-        return ret;
-    }
+    *pOpData = NULL;
+    *pCurve = NULL;
 
     opData = (CpaCyEcdsaVerifyOpData *)
         OPENSSL_malloc(sizeof(CpaCyEcdsaVerifyOpData));
     if (opData == NULL) {
         WARN("Failure to allocate opData\n");
         QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_OPDATA_MALLOC_FAILURE);
-        return ret;
+        return -1;
     }
 
     memset(opData, 0, sizeof(CpaCyEcdsaVerifyOpData));
@@ -1627,15 +3664,25 @@ int qat_ecdsa_do_verify(const unsigned char *dgst, int dgst_len,
 
     opData->fieldType = qat_get_field_type(group);
 
-    if (!qat_get_curve(group, p, a, b, ctx, opData->fieldType)) {
-       QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, ERR_R_INTERNAL_ERROR);
-       goto err;
-    }
+    /* Named curves share their pinned constants from the curve cache */
+    if ((curve = qat_ec_get_cached_curve(group)) != NULL) {
+        opData->xg = curve->xg;
+        opData->yg = curve->yg;
+        opData->a = curve->a;
+        opData->b = curve->b;
+        opData->q = curve->p;
+        opData->n = curve->order;
+    } else {
+        if (!qat_get_curve(group, p, a, b, ctx, opData->fieldType)) {
+           QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, ERR_R_INTERNAL_ERROR);
+           goto err;
+        }
 
-    if (!qat_get_affine_coordinates(group, ec_point, xg, yg, ctx,
-                                    opData->fieldType)) {
-       QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, ERR_R_INTERNAL_ERROR);
-       goto err;
+        if (!qat_get_affine_coordinates(group, ec_point, xg, yg, ctx,
+                                        opData->fieldType)) {
+           QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, ERR_R_INTERNAL_ERROR);
+           goto err;
+        }
     }
 
     if (!qat_get_affine_coordinates(group, pub_key, xp, yp, ctx,
@@ -1645,12 +3692,13 @@ int qat_ecdsa_do_verify(const unsigned char *dgst, int dgst_len,
     }
 
     if ((qat_BN_to_FB(&(opData->m), m) != 1) ||
-        (qat_BN_to_FB(&(opData->xg), xg) != 1) ||
-        (qat_BN_to_FB(&(opData->yg), yg) != 1) ||
-        (qat_BN_to_FB(&(opData->a), a) != 1) ||
-        (qat_BN_to_FB(&(opData->b), b) != 1) ||
-        (qat_BN_to_FB(&(opData->q), p) != 1) ||
-        (qat_BN_to_FB(&(opData->n), order) != 1) ||
+        (curve == NULL &&
+         ((qat_BN_to_FB(&(opData->xg), xg) != 1) ||
+          (qat_BN_to_FB(&(opData->yg), yg) != 1) ||
+          (qat_BN_to_FB(&(opData->a), a) != 1) ||
+          (qat_BN_to_FB(&(opData->b), b) != 1) ||
+          (qat_BN_to_FB(&(opData->q), p) != 1) ||
+          (qat_BN_to_FB(&(opData->n), order) != 1))) ||
         (qat_BN_to_FB(&(opData->r), (BIGNUM *)sig_r) != 1) ||
         (qat_BN_to_FB(&(opData->s), (BIGNUM *)sig_s) != 1) ||
         (qat_BN_to_FB(&(opData->xp), xp) != 1) ||
@@ -1679,6 +3727,109 @@ int qat_ecdsa_do_verify(const unsigned char *dgst, int dgst_len,
         opData->a.pData[0] = 0;
     }
 
+    *pOpData = opData;
+    *pCurve = curve;
+    opData = NULL;
+    ret = 1;
+
+ err:
+    qat_ecdsa_verify_op_free(opData, curve);
+    if (ctx) {
+        BN_CTX_end(ctx);
+        BN_CTX_free(ctx);
+    }
+    return ret;
+}
+
+/******************************************************************************
+* function:
+*         qat_ecdsa_do_verify_int(const unsigned char *dgst, int dgst_len,
+*                                 const ECDSA_SIG *sig, EC_KEY *eckey,
+*                                 qat_asym_sample_t *sample)
+*
+* @param dgst     [IN] - digest to be verified
+* @param dgst_len [IN] - length of the digest
+* @param sig      [IN] - signature to verify
+* @param eckey    [IN] - EC key
+* @param sample   [IN] - dispatch decision already taken for this request,
+*                        or NULL to take it here
+*
+* description:
+*   Performs an ECDSA verify on the path chosen by qat_asym_dispatch_begin.
+*   The batch passes down the decision it took for a request so that the
+*   request is neither dispatched nor sampled twice.
+******************************************************************************/
+static int qat_ecdsa_do_verify_int(const unsigned char *dgst, int dgst_len,
+                                   const ECDSA_SIG *sig, EC_KEY *eckey,
+                                   qat_asym_sample_t *sample)
+{
+    int ret = -1, job_ret = 0, fallback = 0;
+    const EC_GROUP *group;
+    PFUNC_VERIFY_SIG verify_sig_pfunc = NULL;
+
+    int inst_num = QAT_INVALID_INSTANCE;
+    CpaCyEcdsaVerifyOpData *opData = NULL;
+    CpaBoolean bEcdsaVerifyStatus;
+    CpaStatus status;
+    op_done_t op_done;
+    int qatPerformOpRetries = 0;
+    useconds_t ulPollInterval = getQatPollInterval();
+    int iMsgRetry = getQatMsgRetryCount();
+    thread_local_variables_t *tlv = NULL;
+    qat_asym_sample_t local_sample;
+    const qat_ec_curve_t *curve = NULL;
+
+    DEBUG("- Started\n");
+    if (unlikely(dgst == NULL || dgst_len <= 0)) {
+        WARN("Invalid input param.\n");
+        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_INPUT_PARAM_INVALID);
+        return ret;
+    }
+
+    EC_KEY_METHOD_get_verify((EC_KEY_METHOD *) EC_KEY_OpenSSL(),
+                             NULL, &verify_sig_pfunc);
+    if (verify_sig_pfunc == NULL) {
+        WARN("verify_sig_pfunc is NULL\n");
+        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_SW_GET_VERIFY_SIG_PFUNC_NULL);
+        return ret;
+    }
+
+    if (qat_get_qat_offload_disabled()) {
+        DEBUG("- Switched to software mode\n");
+        return (*verify_sig_pfunc)(dgst, dgst_len, sig, eckey);
+    }
+
+    /* check input values */
+    if (eckey == NULL || (group = EC_KEY_get0_group(eckey)) == NULL ||
+        EC_KEY_get0_public_key(eckey) == NULL || sig == NULL) {
+        WARN("eckey, group, pub_key or sig are NULL\n");
+        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_ECKEY_GROUP_PUBKEY_SIG_NULL);
+        return ret;
+    }
+
+    if (EC_GROUP_get0_generator(group) == NULL) {
+        WARN("Failure to retrieve ec_point\n");
+        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY, QAT_R_RETRIEVE_EC_POINT_FAILURE);
+        return ret;
+    }
+
+    if (sample == NULL) {
+        sample = &local_sample;
+        qat_asym_dispatch_begin(sample, QAT_ASYM_ECDSA_VERIFY,
+                                EC_GROUP_get_degree(group));
+    }
+    if (!sample->offload) {
+        ret = (*verify_sig_pfunc)(dgst, dgst_len, sig, eckey);
+        if (ret >= 0)
+            qat_asym_dispatch_end(sample);
+        return ret;
+    }
+
+    ret = qat_ecdsa_verify_op_new(dgst, dgst_len, sig, eckey, &opData, &curve);
+    if (ret != 1)
+        goto err;
+    ret = -1;
+
     /* perform ECDSA verify */
 
     tlv = qat_check_create_local_variables();
@@ -1822,31 +3973,269 @@ int qat_ecdsa_do_verify(const unsigned char *dgst, int dgst_len,
     qat_cleanup_op_done(&op_done);
 
  err:
-    if (opData) {
-        QAT_CHK_QMFREE_FLATBUFF(opData->r);
-        QAT_CHK_QMFREE_FLATBUFF(opData->s);
-        QAT_CHK_QMFREE_FLATBUFF(opData->n);
-        QAT_CHK_QMFREE_FLATBUFF(opData->m);
-        QAT_CHK_QMFREE_FLATBUFF(opData->xg);
-        QAT_CHK_QMFREE_FLATBUFF(opData->yg);
-        QAT_CHK_QMFREE_FLATBUFF(opData->a);
-        QAT_CHK_QMFREE_FLATBUFF(opData->b);
-        QAT_CHK_QMFREE_FLATBUFF(opData->q);
-        QAT_CHK_QMFREE_FLATBUFF(opData->xp);
-        QAT_CHK_QMFREE_FLATBUFF(opData->yp);
-        OPENSSL_free(opData);
-    }
-
-    if (ctx) {
-        BN_CTX_end(ctx);
-        BN_CTX_free(ctx);
-    }
+    qat_ecdsa_verify_op_free(opData, curve);
 
     if (fallback) {
         WARN("- Fallback to software mode.\n");
         CRYPTO_QAT_LOG("Resubmitting request to SW - %s\n", __func__);
         return (*verify_sig_pfunc)(dgst, dgst_len, sig, eckey);
     }
+    if (ret >= 0)
+        qat_asym_dispatch_end(sample);
+    DEBUG("- Finished\n");
+    return ret;
+}
+
+int qat_ecdsa_do_verify(const unsigned char *dgst, int dgst_len,
+                        const ECDSA_SIG *sig, EC_KEY *eckey)
+{
+    return qat_ecdsa_do_verify_int(dgst, dgst_len, sig, eckey, NULL);
+}
+
+/******************************************************************************
+* function:
+*         qat_ecdsa_do_verify_batch(qat_ecdsa_verify_req_t *reqs, int num_reqs)
+*
+* @param reqs     [IN/OUT] - array of verify requests
+* @param num_reqs [IN]     - number of entries in reqs
+*
+* description:
+*   Performs a batch of ECDSA verify operations, such as the signatures of a
+*   certificate chain and its OCSP responses, which may be on different keys
+*   and curves. The requests are submitted back to back to the same instance
+*   and waited for once, the named curves sharing their constants from the
+*   curve cache. The requests that cannot be batched, or that fail on the
+*   accelerator, are performed one at a time through qat_ecdsa_do_verify
+*   which falls back to software as usual. The result of each request is
+*   returned in its ret field as by ECDSA_do_verify. Returns 1 if none of
+*   the requests failed and 0 otherwise, an invalid signature not being a
+*   failure.
+******************************************************************************/
+int qat_ecdsa_do_verify_batch(qat_ecdsa_verify_req_t *reqs, int num_reqs)
+{
+    qat_ecdsa_batch_op_t *ops = NULL;
+    op_done_rsa_crt_t op_done;
+    const EC_GROUP *group = NULL;
+    CpaStatus sts = CPA_STATUS_FAIL;
+    int inst_num = QAT_INVALID_INSTANCE;
+    int job_ret = 0, i = 0, ret = 1;
+    unsigned int num_batched = 0;
+    int qatPerformOpRetries = 0;
+    int iMsgRetry = getQatMsgRetryCount();
+    useconds_t ulPollInterval = getQatPollInterval();
+    thread_local_variables_t *tlv = NULL;
+
+    DEBUG("- Started.\n");
+
+    if (unlikely(reqs == NULL || num_reqs <= 0)) {
+        WARN("Invalid batch of %d requests\n", num_reqs);
+        QATerr(QAT_F_QAT_ECDSA_DO_VERIFY_BATCH, QAT_R_INPUT_PARAM_INVALID);
+        return 0;
+    }
+
+    for (i = 0; i < num_reqs; i++)
+        reqs[i].ret = -1;
+
+    if (qat_get_qat_offload_disabled())
+        goto single;
+
+    ops = OPENSSL_zalloc(num_reqs * sizeof(qat_ecdsa_batch_op_t));
+    if (ops == NULL) {
+        /* Not fatal, the requests are then performed one at a time */
+        WARN("Failed to allocate the batch state\n");
+        goto single;
+    }
+
+    for (i = 0; i < num_reqs; i++) {
+        if (reqs[i].eckey == NULL || reqs[i].sig == NULL ||
+            reqs[i].dgst == NULL || reqs[i].dgst_len <= 0 ||
+            (group = EC_KEY_get0_group(reqs[i].eckey)) == NULL ||
+            EC_KEY_get0_public_key(reqs[i].eckey) == NULL ||
+            EC_GROUP_get0_generator(group) == NULL)
+            continue;
+        ops[i].dispatched = 1;
+        if (!qat_asym_dispatch_begin(&ops[i].sample, QAT_ASYM_ECDSA_VERIFY,
+                                     EC_GROUP_get_degree(group))) {
+            /* Performed in software now so that its latency is its own */
+            reqs[i].ret = qat_ecdsa_do_verify_int(reqs[i].dgst,
+                                                  reqs[i].dgst_len,
+                                                  reqs[i].sig, reqs[i].eckey,
+                                                  &ops[i].sample);
+            if (reqs[i].ret < 0)
+                ret = 0;
+            continue;
+        }
+        /*
+         * Errors building a request are not reported here as the request is
+         * performed again through qat_ecdsa_do_verify_int which raises them.
+         */
+        ERR_set_mark();
+        switch (qat_ecdsa_verify_op_new(reqs[i].dgst, reqs[i].dgst_len,
+                                        reqs[i].sig, reqs[i].eckey,
+                                        &ops[i].opData, &ops[i].curve)) {
+        case 1:
+            ops[i].op_done = &op_done;
+            ops[i].status = CPA_STATUS_FAIL;
+            ops[i].batched = 1;
+            num_batched++;
+            break;
+        case 0:
+            /* r or s out of range, no need to ask the accelerator */
+            reqs[i].ret = 0;
+            qat_asym_dispatch_end(&ops[i].sample);
+            break;
+        default:
+            break;
+        }
+        ERR_pop_to_mark();
+    }
+
+    if (num_batched == 0)
+        goto unbatch;
+
+    tlv = qat_check_create_local_variables();
+    if (NULL == tlv) {
+        WARN("could not create local variables\n");
+        goto unbatch;
+    }
+
+    QAT_INC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+    if (qat_use_signals()) {
+        if (tlv->localOpsInFlight == 1) {
+            if (pthread_kill(timer_poll_func_thread, SIGUSR1) != 0) {
+                WARN("pthread_kill error\n");
+                QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+                goto unbatch;
+            }
+        }
+    }
+
+    if (qat_init_op_done_rsa_crt(&op_done, num_batched) != 1) {
+        WARN("failed to init opdone for the batch\n");
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        goto unbatch;
+    }
+
+    CRYPTO_QAT_LOG("AU - %s\n", __func__);
+
+    if ((inst_num = get_next_inst_num()) == QAT_INVALID_INSTANCE) {
+        WARN("Failure to get an instance\n");
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
+        qat_cleanup_op_done_rsa_crt(&op_done);
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        goto unbatch;
+    }
+
+    /* send the requests back to back so that the ring is kept full */
+    for (i = 0; i < num_reqs; i++) {
+        if (!ops[i].batched)
+            continue;
+        DUMP_ECDSA_VERIFY(qat_instance_handles[inst_num], ops[i].opData);
+        do {
+            sts = cpaCyEcdsaVerify(qat_instance_handles[inst_num],
+                                   qat_ecdsaVerifyBatchCallbackFn, &ops[i],
+                                   ops[i].opData, &ops[i].verifyStatus);
+            if (sts == CPA_STATUS_RETRY) {
+                if (op_done.opDone.job == NULL) {
+                    usleep(ulPollInterval +
+                           (qatPerformOpRetries % QAT_RETRY_BACKOFF_MODULO_DIVISOR));
+                    qatPerformOpRetries++;
+                    if (iMsgRetry != QAT_INFINITE_MAX_NUM_RETRIES) {
+                        if (qatPerformOpRetries >= iMsgRetry) {
+                            WARN("No. of retries exceeded max retry : %d\n", iMsgRetry);
+                            break;
+                        }
+                    }
+                } else {
+                    if ((qat_wake_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0) ||
+                        (qat_pause_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0)) {
+                        WARN("qat_wake_job or qat_pause_job failed\n");
+                        break;
+                    }
+                }
+            }
+        }
+        while (sts == CPA_STATUS_RETRY);
+
+        if (sts != CPA_STATUS_SUCCESS) {
+            WARN("Failed to submit request %d to qat - status = %d\n", i, sts);
+            break;
+        }
+
+        op_done.req++;
+        if (enable_heuristic_polling) {
+            QAT_ATOMIC_INC(num_asym_requests_in_flight);
+        }
+    }
+
+    /* wait for replies */
+    if (op_done.req == num_batched && op_done.opDone.job != NULL) {
+        do {
+            /* If we get a failure on qat_pause_job then we will
+               not flag an error here and quit because we have
+               asynchronous requests in flight.
+               We don't want to start cleaning up data
+               structures that are still being used. If
+               qat_pause_job fails we will just yield and
+               loop around and try again until the requests
+               complete and we can continue. */
+            if ((job_ret = qat_pause_job(op_done.opDone.job, ASYNC_STATUS_OK)) == 0)
+                pthread_yield();
+        } while (op_done.resp != op_done.req ||
+                 QAT_CHK_JOB_RESUMED_UNEXPECTEDLY(job_ret));
+    } else {
+        /*
+         * Sync mode, or a submission failed in which case the callback
+         * will not wake the job and the outstanding responses are polled
+         * for here before the buffers are released.
+         */
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
+        while (op_done.resp != op_done.req) {
+            if(getEnableInlinePolling()) {
+                icp_sal_CyPollInstance(qat_instance_handles[inst_num], 0);
+            }
+            else
+                pthread_yield();
+        }
+    }
+    QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+    qat_cleanup_op_done_rsa_crt(&op_done);
+
+    /*
+     * Unlike a batch of signatures each verification has a result of its
+     * own, the requests which were not submitted or did not succeed are
+     * performed again one at a time.
+     */
+    for (i = 0; i < num_reqs; i++) {
+        if (ops[i].batched && ops[i].status == CPA_STATUS_SUCCESS) {
+            reqs[i].ret = (ops[i].verifyStatus == CPA_TRUE) ? 1 : 0;
+            qat_asym_dispatch_end(&ops[i].sample);
+        }
+    }
+
+unbatch:
+    for (i = 0; i < num_reqs; i++) {
+        qat_ecdsa_verify_op_free(ops[i].opData, ops[i].curve);
+        /* A request performed again is offloaded but no longer timed */
+        ops[i].sample.slot = NULL;
+    }
+
+single:
+    for (i = 0; i < num_reqs; i++) {
+        if (reqs[i].ret >= 0 || (ops != NULL && ops[i].dispatched &&
+                                 !ops[i].sample.offload))
+            continue;
+        reqs[i].ret = qat_ecdsa_do_verify_int(reqs[i].dgst, reqs[i].dgst_len,
+                                              reqs[i].sig, reqs[i].eckey,
+                                              (ops != NULL && ops[i].dispatched)
+                                              ? &ops[i].sample : NULL);
+        if (reqs[i].ret < 0)
+            ret = 0;
+    }
+    OPENSSL_free(ops);
+
     DEBUG("- Finished\n");
     return ret;
 }
@@ -47,9 +47,37 @@
 # define QAT_EC_H
 
 # include <openssl/ossl_typ.h>
+# include <openssl/ec.h>
 
 EC_KEY_METHOD *qat_get_EC_methods(void);
 
 void qat_free_EC_methods(void);
+EVP_PKEY_METHOD *qat_ecx_pmeth(int nid);
+
+/* Pools of values precomputed on the accelerator ahead of the operations */
+typedef enum {
+    QAT_EC_POOL_ECDSA_NONCE = 0,
+    QAT_EC_POOL_ECDH_KEY,
+    QAT_EC_POOL_NUM_TYPES
+} qat_ec_pool_type_t;
+
+int qat_ec_pool_set_size(qat_ec_pool_type_t type, long size);
+
+int qat_ec_pool_set_refill_threshold(qat_ec_pool_type_t type, long threshold);
+
+/*
+ * A verify request of a batch submitted through the ECDSA_VERIFY_BATCH
+ * engine message. ret is set as by ECDSA_do_verify: 1 if the signature is
+ * valid, 0 if it is invalid and -1 if the request failed.
+ */
+typedef struct {
+    EC_KEY *eckey;
+    const unsigned char *dgst;
+    int dgst_len;
+    const ECDSA_SIG *sig;
+    int ret;
+} qat_ecdsa_verify_req_t;
+
+int qat_ecdsa_do_verify_batch(qat_ecdsa_verify_req_t *reqs, int num_reqs);
 
 #endif                          /* QAT_EC_H */
@@ -109,6 +109,11 @@ void engine_finish_before_fork_handler(void)
     qat_engine_finish_int(e, QAT_RETAIN_GLOBALS);
     ENGINE_free(e);
 
+#ifdef USE_QAE_MEM
+    /* Do not carry cached pinned buffers across into the child */
+    qaeCryptoMemCacheFlush();
+#endif
+
     keep_polling = 1;
 }
 
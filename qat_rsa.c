@@ -93,6 +93,11 @@
 /* To specify the RSA op sizes supported by QAT engine */
 #define RSA_QAT_RANGE_MIN 512
 #define RSA_QAT_RANGE_MAX 4096
+/*
+ * Private key operations on larger moduli are offloaded as two ModExp
+ * operations on the half size primes using the CRT.
+ */
+#define RSA_QAT_CRT_RANGE_MAX 8192
 
 #define NO_PADDING 0
 #define PADDING    1
@@ -108,12 +113,57 @@ static int qat_rsa_pub_enc(int flen, const unsigned char *from,
 static int qat_rsa_pub_dec(int flen, const unsigned char *from,
                            unsigned char *to, RSA *rsa, int padding);
 static int qat_rsa_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx);
+static int qat_rsa_keygen(RSA *rsa, int bits, BIGNUM *e_value, BN_GENCB *cb);
+static int qat_rsa_multi_prime_keygen(RSA *rsa, int bits, int primes,
+                                      BIGNUM *e_value, BN_GENCB *cb);
 static int qat_rsa_init(RSA *rsa);
 static int qat_rsa_finish(RSA *rsa);
 #endif
 
 static RSA_METHOD *qat_rsa_method = NULL;
 
+#ifndef OPENSSL_DISABLE_QAT_RSA
+/*
+ * Per RSA object cache of the key material in the pinned flat buffer form
+ * expected by the QAT API. It is attached to the RSA object as ex_data in
+ * qat_rsa_init, populated on first use and torn down in qat_rsa_finish.
+ * The private and public halves are cached independently as verify-only
+ * keys have no private components. The on-core CRT precomputation used by
+ * the synchronous CRT path is cached alongside the private key. Each cached
+ * copy is matched against the current key by value, as a component that is
+ * replaced and freed may be reallocated at the same address, so a key that
+ * is replaced after first use is not served stale. The BIGNUMs of the cache
+ * are private copies of the components the pinned keys were built from. The
+ * pids record the owning process as pinned memory is not inherited across
+ * fork.
+ */
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    pid_t pid;
+    BIGNUM *p;
+    BIGNUM *q;
+    BIGNUM *dmp1;
+    BIGNUM *dmq1;
+    BIGNUM *iqmp;
+    CpaCyRsaPrivateKey *priv_key;
+    qat_rsa_crt_key_t *crt_key;
+    pid_t pub_pid;
+    BIGNUM *n;
+    BIGNUM *e;
+    CpaCyRsaPublicKey *pub_key;
+} qat_rsa_key_cache_t;
+
+/*
+ * Returns 1 if the cached copy holds the same value as bn. Both are
+ * components of the same RSA object, so an early exit of BN_cmp only
+ * reveals that the key has been replaced.
+ */
+# define QAT_RSA_BN_EQ(cached, bn)                                  \
+    ((cached) != NULL && (bn) != NULL && BN_cmp((cached), (bn)) == 0)
+
+static int qat_rsa_key_cache_idx = -1;
+#endif
+
 RSA_METHOD *qat_get_RSA_methods(void)
 {
 #ifndef OPENSSL_DISABLE_QAT_RSA
@@ -124,6 +174,10 @@ RSA_METHOD *qat_get_RSA_methods(void)
         return qat_rsa_method;
 
 #ifndef OPENSSL_DISABLE_QAT_RSA
+    /* The index is kept for the life of the process, failure disables caching */
+    if (qat_rsa_key_cache_idx == -1)
+        qat_rsa_key_cache_idx = RSA_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+
     if ((qat_rsa_method = RSA_meth_new("QAT RSA method", 0)) == NULL) {
         WARN("Failed to allocate QAT RSA methods\n");
         QATerr(QAT_F_QAT_GET_RSA_METHODS, QAT_R_ALLOC_QAT_RSA_METH_FAILURE);
@@ -136,6 +190,11 @@ RSA_METHOD *qat_get_RSA_methods(void)
     res &= RSA_meth_set_priv_dec(qat_rsa_method, qat_rsa_priv_dec);
     res &= RSA_meth_set_mod_exp(qat_rsa_method, qat_rsa_mod_exp);
     res &= RSA_meth_set_bn_mod_exp(qat_rsa_method, BN_mod_exp_mont);
+    res &= RSA_meth_set_keygen(qat_rsa_method, qat_rsa_keygen);
+#ifdef QAT_RSA_MULTI_PRIME
+    res &= RSA_meth_set_multi_prime_keygen(qat_rsa_method,
+                                           qat_rsa_multi_prime_keygen);
+#endif
     res &= RSA_meth_set_init(qat_rsa_method, qat_rsa_init);
     res &= RSA_meth_set_finish(qat_rsa_method, qat_rsa_finish);
 
@@ -175,6 +234,367 @@ static inline int qat_rsa_range_check(int plen)
     return ((plen >= RSA_QAT_RANGE_MIN) && (plen <= RSA_QAT_RANGE_MAX));
 }
 
+static inline int qat_rsa_priv_range_check(int plen)
+{
+    return ((plen >= RSA_QAT_RANGE_MIN) && (plen <= RSA_QAT_CRT_RANGE_MAX));
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_priv_key_free(CpaCyRsaPrivateKey *key)
+*
+* @param key [IN] - Private key to free
+*
+* description:
+*   Cleanses and frees the pinned flat buffers of a type 2 private key
+*   and the key structure itself.
+******************************************************************************/
+static void qat_rsa_priv_key_free(CpaCyRsaPrivateKey *key)
+{
+    if (key == NULL)
+        return;
+
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->privateKeyRep2.prime1P);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->privateKeyRep2.prime2Q);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->privateKeyRep2.exponent1Dp);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->privateKeyRep2.exponent2Dq);
+    QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->privateKeyRep2.coefficientQInv);
+    OPENSSL_free(key);
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_key_cache_clear_priv(qat_rsa_key_cache_t *cache)
+*
+* @param cache [IN] - RSA key cache
+*
+* description:
+*   Cleanses and frees the copies of the private key components the cached
+*   private key was built from. The caller holds the write lock.
+******************************************************************************/
+static void qat_rsa_key_cache_clear_priv(qat_rsa_key_cache_t *cache)
+{
+    BN_clear_free(cache->p);
+    BN_clear_free(cache->q);
+    BN_clear_free(cache->dmp1);
+    BN_clear_free(cache->dmq1);
+    BN_clear_free(cache->iqmp);
+    cache->p = cache->q = cache->dmp1 = cache->dmq1 = cache->iqmp = NULL;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_priv_key_new(const BIGNUM *p, const BIGNUM *q,
+*                              const BIGNUM *dmp1, const BIGNUM *dmq1,
+*                              const BIGNUM *iqmp)
+*
+* @param p    [IN] - First prime factor
+* @param q    [IN] - Second prime factor
+* @param dmp1 [IN] - d mod (p-1)
+* @param dmq1 [IN] - d mod (q-1)
+* @param iqmp [IN] - q^-1 mod p
+*
+* description:
+*   Builds a type 2 CpaCyRsaPrivateKey with the CRT components converted
+*   into pinned flat buffers. Returns NULL on failure.
+******************************************************************************/
+static CpaCyRsaPrivateKey *qat_rsa_priv_key_new(const BIGNUM *p,
+                                                const BIGNUM *q,
+                                                const BIGNUM *dmp1,
+                                                const BIGNUM *dmq1,
+                                                const BIGNUM *iqmp)
+{
+    CpaCyRsaPrivateKey *cpa_prv_key = NULL;
+
+    cpa_prv_key =
+        (CpaCyRsaPrivateKey *) OPENSSL_zalloc(sizeof(CpaCyRsaPrivateKey));
+    if (NULL == cpa_prv_key) {
+        WARN("Failed to allocate cpa_prv_key\n");
+        QATerr(QAT_F_BUILD_DECRYPT_OP_BUF, QAT_R_PRIV_KEY_MALLOC_FAILURE);
+        return NULL;
+    }
+
+    cpa_prv_key->version = CPA_CY_RSA_VERSION_TWO_PRIME;
+
+    /* Setup the private key rep type 2 structure */
+    cpa_prv_key->privateKeyRepType = CPA_CY_RSA_PRIVATE_KEY_REP_TYPE_2;
+    if (qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.prime1P, p) != 1 ||
+        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.prime2Q, q) != 1 ||
+        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.exponent1Dp, dmp1) != 1 ||
+        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.exponent2Dq, dmq1) != 1 ||
+        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.coefficientQInv, iqmp) != 1) {
+        WARN("Failed to convert privateKeyRep2 elements to flatbuffer\n");
+        QATerr(QAT_F_BUILD_DECRYPT_OP_BUF, QAT_R_P_Q_DMP_DMQ_CONVERT_TO_FB_FAILURE);
+        qat_rsa_priv_key_free(cpa_prv_key);
+        return NULL;
+    }
+
+    return cpa_prv_key;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_get_cached_priv_key(RSA *rsa, const BIGNUM *p,
+*                                     const BIGNUM *q, const BIGNUM *dmp1,
+*                                     const BIGNUM *dmq1, const BIGNUM *iqmp)
+*
+* @param rsa  [IN] - RSA object owning the cache
+* @param p    [IN] - First prime factor
+* @param q    [IN] - Second prime factor
+* @param dmp1 [IN] - d mod (p-1)
+* @param dmq1 [IN] - d mod (q-1)
+* @param iqmp [IN] - q^-1 mod p
+*
+* description:
+*   Returns the pinned private key cached on the RSA object, building it on
+*   first use. The returned key stays owned by the cache and remains valid
+*   until qat_rsa_finish. Returns NULL, without raising an error, when no
+*   cached key can be used, in which case the caller builds its own copy.
+******************************************************************************/
+static CpaCyRsaPrivateKey *qat_rsa_get_cached_priv_key(RSA *rsa,
+                                                       const BIGNUM *p,
+                                                       const BIGNUM *q,
+                                                       const BIGNUM *dmp1,
+                                                       const BIGNUM *dmq1,
+                                                       const BIGNUM *iqmp)
+{
+    qat_rsa_key_cache_t *cache = NULL;
+    CpaCyRsaPrivateKey *key = NULL;
+    pid_t pid = getpid();
+
+    if (qat_rsa_key_cache_idx < 0 ||
+        (cache = RSA_get_ex_data(rsa, qat_rsa_key_cache_idx)) == NULL)
+        return NULL;
+
+# define QAT_RSA_PRIV_KEY_CACHE_HIT(c)                              \
+    ((c)->priv_key != NULL && (c)->pid == pid &&                    \
+     QAT_RSA_BN_EQ((c)->p, p) && QAT_RSA_BN_EQ((c)->q, q) &&        \
+     QAT_RSA_BN_EQ((c)->dmp1, dmp1) &&                              \
+     QAT_RSA_BN_EQ((c)->dmq1, dmq1) && QAT_RSA_BN_EQ((c)->iqmp, iqmp))
+
+    if (!CRYPTO_THREAD_read_lock(cache->lock))
+        return NULL;
+    if (QAT_RSA_PRIV_KEY_CACHE_HIT(cache))
+        key = cache->priv_key;
+    CRYPTO_THREAD_unlock(cache->lock);
+
+    if (key != NULL)
+        return key;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        return NULL;
+
+    if (cache->priv_key != NULL && cache->pid != pid) {
+        /* The pinned buffers belong to the parent process, drop them */
+        OPENSSL_free(cache->priv_key);
+        cache->priv_key = NULL;
+    }
+
+    /*
+     * A key whose components were replaced after it was cached is left in
+     * place as other threads may still be using it; such keys are simply
+     * served from per operation copies.
+     */
+    if (cache->priv_key == NULL) {
+        ERR_set_mark();
+        qat_rsa_key_cache_clear_priv(cache);
+        if ((cache->p = BN_dup(p)) != NULL &&
+            (cache->q = BN_dup(q)) != NULL &&
+            (cache->dmp1 = BN_dup(dmp1)) != NULL &&
+            (cache->dmq1 = BN_dup(dmq1)) != NULL &&
+            (cache->iqmp = BN_dup(iqmp)) != NULL)
+            cache->priv_key = qat_rsa_priv_key_new(p, q, dmp1, dmq1, iqmp);
+        ERR_pop_to_mark();
+        if (cache->priv_key != NULL)
+            cache->pid = pid;
+        else
+            qat_rsa_key_cache_clear_priv(cache);
+    }
+
+    if (QAT_RSA_PRIV_KEY_CACHE_HIT(cache))
+        key = cache->priv_key;
+    CRYPTO_THREAD_unlock(cache->lock);
+
+# undef QAT_RSA_PRIV_KEY_CACHE_HIT
+
+    return key;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_pub_key_free(CpaCyRsaPublicKey *key)
+*
+* @param key [IN] - Public key to free
+*
+* description:
+*   Frees the pinned flat buffers of a public key and the key structure
+*   itself.
+******************************************************************************/
+static void qat_rsa_pub_key_free(CpaCyRsaPublicKey *key)
+{
+    if (key == NULL)
+        return;
+
+    QAT_CHK_QMFREE_FLATBUFF(key->modulusN);
+    QAT_CHK_QMFREE_FLATBUFF(key->publicExponentE);
+    OPENSSL_free(key);
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_pub_key_new(const BIGNUM *n, const BIGNUM *e)
+*
+* @param n [IN] - Modulus
+* @param e [IN] - Public exponent
+*
+* description:
+*   Builds a CpaCyRsaPublicKey with n and e converted into pinned flat
+*   buffers. Returns NULL on failure.
+******************************************************************************/
+static CpaCyRsaPublicKey *qat_rsa_pub_key_new(const BIGNUM *n,
+                                              const BIGNUM *e)
+{
+    CpaCyRsaPublicKey *cpa_pub_key = NULL;
+
+    cpa_pub_key = OPENSSL_zalloc(sizeof(CpaCyRsaPublicKey));
+    if (NULL == cpa_pub_key) {
+        WARN("Public Key zalloc failed\n");
+        QATerr(QAT_F_BUILD_ENCRYPT_OP_BUF, QAT_R_PUB_KEY_MALLOC_FAILURE);
+        return NULL;
+    }
+
+    /* Passing Public key from big number format to big endian order binary */
+    if (qat_BN_to_FB(&cpa_pub_key->modulusN, n) != 1 ||
+        qat_BN_to_FB(&cpa_pub_key->publicExponentE, e) != 1) {
+        WARN("Failed to convert cpa_pub_key elements to flatbuffer\n");
+        QATerr(QAT_F_BUILD_ENCRYPT_OP_BUF, QAT_R_N_E_CONVERT_TO_FB_FAILURE);
+        qat_rsa_pub_key_free(cpa_pub_key);
+        return NULL;
+    }
+
+    return cpa_pub_key;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_get_cached_pub_key(RSA *rsa, const BIGNUM *n,
+*                                    const BIGNUM *e)
+*
+* @param rsa [IN] - RSA object owning the cache
+* @param n   [IN] - Modulus
+* @param e   [IN] - Public exponent
+*
+* description:
+*   Returns the pinned public key cached on the RSA object, building it on
+*   first use. The returned key stays owned by the cache and remains valid
+*   until qat_rsa_finish. Returns NULL, without raising an error, when no
+*   cached key can be used, in which case the caller builds its own copy.
+******************************************************************************/
+static CpaCyRsaPublicKey *qat_rsa_get_cached_pub_key(RSA *rsa,
+                                                     const BIGNUM *n,
+                                                     const BIGNUM *e)
+{
+    qat_rsa_key_cache_t *cache = NULL;
+    CpaCyRsaPublicKey *key = NULL;
+    pid_t pid = getpid();
+
+    if (qat_rsa_key_cache_idx < 0 ||
+        (cache = RSA_get_ex_data(rsa, qat_rsa_key_cache_idx)) == NULL)
+        return NULL;
+
+# define QAT_RSA_PUB_KEY_CACHE_HIT(c)                               \
+    ((c)->pub_key != NULL && (c)->pub_pid == pid &&                 \
+     QAT_RSA_BN_EQ((c)->n, n) && QAT_RSA_BN_EQ((c)->e, e))
+
+    if (!CRYPTO_THREAD_read_lock(cache->lock))
+        return NULL;
+    if (QAT_RSA_PUB_KEY_CACHE_HIT(cache))
+        key = cache->pub_key;
+    CRYPTO_THREAD_unlock(cache->lock);
+
+    if (key != NULL)
+        return key;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        return NULL;
+
+    if (cache->pub_key != NULL && cache->pub_pid != pid) {
+        /* The pinned buffers belong to the parent process, drop them */
+        OPENSSL_free(cache->pub_key);
+        cache->pub_key = NULL;
+    }
+
+    if (cache->pub_key == NULL) {
+        ERR_set_mark();
+        BN_free(cache->n);
+        BN_free(cache->e);
+        cache->e = NULL;
+        if ((cache->n = BN_dup(n)) != NULL && (cache->e = BN_dup(e)) != NULL)
+            cache->pub_key = qat_rsa_pub_key_new(n, e);
+        ERR_pop_to_mark();
+        if (cache->pub_key != NULL)
+            cache->pub_pid = pid;
+    }
+
+    if (QAT_RSA_PUB_KEY_CACHE_HIT(cache))
+        key = cache->pub_key;
+    CRYPTO_THREAD_unlock(cache->lock);
+
+# undef QAT_RSA_PUB_KEY_CACHE_HIT
+
+    return key;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_get_cached_crt_key(RSA *rsa, BN_CTX *ctx)
+*
+* @param rsa [IN] - RSA object owning the cache
+* @param ctx [IN] - BN_CTX used if the CRT key has to be built
+*
+* description:
+*   Returns the CRT precomputation cached on the RSA object, building it on
+*   first use. The returned key stays owned by the cache and remains valid
+*   until qat_rsa_finish. Returns NULL, without raising an error, when no
+*   cached key can be used, in which case the caller builds its own copy.
+******************************************************************************/
+const qat_rsa_crt_key_t *qat_rsa_get_cached_crt_key(RSA *rsa, BN_CTX *ctx)
+{
+    qat_rsa_key_cache_t *cache = NULL;
+    const qat_rsa_crt_key_t *key = NULL;
+
+    if (qat_rsa_key_cache_idx < 0 ||
+        (cache = RSA_get_ex_data(rsa, qat_rsa_key_cache_idx)) == NULL)
+        return NULL;
+
+# define QAT_RSA_CRT_KEY_CACHE_HIT(c)                               \
+    qat_rsa_crt_key_matches((c)->crt_key, (const RSA*)rsa)
+
+    if (!CRYPTO_THREAD_read_lock(cache->lock))
+        return NULL;
+    if (QAT_RSA_CRT_KEY_CACHE_HIT(cache))
+        key = cache->crt_key;
+    CRYPTO_THREAD_unlock(cache->lock);
+
+    if (key != NULL)
+        return key;
+
+    if (!CRYPTO_THREAD_write_lock(cache->lock))
+        return NULL;
+
+    /* As for the pinned key a replaced key is served from per op copies */
+    if (cache->crt_key == NULL)
+        cache->crt_key = qat_rsa_crt_key_new((const RSA*)rsa, ctx);
+
+    if (QAT_RSA_CRT_KEY_CACHE_HIT(cache))
+        key = cache->crt_key;
+    CRYPTO_THREAD_unlock(cache->lock);
+
+# undef QAT_RSA_CRT_KEY_CACHE_HIT
+
+    return key;
+}
+
 /******************************************************************************
 * function:
 *         qat_rsaCallbackFn(void *pCallbackTag, CpaStatus status,
@@ -204,24 +624,17 @@ static void qat_rsaCallbackFn(void *pCallbackTag, CpaStatus status, void *pOpDat
 
 static void
 rsa_decrypt_op_buf_free(CpaCyRsaDecryptOpData * dec_op_data,
-                        CpaFlatBuffer * out_buf)
+                        CpaFlatBuffer * out_buf, int key_cached)
 {
-    CpaCyRsaPrivateKeyRep2 *key = NULL;
     DEBUG("- Started\n");
 
     if (dec_op_data) {
         if (dec_op_data->inputData.pData)
             qaeCryptoMemFree(dec_op_data->inputData.pData);
 
-        if (dec_op_data->pRecipientPrivateKey) {
-            key = &dec_op_data->pRecipientPrivateKey->privateKeyRep2;
-            QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->prime1P);
-            QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->prime2Q);
-            QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->exponent1Dp);
-            QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->exponent2Dq);
-            QAT_CHK_CLNSE_QMFREE_FLATBUFF(key->coefficientQInv);
-            OPENSSL_free(dec_op_data->pRecipientPrivateKey);
-        }
+        /* A cached key is owned by the RSA object and freed in qat_rsa_finish */
+        if (!key_cached)
+            qat_rsa_priv_key_free(dec_op_data->pRecipientPrivateKey);
         OPENSSL_free(dec_op_data);
     }
 
@@ -234,15 +647,16 @@ rsa_decrypt_op_buf_free(CpaCyRsaDecryptOpData * dec_op_data,
 }
 
 
-static int qat_rsa_decrypt(CpaCyRsaDecryptOpData * dec_op_data, int rsa_len,
-                           CpaFlatBuffer * output_buf, int * fallback)
+static int qat_rsa_decrypt(CpaCyRsaDecryptOpData * dec_op_data, RSA *rsa,
+                           int rsa_len, CpaFlatBuffer * output_buf,
+                           int * fallback)
 {
     /* Used for RSA Decrypt and RSA Sign */
     op_done_t op_done;
     CpaStatus sts = CPA_STATUS_FAIL;
     int inst_num = QAT_INVALID_INSTANCE;
     int job_ret = 0;
-    int sync_mode_ret = 0;
+    int crt_mode_ret = 0;
     thread_local_variables_t *tlv = NULL;
 
     DEBUG("- Started\n");
@@ -266,22 +680,25 @@ static int qat_rsa_decrypt(CpaCyRsaDecryptOpData * dec_op_data, int rsa_len,
         }
     }
     qat_init_op_done(&op_done);
-    if (op_done.job != NULL) {
-        if (qat_setup_async_event_notification(0) == 0) {
-            WARN("Failed to setup async event notifications\n");
-            QATerr(QAT_F_QAT_RSA_DECRYPT, ERR_R_INTERNAL_ERROR);
-            qat_cleanup_op_done(&op_done);
-            QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
-            return 0;
-        }
-    } else {
+    if (op_done.job == NULL || !qat_rsa_range_check(RSA_bits((const RSA*)rsa)) ||
+        qat_rsa_is_multi_prime((const RSA*)rsa)) {
         /*
-         *  Sync mode
+         *  Sync mode, a modulus too large for cpaCyRsaDecrypt or a
+         *  multi-prime key, which cpaCyRsaDecrypt cannot take, are
+         *  decomposed into one ModExp operation per prime instead
          */
         qat_cleanup_op_done(&op_done);
-        sync_mode_ret = qat_rsa_decrypt_CRT(dec_op_data, rsa_len, output_buf, fallback);
+        crt_mode_ret = qat_rsa_decrypt_CRT(dec_op_data, rsa, rsa_len,
+                                           output_buf, fallback);
         QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
-        return sync_mode_ret;
+        return crt_mode_ret;
+    }
+    if (qat_setup_async_event_notification(0) == 0) {
+        WARN("Failed to setup async event notifications\n");
+        QATerr(QAT_F_QAT_RSA_DECRYPT, ERR_R_INTERNAL_ERROR);
+        qat_cleanup_op_done(&op_done);
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        return 0;
     }
     /*
      * cpaCyRsaDecrypt() is the function called for RSA Sign in the API.
@@ -389,11 +806,15 @@ static int
 build_decrypt_op_buf(int flen, const unsigned char *from, unsigned char *to,
                      RSA *rsa, int padding,
                      CpaCyRsaDecryptOpData ** dec_op_data,
-                     CpaFlatBuffer ** output_buffer, int alloc_pad)
+                     CpaFlatBuffer ** output_buffer, int alloc_pad,
+                     int *key_cached)
 {
     int rsa_len = 0;
     int padding_result = 0;
+    int in_range = 0;
     CpaCyRsaPrivateKey *cpa_prv_key = NULL;
+    BIGNUM *in = NULL;
+    const BIGNUM *n = NULL;
     const BIGNUM *p = NULL;
     const BIGNUM *q = NULL;
     const BIGNUM *dmp1 = NULL;
@@ -427,41 +848,31 @@ build_decrypt_op_buf(int flen, const unsigned char *from, unsigned char *to,
         return 0;
     }
 
-    cpa_prv_key =
-        (CpaCyRsaPrivateKey *) OPENSSL_zalloc(sizeof(CpaCyRsaPrivateKey));
-    if (NULL == cpa_prv_key) {
-        WARN("Failed to allocate cpa_prv_key\n");
-        QATerr(QAT_F_BUILD_DECRYPT_OP_BUF, QAT_R_PRIV_KEY_MALLOC_FAILURE);
-        return 0;
-    }
-
     /* output and input data MUST allocate memory for sign process */
     /* memory allocation for DecOpdata[IN] */
     *dec_op_data = OPENSSL_zalloc(sizeof(CpaCyRsaDecryptOpData));
     if (NULL == *dec_op_data) {
         WARN("Failed to allocate dec_op_data\n");
         QATerr(QAT_F_BUILD_DECRYPT_OP_BUF, QAT_R_DEC_OP_DATA_MALLOC_FAILURE);
-        OPENSSL_free(cpa_prv_key);
         return 0;
     }
 
+    /* Reuse the pinned copy of the key cached on the RSA object if possible */
+    cpa_prv_key = qat_rsa_get_cached_priv_key(rsa, p, q, dmp1, dmq1, iqmp);
+    if (cpa_prv_key != NULL) {
+        *key_cached = 1;
+    } else {
+        cpa_prv_key = qat_rsa_priv_key_new(p, q, dmp1, dmq1, iqmp);
+        if (cpa_prv_key == NULL) {
+            WARN("Failed to build cpa_prv_key\n");
+            /* Errors are already raised within qat_rsa_priv_key_new. */
+            return 0;
+        }
+    }
+
     /* Setup the DecOpData structure */
     (*dec_op_data)->pRecipientPrivateKey = cpa_prv_key;
 
-    cpa_prv_key->version = CPA_CY_RSA_VERSION_TWO_PRIME;
-
-    /* Setup the private key rep type 2 structure */
-    cpa_prv_key->privateKeyRepType = CPA_CY_RSA_PRIVATE_KEY_REP_TYPE_2;
-    if (qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.prime1P, p) != 1 ||
-        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.prime2Q, q) != 1 ||
-        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.exponent1Dp, dmp1) != 1 ||
-        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.exponent2Dq, dmq1) != 1 ||
-        qat_BN_to_FB(&cpa_prv_key->privateKeyRep2.coefficientQInv, iqmp) != 1) {
-        WARN("Failed to convert privateKeyRep2 elements to flatbuffer\n");
-        QATerr(QAT_F_BUILD_DECRYPT_OP_BUF, QAT_R_P_Q_DMP_DMQ_CONVERT_TO_FB_FAILURE);
-        return 0;
-    }
-
     (*dec_op_data)->inputData.pData = (Cpa8U *) qaeCryptoMemAlloc(
         ((padding != RSA_NO_PADDING) && alloc_pad) ? rsa_len : flen,
          __FILE__,
@@ -509,6 +920,27 @@ build_decrypt_op_buf(int flen, const unsigned char *from, unsigned char *to,
         return 0;
     }
 
+    /*
+     * As in OpenSSL the input must be smaller than the modulus, the CRT
+     * path relies on it to reduce the input without a long division.
+     */
+    RSA_get0_key((const RSA*)rsa, &n, NULL, NULL);
+    if (n == NULL ||
+        (in = BN_bin2bn((*dec_op_data)->inputData.pData,
+                        (*dec_op_data)->inputData.dataLenInBytes,
+                        NULL)) == NULL) {
+        WARN("Failed to convert the input to a BIGNUM\n");
+        QATerr(QAT_F_BUILD_DECRYPT_OP_BUF, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    in_range = BN_ucmp(in, n) < 0;
+    BN_clear_free(in);
+    if (!in_range) {
+        WARN("Input is not smaller than the modulus\n");
+        QATerr(QAT_F_BUILD_DECRYPT_OP_BUF, RSA_R_DATA_TOO_LARGE_FOR_MODULUS);
+        return 0;
+    }
+
     *output_buffer = OPENSSL_malloc(sizeof(CpaFlatBuffer));
     if (NULL == *output_buffer) {
         WARN("Failed to allocate output_buffer\n");
@@ -536,19 +968,14 @@ build_decrypt_op_buf(int flen, const unsigned char *from, unsigned char *to,
 
 static void
 rsa_encrypt_op_buf_free(CpaCyRsaEncryptOpData * enc_op_data,
-                        CpaFlatBuffer * out_buf)
+                        CpaFlatBuffer * out_buf, int key_cached)
 {
     DEBUG("- Started\n");
 
     if (enc_op_data) {
-        if (enc_op_data->pPublicKey) {
-            if (enc_op_data->pPublicKey->modulusN.pData)
-                qaeCryptoMemFree(enc_op_data->pPublicKey->modulusN.pData);
-            if (enc_op_data->pPublicKey->publicExponentE.pData)
-                qaeCryptoMemFree(enc_op_data->pPublicKey->
-                                 publicExponentE.pData);
-            OPENSSL_free(enc_op_data->pPublicKey);
-        }
+        /* A cached key is owned by the RSA object and freed in qat_rsa_finish */
+        if (!key_cached)
+            qat_rsa_pub_key_free(enc_op_data->pPublicKey);
         if (enc_op_data->inputData.pData)
             qaeCryptoMemFree(enc_op_data->inputData.pData);
         OPENSSL_free(enc_op_data);
@@ -736,7 +1163,8 @@ static int
 build_encrypt_op_buf(int flen, const unsigned char *from, unsigned char *to,
                      RSA *rsa, int padding,
                      CpaCyRsaEncryptOpData ** enc_op_data,
-                     CpaFlatBuffer ** output_buffer, int alloc_pad)
+                     CpaFlatBuffer ** output_buffer, int alloc_pad,
+                     int *key_cached)
 {
     CpaCyRsaPublicKey *cpa_pub_key = NULL;
     int rsa_len = 0;
@@ -769,34 +1197,31 @@ build_encrypt_op_buf(int flen, const unsigned char *from, unsigned char *to,
         return 0;
     }
 
-    cpa_pub_key = OPENSSL_zalloc(sizeof(CpaCyRsaPublicKey));
-    if (NULL == cpa_pub_key) {
-        WARN("Public Key zalloc failed\n");
-        QATerr(QAT_F_BUILD_ENCRYPT_OP_BUF, QAT_R_PUB_KEY_MALLOC_FAILURE);
-        return 0;
-    }
-
     /* Output and input data MUST allocate memory for RSA verify process */
     /* Memory allocation for EncOpData[IN] */
     *enc_op_data = OPENSSL_zalloc(sizeof(CpaCyRsaEncryptOpData));
     if (NULL == *enc_op_data) {
         WARN("Failed to allocate enc_op_data\n");
         QATerr(QAT_F_BUILD_ENCRYPT_OP_BUF, QAT_R_ENC_OP_DATA_MALLOC_FAILURE);
-        OPENSSL_free(cpa_pub_key);
         return 0;
     }
 
+    /* Reuse the pinned copy of the key cached on the RSA object if possible */
+    cpa_pub_key = qat_rsa_get_cached_pub_key(rsa, n, e);
+    if (cpa_pub_key != NULL) {
+        *key_cached = 1;
+    } else {
+        cpa_pub_key = qat_rsa_pub_key_new(n, e);
+        if (cpa_pub_key == NULL) {
+            WARN("Failed to build cpa_pub_key\n");
+            /* Errors are already raised within qat_rsa_pub_key_new. */
+            return 0;
+        }
+    }
+
     /* Setup the Encrypt operation Data structure */
     (*enc_op_data)->pPublicKey = cpa_pub_key;
 
-    /* Passing Public key from big number format to big endian order binary */
-    if (qat_BN_to_FB(&cpa_pub_key->modulusN, n) != 1 ||
-        qat_BN_to_FB(&cpa_pub_key->publicExponentE, e) != 1) {
-        WARN("Failed to convert cpa_pub_key elements to flatbuffer\n");
-        QATerr(QAT_F_BUILD_ENCRYPT_OP_BUF, QAT_R_N_E_CONVERT_TO_FB_FAILURE);
-        return 0;
-    }
-
     (*enc_op_data)->inputData.pData = (Cpa8U *) qaeCryptoMemAlloc(
         ((padding != RSA_NO_PADDING) && alloc_pad) ? rsa_len : flen,
          __FILE__,
@@ -879,33 +1304,151 @@ build_encrypt_op_buf(int flen, const unsigned char *from, unsigned char *to,
 
 /******************************************************************************
 * function:
-*         qat_rsa_priv_enc (int flen,
-*                           const unsigned char *from,
-*                           unsigned char *to,
-*                           RSA *rsa,
-*                           int padding)
+*         qat_rsa_hw_lenstra_check(RSA *rsa,
+*                                  const unsigned char *sig,
+*                                  const unsigned char *msg,
+*                                  int rsa_len)
+*
+* @param rsa     [IN] - pointer to the key structure
+* @param sig     [IN] - output of the private key operation, rsa_len bytes
+* @param msg     [IN] - input of the private key operation, rsa_len bytes
+* @param rsa_len [IN] - RSA size in bytes
+*
+* description:
+*   Lenstra attack protection performed on the accelerator. The output of
+*   the private key operation is raised to the public exponent with
+*   cpaCyRsaEncrypt and compared with the input it was computed from. The
+*   request is submitted from the same async job as the private key
+*   operation so no public key operation is handed back to the core.
+*   Returns 1 if the results match, 0 if they do not, and -1 if the check
+*   could not be performed on the accelerator in which case the caller
+*   verifies in software instead. This includes keys outside the 512 to
+*   4096 bit range of the public key offload, which the private key CRT
+*   path accepts up to 8192 bits.
+******************************************************************************/
+static int qat_rsa_hw_lenstra_check(RSA *rsa, const unsigned char *sig,
+                                    const unsigned char *msg, int rsa_len)
+{
+    CpaCyRsaEncryptOpData *enc_op_data = NULL;
+    CpaFlatBuffer *output_buffer = NULL;
+    int ret = -1, fallback = 0, key_cached = 0;
+
+    /* The public key operation is not offloaded for CRT only moduli */
+    if (rsa_len != RSA_size((const RSA*)rsa) ||
+        !qat_rsa_range_check(RSA_bits((const RSA*)rsa)))
+        return ret;
+
+    /* Errors are not reported as the software check is used instead */
+    ERR_set_mark();
+    if (1 == build_encrypt_op_buf(rsa_len, sig, NULL, rsa, RSA_NO_PADDING,
+                                  &enc_op_data, &output_buffer, NO_PADDING,
+                                  &key_cached) &&
+        1 == qat_rsa_encrypt(enc_op_data, output_buffer, &fallback)) {
+        ret = (CRYPTO_memcmp(msg, output_buffer->pData, rsa_len) == 0) ? 1 : 0;
+    } else {
+        WARN("Failed to perform the Lenstra check on the accelerator\n");
+    }
+    ERR_pop_to_mark();
+
+    rsa_encrypt_op_buf_free(enc_op_data, output_buffer, key_cached);
+    return ret;
+}
+
+#ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
+/******************************************************************************
+* function:
+*         qat_rsa_lenstra_check(int flen,
+*                               const unsigned char *from,
+*                               const unsigned char *to,
+*                               const unsigned char *msg,
+*                               RSA *rsa,
+*                               int padding,
+*                               int rsa_len)
+*
+* @param flen    [IN] - length in bytes of the input of the sign operation
+* @param from    [IN] - input of the sign operation
+* @param to      [IN] - signature produced on the accelerator
+* @param msg     [IN] - padded input the signature was computed from
+* @param rsa     [IN] - pointer to the key structure
+* @param padding [IN] - Padding scheme
+* @param rsa_len [IN] - RSA size in bytes
+*
+* description:
+*   Lenstra attack protection for a signature produced on the accelerator.
+*   The signature is verified on the accelerator if enabled and possible,
+*   otherwise with the software public decrypt. Returns 1 if the signature
+*   verifies or the key has no public exponent, 0 if it does not verify in
+*   which case the caller redoes the sign operation in software, and -1 on
+*   failure.
+******************************************************************************/
+static int qat_rsa_lenstra_check(int flen, const unsigned char *from,
+                                 const unsigned char *to,
+                                 const unsigned char *msg, RSA *rsa,
+                                 int padding, int rsa_len)
+{
+    unsigned char *ver_msg = NULL;
+    const BIGNUM *n = NULL;
+    const BIGNUM *e = NULL;
+    const BIGNUM *d = NULL;
+    int ret = -1;
+
+    RSA_get0_key((const RSA*)rsa, &n, &e, &d);
+
+    /* Note: not checking 'd' as it is not used */
+    if (e == NULL)
+        return 1;
+
+    if (enable_hw_lenstra_check &&
+        (ret = qat_rsa_hw_lenstra_check(rsa, to, msg, rsa_len)) != -1)
+        return ret;
+
+    ver_msg = OPENSSL_zalloc(flen);
+    if (ver_msg == NULL) {
+        WARN("ver_msg zalloc failed.\n");
+        QATerr(QAT_F_QAT_RSA_PRIV_ENC, ERR_R_MALLOC_FAILURE);
+        return -1;
+    }
+    ret = (RSA_meth_get_pub_dec(RSA_PKCS1_OpenSSL())
+           (rsa_len, to, ver_msg, rsa, padding) > 0 &&
+           CRYPTO_memcmp(from, ver_msg, flen) == 0) ? 1 : 0;
+    OPENSSL_free(ver_msg);
+    return ret;
+}
+#endif
+
+/******************************************************************************
+* function:
+*         qat_rsa_priv_enc_int(int flen,
+*                              const unsigned char *from,
+*                              unsigned char *to,
+*                              RSA *rsa,
+*                              int padding,
+*                              qat_asym_sample_t *sample)
 *
 * @param flen    [IN]  - length in bytes of input file
 * @param from    [IN]  - pointer to the input file
 * @param to      [OUT] - pointer to output signature
 * @param rsa     [IN]  - pointer to private key structure
 * @param padding [IN]  - Padding scheme
+* @param sample  [IN]  - dispatch decision already taken for this request,
+*                        or NULL to take it here
 *
 * description: Perform an RSA private encrypt (RSA Sign)
 *              We use the decrypt implementation to achieve this.
+*              The batch passes down the decision it took for a request so
+*              that the request is neither dispatched nor sampled twice.
 ******************************************************************************/
-int qat_rsa_priv_enc(int flen, const unsigned char *from, unsigned char *to,
-                     RSA *rsa, int padding)
+static int qat_rsa_priv_enc_int(int flen, const unsigned char *from,
+                                unsigned char *to, RSA *rsa, int padding,
+                                qat_asym_sample_t *sample)
 {
     int rsa_len = 0;
     CpaCyRsaDecryptOpData *dec_op_data = NULL;
     CpaFlatBuffer *output_buffer = NULL;
-    int sts = 1, fallback = 0;
+    int sts = 1, fallback = 0, key_cached = 0;
+    qat_asym_sample_t local_sample;
 #ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
-    unsigned char *ver_msg = NULL;
-    const BIGNUM *n = NULL;
-    const BIGNUM *e = NULL;
-    const BIGNUM *d = NULL;
+    int lenstra_ret = 1;
 #endif
 
     DEBUG("- Started.\n");
@@ -935,19 +1478,33 @@ int qat_rsa_priv_enc(int flen, const unsigned char *from, unsigned char *to,
     * back to software
     */
 
-    if (!qat_rsa_range_check(RSA_bits((const RSA*)rsa)))
+    if (!qat_rsa_priv_range_check(RSA_bits((const RSA*)rsa)))
         return RSA_meth_get_priv_enc(RSA_PKCS1_OpenSSL())
                                      (flen, from, to, rsa, padding);
 
+    if (sample == NULL) {
+        sample = &local_sample;
+        qat_asym_dispatch_begin(sample, QAT_ASYM_RSA_PRIV,
+                                RSA_bits((const RSA*)rsa));
+    }
+    if (!sample->offload) {
+        int sw_len = RSA_meth_get_priv_enc(RSA_PKCS1_OpenSSL())
+                                           (flen, from, to, rsa, padding);
+        if (sw_len > 0)
+            qat_asym_dispatch_end(sample);
+        return sw_len;
+    }
+
     if (1 != build_decrypt_op_buf(flen, from, to, rsa, padding,
-                                  &dec_op_data, &output_buffer, PADDING)) {
+                                  &dec_op_data, &output_buffer, PADDING,
+                                  &key_cached)) {
         WARN("Failure in build_decrypt_op_buf\n");
         /* Errors are already raised within build_decrypt_op_buf. */
         sts = 0;
         goto exit;
     }
 
-    if (1 != qat_rsa_decrypt(dec_op_data, rsa_len, output_buffer, &fallback)) {
+    if (1 != qat_rsa_decrypt(dec_op_data, rsa, rsa_len, output_buffer, &fallback)) {
         WARN("Failure in qat_rsa_decrypt  fallback = %d\n", fallback);
         /* Errors are already raised within qat_rsa_decrypt. */
         sts = 0;
@@ -955,39 +1512,34 @@ int qat_rsa_priv_enc(int flen, const unsigned char *from, unsigned char *to,
     }
     memcpy(to, output_buffer->pData, rsa_len);
 
-    rsa_decrypt_op_buf_free(dec_op_data, output_buffer);
-
 #ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
-    /* Lenstra vulnerability protection: Now call the s/w impl'n of public decrypt in order to
-       verify the sign operation just carried out (cpaCyRsaDecrypt). */
-    RSA_get0_key((const RSA*)rsa, &n, &e, &d);
+    /* Lenstra vulnerability protection: verify the sign operation just
+       carried out (cpaCyRsaDecrypt) before releasing the signature. */
+    lenstra_ret = qat_rsa_lenstra_check(flen, from, to,
+                                        dec_op_data->inputData.pData,
+                                        rsa, padding, rsa_len);
+#endif
 
-    /* Note: not checking 'd' as it is not used */
-    if (e != NULL) { /* then a public key exists and we can effect Lenstra attack protection*/
-        ver_msg = OPENSSL_zalloc(flen);
-        if (ver_msg == NULL) {
-            WARN("ver_msg zalloc failed.\n");
-            QATerr(QAT_F_QAT_RSA_PRIV_ENC, ERR_R_MALLOC_FAILURE);
-            sts = 0;
-            goto exit_lenstra;
-        }
-        if ((RSA_meth_get_pub_dec(RSA_PKCS1_OpenSSL())
-             (rsa_len, (const unsigned char *)to, ver_msg, rsa, padding) <= 0)
-            || (CRYPTO_memcmp(from, ver_msg, flen) != 0)) {
-            WARN("- Verify failed - redoing sign operation in s/w\n");
-            OPENSSL_free(ver_msg);
-            return RSA_meth_get_priv_enc(RSA_PKCS1_OpenSSL())(flen, from, to, rsa, padding);
-        }
-        OPENSSL_free(ver_msg);
+    rsa_decrypt_op_buf_free(dec_op_data, output_buffer, key_cached);
+
+#ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
+    if (lenstra_ret == 0) {
+        WARN("- Verify failed - redoing sign operation in s/w\n");
+        return RSA_meth_get_priv_enc(RSA_PKCS1_OpenSSL())(flen, from, to, rsa, padding);
+    }
+    if (lenstra_ret < 0) {
+        sts = 0;
+        goto exit_lenstra;
     }
 #endif
 
+    qat_asym_dispatch_end(sample);
     DEBUG("- Finished\n");
     return rsa_len;
 
 exit:
     /* Free all the memory allocated in this function */
-    rsa_decrypt_op_buf_free(dec_op_data, output_buffer);
+    rsa_decrypt_op_buf_free(dec_op_data, output_buffer, key_cached);
 #ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
 exit_lenstra:
 #endif
@@ -1007,6 +1559,290 @@ exit_lenstra:
     return 0;
 }
 
+int qat_rsa_priv_enc(int flen, const unsigned char *from, unsigned char *to,
+                     RSA *rsa, int padding)
+{
+    return qat_rsa_priv_enc_int(flen, from, to, rsa, padding, NULL);
+}
+
+/* Per request state of a batch of RSA sign operations */
+typedef struct {
+    CpaCyRsaDecryptOpData *dec_op_data;
+    CpaFlatBuffer *output_buffer;
+    int key_cached;
+    qat_asym_sample_t sample;
+    int dispatched;
+    int batched;
+} qat_rsa_batch_op_t;
+
+/******************************************************************************
+* function:
+*         qat_rsa_priv_enc_batch(qat_rsa_sign_req_t *reqs, int num_reqs)
+*
+* @param reqs     [IN/OUT] - array of sign requests
+* @param num_reqs [IN]     - number of entries in reqs
+*
+* description:
+*   Performs a batch of RSA private encrypt (RSA Sign) operations. The
+*   requests within the range supported by cpaCyRsaDecrypt are submitted
+*   back to back to the same instance and waited for once, pausing the
+*   async job a single time rather than once per signature. The requests
+*   that cannot be batched, or that fail on the accelerator, are performed
+*   one at a time through qat_rsa_priv_enc_int which falls back to software
+*   as usual. The signature length, or 0 on failure, is returned in the ret
+*   field of each request. Returns 1 if all the requests succeeded and 0
+*   otherwise.
+******************************************************************************/
+int qat_rsa_priv_enc_batch(qat_rsa_sign_req_t *reqs, int num_reqs)
+{
+    qat_rsa_batch_op_t *ops = NULL;
+    op_done_rsa_crt_t op_done;
+    CpaStatus sts = CPA_STATUS_FAIL;
+    int inst_num = QAT_INVALID_INSTANCE;
+    int job_ret = 0, i = 0, ret = 1;
+    unsigned int num_batched = 0;
+    int qatPerformOpRetries = 0;
+    int iMsgRetry = getQatMsgRetryCount();
+    useconds_t ulPollInterval = getQatPollInterval();
+    thread_local_variables_t *tlv = NULL;
+#ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
+    int lenstra_ret = 1;
+#endif
+
+    DEBUG("- Started.\n");
+
+    if (unlikely(reqs == NULL || num_reqs <= 0)) {
+        WARN("Invalid batch of %d requests\n", num_reqs);
+        QATerr(QAT_F_QAT_RSA_PRIV_ENC_BATCH, QAT_R_RSA_FROM_TO_NULL);
+        return 0;
+    }
+
+    for (i = 0; i < num_reqs; i++)
+        reqs[i].ret = 0;
+
+    if (qat_get_qat_offload_disabled())
+        goto single;
+
+    ops = OPENSSL_zalloc(num_reqs * sizeof(qat_rsa_batch_op_t));
+    if (ops == NULL) {
+        /* Not fatal, the requests are then performed one at a time */
+        WARN("Failed to allocate the batch state\n");
+        goto single;
+    }
+
+    for (i = 0; i < num_reqs; i++) {
+        if (reqs[i].rsa == NULL || reqs[i].from == NULL ||
+            reqs[i].to == NULL || reqs[i].flen <= 0 ||
+            !qat_rsa_range_check(RSA_bits((const RSA*)reqs[i].rsa)) ||
+            qat_rsa_is_multi_prime((const RSA*)reqs[i].rsa))
+            continue;
+        ops[i].dispatched = 1;
+        if (!qat_asym_dispatch_begin(&ops[i].sample, QAT_ASYM_RSA_PRIV,
+                                     RSA_bits((const RSA*)reqs[i].rsa))) {
+            /* Performed in software now so that its latency is its own */
+            reqs[i].ret = qat_rsa_priv_enc_int(reqs[i].flen, reqs[i].from,
+                                               reqs[i].to, reqs[i].rsa,
+                                               reqs[i].padding,
+                                               &ops[i].sample);
+            if (reqs[i].ret <= 0) {
+                reqs[i].ret = 0;
+                ret = 0;
+            }
+            continue;
+        }
+        /*
+         * Errors building a request are not reported here as the request is
+         * performed again through qat_rsa_priv_enc_int which raises them.
+         */
+        ERR_set_mark();
+        if (1 != build_decrypt_op_buf(reqs[i].flen, reqs[i].from, reqs[i].to,
+                                      reqs[i].rsa, reqs[i].padding,
+                                      &ops[i].dec_op_data,
+                                      &ops[i].output_buffer, PADDING,
+                                      &ops[i].key_cached)) {
+            rsa_decrypt_op_buf_free(ops[i].dec_op_data, ops[i].output_buffer,
+                                    ops[i].key_cached);
+            ops[i].dec_op_data = NULL;
+            ops[i].output_buffer = NULL;
+            ERR_pop_to_mark();
+            continue;
+        }
+        ERR_pop_to_mark();
+        ops[i].batched = 1;
+        num_batched++;
+    }
+
+    if (num_batched == 0)
+        goto unbatch;
+
+    tlv = qat_check_create_local_variables();
+    if (NULL == tlv) {
+        WARN("could not create local variables\n");
+        goto unbatch;
+    }
+
+    QAT_INC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+    if (qat_use_signals()) {
+        if (tlv->localOpsInFlight == 1) {
+            if (pthread_kill(timer_poll_func_thread, SIGUSR1) != 0) {
+                WARN("pthread_kill error\n");
+                QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+                goto unbatch;
+            }
+        }
+    }
+
+    if (qat_init_op_done_rsa_crt(&op_done, num_batched) != 1) {
+        WARN("failed to init opdone for the batch\n");
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        goto unbatch;
+    }
+
+    CRYPTO_QAT_LOG("RSA - %s\n", __func__);
+
+    if ((inst_num = get_next_inst_num()) == QAT_INVALID_INSTANCE) {
+        WARN("Failure to get an instance\n");
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
+        qat_cleanup_op_done_rsa_crt(&op_done);
+        QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+        goto unbatch;
+    }
+
+    /* send the requests back to back so that the ring is kept full */
+    for (i = 0; i < num_reqs; i++) {
+        if (!ops[i].batched)
+            continue;
+        do {
+            sts = cpaCyRsaDecrypt(qat_instance_handles[inst_num],
+                                  qat_rsaCallbackFn_CRT, &op_done,
+                                  ops[i].dec_op_data, ops[i].output_buffer);
+            if (sts == CPA_STATUS_RETRY) {
+                if (op_done.opDone.job == NULL) {
+                    usleep(ulPollInterval +
+                           (qatPerformOpRetries % QAT_RETRY_BACKOFF_MODULO_DIVISOR));
+                    qatPerformOpRetries++;
+                    if (iMsgRetry != QAT_INFINITE_MAX_NUM_RETRIES) {
+                        if (qatPerformOpRetries >= iMsgRetry) {
+                            WARN("No. of retries exceeded max retry : %d\n", iMsgRetry);
+                            break;
+                        }
+                    }
+                } else {
+                    if ((qat_wake_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0) ||
+                        (qat_pause_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0)) {
+                        WARN("qat_wake_job or qat_pause_job failed\n");
+                        break;
+                    }
+                }
+            }
+        }
+        while (sts == CPA_STATUS_RETRY);
+
+        if (sts != CPA_STATUS_SUCCESS) {
+            WARN("Failed to submit request %d to qat - status = %d\n", i, sts);
+            break;
+        }
+
+        op_done.req++;
+        if (enable_heuristic_polling) {
+            QAT_ATOMIC_INC(num_asym_requests_in_flight);
+        }
+    }
+
+    /* wait for replies */
+    if (op_done.req == num_batched && op_done.opDone.job != NULL) {
+        do {
+            /* If we get a failure on qat_pause_job then we will
+               not flag an error here and quit because we have
+               asynchronous requests in flight.
+               We don't want to start cleaning up data
+               structures that are still being used. If
+               qat_pause_job fails we will just yield and
+               loop around and try again until the requests
+               complete and we can continue. */
+            if ((job_ret = qat_pause_job(op_done.opDone.job, ASYNC_STATUS_OK)) == 0)
+                pthread_yield();
+        } while (op_done.resp != op_done.req ||
+                 QAT_CHK_JOB_RESUMED_UNEXPECTEDLY(job_ret));
+    } else {
+        /*
+         * Sync mode, or a submission failed in which case the callback
+         * will not wake the job and the outstanding responses are polled
+         * for here before the buffers are released.
+         */
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
+        while (op_done.resp != op_done.req) {
+            if(getEnableInlinePolling()) {
+                icp_sal_CyPollInstance(qat_instance_handles[inst_num], 0);
+            }
+            else
+                pthread_yield();
+        }
+    }
+    QAT_DEC_IN_FLIGHT_REQS(num_requests_in_flight, tlv);
+
+    /*
+     * The results of the batch are only used if all of them completed, the
+     * status of the individual requests is not known otherwise.
+     */
+    if (op_done.req != num_batched || op_done.opDone.verifyResult != CPA_TRUE) {
+        WARN("Batch of %u requests failed - performing them one at a time\n",
+             num_batched);
+        qat_cleanup_op_done_rsa_crt(&op_done);
+        goto unbatch;
+    }
+    qat_cleanup_op_done_rsa_crt(&op_done);
+
+    for (i = 0; i < num_reqs; i++) {
+        if (!ops[i].batched)
+            continue;
+        memcpy(reqs[i].to, ops[i].output_buffer->pData, RSA_size(reqs[i].rsa));
+#ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
+        lenstra_ret = qat_rsa_lenstra_check(reqs[i].flen, reqs[i].from,
+                                            reqs[i].to,
+                                            ops[i].dec_op_data->inputData.pData,
+                                            reqs[i].rsa, reqs[i].padding,
+                                            RSA_size(reqs[i].rsa));
+        if (lenstra_ret != 1) {
+            WARN("- Verify failed - redoing sign operation %d\n", i);
+            continue;
+        }
+#endif
+        reqs[i].ret = RSA_size(reqs[i].rsa);
+        qat_asym_dispatch_end(&ops[i].sample);
+    }
+
+unbatch:
+    for (i = 0; i < num_reqs; i++) {
+        rsa_decrypt_op_buf_free(ops[i].dec_op_data, ops[i].output_buffer,
+                                ops[i].key_cached);
+        /* A request performed again is offloaded but no longer timed */
+        ops[i].sample.slot = NULL;
+    }
+
+single:
+    for (i = 0; i < num_reqs; i++) {
+        if (reqs[i].ret > 0 || (ops != NULL && ops[i].dispatched &&
+                                !ops[i].sample.offload))
+            continue;
+        reqs[i].ret = qat_rsa_priv_enc_int(reqs[i].flen, reqs[i].from,
+                                           reqs[i].to, reqs[i].rsa,
+                                           reqs[i].padding,
+                                           (ops != NULL && ops[i].dispatched)
+                                           ? &ops[i].sample : NULL);
+        if (reqs[i].ret <= 0) {
+            reqs[i].ret = 0;
+            ret = 0;
+        }
+    }
+    OPENSSL_free(ops);
+
+    DEBUG("- Finished\n");
+    return ret;
+}
+
 /******************************************************************************
 * function:
 *         qat_rsa_priv_dec(int flen,
@@ -1029,11 +1865,13 @@ int qat_rsa_priv_dec(int flen, const unsigned char *from,
 {
     int rsa_len = 0;
     int output_len = -1;
-    int sts = 1, fallback = 0;
+    int sts = 1, fallback = 0, key_cached = 0;
+    qat_asym_sample_t sample;
     CpaCyRsaDecryptOpData *dec_op_data = NULL;
     CpaFlatBuffer *output_buffer = NULL;
 #ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
     unsigned char *ver_msg = NULL;
+    int lenstra_ret = -1;
     const BIGNUM *n = NULL;
     const BIGNUM *e = NULL;
     const BIGNUM *d = NULL;
@@ -1061,19 +1899,29 @@ int qat_rsa_priv_dec(int flen, const unsigned char *from,
     * back to software
     */
 
-    if (!qat_rsa_range_check(RSA_bits((const RSA*)rsa)))
+    if (!qat_rsa_priv_range_check(RSA_bits((const RSA*)rsa)))
         return RSA_meth_get_priv_dec(RSA_PKCS1_OpenSSL())
                                      (flen, from, to, rsa, padding);
 
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_RSA_PRIV,
+                                 RSA_bits((const RSA*)rsa))) {
+        int sw_len = RSA_meth_get_priv_dec(RSA_PKCS1_OpenSSL())
+                                           (flen, from, to, rsa, padding);
+        if (sw_len > 0)
+            qat_asym_dispatch_end(&sample);
+        return sw_len;
+    }
+
     if (1 != build_decrypt_op_buf(flen, from, to, rsa, padding,
-                                  &dec_op_data, &output_buffer, NO_PADDING)) {
+                                  &dec_op_data, &output_buffer, NO_PADDING,
+                                  &key_cached)) {
         WARN("Failure in build_decrypt_op_buf\n");
         /* Errors are already raised within build_decrypt_op_buf. */
         sts = 0;
         goto exit;
     }
 
-    if (1 != qat_rsa_decrypt(dec_op_data, rsa_len, output_buffer, &fallback)) {
+    if (1 != qat_rsa_decrypt(dec_op_data, rsa, rsa_len, output_buffer, &fallback)) {
         WARN("Failure in qat_rsa_decrypt\n");
         if (fallback == 0) {
             /* Most but not all error cases are also raised within qat_rsa_decrypt. */
@@ -1084,12 +1932,25 @@ int qat_rsa_priv_dec(int flen, const unsigned char *from,
     }
 
 #ifndef OPENSSL_DISABLE_QAT_LENSTRA_PROTECTION
-    /* Lenstra vulnerability protection: Now call the s/w impl'n of public encrypt in order to
-       verify the decrypt operation just carried out. */
     RSA_get0_key((const RSA*)rsa, &n, &e, &d);
 
     /* Note: not checking 'd' as it is not used */
-    if (e != NULL) { /* then a public key exists and we can effect Lenstra attack protection*/
+    if (e != NULL && enable_hw_lenstra_check) {
+        /* Lenstra vulnerability protection: re-encrypt the result on the
+           accelerator and compare it with the ciphertext. */
+        lenstra_ret = qat_rsa_hw_lenstra_check(rsa, output_buffer->pData,
+                                               from, rsa_len);
+        if (lenstra_ret == 0) {
+            WARN("- Verify of offloaded decrypt operation failed - redoing decrypt operation in s/w\n");
+            rsa_decrypt_op_buf_free(dec_op_data, output_buffer, key_cached);
+            return RSA_meth_get_priv_dec(RSA_PKCS1_OpenSSL())(flen, from, to, rsa, padding);
+        }
+    }
+
+    /* Lenstra vulnerability protection: Now call the s/w impl'n of public encrypt in order to
+       verify the decrypt operation just carried out, unless this has already
+       been done on the accelerator. */
+    if (e != NULL && lenstra_ret == -1) { /* then a public key exists and we can effect Lenstra attack protection*/
         ver_msg = OPENSSL_zalloc(flen);
         if (ver_msg == NULL) {
             WARN("ver_msg zalloc failed.\n");
@@ -1102,7 +1963,7 @@ int qat_rsa_priv_dec(int flen, const unsigned char *from,
             || (CRYPTO_memcmp(from, ver_msg, flen) != 0)) {
             WARN("- Verify of offloaded decrypt operation failed - redoing decrypt operation in s/w\n");
             OPENSSL_free(ver_msg);
-            rsa_decrypt_op_buf_free(dec_op_data, output_buffer);
+            rsa_decrypt_op_buf_free(dec_op_data, output_buffer, key_cached);
             return RSA_meth_get_priv_dec(RSA_PKCS1_OpenSSL())(flen, from, to, rsa, padding);
         }
         OPENSSL_free(ver_msg);
@@ -1155,14 +2016,15 @@ int qat_rsa_priv_dec(int flen, const unsigned char *from,
         goto exit;
     }
 
-    rsa_decrypt_op_buf_free(dec_op_data, output_buffer);
+    rsa_decrypt_op_buf_free(dec_op_data, output_buffer, key_cached);
 
+    qat_asym_dispatch_end(&sample);
     DEBUG("- Finished\n");
     return output_len;
 
  exit:
     /* Free all the memory allocated in this function */
-    rsa_decrypt_op_buf_free(dec_op_data, output_buffer);
+    rsa_decrypt_op_buf_free(dec_op_data, output_buffer, key_cached);
 
     if (fallback) {
         WARN("- Fallback to software mode.\n");
@@ -1205,7 +2067,8 @@ int qat_rsa_pub_enc(int flen, const unsigned char *from,
     int rsa_len = 0;
     CpaCyRsaEncryptOpData *enc_op_data = NULL;
     CpaFlatBuffer *output_buffer = NULL;
-    int sts = 1, fallback = 0;
+    int sts = 1, fallback = 0, key_cached = 0;
+    qat_asym_sample_t sample;
 
     DEBUG("- Started\n");
 
@@ -1234,8 +2097,18 @@ int qat_rsa_pub_enc(int flen, const unsigned char *from,
         return RSA_meth_get_pub_enc(RSA_PKCS1_OpenSSL())
                                     (flen, from, to, rsa, padding);
 
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_RSA_PUB,
+                                 RSA_bits((const RSA*)rsa))) {
+        int sw_len = RSA_meth_get_pub_enc(RSA_PKCS1_OpenSSL())
+                                          (flen, from, to, rsa, padding);
+        if (sw_len > 0)
+            qat_asym_dispatch_end(&sample);
+        return sw_len;
+    }
+
     if (1 != build_encrypt_op_buf(flen, from, to, rsa, padding,
-                                  &enc_op_data, &output_buffer, PADDING)) {
+                                  &enc_op_data, &output_buffer, PADDING,
+                                  &key_cached)) {
         WARN("Failure in build_encrypt_op_buf\n");
         /* Errors are already raised within build_encrypt_op_buf. */
         sts = 0;
@@ -1251,13 +2124,14 @@ int qat_rsa_pub_enc(int flen, const unsigned char *from,
     } else {
         memcpy(to, output_buffer->pData, output_buffer->dataLenInBytes);
     }
-    rsa_encrypt_op_buf_free(enc_op_data, output_buffer);
+    rsa_encrypt_op_buf_free(enc_op_data, output_buffer, key_cached);
 
+    qat_asym_dispatch_end(&sample);
     DEBUG("- Finished\n");
     return rsa_len;
  exit:
     /* Free all the memory allocated in this function */
-    rsa_encrypt_op_buf_free(enc_op_data, output_buffer);
+    rsa_encrypt_op_buf_free(enc_op_data, output_buffer, key_cached);
 
     if (fallback) {
         WARN("- Fallback to software mode.\n");
@@ -1300,7 +2174,8 @@ int qat_rsa_pub_dec(int flen, const unsigned char *from, unsigned char *to,
     int output_len = -1;
     CpaCyRsaEncryptOpData *enc_op_data = NULL;
     CpaFlatBuffer *output_buffer = NULL;
-    int sts = 1, fallback = 0;
+    int sts = 1, fallback = 0, key_cached = 0;
+    qat_asym_sample_t sample;
 
     DEBUG("- Started\n");
 
@@ -1328,8 +2203,18 @@ int qat_rsa_pub_dec(int flen, const unsigned char *from, unsigned char *to,
         return RSA_meth_get_pub_dec(RSA_PKCS1_OpenSSL())
                                     (flen, from, to, rsa, padding);
 
+    if (!qat_asym_dispatch_begin(&sample, QAT_ASYM_RSA_PUB,
+                                 RSA_bits((const RSA*)rsa))) {
+        int sw_len = RSA_meth_get_pub_dec(RSA_PKCS1_OpenSSL())
+                                          (flen, from, to, rsa, padding);
+        if (sw_len > 0)
+            qat_asym_dispatch_end(&sample);
+        return sw_len;
+    }
+
     if (1 != build_encrypt_op_buf(flen, from, to, rsa, padding,
-                                  &enc_op_data, &output_buffer, NO_PADDING)) {
+                                  &enc_op_data, &output_buffer, NO_PADDING,
+                                  &key_cached)) {
         WARN("Failure in build_encrypt_op_buf\n");
         /* Errors are already raised within build_encrypt_op_buf. */
         sts = 0;
@@ -1379,13 +2264,14 @@ int qat_rsa_pub_dec(int flen, const unsigned char *from, unsigned char *to,
         goto exit;
     }
 
-    rsa_encrypt_op_buf_free(enc_op_data, output_buffer);
+    rsa_encrypt_op_buf_free(enc_op_data, output_buffer, key_cached);
+    qat_asym_dispatch_end(&sample);
     DEBUG("- Finished\n");
     return output_len;
 
  exit:
     /* Free all the memory allocated in this function */
-    rsa_encrypt_op_buf_free(enc_op_data, output_buffer);
+    rsa_encrypt_op_buf_free(enc_op_data, output_buffer, key_cached);
 
     if (fallback) {
         WARN("- Fallback to software mode.\n");
@@ -1421,6 +2307,260 @@ qat_rsa_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
                                 (r0, I, rsa, ctx);
 }
 
+/******************************************************************************
+* function:
+*         qat_rsa_mod_inverse(BIGNUM *r, const BIGNUM *a, const BIGNUM *m,
+*                             BN_CTX *ctx)
+*
+* @param r   [OUT] - inverse of a modulo m
+* @param a   [IN]  - bignum to invert
+* @param m   [IN]  - modulus
+* @param ctx [IN]  - BN_CTX used by the software path
+*
+* description:
+*   Computes a modular inverse for key generation on the accelerator,
+*   falling back to BN_mod_inverse if that fails. Errors raised on the way
+*   are not left behind when the software path succeeds.
+******************************************************************************/
+static int qat_rsa_mod_inverse(BIGNUM *r, const BIGNUM *a, const BIGNUM *m,
+                               BN_CTX *ctx)
+{
+    int fallback = 0;
+
+    if (!qat_get_qat_offload_disabled() && (BN_is_odd(a) || BN_is_odd(m))) {
+        ERR_set_mark();
+        if (qat_mod_inv(r, a, m, &fallback)) {
+            ERR_pop_to_mark();
+            return 1;
+        }
+        ERR_pop_to_mark();
+        WARN("Modular inversion failed on qat - performing it in sw\n");
+    }
+    return BN_mod_inverse(r, a, m, ctx) != NULL;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_multi_prime_keygen(RSA *rsa, int bits, int primes,
+*                                    BIGNUM *e_value, BN_GENCB *cb)
+*
+* @param rsa     [OUT] - RSA object the key is set in
+* @param bits    [IN]  - size of the modulus in bits
+* @param primes  [IN]  - number of primes
+* @param e_value [IN]  - public exponent
+* @param cb      [IN]  - callback reporting the progress as for
+*                        RSA_generate_multi_prime_key
+*
+* description:
+*   Generates an RSA key as RSA_generate_multi_prime_key does on core. The
+*   primes come from qat_generate_prime, which tests the candidates by
+*   batches on the accelerator, and the private exponent and the CRT
+*   coefficients are computed with modular inversions on the accelerator.
+******************************************************************************/
+int
+qat_rsa_multi_prime_keygen(RSA *rsa, int bits, int primes, BIGNUM *e_value,
+                           BN_GENCB *cb)
+{
+    BIGNUM *n = NULL, *e = NULL, *d = NULL;
+    BIGNUM *r[QAT_RSA_MAX_PRIMES] = { NULL, };
+    BIGNUM *dr[QAT_RSA_MAX_PRIMES] = { NULL, };
+    BIGNUM *t[QAT_RSA_MAX_PRIMES] = { NULL, };
+    BIGNUM *r1[QAT_RSA_MAX_PRIMES] = { NULL, };
+    BIGNUM *phi = NULL, *prod = NULL, *gcd = NULL;
+    BN_CTX *ctx = NULL;
+    int ok = 0, retries = 0, i = 0, j = 0, cap = 2, bitsr = 0;
+
+    DEBUG("- Started\n");
+
+    /* Matches the limits OpenSSL keeps internal */
+    if (bits >= 8192)
+        cap = 5;
+    else if (bits >= 4096)
+        cap = 4;
+    else if (bits >= 1024)
+        cap = 3;
+    if (cap > QAT_RSA_MAX_PRIMES)
+        cap = QAT_RSA_MAX_PRIMES;
+
+    if (unlikely(rsa == NULL || e_value == NULL || !BN_is_odd(e_value) ||
+                 bits < RSA_QAT_RANGE_MIN || primes < 2 || primes > cap)) {
+        WARN("Invalid input params.\n");
+        QATerr(QAT_F_QAT_RSA_KEYGEN, QAT_R_INPUT_PARAM_INVALID);
+        return 0;
+    }
+
+    if ((ctx = BN_CTX_new()) == NULL) {
+        WARN("Failure to allocate ctx\n");
+        QATerr(QAT_F_QAT_RSA_KEYGEN, QAT_R_CTX_MALLOC_FAILURE);
+        return 0;
+    }
+    BN_CTX_start(ctx);
+    phi = BN_CTX_get(ctx);
+    prod = BN_CTX_get(ctx);
+    gcd = BN_CTX_get(ctx);
+    for (i = 0; i < primes; i++) {
+        r1[i] = BN_CTX_get(ctx);
+        r[i] = BN_secure_new();
+        dr[i] = BN_secure_new();
+        /* t[0] is unused, t[1] being iqmp */
+        if (i > 0)
+            t[i] = BN_secure_new();
+        if (r[i] == NULL || dr[i] == NULL || (i > 0 && t[i] == NULL))
+            break;
+        BN_set_flags(r[i], BN_FLG_CONSTTIME);
+    }
+    n = BN_new();
+    e = BN_dup(e_value);
+    d = BN_secure_new();
+    if (i < primes || r1[primes - 1] == NULL || n == NULL || e == NULL ||
+        d == NULL) {
+        WARN("Failure to allocate the key\n");
+        QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+    BN_set_flags(phi, BN_FLG_CONSTTIME);
+    BN_set_flags(prod, BN_FLG_CONSTTIME);
+
+    /*
+     * The primes are distinct, r - 1 is coprime with e, and the last prime
+     * is drawn again until the modulus has exactly bits bits.
+     */
+    for (i = 0; i < primes; i++) {
+        bitsr = bits / primes + (i < bits % primes);
+        for (;;) {
+            if (!qat_generate_prime(r[i], bitsr, 0, NULL, NULL, cb) ||
+                !BN_sub(r1[i], r[i], BN_value_one()) ||
+                !BN_gcd(gcd, r1[i], e, ctx))
+                goto err;
+            for (j = 0; j < i && BN_cmp(r[i], r[j]) != 0; j++)
+                continue;
+            if (BN_is_one(gcd) && j == i) {
+                if (i == 0) {
+                    if (BN_copy(n, r[0]) == NULL)
+                        goto err;
+                    break;
+                }
+                if (!BN_mul(prod, n, r[i], ctx))
+                    goto err;
+                if (i < primes - 1 || BN_num_bits(prod) == bits) {
+                    if (BN_copy(n, prod) == NULL)
+                        goto err;
+                    break;
+                }
+            }
+            if (!BN_GENCB_call(cb, 2, retries++))
+                goto err;
+        }
+        if (!BN_GENCB_call(cb, 3, i))
+            goto err;
+    }
+
+    /* p is the larger of the first two primes */
+    if (BN_cmp(r[0], r[1]) < 0) {
+        BN_swap(r[0], r[1]);
+        BN_swap(r1[0], r1[1]);
+    }
+
+    if (BN_copy(phi, r1[0]) == NULL) {
+        QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_BN_LIB);
+        goto err;
+    }
+    for (i = 1; i < primes; i++) {
+        if (!BN_mul(phi, phi, r1[i], ctx)) {
+            WARN("Failure to compute phi\n");
+            QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_BN_LIB);
+            goto err;
+        }
+    }
+
+    if (!qat_rsa_mod_inverse(d, e, phi, ctx)) {
+        WARN("Failure to compute d\n");
+        QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    /*
+     * t[1] is iqmp, the inverse of q mod p, and the following t[i] are the
+     * inverses of the products of the preceding primes mod r[i].
+     */
+    if (BN_copy(prod, r[0]) == NULL)
+        goto err;
+    for (i = 0; i < primes; i++) {
+        if (!BN_mod(dr[i], d, r1[i], ctx) ||
+            (i == 1 && !qat_rsa_mod_inverse(t[1], r[1], r[0], ctx)) ||
+            (i > 1 && !qat_rsa_mod_inverse(t[i], prod, r[i], ctx)) ||
+            (i > 0 && !BN_mul(prod, prod, r[i], ctx))) {
+            WARN("Failure to compute the CRT parameters\n");
+            QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_BN_LIB);
+            goto err;
+        }
+    }
+
+    if (!RSA_set0_key(rsa, n, e, d)) {
+        WARN("Failure to set the key\n");
+        QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    n = e = d = NULL;
+    if (!RSA_set0_factors(rsa, r[0], r[1])) {
+        WARN("Failure to set the factors\n");
+        QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    r[0] = r[1] = NULL;
+    if (!RSA_set0_crt_params(rsa, dr[0], dr[1], t[1])) {
+        WARN("Failure to set the CRT parameters\n");
+        QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+    dr[0] = dr[1] = t[1] = NULL;
+#ifdef QAT_RSA_MULTI_PRIME
+    if (primes > 2) {
+        if (!RSA_set0_multi_prime_params(rsa, &r[2], &dr[2], &t[2],
+                                         primes - 2)) {
+            WARN("Failure to set the additional primes\n");
+            QATerr(QAT_F_QAT_RSA_KEYGEN, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+        for (i = 2; i < primes; i++)
+            r[i] = dr[i] = t[i] = NULL;
+    }
+#endif
+    ok = 1;
+
+ err:
+    BN_free(n);
+    BN_free(e);
+    BN_clear_free(d);
+    for (i = 0; i < QAT_RSA_MAX_PRIMES; i++) {
+        BN_clear_free(r[i]);
+        BN_clear_free(dr[i]);
+        BN_clear_free(t[i]);
+    }
+    BN_CTX_end(ctx);
+    BN_CTX_free(ctx);
+    DEBUG("- Finished\n");
+    return ok;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_keygen(RSA *rsa, int bits, BIGNUM *e_value, BN_GENCB *cb)
+*
+* @param rsa     [OUT] - RSA object the key is set in
+* @param bits    [IN]  - size of the modulus in bits
+* @param e_value [IN]  - public exponent
+* @param cb      [IN]  - callback reporting the progress
+*
+* description:
+*   Generates a two prime RSA key, see qat_rsa_multi_prime_keygen.
+******************************************************************************/
+int
+qat_rsa_keygen(RSA *rsa, int bits, BIGNUM *e_value, BN_GENCB *cb)
+{
+    return qat_rsa_multi_prime_keygen(rsa, bits, 2, e_value, cb);
+}
+
 /******************************************************************************
 * function:
 *         qat_rsa_init(RSA *rsa)
@@ -1428,13 +2568,33 @@ qat_rsa_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
 * @param rsa   [IN] - The RSA data structure
 *
 * description:
-*             Returns sw implementation of rsa_init.
+*             Attaches an empty pinned key cache to the RSA object and
+*             returns sw implementation of rsa_init.
 *             Needed to ensure correct caching occurs.
 *
 *******************************************************************************/
 int
 qat_rsa_init(RSA *rsa)
 {
+    qat_rsa_key_cache_t *cache = NULL;
+
+    if (qat_rsa_key_cache_idx >= 0) {
+        cache = OPENSSL_zalloc(sizeof(qat_rsa_key_cache_t));
+        if (cache != NULL && (cache->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+            OPENSSL_free(cache);
+            cache = NULL;
+        }
+        if (cache == NULL ||
+            !RSA_set_ex_data(rsa, qat_rsa_key_cache_idx, cache)) {
+            /* Not fatal, the key is then converted on every operation */
+            WARN("Failed to set up the RSA key cache\n");
+            if (cache != NULL) {
+                CRYPTO_THREAD_lock_free(cache->lock);
+                OPENSSL_free(cache);
+            }
+        }
+    }
+
     return RSA_meth_get_init(RSA_PKCS1_OpenSSL())(rsa);
 }
 
@@ -1445,13 +2605,39 @@ qat_rsa_init(RSA *rsa)
 * @param rsa   [IN] - The RSA data structure
 *
 * description:
-*             Returns sw implementation of rsa_finish.
+*             Cleanses and frees the pinned key caches of the RSA object
+*             and returns sw implementation of rsa_finish.
 *             Needed to ensure correct cleanup of cached data.
 *
 *******************************************************************************/
 int
 qat_rsa_finish(RSA *rsa)
 {
+    qat_rsa_key_cache_t *cache = NULL;
+
+    if (qat_rsa_key_cache_idx >= 0 &&
+        (cache = RSA_get_ex_data(rsa, qat_rsa_key_cache_idx)) != NULL) {
+        if (cache->priv_key != NULL) {
+            if (cache->pid == getpid())
+                qat_rsa_priv_key_free(cache->priv_key);
+            else
+                OPENSSL_free(cache->priv_key);
+        }
+        qat_rsa_key_cache_clear_priv(cache);
+        qat_rsa_crt_key_free(cache->crt_key);
+        BN_free(cache->n);
+        BN_free(cache->e);
+        if (cache->pub_key != NULL) {
+            if (cache->pub_pid == getpid())
+                qat_rsa_pub_key_free(cache->pub_key);
+            else
+                OPENSSL_free(cache->pub_key);
+        }
+        CRYPTO_THREAD_lock_free(cache->lock);
+        OPENSSL_free(cache);
+        RSA_set_ex_data(rsa, qat_rsa_key_cache_idx, NULL);
+    }
+
     return RSA_meth_get_finish(RSA_PKCS1_OpenSSL())(rsa);
 }
 
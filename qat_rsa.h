@@ -55,4 +55,20 @@ RSA_METHOD *qat_get_RSA_methods(void);
 
 void qat_free_RSA_methods(void);
 
+/*
+ * A sign request of a batch submitted through the RSA_SIGN_BATCH engine
+ * message. ret is set to the length of the signature written to to, or 0
+ * if the request failed.
+ */
+typedef struct {
+    RSA *rsa;
+    const unsigned char *from;
+    int flen;
+    unsigned char *to;
+    int padding;
+    int ret;
+} qat_rsa_sign_req_t;
+
+int qat_rsa_priv_enc_batch(qat_rsa_sign_req_t *reqs, int num_reqs);
+
 #endif                          /* QAT_RSA_H */
@@ -86,136 +86,371 @@
 #endif
 
 #ifndef OPENSSL_DISABLE_QAT_RSA
-static void qat_rsaCallbackFn_CRT(void *pCallbackTag, CpaStatus status, void *pOpData,
-                                  CpaFlatBuffer * pOut)
+/******************************************************************************
+* function:
+*         qat_rsaCallbackFn_CRT(void *pCallbackTag, CpaStatus status,
+*                               void *pOpData, CpaFlatBuffer * pOut)
+*
+* @param pCallbackTag   [IN]  - op_done_rsa_crt_t of the CRT operation.
+* @param status         [IN]  - Status result of the ModExp operation.
+* @param pOpData        [IN]  - ModExp operation data.
+* @param pOut           [IN]  - ModExp result.
+*
+* description:
+*   Callback of each of the ModExp requests of a CRT operation, also used
+*   for the requests of a batch of RSA sign operations. The paused job, if
+*   any, is woken once all the expected responses have arrived.
+*   The response count is updated last as the requesting thread may release
+*   op_done as soon as it sees all the responses.
+******************************************************************************/
+void qat_rsaCallbackFn_CRT(void *pCallbackTag, CpaStatus status, void *pOpData,
+                           CpaFlatBuffer * pOut)
 {
     op_done_rsa_crt_t *op_done = (op_done_rsa_crt_t *)pCallbackTag;
-    op_done->resp++;
+    ASYNC_JOB *job = (ASYNC_JOB *)op_done->opDone.job;
+    unsigned int num_reqs = op_done->num_reqs;
+
+    if (enable_heuristic_polling) {
+        QAT_ATOMIC_DEC(num_asym_requests_in_flight);
+    }
+
     op_done->opDone.verifyResult *= (status == CPA_STATUS_SUCCESS);
     if (op_done->opDone.status == CPA_STATUS_SUCCESS)
         op_done->opDone.status = status;
+
+    if (QAT_ATOMIC_INC(op_done->resp) == num_reqs && job != NULL)
+        qat_wake_job(job, ASYNC_STATUS_OK);
 }
 
-static inline int
-CRT_prepare(CpaFlatBuffer *crt_out1, CpaFlatBuffer *crt_out2,
-             int rsa_len, CpaCyRsaDecryptOpData * dec_op_data,
-             CpaCyLnModExpOpData *crt_op1_data, CpaCyLnModExpOpData *crt_op2_data)
+/******************************************************************************
+* function:
+*         qat_rsa_is_multi_prime(const RSA *rsa)
+*
+* @param rsa [IN] - RSA key
+*
+* description:
+*   Returns 1 if the key has more than two primes, 0 otherwise.
+******************************************************************************/
+int qat_rsa_is_multi_prime(const RSA *rsa)
 {
-    int ret = 0;
-    BN_CTX *ctx = NULL;
-    BIGNUM *c = NULL, *p = NULL, *q = NULL, *cp = NULL, *cq = NULL;
-    unsigned char *cp_buf = NULL, *cq_buf = NULL;
-    CpaCyRsaPrivateKey *cpa_prv_key = dec_op_data->pRecipientPrivateKey;
+#ifdef QAT_RSA_MULTI_PRIME
+    return RSA_get_multi_prime_extra_count(rsa) > 0;
+#else
+    return 0;
+#endif
+}
 
-    if ((ctx = BN_CTX_new()) == NULL) {
-        WARN("Failed to allocate memory for ctx\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_CTX_MALLOC_FAILURE);
-        goto err;
+/*
+ * Fetches the CRT components of rsa, the additional primes of a
+ * multi-prime key from index 2. Returns the number of primes, 0 on failure.
+ */
+static int
+CRT_get0_components(const RSA *rsa, const BIGNUM **r, const BIGNUM **d,
+                    const BIGNUM **t, const BIGNUM **iqmp)
+{
+    int num_primes = 2;
+
+    RSA_get0_factors(rsa, &r[0], &r[1]);
+    RSA_get0_crt_params(rsa, &d[0], &d[1], iqmp);
+#ifdef QAT_RSA_MULTI_PRIME
+    num_primes += RSA_get_multi_prime_extra_count(rsa);
+    if (num_primes > QAT_RSA_MAX_PRIMES) {
+        WARN("Too many primes %d\n", num_primes);
+        return 0;
+    }
+    /* The accessors fill in the additional primes only, from index 0 */
+    if (num_primes > 2 &&
+        (RSA_get0_multi_prime_factors(rsa, &r[2]) != 1 ||
+         RSA_get0_multi_prime_crt_params(rsa, &d[2], &t[2]) != 1)) {
+        WARN("Failed to get the multi-prime key components\n");
+        return 0;
     }
+#endif
+    return num_primes;
+}
 
-    BN_CTX_start(ctx);
+/*
+ * Returns a copy of a secret key component flagged for constant time use,
+ * NULL if bn is NULL or on failure.
+ */
+static inline BIGNUM *
+CRT_bn_dup(const BIGNUM *bn)
+{
+    BIGNUM *r = NULL;
 
-    c = BN_CTX_get(ctx);
-    p = BN_CTX_get(ctx);
-    q = BN_CTX_get(ctx);
-    cp = BN_CTX_get(ctx);
-    cq = BN_CTX_get(ctx);
+    if (bn == NULL || (r = BN_dup(bn)) == NULL)
+        return NULL;
+    BN_set_flags(r, BN_FLG_CONSTTIME);
+    return r;
+}
 
-    if (cq == NULL) {
-        WARN("Failed to allocate c, p, q, cp or cq\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_C_P_Q_CP_CQ_MALLOC_FAILURE);
-        goto err;
+/******************************************************************************
+* function:
+*         qat_rsa_crt_key_new(const RSA *rsa, BN_CTX *ctx)
+*
+* @param rsa [IN] - RSA key
+* @param ctx [IN] - BN_CTX used for the precomputation
+*
+* description:
+*   Precomputes the Montgomery contexts of p and q and the Montgomery form
+*   of iqmp and, for multi-prime keys, the products of the primes preceding
+*   each additional prime. The key components are copied so the result
+*   stays valid if the components of the RSA key are later replaced.
+*   Returns NULL on failure.
+******************************************************************************/
+qat_rsa_crt_key_t *qat_rsa_crt_key_new(const RSA *rsa, BN_CTX *ctx)
+{
+    qat_rsa_crt_key_t *crt_key = NULL;
+    const BIGNUM *r[QAT_RSA_MAX_PRIMES] = { NULL };
+    const BIGNUM *d[QAT_RSA_MAX_PRIMES] = { NULL };
+    const BIGNUM *t[QAT_RSA_MAX_PRIMES] = { NULL };
+    const BIGNUM *iqmp = NULL;
+    int i = 0;
+
+    if ((crt_key = OPENSSL_zalloc(sizeof(qat_rsa_crt_key_t))) == NULL) {
+        WARN("Failed to allocate crt_key\n");
+        return NULL;
     }
 
-    /*
-     * reduce base (c mod p and c mod q) in advance
-     * make sure firmwre to use modulus of expected length
-     */
-    c = BN_bin2bn(dec_op_data->inputData.pData,
-                dec_op_data->inputData.dataLenInBytes, c);
-    p = BN_bin2bn(cpa_prv_key->privateKeyRep2.prime1P.pData,
-                cpa_prv_key->privateKeyRep2.prime1P.dataLenInBytes, p);
-    q = BN_bin2bn(cpa_prv_key->privateKeyRep2.prime2Q.pData,
-                cpa_prv_key->privateKeyRep2.prime2Q.dataLenInBytes, q);
-
-    if (!BN_mod(cp, c, p, ctx)) {
-        WARN("Failed to calculate (c mod p)\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_C_MODULO_P_FAILURE);
-        goto err;
+    if ((crt_key->num_primes = CRT_get0_components(rsa, r, d, t, &iqmp)) == 0) {
+        qat_rsa_crt_key_free(crt_key);
+        return NULL;
     }
-    if (!BN_mod(cq, c, q, ctx)) {
-        WARN("Failed to calculate (c mod q)\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_C_MODULO_Q_FAILURE);
-        goto err;
+
+    for (i = 0; i < crt_key->num_primes; i++) {
+        if ((crt_key->r[i] = CRT_bn_dup(r[i])) == NULL ||
+            (crt_key->d[i] = CRT_bn_dup(d[i])) == NULL ||
+            (i >= 2 && (crt_key->t[i] = CRT_bn_dup(t[i])) == NULL)) {
+            WARN("Failed to copy the key components\n");
+            qat_rsa_crt_key_free(crt_key);
+            return NULL;
+        }
+    }
+    crt_key->p = crt_key->r[0];
+    crt_key->q = crt_key->r[1];
+
+    if ((crt_key->iqmp = CRT_bn_dup(iqmp)) == NULL ||
+        (crt_key->mont_p = BN_MONT_CTX_new()) == NULL ||
+        (crt_key->mont_q = BN_MONT_CTX_new()) == NULL ||
+        (crt_key->iqmp_mont = BN_new()) == NULL ||
+        !BN_MONT_CTX_set(crt_key->mont_p, crt_key->p, ctx) ||
+        !BN_MONT_CTX_set(crt_key->mont_q, crt_key->q, ctx) ||
+        !BN_to_montgomery(crt_key->iqmp_mont, crt_key->iqmp,
+                          crt_key->mont_p, ctx)) {
+        WARN("Failed to precompute the CRT key\n");
+        qat_rsa_crt_key_free(crt_key);
+        return NULL;
     }
 
-    cp_buf = OPENSSL_malloc(rsa_len/2);
-    if (cp_buf == NULL) {
-        WARN("Failure to allocate cp_buf\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_CP_BUF_MALLOC_FAILURE);
-        goto err;
+    /* pp[i] is the product of the primes r[0] .. r[i-1] */
+    for (i = 2; i < crt_key->num_primes; i++) {
+        if ((crt_key->pp[i] = BN_new()) == NULL ||
+            !BN_mul(crt_key->pp[i], (i == 2) ? crt_key->p : crt_key->pp[i - 1],
+                    crt_key->r[i - 1], ctx)) {
+            WARN("Failed to compute the product of the primes\n");
+            qat_rsa_crt_key_free(crt_key);
+            return NULL;
+        }
     }
-    cq_buf = OPENSSL_malloc(rsa_len/2);
-    if (cq_buf == NULL) {
-        WARN("Failure to allocate cq_buf\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_CQ_BUF_MALLOC_FAILURE);
-        goto err;
+
+    return crt_key;
+}
+
+/******************************************************************************
+* function:
+*         qat_rsa_crt_key_free(qat_rsa_crt_key_t *crt_key)
+*
+* @param crt_key [IN] - CRT key to free
+*
+* description:
+*   Cleanses and frees a CRT key built by qat_rsa_crt_key_new.
+******************************************************************************/
+void qat_rsa_crt_key_free(qat_rsa_crt_key_t *crt_key)
+{
+    int i = 0;
+
+    if (crt_key == NULL)
+        return;
+
+    BN_MONT_CTX_free(crt_key->mont_p);
+    BN_MONT_CTX_free(crt_key->mont_q);
+    BN_clear_free(crt_key->iqmp_mont);
+    BN_clear_free(crt_key->iqmp);
+    for (i = 0; i < QAT_RSA_MAX_PRIMES; i++) {
+        BN_clear_free(crt_key->r[i]);
+        BN_clear_free(crt_key->d[i]);
+        BN_clear_free(crt_key->t[i]);
+        BN_clear_free(crt_key->pp[i]);
     }
-    BN_bn2bin(cp, cp_buf);
-    BN_bn2bin(cq, cq_buf);
+    OPENSSL_free(crt_key);
+}
 
-    crt_op1_data->base.pData = qaeCryptoMemAlloc(rsa_len/2, __FILE__, __LINE__);
-    if (crt_op1_data->base.pData == NULL) {
-        WARN("Failure to allocate crt_op1_data->base.pData\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_OP1_BASE_PDATA_MALLOC_FAILURE);
+/******************************************************************************
+* function:
+*         qat_rsa_crt_key_matches(const qat_rsa_crt_key_t *crt_key,
+*                                 const RSA *rsa)
+*
+* @param crt_key [IN] - CRT key built by qat_rsa_crt_key_new
+* @param rsa     [IN] - RSA key
+*
+* description:
+*   Returns 1 if crt_key was built from the current values of every CRT
+*   component of rsa, including the additional primes, 0 otherwise.
+******************************************************************************/
+int qat_rsa_crt_key_matches(const qat_rsa_crt_key_t *crt_key, const RSA *rsa)
+{
+    const BIGNUM *r[QAT_RSA_MAX_PRIMES] = { NULL };
+    const BIGNUM *d[QAT_RSA_MAX_PRIMES] = { NULL };
+    const BIGNUM *t[QAT_RSA_MAX_PRIMES] = { NULL };
+    const BIGNUM *iqmp = NULL;
+    int i = 0;
+
+    if (crt_key == NULL ||
+        CRT_get0_components(rsa, r, d, t, &iqmp) != crt_key->num_primes ||
+        iqmp == NULL || BN_cmp(crt_key->iqmp, iqmp) != 0)
+        return 0;
+
+    for (i = 0; i < crt_key->num_primes; i++) {
+        if (r[i] == NULL || d[i] == NULL ||
+            BN_cmp(crt_key->r[i], r[i]) != 0 ||
+            BN_cmp(crt_key->d[i], d[i]) != 0 ||
+            (i >= 2 && (t[i] == NULL || BN_cmp(crt_key->t[i], t[i]) != 0)))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Reduces c modulo the modulus of mont. build_decrypt_op_buf() rejects
+ * inputs which are not below n, so when p and q have the same length
+ * c < p * q < p * R and the reduction is two Montgomery steps instead of a
+ * long division, otherwise BN_mod is used.
+ */
+static inline int
+CRT_reduce(BIGNUM *r, const BIGNUM *c, const BIGNUM *m,
+           BN_MONT_CTX *mont, int smooth, BN_CTX *ctx)
+{
+    if (smooth)
+        return BN_from_montgomery(r, c, mont, ctx) &&
+               BN_to_montgomery(r, r, mont, ctx);
+    return BN_mod(r, c, m, ctx);
+}
+
+/*
+ * Converts a BIGNUM into a zero padded pinned flat buffer of len bytes.
+ */
+static inline int
+CRT_bn_to_padded_fb(CpaFlatBuffer *fb, const BIGNUM *bn, int len)
+{
+    fb->pData = qaeCryptoMemAlloc(len, __FILE__, __LINE__);
+    if (fb->pData == NULL)
+        return 0;
+    fb->dataLenInBytes = len;
+    return BN_bn2binpad(bn, fb->pData, len) >= 0;
+}
+
+static inline int
+CRT_prepare(CpaFlatBuffer *crt_out, CpaCyRsaDecryptOpData * dec_op_data,
+             const qat_rsa_crt_key_t *crt_key, BN_CTX *ctx,
+             CpaCyLnModExpOpData *crt_op_data)
+{
+    int ret = 0;
+    int smooth = 0;
+    int i = 0, len = 0;
+    BIGNUM *c = NULL, *cr = NULL;
+    CpaCyRsaPrivateKey *cpa_prv_key = dec_op_data->pRecipientPrivateKey;
+
+    BN_CTX_start(ctx);
+
+    c = BN_CTX_get(ctx);
+    cr = BN_CTX_get(ctx);
+
+    if (cr == NULL) {
+        WARN("Failed to allocate c or cr\n");
+        QATerr(QAT_F_CRT_PREPARE, QAT_R_C_P_Q_CP_CQ_MALLOC_FAILURE);
         goto err;
     }
-    crt_op1_data->base.dataLenInBytes = rsa_len/2;
-    memset(crt_op1_data->base.pData, 0, rsa_len/2);
-    memcpy(crt_op1_data->base.pData + rsa_len/2 - BN_num_bytes(cp),
-            &cp_buf[0], BN_num_bytes(cp));
 
-    crt_op2_data->base.pData = qaeCryptoMemAlloc(rsa_len/2, __FILE__, __LINE__);
-    if (crt_op2_data->base.pData == NULL) {
-        WARN("Failure to allocate crt_op2_data->base.pData\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_OP2_BASE_PDATA_MALLOC_FAILURE);
+    if (BN_bin2bn(dec_op_data->inputData.pData,
+                  dec_op_data->inputData.dataLenInBytes, c) == NULL) {
+        WARN("Failed to convert the input to a BIGNUM\n");
+        QATerr(QAT_F_CRT_PREPARE, QAT_R_C_P_Q_CP_CQ_MALLOC_FAILURE);
         goto err;
     }
-    crt_op2_data->base.dataLenInBytes = rsa_len/2;
-    memset(crt_op2_data->base.pData, 0, rsa_len/2);
-    memcpy(crt_op2_data->base.pData + rsa_len/2 - BN_num_bytes(cq),
-            &cq_buf[0], BN_num_bytes(cq));
 
-    memcpy(&crt_op1_data->modulus,
+    smooth = (crt_key->num_primes == 2 &&
+              BN_num_bits(crt_key->p) == BN_num_bits(crt_key->q));
+
+    /*
+     * The pinned p, q, dP and dQ come from the private key. The modulus
+     * and exponent of each additional prime are converted per operation
+     * and freed in qat_rsa_decrypt_CRT().
+     */
+    memcpy(&crt_op_data[0].modulus,
             &cpa_prv_key->privateKeyRep2.prime1P,
             sizeof(cpa_prv_key->privateKeyRep2.prime1P));
-    memcpy(&crt_op2_data->modulus,
+    memcpy(&crt_op_data[1].modulus,
             &cpa_prv_key->privateKeyRep2.prime2Q,
             sizeof(cpa_prv_key->privateKeyRep2.prime2Q));
 
-    memcpy(&crt_op1_data->exponent,
+    memcpy(&crt_op_data[0].exponent,
             &cpa_prv_key->privateKeyRep2.exponent1Dp,
             sizeof(cpa_prv_key->privateKeyRep2.exponent1Dp));
 
-    memcpy(&crt_op2_data->exponent,
+    memcpy(&crt_op_data[1].exponent,
             &cpa_prv_key->privateKeyRep2.exponent2Dq,
             sizeof(cpa_prv_key->privateKeyRep2.exponent2Dq));
 
-
-    crt_out1->pData = qaeCryptoMemAlloc(rsa_len/2, __FILE__, __LINE__);
-    if (crt_out1->pData == NULL) {
-        WARN("Failure to allocate crt_out1->pData\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_OUT1_PDATA_MALLOC_FAILURE);
-        goto err;
+    for (i = 2; i < crt_key->num_primes; i++) {
+        if (qat_BN_to_FB(&crt_op_data[i].modulus, crt_key->r[i]) != 1 ||
+            qat_BN_to_FB(&crt_op_data[i].exponent, crt_key->d[i]) != 1) {
+            WARN("Failed to convert prime %d to flat buffers\n", i);
+            QATerr(QAT_F_CRT_PREPARE, QAT_R_OP1_BASE_PDATA_MALLOC_FAILURE);
+            goto err;
+        }
     }
-    crt_out1->dataLenInBytes = rsa_len/2;
-    crt_out2->pData = qaeCryptoMemAlloc(rsa_len/2, __FILE__, __LINE__);
-    if (crt_out2->pData == NULL) {
-        WARN("Failure to allocate crt_out2->pData\n");
-        QATerr(QAT_F_CRT_PREPARE, QAT_R_OUT2_PDATA_MALLOC_FAILURE);
-        goto err;
+
+    /*
+     * reduce base (c mod r_i) in advance
+     * make sure firmwre to use modulus of expected length
+     * The bases and results are sized after the primes rather than the
+     * modulus so that moduli which are not a multiple of 16 bits are
+     * handled too.
+     */
+    for (i = 0; i < crt_key->num_primes; i++) {
+        if (i == 0)
+            ret = CRT_reduce(cr, c, crt_key->p, crt_key->mont_p, smooth, ctx);
+        else if (i == 1)
+            ret = CRT_reduce(cr, c, crt_key->q, crt_key->mont_q, smooth, ctx);
+        else
+            ret = BN_mod(cr, c, crt_key->r[i], ctx);
+        if (!ret) {
+            WARN("Failed to calculate (c mod r_%d)\n", i);
+            QATerr(QAT_F_CRT_PREPARE, (i == 0) ? QAT_R_C_MODULO_P_FAILURE
+                                               : QAT_R_C_MODULO_Q_FAILURE);
+            ret = 0;
+            goto err;
+        }
+        ret = 0;
+
+        len = crt_op_data[i].modulus.dataLenInBytes;
+        if (!CRT_bn_to_padded_fb(&crt_op_data[i].base, cr, len)) {
+            WARN("Failure to set crt_op_data[%d].base\n", i);
+            QATerr(QAT_F_CRT_PREPARE, (i == 0) ? QAT_R_OP1_BASE_PDATA_MALLOC_FAILURE
+                                               : QAT_R_OP2_BASE_PDATA_MALLOC_FAILURE);
+            goto err;
+        }
+
+        crt_out[i].pData = qaeCryptoMemAlloc(len, __FILE__, __LINE__);
+        if (crt_out[i].pData == NULL) {
+            WARN("Failure to allocate crt_out[%d].pData\n", i);
+            QATerr(QAT_F_CRT_PREPARE, (i == 0) ? QAT_R_OUT1_PDATA_MALLOC_FAILURE
+                                               : QAT_R_OUT2_PDATA_MALLOC_FAILURE);
+            goto err;
+        }
+        crt_out[i].dataLenInBytes = len;
     }
-    crt_out2->dataLenInBytes = rsa_len/2;
 
     ret = 1;
 
@@ -225,56 +460,37 @@ err:
      * Normally these pinned memory allocations are
      * freed in qat_rsa_decrypt_CRT().
      */
-
-    if (cp_buf)
-        OPENSSL_free(cp_buf);
-    if (cq_buf)
-        OPENSSL_free(cq_buf);
-    if (ctx) {
-        BN_CTX_end(ctx);
-        BN_CTX_free(ctx);
-    }
+    BN_CTX_end(ctx);
     return ret;
 }
 
 static inline int
-CRT_combine(CpaFlatBuffer *crt_out1, CpaFlatBuffer *crt_out2, int rsa_len,
-             CpaFlatBuffer *output_buf, CpaCyRsaPrivateKey *cpa_prv_key)
+CRT_combine(CpaFlatBuffer *crt_out, int rsa_len,
+             CpaFlatBuffer *output_buf, const qat_rsa_crt_key_t *crt_key,
+             BN_CTX *ctx)
 {
     int ret = 0;
-    BN_CTX *ctx = NULL;
-    BIGNUM *m1 = NULL, *m2 = NULL, *p = NULL, *q = NULL;
-    BIGNUM *qinv = NULL, *tmp = NULL;
-
-    if ((ctx = BN_CTX_new()) == NULL) {
-        WARN("Failed to allocate memory for ctx\n");
-        QATerr(QAT_F_CRT_COMBINE, QAT_R_CTX_MALLOC_FAILURE);
-        goto err;
-    }
+    int i = 0;
+    BIGNUM *m1 = NULL, *m2 = NULL, *tmp = NULL;
 
     BN_CTX_start(ctx);
 
     m1 = BN_CTX_get(ctx);
     m2 = BN_CTX_get(ctx);
-    p = BN_CTX_get(ctx);
-    q = BN_CTX_get(ctx);
-    qinv = BN_CTX_get(ctx);
     tmp = BN_CTX_get(ctx);
 
     if (tmp == NULL) {
-        WARN("Failed to allocate m1, m2, p, q, qinv or tmp\n");
+        WARN("Failed to allocate m1, m2 or tmp\n");
         QATerr(QAT_F_CRT_COMBINE, QAT_R_M1_M2_P_Q_QINV_TMP_MALLOC_FAILURE);
         goto err;
     }
 
-    m1 = BN_bin2bn(crt_out1->pData, crt_out1->dataLenInBytes, m1);
-    m2 = BN_bin2bn(crt_out2->pData, crt_out2->dataLenInBytes, m2);
-    p = BN_bin2bn(cpa_prv_key->privateKeyRep2.prime1P.pData,
-                    cpa_prv_key->privateKeyRep2.prime1P.dataLenInBytes, p);
-    q = BN_bin2bn(cpa_prv_key->privateKeyRep2.prime2Q.pData,
-                    cpa_prv_key->privateKeyRep2.prime2Q.dataLenInBytes, q);
-    qinv = BN_bin2bn(cpa_prv_key->privateKeyRep2.coefficientQInv.pData,
-                    cpa_prv_key->privateKeyRep2.coefficientQInv.dataLenInBytes, qinv);
+    if (BN_bin2bn(crt_out[0].pData, crt_out[0].dataLenInBytes, m1) == NULL ||
+        BN_bin2bn(crt_out[1].pData, crt_out[1].dataLenInBytes, m2) == NULL) {
+        WARN("Failed to convert m1 or m2 to a BIGNUM\n");
+        QATerr(QAT_F_CRT_COMBINE, QAT_R_M1_M2_P_Q_QINV_TMP_MALLOC_FAILURE);
+        goto err;
+    }
 
     /* m1 - m2 */
     if (!BN_sub(m1, m1, m2)) {
@@ -282,31 +498,28 @@ CRT_combine(CpaFlatBuffer *crt_out1, CpaFlatBuffer *crt_out2, int rsa_len,
         QATerr(QAT_F_CRT_COMBINE, QAT_R_M1_DEDUCT_M2_FAILURE);
         goto err;
     }
-    /* make sure a positive result */
-    if (BN_is_negative(m1))
-        if (!BN_add(m1, m1, p)) {
+    /* make sure a positive result, m2 < q may exceed p so loop */
+    while (BN_is_negative(m1)) {
+        if (!BN_add(m1, m1, crt_key->p)) {
             WARN("Failed to adjust (m1 - m2)\n");
             QATerr(QAT_F_CRT_COMBINE, QAT_R_ADJUST_DELTA_M1_M2_FAILURE);
             goto err;
         }
-
-    /* h = qinv * (m1-m2) mod p */
-    if (!BN_mul(tmp, m1, qinv, ctx)) {
-        WARN("Failed to calculate (qinv *(m1 - m2))\n");
-        QATerr(QAT_F_CRT_COMBINE, QAT_R_MULTIPLY_QINV_FAILURE);
-        goto err;
     }
-    if (!BN_mod(m1, tmp, p, ctx)) {
+
+    /*
+     * h = qinv * (m1-m2) mod p, computed as a Montgomery product with qinv
+     * already in the Montgomery domain: (m1-m2) * qinv * R * R^-1 mod p
+     */
+    if (!BN_mod_mul_montgomery(m1, m1, crt_key->iqmp_mont, crt_key->mont_p,
+                               ctx)) {
         WARN("Failed to calculate ((qinv *(m1 - m2)) mod p)\n");
-        QATerr(QAT_F_CRT_COMBINE, QAT_R_MODULO_P_FAILURE);
+        QATerr(QAT_F_CRT_COMBINE, QAT_R_MULTIPLY_QINV_FAILURE);
         goto err;
     }
-    if (BN_is_negative(m1))
-        if (!BN_add(m1, m1, p))
-            goto err;
 
     /* h*q */
-    if (!BN_mul(tmp, m1, q, ctx)) {
+    if (!BN_mul(tmp, m1, crt_key->q, ctx)) {
         WARN("Failed to calculate (q *((qinv *(m1 - m2)) mod p))\n");
         QATerr(QAT_F_CRT_COMBINE, QAT_R_COMPUTE_H_MULTIPLY_Q_FAILURE);
         goto err;
@@ -319,34 +532,56 @@ CRT_combine(CpaFlatBuffer *crt_out1, CpaFlatBuffer *crt_out2, int rsa_len,
         goto err;
     }
 
+    /*
+     * Multi-prime: fold in each additional prime r_i, with m holding the
+     * result modulo the product pp_i of the preceding primes:
+     * m = m + pp_i * ((m_i - m) * t_i mod r_i)
+     */
+    for (i = 2; i < crt_key->num_primes; i++) {
+        if (BN_bin2bn(crt_out[i].pData, crt_out[i].dataLenInBytes, m2) == NULL ||
+            !BN_sub(tmp, m2, m1) ||
+            !BN_nnmod(tmp, tmp, crt_key->r[i], ctx) ||
+            !BN_mod_mul(tmp, tmp, crt_key->t[i], crt_key->r[i], ctx) ||
+            !BN_mul(tmp, tmp, crt_key->pp[i], ctx) ||
+            !BN_add(m1, m1, tmp)) {
+            WARN("Failed to recombine prime %d\n", i);
+            QATerr(QAT_F_CRT_COMBINE, QAT_R_ADD_M2_FAILURE);
+            goto err;
+        }
+    }
+
     /* NOTE: BN convert to Bin function will omit the most left zeros
      * which is part of RSA padding partten, we need to keep these zeros
      */
-    memset(output_buf->pData, 0, rsa_len);
-    output_buf->dataLenInBytes = BN_bn2bin(m1, &output_buf->pData[rsa_len - BN_num_bytes(m1)]);
-    output_buf->dataLenInBytes += rsa_len - BN_num_bytes(m1);
+    if (BN_bn2binpad(m1, output_buf->pData, rsa_len) < 0) {
+        WARN("Failed to convert the result to a flat buffer\n");
+        QATerr(QAT_F_CRT_COMBINE, QAT_R_ADD_M2_FAILURE);
+        goto err;
+    }
+    output_buf->dataLenInBytes = rsa_len;
 
     ret = 1;
 
 err:
-    if (ctx) {
-        BN_CTX_end(ctx);
-        BN_CTX_free(ctx);
-    }
-
+    BN_CTX_end(ctx);
     return ret;
 }
 
-int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data, int rsa_len,
-                        CpaFlatBuffer * output_buf, int * fallback)
+int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data, RSA *rsa,
+                        int rsa_len, CpaFlatBuffer * output_buf,
+                        int * fallback)
 {
-    CpaCyLnModExpOpData crt_op1_data = {{0}}, crt_op2_data = {{0}};
-    CpaFlatBuffer crt_out1 = {0}, crt_out2 = {0};
+    CpaCyLnModExpOpData crt_op_data[QAT_RSA_MAX_PRIMES] = {{{0}}};
+    CpaFlatBuffer crt_out[QAT_RSA_MAX_PRIMES] = {{0}};
     op_done_rsa_crt_t op_done;
     CpaStatus sts = CPA_STATUS_FAIL;
     int qatPerformOpRetries = 0;
     int inst_num = QAT_INVALID_INSTANCE;
-    CpaCyRsaPrivateKey *cpa_prv_key = NULL;
+    int job_ret = 0;
+    unsigned int i = 0, num_reqs = 0;
+    BN_CTX *ctx = NULL;
+    const qat_rsa_crt_key_t *crt_key = NULL;
+    qat_rsa_crt_key_t *tmp_crt_key = NULL;
 
     int iMsgRetry = getQatMsgRetryCount();
     useconds_t ulPollInterval = getQatPollInterval();
@@ -361,108 +596,104 @@ int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data, int rsa_len,
         QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, QAT_R_INPUT_PARAM_INVALID);
         return 0;
     }
-    if (qat_init_op_done_rsa_crt(&op_done) != 1) {
-        WARN("failed to init opdone for rsa crt\n");
+
+    if ((ctx = qat_get_local_bn_ctx()) == NULL) {
+        WARN("Failed to get a BN_CTX\n");
+        QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, QAT_R_CTX_MALLOC_FAILURE);
         return 0;
     }
 
-    CRYPTO_QAT_LOG("RSA - %s\n", __func__);
-
-    if ((inst_num = get_next_inst_num()) == QAT_INVALID_INSTANCE) {
-        WARN("Failure to get an instance\n");
-        if (qat_get_sw_fallback_enabled()) {
-            CRYPTO_QAT_LOG("Failed to get an instance - fallback to SW - %s\n", __func__);
-            *fallback = 1;
-        }
-        else
+    /* Use the precomputed key cached on the RSA object when available */
+    if ((crt_key = qat_rsa_get_cached_crt_key(rsa, ctx)) == NULL) {
+        if ((tmp_crt_key = qat_rsa_crt_key_new(rsa, ctx)) == NULL) {
+            WARN("Failed to precompute the CRT key\n");
             QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, ERR_R_INTERNAL_ERROR);
-        qat_cleanup_op_done_rsa_crt(&op_done);
-        return 0;
+            return 0;
+        }
+        crt_key = tmp_crt_key;
     }
+    /* One ModExp request per prime */
+    num_reqs = crt_key->num_primes;
 
-    DUMP_RSA_DECRYPT(qat_instance_handles[inst_num], &op_done, dec_op_data, output_buf);
-
-    rv = CRT_prepare(&crt_out1, &crt_out2, rsa_len, dec_op_data,
-                     &crt_op1_data, &crt_op2_data);
-    if(rv == 0) {
+    /*
+     * The on-core precomputation is done before any request is submitted,
+     * so no BN_CTX frame of the thread is held while the job is paused.
+     */
+    rv = CRT_prepare(crt_out, dec_op_data, crt_key, ctx, crt_op_data);
+    if (rv == 0) {
         WARN("failed to execute CRT_prepare\n");
         QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, ERR_R_INTERNAL_ERROR);
-        qat_cleanup_op_done_rsa_crt(&op_done);
         goto err;
     }
 
-    /* send the 1st ModExp request */
-    do {
-        sts = cpaCyLnModExp(qat_instance_handles[inst_num], qat_rsaCallbackFn_CRT, &op_done,
-                            &crt_op1_data, &crt_out1);
-        if (sts == CPA_STATUS_RETRY) {
-            usleep(ulPollInterval +
-                   (qatPerformOpRetries % QAT_RETRY_BACKOFF_MODULO_DIVISOR));
-            qatPerformOpRetries++;
-            if (iMsgRetry != QAT_INFINITE_MAX_NUM_RETRIES) {
-                if (qatPerformOpRetries >= iMsgRetry) {
-                    WARN("No. of retries exceeded max retry : %d\n", iMsgRetry);
-                    break;
-                }
-            }
-        }
+    if (qat_init_op_done_rsa_crt(&op_done, num_reqs) != 1) {
+        WARN("failed to init opdone for rsa crt\n");
+        goto err;
     }
-    while (sts == CPA_STATUS_RETRY);
 
-    if (sts != CPA_STATUS_SUCCESS) {
-        WARN("sending 1st cpaCyLnModExp failed, sts=%d.\n", sts);
-        if (qat_get_sw_fallback_enabled() && (sts == CPA_STATUS_RESTARTING || sts == CPA_STATUS_FAIL)) {
-            CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
-                           inst_num,
-                           qat_instance_details[inst_num].qat_instance_info.physInstId.packageId,
-                           __func__);
+    CRYPTO_QAT_LOG("RSA - %s\n", __func__);
+
+    if ((inst_num = get_next_inst_num()) == QAT_INVALID_INSTANCE) {
+        WARN("Failure to get an instance\n");
+        if (qat_get_sw_fallback_enabled()) {
+            CRYPTO_QAT_LOG("Failed to get an instance - fallback to SW - %s\n", __func__);
             *fallback = 1;
         }
         else
             QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, ERR_R_INTERNAL_ERROR);
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
         qat_cleanup_op_done_rsa_crt(&op_done);
         goto err;
-    } else {
-        op_done.req++;
-        if (qat_get_sw_fallback_enabled()) {
-            CRYPTO_QAT_LOG("Submit success qat inst_num %d device_id %d - %s\n",
-                           inst_num,
-                           qat_instance_details[inst_num].qat_instance_info.physInstId.packageId,
-                           __func__);
-        }
     }
 
-    /* send the 2nd ModExp request */
-    do {
-        sts = cpaCyLnModExp(qat_instance_handles[inst_num], qat_rsaCallbackFn_CRT, &op_done,
-                            &crt_op2_data, &crt_out2);
-        if (sts == CPA_STATUS_RETRY) {
-            usleep(ulPollInterval +
-                   (qatPerformOpRetries % QAT_RETRY_BACKOFF_MODULO_DIVISOR));
-            qatPerformOpRetries++;
-            if (iMsgRetry != QAT_INFINITE_MAX_NUM_RETRIES) {
-                if (qatPerformOpRetries >= iMsgRetry) {
-                    WARN("No. of retries exceeded max retry : %d\n", iMsgRetry);
-                    break;
+    DUMP_RSA_DECRYPT(qat_instance_handles[inst_num], &op_done, dec_op_data, output_buf);
+
+    /* send the ModExp requests back to back so they run in parallel */
+    for (i = 0; i < num_reqs; i++) {
+        do {
+            sts = cpaCyLnModExp(qat_instance_handles[inst_num], qat_rsaCallbackFn_CRT,
+                                &op_done, &crt_op_data[i], &crt_out[i]);
+            if (sts == CPA_STATUS_RETRY) {
+                if (op_done.opDone.job == NULL) {
+                    usleep(ulPollInterval +
+                           (qatPerformOpRetries % QAT_RETRY_BACKOFF_MODULO_DIVISOR));
+                    qatPerformOpRetries++;
+                    if (iMsgRetry != QAT_INFINITE_MAX_NUM_RETRIES) {
+                        if (qatPerformOpRetries >= iMsgRetry) {
+                            WARN("No. of retries exceeded max retry : %d\n", iMsgRetry);
+                            break;
+                        }
+                    }
+                } else {
+                    if ((qat_wake_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0) ||
+                        (qat_pause_job(op_done.opDone.job, ASYNC_STATUS_EAGAIN) == 0)) {
+                        WARN("qat_wake_job or qat_pause_job failed\n");
+                        break;
+                    }
                 }
             }
         }
-    }
-    while (sts == CPA_STATUS_RETRY);
-
-    if (sts != CPA_STATUS_SUCCESS) {
-        WARN("sending 2nd cpaCyLnModExp failed, sts=%d.\n", sts);
-        if (qat_get_sw_fallback_enabled() && (sts == CPA_STATUS_RESTARTING || sts == CPA_STATUS_FAIL)) {
-            CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
-                           inst_num,
-                           qat_instance_details[inst_num].qat_instance_info.physInstId.packageId,
-                           __func__);
-            *fallback = 1;
+        while (sts == CPA_STATUS_RETRY);
+
+        if (sts != CPA_STATUS_SUCCESS) {
+            WARN("sending cpaCyLnModExp %u failed, sts=%d.\n", i, sts);
+            if (qat_get_sw_fallback_enabled() && (sts == CPA_STATUS_RESTARTING || sts == CPA_STATUS_FAIL)) {
+                CRYPTO_QAT_LOG("Failed to submit request to qat inst_num %d device_id %d - fallback to SW - %s\n",
+                               inst_num,
+                               qat_instance_details[inst_num].qat_instance_info.physInstId.packageId,
+                               __func__);
+                *fallback = 1;
+            }
+            else
+                QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, ERR_R_INTERNAL_ERROR);
+            break;
         }
-        else
-            QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, ERR_R_INTERNAL_ERROR);
-    } else {
+
         op_done.req++;
+        if (enable_heuristic_polling) {
+            QAT_ATOMIC_INC(num_asym_requests_in_flight);
+        }
         if (qat_get_sw_fallback_enabled()) {
             CRYPTO_QAT_LOG("Submit success qat inst_num %d device_id %d - %s\n",
                            inst_num,
@@ -472,17 +703,40 @@ int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data, int rsa_len,
     }
 
     /* wait for replies */
-    do {
-        if(getEnableInlinePolling()) {
-            icp_sal_CyPollInstance(qat_instance_handles[inst_num], 0);
+    if (op_done.req == num_reqs && op_done.opDone.job != NULL) {
+        do {
+            /* If we get a failure on qat_pause_job then we will
+               not flag an error here and quit because we have
+               an asynchronous request in flight.
+               We don't want to start cleaning up data
+               structures that are still being used. If
+               qat_pause_job fails we will just yield and
+               loop around and try again until the request
+               completes and we can continue. */
+            if ((job_ret = qat_pause_job(op_done.opDone.job, ASYNC_STATUS_OK)) == 0)
+                pthread_yield();
+        } while (op_done.resp != op_done.req ||
+                 QAT_CHK_JOB_RESUMED_UNEXPECTEDLY(job_ret));
+    } else {
+        /*
+         * Sync mode, or a submission failed in which case the callback
+         * will not wake the job and the outstanding responses are polled
+         * for here before the buffers are released.
+         */
+        if (op_done.opDone.job != NULL)
+            qat_clear_async_event_notification();
+        while (op_done.resp != op_done.req) {
+            if(getEnableInlinePolling()) {
+                icp_sal_CyPollInstance(qat_instance_handles[inst_num], 0);
+            }
+            else
+                pthread_yield();
         }
-        else
-            pthread_yield();
-    } while(op_done.req != op_done.resp);
+    }
 
-    /* discard results if the 2nd request sending failed */
-    if (op_done.req != 2) {
-        WARN("failed to send 2 ModExp requests\n");
+    /* discard results if not all the requests could be sent */
+    if (op_done.req != num_reqs) {
+        WARN("failed to send %u ModExp requests\n", num_reqs);
         QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, ERR_R_INTERNAL_ERROR);
         qat_cleanup_op_done_rsa_crt(&op_done);
         goto err;
@@ -504,8 +758,7 @@ int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data, int rsa_len,
     }
 
     qat_cleanup_op_done_rsa_crt(&op_done);
-    cpa_prv_key = dec_op_data->pRecipientPrivateKey;
-    rv = CRT_combine(&crt_out1, &crt_out2, rsa_len, output_buf, cpa_prv_key);
+    rv = CRT_combine(crt_out, rsa_len, output_buf, crt_key, ctx);
     if (rv  == 0) {
         WARN("failed to execute CRT_combine\n");
         QATerr(QAT_F_QAT_RSA_DECRYPT_CRT, ERR_R_INTERNAL_ERROR);
@@ -517,10 +770,16 @@ int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data, int rsa_len,
     ret = 1;
 
 err:
-    QAT_CHK_CLNSE_QMFREE_FLATBUFF(crt_op1_data.base);
-    QAT_CHK_CLNSE_QMFREE_FLATBUFF(crt_op2_data.base);
-    QAT_CHK_CLNSE_QMFREE_FLATBUFF(crt_out1);
-    QAT_CHK_CLNSE_QMFREE_FLATBUFF(crt_out2);
+    for (i = 0; i < QAT_RSA_MAX_PRIMES; i++) {
+        QAT_CHK_CLNSE_QMFREE_FLATBUFF(crt_op_data[i].base);
+        QAT_CHK_CLNSE_QMFREE_FLATBUFF(crt_out[i]);
+        /* Only the additional primes own their modulus and exponent */
+        if (i >= 2) {
+            QAT_CHK_QMFREE_FLATBUFF(crt_op_data[i].modulus);
+            QAT_CHK_CLNSE_QMFREE_FLATBUFF(crt_op_data[i].exponent);
+        }
+    }
+    qat_rsa_crt_key_free(tmp_crt_key);
 
     DEBUG("- Finished\n");
     return ret;
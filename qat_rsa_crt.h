@@ -48,10 +48,55 @@
 #ifndef QAT_RSA_CRT_H
 # define QAT_RSA_CRT_H
 
+#include <openssl/rsa.h>
 #include "cpa.h"
 #include "cpa_types.h"
 
-int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data,
+/* Multi-prime RSA keys are only available from OpenSSL 1.1.1 */
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+# define QAT_RSA_MULTI_PRIME
+/* Matches the limit of RSA_MAX_PRIME_NUM which OpenSSL keeps internal */
+# define QAT_RSA_MAX_PRIMES 5
+#else
+# define QAT_RSA_MAX_PRIMES 2
+#endif
+
+/*
+ * On-core forms of the CRT key components used around the modular
+ * exponentiations offloaded to QAT. iqmp is held in the Montgomery domain
+ * of p so that the Garner recombination is a single Montgomery product.
+ * For multi-prime keys the primes beyond p and q are recombined in turn,
+ * each with its coefficient and the product of the preceding primes.
+ */
+typedef struct {
+    const BIGNUM *p;    /* Alias of r[0] */
+    const BIGNUM *q;    /* Alias of r[1] */
+    BIGNUM *iqmp;
+    BN_MONT_CTX *mont_p;
+    BN_MONT_CTX *mont_q;
+    BIGNUM *iqmp_mont;
+    int num_primes;
+    BIGNUM *r[QAT_RSA_MAX_PRIMES];
+    BIGNUM *d[QAT_RSA_MAX_PRIMES];
+    BIGNUM *t[QAT_RSA_MAX_PRIMES];
+    BIGNUM *pp[QAT_RSA_MAX_PRIMES];
+} qat_rsa_crt_key_t;
+
+int qat_rsa_is_multi_prime(const RSA *rsa);
+
+void qat_rsaCallbackFn_CRT(void *pCallbackTag, CpaStatus status, void *pOpData,
+                           CpaFlatBuffer * pOut);
+
+qat_rsa_crt_key_t *qat_rsa_crt_key_new(const RSA *rsa, BN_CTX *ctx);
+
+void qat_rsa_crt_key_free(qat_rsa_crt_key_t *crt_key);
+
+int qat_rsa_crt_key_matches(const qat_rsa_crt_key_t *crt_key, const RSA *rsa);
+
+/* Implemented in qat_rsa.c, returns the copy cached on the RSA object */
+const qat_rsa_crt_key_t *qat_rsa_get_cached_crt_key(RSA *rsa, BN_CTX *ctx);
+
+int qat_rsa_decrypt_CRT(CpaCyRsaDecryptOpData * dec_op_data, RSA *rsa,
                         int rsa_len, CpaFlatBuffer * output_buf,
                         int * fallback);
 